@@ -15,15 +15,19 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 #include <apertium/transfer_mult.h>
+#include <apertium/exception.h>
+#include <apertium/shell_utils.h>
 #include <lttoolbox/lt_locale.h>
 #include <apertium/apertium_config.h>
 
+#include <climits>
 #include <cstdlib>
 #include <iostream>
 #include <libgen.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include "getopt_long.h"
 #ifdef _WIN32
 #include <io.h>
 #include <fcntl.h>
@@ -33,21 +37,78 @@ using namespace std;
 
 void message(char *progname)
 {
-  cerr << "USAGE: " << basename(progname) << " preproc biltrans [input [output]]" << endl;
+  cerr << "USAGE: " << basename(progname) << " [-l] [-m n] preproc biltrans [input [output]]" << endl;
   cerr << "  preproc    result of preprocess trules file" << endl;
   cerr << "  biltrans   bilingual letter transducer file" << endl;
   cerr << "  input      input file, standard input by default" << endl;
   cerr << "  output     output file, standard output by default" << endl;
+  cerr << "  -l         write the translations of each word of a segment apart" << endl;
+  cerr << "  -m n       write at most n translations of a segment (0, no limit, by default)" << endl;
+  cerr << "  -h         shows this message" << endl;
   exit(EXIT_FAILURE);
 }
 
+unsigned long parse_number(char const *arg, unsigned long min,
+                           unsigned long max, char const *what)
+{
+  try
+  {
+    return Apertium::ShellUtils::parse_number(what, arg, min, max);
+  }
+  catch(Apertium::Exception::Shell::InvalidNumber &e)
+  {
+    cerr << "Error: " << e.what() << "." << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
 int main(int argc, char *argv[])
 {
   LtLocale::tryToSetLocale();
 
+  bool lattice = false;
+  long max_paths = 0;
+
+  int option_index=0;
+
+  while (true) {
+    static struct option long_options[] =
+    {
+      {"lattice",   no_argument, 0, 'l'},
+      {"max-paths", required_argument, 0, 'm'},
+      {"help",      no_argument, 0, 'h'},
+      {0, 0, 0, 0}
+    };
+
+    int c=getopt_long(argc, argv, "lm:h", long_options, &option_index);
+    if (c==-1)
+      break;
+
+    switch (c)
+    {
+      case 'l':
+        lattice = true;
+        break;
+
+      case 'm':
+        max_paths = parse_number(optarg, 0, UINT_MAX, "number of translations");
+        break;
+
+      case 'h':
+      default:
+        message(argv[0]);
+        break;
+    }
+  }
+
+  // the positional arguments are taken as if there were no options
+  char *progname = argv[0];
+  argc -= optind - 1;
+  argv += optind - 1;
+
   if(argc > 5 || argc <3)
   {
-    message(argv[0]);
+    message(progname);
   }
 
   for(unsigned int i = 1; i < 3; i++)
@@ -88,6 +149,8 @@ int main(int argc, char *argv[])
 
   TransferMult t;
   t.read(argv[1], argv[2]);
+  t.setLattice(lattice);
+  t.setMaxPaths(max_paths);
 
   t.transfer(input, output);
   return EXIT_SUCCESS;
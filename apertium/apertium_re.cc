@@ -17,14 +17,17 @@
 #include <apertium/apertium_re.h>
 #include <lttoolbox/compression.h>
 #include <iostream>
+#include <cctype>
 #include <cstdlib>
+#include <cstring>
 #include <apertium/string_utils.h>
 
 using namespace Apertium;
 using namespace std;
 
 ApertiumRE::ApertiumRE() :
-re(0)
+re(0),
+shape(shape_pcre)
 {
   empty = true;
 }
@@ -67,6 +70,287 @@ ApertiumRE::compile(string const &str)
   }
   
   empty = false;
+  recognise(str);
+}
+
+void
+ApertiumRE::recognise(string const &str)
+{
+  // the fixed attributes, as written by TransferData
+  shape = shape_pcre;
+  tagset.clear();
+  if(str == "^(([^<]|\"\\<\")+)")
+  {
+    shape = shape_lem;
+  }
+  else if(str == "^(([^<#]|\"\\<\"|\"\\#\")+)")
+  {
+    shape = shape_lemh;
+  }
+  else if(str == "\\#[- _][^<]+")
+  {
+    shape = shape_lemq;
+  }
+  else if(str == "(.+)")
+  {
+    shape = shape_whole;
+  }
+  else if(str == "((<[^>]+>)+)")
+  {
+    shape = shape_tags;
+  }
+  else if(str == "({([^/]+)\\/)")
+  {
+    shape = shape_chname;
+  }
+  else if(str == "(\\{.+)")
+  {
+    shape = shape_content;
+  }
+  else
+  {
+    // a 'def-attr': alternatives of literal tag sequences, <a><b>|<c>
+    string body = str;
+    if(body.size() > 2 && body[0] == '(' && body[body.size()-1] == ')')
+    {
+      body = body.substr(1, body.size() - 2);
+    }
+
+    vector<string> alternatives;
+    string current;
+    for(unsigned int i = 0; i <= body.size(); i++)
+    {
+      if(i == body.size() || body[i] == '|')
+      {
+        if(current.size() < 3 || current[0] != '<' ||
+           current[current.size()-1] != '>')
+        {
+          return;
+        }
+        alternatives.push_back(current);
+        current.clear();
+        continue;
+      }
+
+      unsigned char const c = body[i];
+      // anything PCRE could read as syntax, or fold beyond ASCII, is
+      // left to PCRE
+      if(c >= 0x80 || isspace(c) || strchr("\\^$.?*+()[]{}#", c) != NULL)
+      {
+        return;
+      }
+      current += tolower(c);
+    }
+
+    tagset.swap(alternatives);
+    shape = shape_tagset;
+  }
+}
+
+bool
+ApertiumRE::scanLemma(string const &str, size_t length, bool hash,
+                      size_t &begin, size_t &end) const
+{
+  // ^(([^<]|"\<")+), or ^(([^<#]|"\<"|"\#")+) with hash: the longest
+  // prefix made of plain characters and quoted '<' (and '#')
+  vector<bool> reach(length + 1, false);
+  reach[0] = true;
+  size_t longest = 0;
+  for(size_t i = 0; i < length; i++)
+  {
+    if(!reach[i])
+    {
+      continue;
+    }
+    char const c = str[i];
+    if(c != '<' && !(hash && c == '#'))
+    {
+      reach[i+1] = true;
+      longest = i + 1;
+    }
+    if(c == '"' && i + 2 < length && str[i+2] == '"' &&
+       (str[i+1] == '<' || (hash && str[i+1] == '#')))
+    {
+      reach[i+3] = true;
+      if(i + 3 > longest)
+      {
+        longest = i + 3;
+      }
+    }
+  }
+
+  begin = 0;
+  end = longest;
+  return longest != 0;
+}
+
+bool
+ApertiumRE::scanTagset(string const &str, size_t length,
+                       size_t &begin, size_t &end) const
+{
+  for(size_t i = 0; i < length; i++)
+  {
+    if(str[i] != '<')
+    {
+      continue;
+    }
+
+    size_t longest = 0;
+    for(unsigned int j = 0; j != tagset.size(); j++)
+    {
+      string const &alt = tagset[j];
+      if(alt.size() <= longest || alt.size() > length - i)
+      {
+        continue;
+      }
+      size_t k = 0;
+      while(k != alt.size() && tolower((unsigned char) str[i+k]) == alt[k])
+      {
+        k++;
+      }
+      if(k == alt.size())
+      {
+        longest = k;
+      }
+    }
+
+    if(longest != 0)
+    {
+      begin = i;
+      end = i + longest;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+ApertiumRE::search(string const &str, size_t length,
+                   size_t &begin, size_t &end) const
+{
+  if(empty)
+  {
+    return false;
+  }
+
+  switch(shape)
+  {
+    case shape_lem:
+      return scanLemma(str, length, false, begin, end);
+
+    case shape_lemh:
+      return scanLemma(str, length, true, begin, end);
+
+    case shape_lemq:
+      // \#[- _][^<]+
+      for(size_t i = 0; i + 2 < length; i++)
+      {
+        if(str[i] == '#' && (str[i+1] == '-' || str[i+1] == ' ' || str[i+1] == '_') &&
+           str[i+2] != '<')
+        {
+          begin = i;
+          end = i + 3;
+          while(end < length && str[end] != '<')
+          {
+            end++;
+          }
+          return true;
+        }
+      }
+      return false;
+
+    case shape_whole:
+      begin = 0;
+      end = length;
+      return length != 0;
+
+    case shape_tags:
+      // ((<[^>]+>)+)
+      for(size_t i = 0; i < length; i++)
+      {
+        if(str[i] != '<')
+        {
+          continue;
+        }
+        size_t tag_end = i;
+        size_t pos = i;
+        while(pos < length && str[pos] == '<')
+        {
+          size_t const close = str.find('>', pos + 1);
+          if(close == string::npos || close >= length || close == pos + 1)
+          {
+            break;
+          }
+          tag_end = close + 1;
+          pos = tag_end;
+        }
+        if(tag_end != i)
+        {
+          begin = i;
+          end = tag_end;
+          return true;
+        }
+      }
+      return false;
+
+    case shape_chname:
+      // ({([^/]+)\/)
+      for(size_t i = 0; i < length; i++)
+      {
+        if(str[i] == '{')
+        {
+          size_t const slash = str.find('/', i + 1);
+          if(slash == string::npos || slash >= length)
+          {
+            return false;
+          }
+          if(slash != i + 1)
+          {
+            begin = i;
+            end = slash + 1;
+            return true;
+          }
+        }
+      }
+      return false;
+
+    case shape_content:
+      // (\{.+)
+      begin = str.find('{');
+      if(begin == string::npos || begin + 1 >= length)
+      {
+        return false;
+      }
+      end = length;
+      return true;
+
+    case shape_tagset:
+      return scanTagset(str, length, begin, end);
+
+    default:
+      break;
+  }
+
+  int result[3];
+  int workspace[4096];
+  int rc = pcre_dfa_exec(re, NULL, str.c_str(), length, 0, PCRE_NO_UTF8_CHECK, result, 3, workspace, 4096);
+
+  if(rc < 0)
+  {
+    switch(rc)
+    {
+      case PCRE_ERROR_NOMATCH:
+	return false;
+
+      default:
+	wcerr << L"Error: Unknown error matching regexp (code " << rc << L")" << endl;
+	exit(EXIT_FAILURE);
+    }
+  }
+
+  begin = result[0];
+  end = result[1];
+  return true;
 }
 
 void 
@@ -99,59 +383,20 @@ ApertiumRE::write(FILE *output) const
 string
 ApertiumRE::match(string const &str) const
 {
-  if(empty)
-  {
-    return "";
-  }
-  
-  int result[3];
-  int workspace[4096];
-//  int rc = pcre_exec(re, NULL, str.c_str(), str.size(), 0, PCRE_NO_UTF8_CHECK, result, 3);
-  int rc = pcre_dfa_exec(re, NULL, str.c_str(), str.size(), 0, PCRE_NO_UTF8_CHECK, result, 3, workspace, 4096);
-
-  if(rc < 0)
+  size_t begin, end;
+  if(search(str, str.size(), begin, end))
   {
-    switch(rc)
-    {
-      case PCRE_ERROR_NOMATCH:
-	return "";
-
-      default:
-	wcerr << L"Error: Unknown error matching regexp (code " << rc << L")" << endl;
-	exit(EXIT_FAILURE);
-    }
+    return str.substr(begin, end - begin);
   }
-  
-  return str.substr(result[0], result[1]-result[0]);
+  return "";
 }
 
 void
 ApertiumRE::replace(string &str, string const &value) const
 {
-  if(empty)
+  size_t begin, end;
+  if(search(str, str.size(), begin, end))
   {
-    return;
+    str.replace(begin, end - begin, value);
   }
-  
-  int result[3];
-  int workspace[4096];
-  // int rc = pcre_exec(re, NULL, str.c_str(), str.size(), 0, PCRE_NO_UTF8_CHECK, result, 3);
-  int rc = pcre_dfa_exec(re, NULL, str.c_str(), str.size(), 0, PCRE_NO_UTF8_CHECK, result, 3, workspace, 4096);
-  if(rc < 0)
-  {
-    switch(rc)
-    {
-      case PCRE_ERROR_NOMATCH:
-	return;
-      
-      default:
-	wcerr << L"Error: Unknown error matching regexp (code " << rc << L")" << endl;
-	exit(EXIT_FAILURE);
-    }
-  }
-
-  string res = str.substr(0, result[0]);
-  res.append(value);
-  res.append(str.substr(result[1]));
-  str = res;
 }
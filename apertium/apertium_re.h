@@ -21,14 +21,39 @@
 #include <pcre.h>
 #include <cstdio>
 #include <string>
+#include <vector>
 
 using namespace std;
 
 class ApertiumRE
 {
 private:
+  /**
+   * Patterns that can be searched for without running PCRE: the fixed
+   * attributes of the transfer modules and the tag sets of 'def-attr'
+   */
+  enum Shape
+  {
+    shape_pcre,
+    shape_lem,
+    shape_lemh,
+    shape_lemq,
+    shape_whole,
+    shape_tags,
+    shape_chname,
+    shape_content,
+    shape_tagset
+  };
+
   bool empty;
   pcre *re;
+  Shape shape;
+  vector<string> tagset;
+
+  bool scanLemma(string const &str, size_t length, bool hash,
+                 size_t &begin, size_t &end) const;
+  bool scanTagset(string const &str, size_t length,
+                  size_t &begin, size_t &end) const;
 public:
   ApertiumRE();
   ~ApertiumRE();
@@ -37,6 +62,26 @@ public:
   string match(string const &str) const;
   void replace(string &str, string const &value) const;
   void compile(string const &str);
+
+  /**
+   * Tell the expression the pattern it was compiled from, so that the
+   * shapes generated by apertium-preprocess-transfer are searched for
+   * with a plain scan.  compile() does this by itself; it is needed
+   * after read().
+   * @param str the source of the regular expression
+   */
+  void recognise(string const &str);
+
+  /**
+   * Find the leftmost-longest match in the first length bytes of str
+   * @param str the string to search
+   * @param length the number of bytes of str to consider
+   * @param begin start of the match
+   * @param end end of the match
+   * @return true if there is a match
+   */
+  bool search(string const &str, size_t length,
+              size_t &begin, size_t &end) const;
 };
 
 #endif
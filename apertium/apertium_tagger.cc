@@ -32,6 +32,7 @@
 #include "stream_5_3_2_tagger_trainer.h"
 #include "stream_5_3_3_tagger.h"
 #include "stream_5_3_3_tagger_trainer.h"
+#include <apertium/parallel.h>
 #include <apertium/perceptron_tagger.h>
 #include <apertium/hmm.cc>
 #include <apertium/lswpost.h>
@@ -66,10 +67,11 @@ apertium_tagger::apertium_tagger(int &argc, char **&argv)
       FunctionTypeOption_indexptr(),
 
       TheFunctionTypeType(), TheUnigramType(), TheFunctionType(),
-      TheFunctionTypeOptionArgument(0), TheFlags() {
+      TheFunctionTypeOptionArgument(0), TheThreads(1), TheSeed(0), TheEvaluate(false),
+      TheFlags() {
   try {
     while (true) {
-      The_val = getopt_long(argc, argv, "bdfegmpr:s:t:u:wxz", longopts, &The_indexptr);
+      The_val = getopt_long(argc, argv, "bdfegj:mpr:s:t:u:wxz", longopts, &The_indexptr);
 
       if (The_val == -1)
         break;
@@ -142,6 +144,15 @@ apertium_tagger::apertium_tagger(int &argc, char **&argv)
       case 'g':
         functionTypeOptionCase(Tagger);
         break;
+      case 'j':
+        getThreadsArgument();
+        break;
+      case 'S':
+        getSeedArgument();
+        break;
+      case 'E':
+        TheEvaluate = true;
+        break;
       case 'r':
         functionTypeOptionCase(Retrain);
         getIterationsArgument();
@@ -358,6 +369,8 @@ void apertium_tagger::help() {
   options_description_.push_back(std::make_pair("-w, --sliding-window", "use the Light Sliding Window algorithm"));
   options_description_.push_back(std::make_pair("-x, --perceptron", "use the averaged perceptron algorithm"));
   options_description_.push_back(std::make_pair("-e, --skip-on-error", "with -xs, ignore certain types of errors with the training corpus"));
+  options_description_.push_back(std::make_pair("    --seed=SEED", "with -xs, shuffle the training corpus starting from SEED (0 by default)"));
+  options_description_.push_back(std::make_pair("    --evaluate", "with -xs, report the accuracy of the trained model on the training corpus"));
   align::align_(options_description_);
   std::wcerr << '\n';
   options_description_.clear();
@@ -368,6 +381,7 @@ void apertium_tagger::help() {
   options_description_.push_back(std::make_pair("-r, --retrain=ITERATIONS", "with -u: exit;\notherwise: retrain the tagger with ITERATIONS unsupervised iterations"));
   options_description_.push_back(std::make_pair("-s, --supervised=ITERATIONS", "with -u: train the tagger with a hand-tagged corpus;\nwith -w: exit;\notherwise: initialise the tagger with a hand-tagged corpus and retrain it with ITERATIONS unsupervised iterations"));
   options_description_.push_back(std::make_pair("-t, --train=ITERATIONS", "with -u: exit;\notherwise: train the tagger with ITERATIONS unsupervised iterations"));
+  options_description_.push_back(std::make_pair("-j, --threads=THREADS", "with -r, -s or -t, run the unsupervised iterations with THREADS threads;\nwith -xs, train on THREADS shards of the corpus in parallel;\nat most 256"));
   align::align_(options_description_);
   std::wcerr << '\n';
   options_description_.clear();
@@ -391,6 +405,9 @@ const struct option apertium_tagger::longopts[] = {
     {"retrain", required_argument, 0, 'r'},
     {"supervised", required_argument, 0, 's'},
     {"train", required_argument, 0, 't'},
+    {"threads", required_argument, 0, 'j'},
+    {"seed", required_argument, 0, 'S'},
+    {"evaluate", no_argument, 0, 'E'},
     {0, 0, 0, 0}};
 
 /** Utilities */
@@ -493,6 +510,32 @@ void apertium_tagger::getIterationsArgument() {
   }
 }
 
+void apertium_tagger::getSeedArgument() {
+  try {
+    TheSeed = optarg_unsigned_long("SEED");
+  } catch (const ExceptionType &ExceptionType_) {
+    std::stringstream what_;
+    what_ << "invalid argument '" << optarg << "' for '" << option_string()
+          << '\'';
+    throw Exception::apertium_tagger::InvalidArgument(what_);
+  }
+}
+
+void apertium_tagger::getThreadsArgument() {
+  try {
+    TheThreads = optarg_unsigned_long("THREADS");
+  } catch (const ExceptionType &ExceptionType_) {
+    TheThreads = 0;
+  }
+
+  if (TheThreads == 0 || TheThreads > maxThreads) {
+    std::stringstream what_;
+    what_ << "invalid argument '" << optarg << "' for '" << option_string()
+          << '\'';
+    throw Exception::apertium_tagger::InvalidArgument(what_);
+  }
+}
+
 static unsigned long parse_unsigned_long(const char *metavar, const char *val) {
   char *str_end;
   errno = 0;
@@ -555,6 +598,7 @@ void apertium_tagger::get_file_arguments(
 void apertium_tagger::init_FILE_Tagger(FILE_Tagger &FILE_Tagger_, string const &TsxFn) {
   FILE_Tagger_.deserialise(TsxFn);
   FILE_Tagger_.set_debug(TheFlags.getDebug());
+  FILE_Tagger_.set_threads(TheThreads);
   TaggerWord::setArrayTags(FILE_Tagger_.getArrayTags());
 }
 
@@ -651,6 +695,9 @@ void apertium_tagger::s_StreamTaggerTrainer(
 
     PerceptronTagger &pt = dynamic_cast<PerceptronTagger&>(StreamTaggerTrainer_);
     pt.read_spec(argv[optind + 3]);
+    pt.set_threads(TheThreads);
+    pt.set_seed(TheSeed);
+    pt.set_evaluate(TheEvaluate);
     pt.train(TaggedCorpus, UntaggedCorpus, TheFunctionTypeOptionArgument);
   } else {
     StreamTaggerTrainer_.train(TaggedCorpus);
@@ -714,6 +761,7 @@ void apertium_tagger::r_FILE_Tagger(FILE_Tagger &FILE_Tagger_) {
   try_close_file("SERIALISED_TAGGER", ProbFn, Serialised_FILE_Tagger);
 
   FILE_Tagger_.set_debug(TheFlags.getDebug());
+  FILE_Tagger_.set_threads(TheThreads);
   TaggerWord::setArrayTags(FILE_Tagger_.getArrayTags());
 
   FILE *UntaggedCorpus;
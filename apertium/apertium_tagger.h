@@ -51,6 +51,8 @@ private:
   void functionTypeOptionCase(const FunctionType &FunctionType_);
   void getCgAugmentedModeArgument();
   void getIterationsArgument();
+  void getThreadsArgument();
+  void getSeedArgument();
   unsigned long optarg_unsigned_long(const char *metavar);
   void get_file_arguments(
     bool get_crp_fn,
@@ -89,6 +91,9 @@ private:
   Optional<UnigramType> TheUnigramType;
   Optional<FunctionType> TheFunctionType;
   unsigned long TheFunctionTypeOptionArgument;
+  unsigned long TheThreads;
+  unsigned long TheSeed;
+  bool TheEvaluate;
   unsigned long CgAugmentedMode;
   basic_Tagger::Flags TheFlags;
 };
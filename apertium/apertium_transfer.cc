@@ -15,8 +15,13 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 #include <apertium/transfer.h>
+#include <apertium/transfer_parallel.h>
+#include <apertium/transfer_pipeline.h>
+#include <apertium/exception.h>
+#include <apertium/shell_utils.h>
 #include <lttoolbox/lt_locale.h>
 
+#include <climits>
 #include <cstdlib>
 #include <iostream>
 #include <libgen.h>
@@ -53,6 +58,10 @@ void message(char *progname)
   wcerr << "  -t         trace (show rule numbers and patterns matched)" << endl;
   wcerr << "  -T         trace, for apertium-transfer-tools (also sets -t)" << endl;
   wcerr << "  -z         null-flushing output on '\0'" << endl;
+  wcerr << "  -C size    bilingual lookups to cache, 0 disables (10000 by default)" << endl;
+  wcerr << "  -j n       translate with n threads" << endl;
+  wcerr << "  -I t2x,bin run interchunk with these rules in the same process" << endl;
+  wcerr << "  -P t3x,bin run postchunk with these rules in the same process" << endl;
   wcerr << "  -h         shows this message" << endl;
   
 
@@ -83,6 +92,35 @@ FILE * open_input(string const &filename)
   return input;
 }  
 
+unsigned long parse_number(char const *arg, unsigned long min,
+                           unsigned long max, char const *what)
+{
+  try
+  {
+    return ShellUtils::parse_number(what, arg, min, max);
+  }
+  catch(Exception::Shell::InvalidNumber &e)
+  {
+    wcerr << "Error: " << e.what() << "." << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+void parse_stage(char const *arg, string &rules, string &preproc)
+{
+  string const value = arg;
+  string::size_type comma = value.find(',');
+  if(comma == string::npos)
+  {
+    wcerr << "Error: expected 'rules,preproc', got '" << arg << "'." << endl;
+    exit(EXIT_FAILURE);
+  }
+  rules = value.substr(0, comma);
+  preproc = value.substr(comma + 1);
+  testfile(rules);
+  testfile(preproc);
+}
+
 FILE * open_output(string const &filename)
 {
   FILE *output = fopen(filename.c_str(), "w");
@@ -99,7 +137,17 @@ int main(int argc, char *argv[])
 {
   LtLocale::tryToSetLocale();
  
-  Transfer t;
+  bool trace = false;
+  bool trace_att = false;
+  bool pre_bilingual = false;
+  bool use_bilingual = true;
+  bool case_sensitive = false;
+  bool null_flush = false;
+  string extended;
+  bool set_cache_size = false;
+  unsigned int cache_size = 0;
+  unsigned int threads = 1;
+  string ic_rules, ic_preproc, pc_rules, pc_preproc;
 
   int option_index=0;
 
@@ -113,44 +161,64 @@ int main(int argc, char *argv[])
       {"null-flush", no_argument, 0, 'z'},
       {"trace", no_argument, 0, 't'},
       {"trace_att", no_argument, 0, 'T'},
+      {"cache-size", required_argument, 0, 'C'},
+      {"threads", required_argument, 0, 'j'},
+      {"interchunk", required_argument, 0, 'I'},
+      {"postchunk", required_argument, 0, 'P'},
       {"help", no_argument, 0, 'h'},
       {0, 0, 0, 0}
     };
 
-    int c=getopt_long(argc, argv, "nbx:cztTh", long_options, &option_index);
+    int c=getopt_long(argc, argv, "nbx:cztTC:j:I:P:h", long_options, &option_index);
     if (c==-1)
       break;
       
     switch (c)
     {
       case 'b':
-        t.setPreBilingual(true);
-        t.setUseBilingual(false);
+        pre_bilingual = true;
+        use_bilingual = false;
         break;
 
       case 'n':
-        t.setUseBilingual(false);
+        use_bilingual = false;
         break;
         
       case 'x':
-        t.setExtendedDictionary(optarg);
+        extended = optarg;
         break;
         
       case 'c':
-        t.setCaseSensitiveness(true);
+        case_sensitive = true;
         break;
       
       case 't':
-        t.setTrace(true);
+        trace = true;
         break;
       
       case 'T':
-        t.setTrace(true);
-        t.setTraceATT(true);
+        trace_att = true;
         break;
       
       case 'z':
-        t.setNullFlush(true);
+        null_flush = true;
+        break;
+
+      case 'C':
+        cache_size = parse_number(optarg, 0, UINT_MAX, "cache size");
+        set_cache_size = true;
+        break;
+
+      case 'j':
+        threads = parse_number(optarg, 1, maxThreads, "number of threads");
+        break;
+
+      case 'I':
+        parse_stage(optarg, ic_rules, ic_preproc);
+        break;
+
+      case 'P':
+        parse_stage(optarg, pc_rules, pc_preproc);
         break;
 
       case 'h':
@@ -160,7 +228,15 @@ int main(int argc, char *argv[])
     }    
   }
 
+  bool const pipeline = ic_rules != "" || pc_rules != "";
+  if(pipeline && threads > 1)
+  {
+    wcerr << "Error: -I and -P can't be used with -j." << endl;
+    exit(EXIT_FAILURE);
+  }
+
   FILE *input = stdin, *output = stdout;
+  string trules, preproc, biltrans;
 
   switch(argc - optind + 1)
   {
@@ -170,17 +246,20 @@ int main(int argc, char *argv[])
       testfile(argv[argc-3]);
       testfile(argv[argc-4]);
       testfile(argv[argc-5]);
-      t.read(argv[argc-5], argv[argc-4], argv[argc-3]);
+      trules = argv[argc-5];
+      preproc = argv[argc-4];
+      biltrans = argv[argc-3];
       break;
       
     case 5:
-      if(t.getUseBilingual() == false || t.getPreBilingual() == true)
+      if(use_bilingual == false || pre_bilingual == true)
       {
         output = open_output(argv[argc-1]);
         input = open_input(argv[argc-2]);
         testfile(argv[argc-3]);
         testfile(argv[argc-4]);
-        t.read(argv[argc-4], argv[argc-3]);
+        trules = argv[argc-4];
+        preproc = argv[argc-3];
       }
       else
       {
@@ -188,32 +267,38 @@ int main(int argc, char *argv[])
         testfile(argv[argc-2]);
         testfile(argv[argc-3]);
         testfile(argv[argc-4]);
-        t.read(argv[argc-4], argv[argc-3], argv[argc-2]);
+        trules = argv[argc-4];
+        preproc = argv[argc-3];
+        biltrans = argv[argc-2];
       }
       break;
       
     case 4:
-      if(t.getUseBilingual() == false || t.getPreBilingual() == true)
+      if(use_bilingual == false || pre_bilingual == true)
       {
         input = open_input(argv[argc-1]);
         testfile(argv[argc-2]);
         testfile(argv[argc-3]);
-        t.read(argv[argc-3], argv[argc-2]);
+        trules = argv[argc-3];
+        preproc = argv[argc-2];
       }
       else
       {
         testfile(argv[argc-1]);
         testfile(argv[argc-2]);
         testfile(argv[argc-3]);
-        t.read(argv[argc-3], argv[argc-2], argv[argc-1]);
+        trules = argv[argc-3];
+        preproc = argv[argc-2];
+        biltrans = argv[argc-1];
       }
       break;
     case 3:
-      if(t.getUseBilingual() == false || t.getPreBilingual() == true)
+      if(use_bilingual == false || pre_bilingual == true)
       {
         testfile(argv[argc-1]);
         testfile(argv[argc-2]);
-        t.read(argv[argc-2], argv[argc-1]);
+        trules = argv[argc-2];
+        preproc = argv[argc-1];
       }
       else
       {
@@ -227,10 +312,89 @@ int main(int argc, char *argv[])
   }  
   
 #ifdef _MSC_VER
-  _setmode(_fileno(input), _O_U8TEXT);
-  _setmode(_fileno(output), _O_U8TEXT);
-#endif 
+  // transfer reads and writes UTF-8 bytes itself; interchunk and
+  // postchunk write wide characters
+  _setmode(_fileno(input), _O_BINARY);
+  _setmode(_fileno(output), pipeline ? _O_U8TEXT : _O_BINARY);
+#endif
+
+  Transfer *t = new Transfer();
+  t->setPreBilingual(pre_bilingual);
+  t->setUseBilingual(use_bilingual);
+  if(extended != "")
+  {
+    t->setExtendedDictionary(extended);
+  }
+  t->setCaseSensitiveness(case_sensitive);
+  t->setTrace(trace || trace_att);
+  t->setTraceATT(trace_att);
+  if(set_cache_size)
+  {
+    t->setBiltransCacheSize(cache_size);
+  }
+  t->read(trules, preproc, biltrans);
+
+  // one chunker per thread; they share the rules and dictionaries of the
+  // first one
+  vector<Transfer *> workers(threads);
+  workers[0] = t;
+  for(unsigned int i = 1; i != workers.size(); i++)
+  {
+    workers[i] = t->makeWorker();
+  }
+
+  if(pipeline)
+  {
+    Interchunk *ic = NULL;
+    Postchunk *pc = NULL;
+    if(ic_rules != "")
+    {
+      ic = new Interchunk();
+      ic->setTrace(trace);
+      ic->read(ic_rules, ic_preproc);
+    }
+    if(pc_rules != "")
+    {
+      pc = new Postchunk();
+      pc->setTrace(trace);
+      pc->read(pc_rules, pc_preproc);
+    }
 
-  t.transfer(input, output);
+    TransferPipeline tpl(*workers[0], ic, pc);
+    tpl.setNullFlush(null_flush);
+    tpl.run(input, output);
+
+    delete ic;
+    delete pc;
+  }
+  else if(workers.size() == 1)
+  {
+    workers[0]->setNullFlush(null_flush);
+    workers[0]->transfer(input, output);
+  }
+  else
+  {
+    TransferParallel tp(workers);
+    tp.setNullFlush(null_flush);
+    tp.transfer(input, output);
+  }
+
+  if(trace)
+  {
+    unsigned long hits = 0, misses = 0;
+    for(unsigned int i = 0; i != workers.size(); i++)
+    {
+      hits += workers[i]->getBiltransCacheHits();
+      misses += workers[i]->getBiltransCacheMisses();
+    }
+    wcerr << L"Bilingual cache: " << hits << L" hits, ";
+    wcerr << misses << L" misses" << endl;
+  }
+
+  // the first chunker owns what the others share
+  for(unsigned int i = workers.size(); i-- != 0;)
+  {
+    delete workers[i];
+  }
   return EXIT_SUCCESS; 
 }
@@ -79,14 +79,20 @@ void basic_StreamTagger::tag(const LexicalUnit &LexicalUnit_,
   Optional<Analysis> TheAnalysis;
 
   if (!LexicalUnit_.TheAnalyses.empty()) {
-    TheAnalysis = *LexicalUnit_.TheAnalyses.begin();
+    std::vector<Analysis>::const_iterator TheAnalysis_ =
+        LexicalUnit_.TheAnalyses.begin();
+    long double TheScore = score(*TheAnalysis_);
     for (std::vector<Analysis>::const_iterator Analysis_ =
              LexicalUnit_.TheAnalyses.begin() + 1;
          // Call .end() each iteration to save memory.
          Analysis_ != LexicalUnit_.TheAnalyses.end(); ++Analysis_) {
-      if (score(*Analysis_) > score(*TheAnalysis))
-        TheAnalysis = *Analysis_;
+      long double const Score = score(*Analysis_);
+      if (Score > TheScore) {
+        TheAnalysis_ = Analysis_;
+        TheScore = Score;
+      }
     }
+    TheAnalysis = *TheAnalysis_;
   }
 
   outputLexicalUnit(LexicalUnit_, TheAnalysis, Output);
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/biltrans_cache.h>
+
+using namespace std;
+
+BiltransCache::BiltransCache(unsigned int capacity) :
+capacity(capacity),
+hits(0),
+misses(0)
+{
+}
+
+void
+BiltransCache::setCapacity(unsigned int capacity)
+{
+  this->capacity = capacity;
+  while(entries.size() > capacity)
+  {
+    index.erase(entries.back().source);
+    entries.pop_back();
+  }
+}
+
+unsigned int
+BiltransCache::getCapacity() const
+{
+  return capacity;
+}
+
+bool
+BiltransCache::find(string const &source, string &target, int &queue)
+{
+  map<string, list<Entry>::iterator>::iterator it = index.find(source);
+  if(it == index.end())
+  {
+    misses++;
+    return false;
+  }
+
+  hits++;
+  entries.splice(entries.begin(), entries, it->second);
+  target = it->second->target;
+  queue = it->second->queue;
+  return true;
+}
+
+void
+BiltransCache::insert(string const &source, string const &target, int queue)
+{
+  if(capacity == 0 || index.find(source) != index.end())
+  {
+    return;
+  }
+
+  if(entries.size() == capacity)
+  {
+    // recycle the least recently used entry
+    index.erase(entries.back().source);
+    entries.splice(entries.begin(), entries, --entries.end());
+  }
+  else
+  {
+    entries.push_front(Entry());
+  }
+
+  Entry &e = entries.front();
+  e.source = source;
+  e.target = target;
+  e.queue = queue;
+  index[source] = entries.begin();
+}
+
+unsigned long
+BiltransCache::getHits() const
+{
+  return hits;
+}
+
+unsigned long
+BiltransCache::getMisses() const
+{
+  return misses;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _BILTRANSCACHE_
+#define _BILTRANSCACHE_
+
+#include <list>
+#include <map>
+#include <string>
+
+using namespace std;
+
+/**
+ * Least recently used cache of bilingual dictionary lookups, keyed by the
+ * source analysis, so that frequent words only go through the bilingual
+ * transducer once
+ */
+class BiltransCache
+{
+private:
+  struct Entry
+  {
+    string source;
+    string target;
+    int queue;
+  };
+
+  /**
+   * Entries, most recently used first
+   */
+  list<Entry> entries;
+
+  /**
+   * Position of each source analysis in entries
+   */
+  map<string, list<Entry>::iterator> index;
+
+  /**
+   * Maximum number of entries, 0 disables the cache
+   */
+  unsigned int capacity;
+
+  unsigned long hits;
+  unsigned long misses;
+
+  BiltransCache(BiltransCache const &o);
+  BiltransCache & operator =(BiltransCache const &o);
+public:
+  /**
+   * Empty cache
+   * @param capacity maximum number of entries
+   */
+  BiltransCache(unsigned int capacity = 10000);
+
+  /**
+   * Change the maximum number of entries, discarding the least recently
+   * used ones if needed
+   * @param capacity maximum number of entries, 0 disables the cache
+   */
+  void setCapacity(unsigned int capacity);
+  unsigned int getCapacity() const;
+
+  /**
+   * Look up a source analysis, counting a hit or a miss
+   * @param source the source analysis
+   * @param target set to the translation on a hit
+   * @param queue set to the queue length on a hit
+   * @return true on a hit
+   */
+  bool find(string const &source, string &target, int &queue);
+
+  /**
+   * Store the translation of a source analysis that find() missed
+   * @param source the source analysis
+   * @param target its translation
+   * @param queue its queue length
+   */
+  void insert(string const &source, string const &target, int queue);
+
+  unsigned long getHits() const;
+  unsigned long getMisses() const;
+};
+
+#endif
@@ -20,8 +20,15 @@
 #include <apertium/serialiser.h>
 #include <apertium/deserialiser.h>
 
+#include <climits>
+
 using namespace Apertium;
 
+static unsigned int const posting_bits = sizeof(unsigned long) * CHAR_BIT;
+
+/** Bound on the number of find_superset results kept */
+static size_t const max_supersets = 4096;
+
 int
 Collection::size()
 {
@@ -31,32 +38,110 @@ Collection::size()
 bool 
 Collection::has_not(const set<int> &t)
 {
-  return index.find(t) == index.end();
+  return find(TagBitset(t)) == -1;
+}
+
+int
+Collection::find(const TagBitset &t)
+{
+  return index.find(bits, t, t.hash());
 }
 
 const set<int> &
 Collection::operator[](int n)
 {
-  return *element[n];
+  return element[n];
 }
 
-int &
+int
 Collection::operator[](const set<int> &t)
 {
-  if(has_not(t))
+  TagBitset const t_bits(t);
+  unsigned int const t_hash = t_bits.hash();
+  int n = index.find(bits, t_bits, t_hash);
+  if(n == -1)
   {
-    index[t] = index.size()-1;
-    element.push_back(&(index.find(t)->first));
+    n = index.push_back(t_hash);
+    element.push_back(t);
+    bits.push_back(t_bits);
+
+    for(set<int>::const_iterator it = t.begin(); it != t.end(); it++)
+    {
+      if(*it < 0)
+      {
+        continue;
+      }
+      if(postings.size() <= (size_t)*it)
+      {
+        postings.resize(*it + 1);
+      }
+      vector<unsigned long> &posting = postings[*it];
+      posting.resize(n / posting_bits + 1, 0);
+      posting[n / posting_bits] |= 1UL << (n % posting_bits);
+    }
+    supersets.clear();
   }
-  return index[t];
+  return n;
 }
 
-int &
+int
 Collection::add(const set<int> &t)
 {
   return (*this)[t];
 }
 
+int
+Collection::find_superset(const set<int> &t)
+{
+  map<set<int>, int>::const_iterator memo = supersets.find(t);
+  if(memo != supersets.end())
+  {
+    return memo->second;
+  }
+
+  // the elements that contain every integer of t
+  size_t const words = (element.size() + posting_bits - 1) / posting_bits;
+  vector<unsigned long> candidates(words, ~0UL);
+  if(element.size() % posting_bits != 0)
+  {
+    candidates[words - 1] = (1UL << (element.size() % posting_bits)) - 1;
+  }
+  for(set<int>::const_iterator it = t.begin(); it != t.end(); it++)
+  {
+    if(*it < 0 || (size_t)*it >= postings.size())
+    {
+      candidates.assign(words, 0);
+      break;
+    }
+    vector<unsigned long> const &posting = postings[*it];
+    for(size_t w = 0; w != words; w++)
+    {
+      candidates[w] &= w < posting.size() ? posting[w] : 0;
+    }
+  }
+
+  int superset = -1;
+  for(size_t w = 0; w != words; w++)
+  {
+    unsigned long bits = candidates[w];
+    for(size_t n = w * posting_bits; bits != 0; n++, bits >>= 1)
+    {
+      if((bits & 1) &&
+         (superset == -1 || element[n].size() < element[superset].size()))
+      {
+        superset = n;
+      }
+    }
+  }
+
+  if(supersets.size() >= max_supersets)
+  {
+    supersets.clear();
+  }
+  supersets[t] = superset;
+  return superset;
+}
+
 void
 Collection::write(FILE *output)
 {
@@ -64,9 +149,9 @@ Collection::write(FILE *output)
 
   for(int i = 0, limit = element.size(); i != limit; i++)
   {
-    Compression::multibyte_write(element[i]->size(), output);
-    for(set<int>::const_iterator it = element[i]->begin(), 
-	  limit2 = element[i]->end(); it != limit2; it++)
+    Compression::multibyte_write(element[i].size(), output);
+    for(set<int>::const_iterator it = element[i].begin(), 
+	  limit2 = element[i].end(); it != limit2; it++)
     {
       Compression::multibyte_write(*it, output);
     }
@@ -95,7 +180,7 @@ Collection::serialise(std::ostream &serialised) const
 {
   Serialiser<size_t>::serialise(element.size(), serialised);
   for (size_t i = 0; i < element.size(); i++) {
-    Serialiser<set<int> >::serialise(*element[i], serialised);
+    Serialiser<set<int> >::serialise(element[i], serialised);
   }
 }
 
@@ -18,18 +18,39 @@
 #define __COLLECTION_H
 
 #include <cstdio>
+#include <deque>
 #include <map>
 #include <set>
 #include <vector>
 
+#include <apertium/hash_index.h>
+#include <apertium/tag_bitset.h>
+
 using namespace std;
 
 /** Collection
- *  Is an indexed set.
+ *  Is an indexed set of sets of non-negative integers.  The positions of
+ *  the elements are found through a hash index of their bitsets, so a
+ *  lookup hashes the element once and only compares bitsets on a hash
+ *  match.
  */ 
 class Collection {
-  map <set<int>, int> index;
-  vector <const set<int> *> element;
+  /** The elements by position; a deque, so that references to them stay
+   *  valid as elements are added
+   */
+  deque <set<int> > element;
+  /** The elements as bitsets, by position, and their hash index
+   */
+  vector <TagBitset> bits;
+  HashIndex index;
+  /** For each integer, a bitset of the positions of the elements that
+   *  contain it
+   */
+  vector<vector<unsigned long> > postings;
+  /** Results of find_superset since the last element was added
+   */
+  map <set<int>, int> supersets;
+
 public:
   /** Returns the collection's size. 
    */
@@ -42,6 +63,12 @@ public:
    */
   bool has_not (const set<int>& t);
 
+  /** Looks an element up by its bitset, without building a set.
+   *  @param t element as a bitset
+   *  @return the position of t, or -1 if t is not in the collection
+   */
+  int find (const TagBitset& t);
+
   /** @param n position in the collection
    *  @return the element at the n-th position
    */
@@ -52,12 +79,19 @@ public:
    *  @param t an element @return
    *  the position in which t appears in the collection.
    */
-  int& operator[] (const set<int>& t);
+  int operator[] (const set<int>& t);
 
   /** Adds an element to the collection
    *  @param t the element to be added
    */  
-  int& add(const set<int>& t);
+  int add(const set<int>& t);
+
+  /** Finds the smallest element that includes the one received as a
+   *  parameter; of several elements that small, the first one.
+   *  @param t an element
+   *  @return the position of the superset, or -1 if there is none
+   */
+  int find_superset(const set<int>& t);
 
   /** 
    *  Write the collection contents to an output stream
@@ -43,6 +43,7 @@ EXCEPTION(UnexpectedFileArgumentCount)
 EXCEPTION(StreamOpenError)
 EXCEPTION(FopenError)
 EXCEPTION(FcloseError)
+EXCEPTION(InvalidNumber)
 }
 
 namespace apertium_tagger {
@@ -4,6 +4,7 @@
 #include <apertium/serialiser.h>
 #include <algorithm>
 #include <iterator>
+#include <map>
 #include <vector>
 
 namespace Apertium {
@@ -20,10 +21,10 @@ bool CompareFeatureKey::operator() (FeatureKey const& lhs, FeatureKey const& rhs
   return lhs.size() < rhs.size();
 }
 
-FeatureVec::FeatureVec() : data() {}
+FeatureVec::FeatureVec() {}
 
 template <typename Container>
-FeatureVec::FeatureVec(Container &container) : data()
+FeatureVec::FeatureVec(Container &container)
 {
   init(container.begin(), container.end());
 }
@@ -31,12 +32,58 @@ FeatureVec::FeatureVec(Container &container) : data()
 template
 FeatureVec::FeatureVec(UnaryFeatureVec &ufv);
 
+template
+FeatureVec::FeatureVec(const UnaryFeatureVec &ufv);
+
 template <typename Iter>
-FeatureVec::FeatureVec(Iter first, Iter last) : data()
+FeatureVec::FeatureVec(Iter first, Iter last)
 {
   init(first, last);
 }
 
+unsigned int
+FeatureVec::hash(const FeatureKey &key)
+{
+  // FNV-1a over the strings, each one followed by a separator so that
+  // ["ab", "c"] and ["a", "bc"] differ
+  unsigned int value = HashIndex::basis;
+  for (FeatureKey::const_iterator it = key.begin(); it != key.end(); it++) {
+    for (std::string::const_iterator c = it->begin(); c != it->end(); c++) {
+      value = HashIndex::mix(value, (unsigned char)*c);
+    }
+    value = HashIndex::mix(value, 0xffU);
+  }
+  return value;
+}
+
+int
+FeatureVec::find(const FeatureKey &key) const
+{
+  return index.find(keys, key, hash(key));
+}
+
+int
+FeatureVec::intern(const FeatureKey &key)
+{
+  unsigned int key_hash = hash(key);
+  int id = index.find(keys, key, key_hash);
+  if (id != -1) {
+    return id;
+  }
+  id = index.push_back(key_hash);
+  keys.push_back(key);
+  values.push_back(0.0L);
+  return id;
+}
+
+void
+FeatureVec::clear()
+{
+  keys.clear();
+  values.clear();
+  index.clear();
+}
+
 FeatureVec&
 FeatureVec::operator+=(const UnaryFeatureVec &other)
 {
@@ -46,7 +93,10 @@ FeatureVec::operator+=(const UnaryFeatureVec &other)
 FeatureVec&
 FeatureVec::operator+=(const FeatureVec &other)
 {
-  return inPlaceAdd(other.data.begin(), other.data.end());
+  for (size_t id = 0; id < other.keys.size(); id++) {
+    add(other.keys[id], other.values[id]);
+  }
+  return *this;
 }
 
 FeatureVec&
@@ -55,20 +105,45 @@ FeatureVec::operator-=(const UnaryFeatureVec &other)
   return inPlaceSubtract(other.begin(), other.end());
 }
 
+FeatureVec&
+FeatureVec::operator-=(const FeatureVec &other)
+{
+  for (size_t id = 0; id < other.keys.size(); id++) {
+    add(other.keys[id], -other.values[id]);
+  }
+  return *this;
+}
+
+namespace {
+struct CompareFeatureIds {
+  const std::vector<FeatureKey> &keys;
+  CompareFeatureIds(const std::vector<FeatureKey> &keys) : keys(keys) {}
+  bool operator() (size_t lhs, size_t rhs) const {
+    return CompareFeatureKey()(keys[lhs], keys[rhs]);
+  }
+};
+}
+
 template <typename OStream>
 OStream&
 operator<<(OStream & out, FeatureVec const &fv) {
-  FeatureVec::Map::const_iterator feat_it = fv.data.begin();
-  for (; feat_it != fv.data.end(); feat_it++) {
-    FeatureKey::const_iterator bc_it = feat_it->first.begin();
+  // print in key order, whatever the order of the ids
+  std::vector<size_t> order(fv.keys.size());
+  for (size_t id = 0; id < order.size(); id++) {
+    order[id] = id;
+  }
+  std::sort(order.begin(), order.end(), CompareFeatureIds(fv.keys));
+  for (size_t i = 0; i < order.size(); i++) {
+    const FeatureKey &key = fv.keys[order[i]];
+    FeatureKey::const_iterator bc_it = key.begin();
     out << std::dec << (int)(*(bc_it++))[0] << "; ";
-    for (;bc_it != feat_it->first.end(); bc_it++) {
+    for (;bc_it != key.end(); bc_it++) {
       out << bc_it->c_str();
-      if (bc_it + 1 != feat_it->first.end()) {
+      if (bc_it + 1 != key.end()) {
         out << ", ";
       }
     }
-    out << ": " << feat_it->second << "\n";
+    out << ": " << fv.values[order[i]] << "\n";
   }
   return out;
 }
@@ -79,20 +154,14 @@ operator<<(std::wostream& out, FeatureVec const &fv);
 template std::ostream&
 operator<<(std::ostream& out, FeatureVec const &fv);
 
-FeatureVec&
-FeatureVec::operator-=(const FeatureVec &other)
-{
-  return inPlaceSubtract(other.data.begin(), other.data.end());
-}
-
 double FeatureVec::operator*(const UnaryFeatureVec &other) const
 {
   double result = 0.0L;
   UnaryFeatureVec::const_iterator other_it;
   for (other_it = other.begin(); other_it != other.end(); other_it++) {
-    Map::const_iterator fv_it = data.find(*other_it);
-    if (fv_it != data.end()) {
-      result += fv_it->second;
+    int id = find(*other_it);
+    if (id != -1) {
+      result += values[id];
     }
   }
   return result;
@@ -100,29 +169,32 @@ double FeatureVec::operator*(const UnaryFeatureVec &other) const
 
 double FeatureVec::operator*(const FeatureVec &other) const
 {
-  // This is O(N) in the size of the largest vector.
-  // With a hash table we would have O(n) in the size of the smaller vector.
-  double result = 0.0L;
-  FeatureVec::Map::const_iterator il = data.begin();
-  FeatureVec::Map::const_iterator ir = other.data.begin();
-  while (il != data.end() && ir != other.data.end()) {
-    if (il->first < ir->first) {
-      ++il;
-    } else if (ir->first < il->first) {
-      ++ir;
-    } else {
-      result += il->second * ir->second;
-      ++il;
-      ++ir;
+  // Look up the features of the smaller vector in the larger one
+  if (other.size() > size()) {
+    return other * *this;
+  }
+  std::vector<size_t> shared;
+  for (size_t id = 0; id < other.keys.size(); id++) {
+    if (index.find(keys, other.keys[id], other.index.hash(id)) != -1) {
+      shared.push_back(id);
     }
   }
+  // sum in key order, as the merge over two sorted maps did, so that the
+  // rounding doesn't depend on the order the features were first seen in
+  std::sort(shared.begin(), shared.end(), CompareFeatureIds(other.keys));
+  double result = 0.0L;
+  for (size_t i = 0; i < shared.size(); i++) {
+    size_t id = shared[i];
+    int this_id = index.find(keys, other.keys[id], other.index.hash(id));
+    result += values[this_id] * other.values[id];
+  }
   return result;
 }
 
 size_t
 FeatureVec::size() const
 {
-  return data.size();
+  return keys.size();
 };
 
 template <typename Iter>
@@ -130,60 +202,29 @@ void
 FeatureVec::init(Iter first, Iter last)
 {
   for (;first!=last;first++) {
-    data.insert(initPair(*first));
+    add(*first, 1.0L);
   }
 }
 
-FeatureVec::Pair
-FeatureVec::initPair(const FeatureVec::Pair &pair)
-{
-  return pair;
-}
-
-FeatureVec::Pair
-FeatureVec::initPair(const FeatureKey &key)
-{
-  return make_pair(key, 1.0L);
-}
-
-FeatureVec::FeatOp::FeatOp(FeatureVec::Map &data)
-  : data(data) {}
-
-FeatureVec::AddFeat::AddFeat(FeatureVec::Map &data)
-  : FeatOp(data) {}
-
-FeatureVec::SubFeat::SubFeat(FeatureVec::Map &data)
-  : FeatOp(data) {}
-
-void
-FeatureVec::AddFeat::operator()(const FeatureKey &feat)
-{
-  data[feat] += 1.0L;
-}
-
 void
-FeatureVec::AddFeat::operator()(const FeatureVec::Pair &feat_val)
+FeatureVec::add(const FeatureKey &feat, double value)
 {
-  data[feat_val.first] += feat_val.second;
+  values[intern(feat)] += value;
 }
 
 void
-FeatureVec::SubFeat::operator()(const FeatureKey &feat)
+FeatureVec::add(const FeatureVec::Pair &feat_val, double sign)
 {
-  data[feat] -= 1.0L;
-}
-
-void
-FeatureVec::SubFeat::operator()(const FeatureVec::Pair &feat_val)
-{
-  data[feat_val.first] -= feat_val.second;
+  values[intern(feat_val.first)] += sign * feat_val.second;
 }
 
 template <typename Iter>
 FeatureVec&
 FeatureVec::inPlaceAdd(Iter first, Iter last)
 {
-  for_each(first, last, AddFeat(data));
+  for (; first != last; first++) {
+    add(*first, 1.0L);
+  }
   return *this;
 }
 
@@ -191,16 +232,73 @@ template <typename Iter>
 FeatureVec&
 FeatureVec::inPlaceSubtract(Iter first, Iter last)
 {
-  for_each(first, last, SubFeat(data));
+  for (; first != last; first++) {
+    add(*first, -1.0L);
+  }
   return *this;
 }
 
+// Marker starting the compact format; the old format started with the
+// number of features instead
+static const size_t compact_format = (size_t)-1;
+
 void FeatureVec::serialise(std::ostream &serialised) const {
-  Serialiser<FeatureVec::Map>::serialise(data, serialised);
+  // Each distinct string is stored once, and every feature as the ids
+  // of its strings followed by its weight
+  std::vector<std::string> strings;
+  std::map<std::string, size_t> string_ids;
+  std::vector<size_t> key_ids;
+  for (size_t id = 0; id < keys.size(); id++) {
+    key_ids.push_back(keys[id].size());
+    for (FeatureKey::const_iterator it = keys[id].begin(); it != keys[id].end(); it++) {
+      std::map<std::string, size_t>::iterator si = string_ids.find(*it);
+      if (si == string_ids.end()) {
+        si = string_ids.insert(make_pair(*it, strings.size())).first;
+        strings.push_back(*it);
+      }
+      key_ids.push_back(si->second);
+    }
+  }
+
+  Serialiser<size_t>::serialise(compact_format, serialised);
+  Serialiser<std::vector<std::string> >::serialise(strings, serialised);
+  Serialiser<std::vector<size_t> >::serialise(key_ids, serialised);
+  Serialiser<std::vector<double> >::serialise(values, serialised);
 }
 
 void FeatureVec::deserialise(std::istream &serialised) {
-  data = Deserialiser<FeatureVec::Map>::deserialise(serialised);
+  clear();
+  size_t header = Deserialiser<size_t>::deserialise(serialised);
+  if (header != compact_format) {
+    // std::map<FeatureKey, double> written by earlier versions
+    for (size_t i = 0; i < header; i++) {
+      FeatureKey key = Deserialiser<FeatureKey>::deserialise(serialised);
+      double value = Deserialiser<double>::deserialise(serialised);
+      add(key, value);
+    }
+    return;
+  }
+
+  std::vector<std::string> strings =
+    Deserialiser<std::vector<std::string> >::deserialise(serialised);
+  std::vector<size_t> key_ids =
+    Deserialiser<std::vector<size_t> >::deserialise(serialised);
+  std::vector<double> key_values =
+    Deserialiser<std::vector<double> >::deserialise(serialised);
+
+  FeatureKey key;
+  for (size_t pos = 0, id = 0; pos < key_ids.size(); id++) {
+    size_t len = key_ids[pos++];
+    if (pos + len > key_ids.size() || id >= key_values.size()) {
+      throw Exception::Deserialiser::not_Stream_good(
+          "can't deserialise feature vector: ids out of range");
+    }
+    key.resize(len);
+    for (size_t i = 0; i < len; i++) {
+      key[i] = strings.at(key_ids[pos++]);
+    }
+    add(key, key_values[id]);
+  }
 }
 
 }
@@ -1,12 +1,13 @@
 #ifndef _FEATURE_VEC_H
 #define _FEATURE_VEC_H
 
-#include <map>
 #include <vector>
 #include <string>
 #include <utility>
 #include <iostream>
 
+#include <apertium/hash_index.h>
+
 namespace Apertium {
 
 typedef std::vector<std::string> FeatureKey;
@@ -15,12 +16,17 @@ struct CompareFeatureKey {
 };
 typedef std::vector<FeatureKey> UnaryFeatureVec;
 
+/**
+ * Sparse feature vector.  Every feature key gets a dense id when it is
+ * first seen, and the ids are found through a hash index of the keys, so
+ * a lookup hashes the key once and only compares strings
+ * on a hash match.
+ */
 class FeatureVec
 {
   friend class FeatureVecAverager;
   friend class PerceptronTagger;
 public:
-  typedef std::map<FeatureKey, double, CompareFeatureKey> Map;
   typedef std::pair<FeatureKey, double> Pair;
   FeatureVec();
   template <typename Container> FeatureVec(Container &container);
@@ -35,24 +41,18 @@ public:
   size_t size() const;
   template <typename OStream> friend OStream& operator<<(OStream & out, FeatureVec const &fv);
 private:
-  static Pair initPair(const Pair &pair);
-  static Pair initPair(const FeatureKey &key);
-  Map data;
+  std::vector<FeatureKey> keys;
+  std::vector<double> values;
+  HashIndex index;
+
+  static unsigned int hash(const FeatureKey &key);
+  int find(const FeatureKey &key) const;
+  int intern(const FeatureKey &key);
+  void clear();
+
   template <typename Iter> void init(Iter first, Iter last);
-  struct FeatOp {
-    FeatOp(Map &data);
-    Map &data;
-  };
-  struct AddFeat : FeatOp {
-    AddFeat(Map &data);
-    void operator() (const FeatureKey &feat);
-    void operator() (const Pair &feat_val);
-  };
-  struct SubFeat : FeatOp {
-    SubFeat(Map &data);
-    void operator() (const FeatureKey &feat);
-    void operator() (const Pair &feat_val);
-  };
+  void add(const FeatureKey &feat, double value);
+  void add(const Pair &feat_val, double sign);
   template <typename Iter> FeatureVec& inPlaceAdd(Iter first, Iter last);
   template <typename Iter> FeatureVec& inPlaceSubtract(Iter first, Iter last);
 public:
@@ -3,22 +3,27 @@
 namespace Apertium {
 
 FeatureVecAverager::FeatureVecAverager(FeatureVec &weights)
-  : weights(weights), iterations(0) {}
+  : tstamps(weights.size(), 0), totals(weights.size(), 0.0L),
+    weights(weights), iterations(0) {}
 
 void
 FeatureVecAverager::incIteration() {
   iterations++;
 }
 
-inline void FeatureVecAverager::updateTotal(const FeatureKey &fk) {
-  totals[fk] += (iterations - tstamps[fk]) * weights.data[fk];
+inline void FeatureVecAverager::updateTotal(size_t id) {
+  if (id >= totals.size()) {
+    totals.resize(weights.size(), 0.0L);
+    tstamps.resize(weights.size(), 0);
+  }
+  totals[id] += (iterations - tstamps[id]) * weights.values[id];
 }
 
 inline void FeatureVecAverager::updateTotalsTimestamps(const FeatureVec &other) {
-  FeatureVec::Map::const_iterator other_it;
-  for (other_it = other.data.begin(); other_it != other.data.end(); other_it++) {
-    updateTotal(other_it->first);
-    tstamps[other_it->first] = iterations;
+  for (size_t other_id = 0; other_id < other.keys.size(); other_id++) {
+    size_t id = weights.intern(other.keys[other_id]);
+    updateTotal(id);
+    tstamps[id] = iterations;
   }
 }
 
@@ -38,16 +43,34 @@ FeatureVecAverager::operator-=(const FeatureVec &other) {
 
 void
 FeatureVecAverager::average() {
-  FeatureVec::Map::iterator weights_it;
-  for (weights_it = weights.data.begin();
-       weights_it != weights.data.end(); weights_it++) {
-    const FeatureKey &fk = weights_it->first;
-    updateTotal(fk);
-    if (totals[fk] == 0) {
-      weights.data.erase(weights_it);
-    } else {
-      weights_it->second = totals[fk] / iterations;
+  // features whose total is zero are dropped, so the averaged weights get
+  // new ids
+  FeatureVec averaged;
+  for (size_t id = 0; id < weights.size(); id++) {
+    updateTotal(id);
+    if (totals[id] != 0) {
+      averaged.add(weights.keys[id], totals[id] / iterations);
+    }
+  }
+  weights = averaged;
+  totals.assign(weights.size(), 0.0L);
+  tstamps.assign(weights.size(), 0);
+}
+
+void
+FeatureVecAverager::addTotals(FeatureVec &sums) {
+  for (size_t id = 0; id < weights.size(); id++) {
+    updateTotal(id);
+    tstamps[id] = iterations;
+    if (totals[id] != 0) {
+      sums.add(weights.keys[id], totals[id]);
     }
+    totals[id] = 0;
   }
 }
+
+unsigned int
+FeatureVecAverager::getIterations() const {
+  return iterations;
+}
 }
@@ -5,12 +5,13 @@
 
 namespace Apertium {
 class FeatureVecAverager {
-std::map<FeatureKey, unsigned int> tstamps;
-std::map<FeatureKey, double> totals;
+// indexed by the ids of the features in weights
+std::vector<unsigned int> tstamps;
+std::vector<double> totals;
 FeatureVec& weights;
 unsigned int iterations;
 
-inline void updateTotal(const FeatureKey &fk);
+inline void updateTotal(size_t id);
 inline void updateTotalsTimestamps(const FeatureVec &other);
 
 public:
@@ -19,6 +20,12 @@ void incIteration();
 FeatureVecAverager& operator+=(const FeatureVec &other);
 FeatureVecAverager& operator-=(const FeatureVec &other);
 void average();
+/**
+ * Add the weights summed over every update so far to sums, so that the
+ * averages of several averagers can be combined.
+ */
+void addTotals(FeatureVec &sums);
+unsigned int getIterations() const;
 };
 }
 
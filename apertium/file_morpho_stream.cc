@@ -71,11 +71,7 @@ FileMorphoStream::get_next_word()
     
     if(word->isAmbiguous())
     {
-      vector<wstring> &ref = td->getDiscardRules();
-      for(unsigned int i = 0; i < ref.size(); i++)
-      {
-        word->discardOnAmbiguity(ref[i]);
-      }
+      word->discardOnAmbiguity(td->getDiscardPatterns());
     }
 //    cout << *word << endl;
     return word;
@@ -95,7 +91,7 @@ FileMorphoStream::get_next_word()
     if(feof(input) || (null_flush && symbol == L'\0'))
     {
       end_of_file = true;
-      vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferRules());
+      vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferPatterns());
       return get_next_word();
     }
     if(symbol == L'^')
@@ -125,7 +121,7 @@ FileMorphoStream::get_next_word()
 	{
 	  end_of_file = true;
 	  vwords[ivwords]->add_ignored_string(str);
-          vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferRules());
+          vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferPatterns());
 	  return get_next_word();
 	}
 	else if(symbol == L'\\')
@@ -136,7 +132,7 @@ FileMorphoStream::get_next_word()
 	  {
 	    end_of_file = true;
 	    vwords[ivwords]->add_ignored_string(str);
-            vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferRules());
+            vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferPatterns());
 	    return get_next_word();
 	  }
 	  str += static_cast<wchar_t>(symbol);
@@ -217,7 +213,7 @@ FileMorphoStream::lrlmClassify(wstring const &str, int &ivwords)
       {
         vwords[ivwords]->add_tag(last_type, 
                                  str.substr(floor, last_pos - floor + 1),
-                                 td->getPreferRules());
+                                 td->getPreferPatterns());
 	if(str[last_pos+1] == L'+' && last_pos+1 < limit )
 	{	
 	  floor = last_pos + 1;
@@ -237,7 +233,7 @@ FileMorphoStream::lrlmClassify(wstring const &str, int &ivwords)
 	  wcerr<<L"Warning: There is not coarse tag for the fine tag '"<< str.substr(floor) <<L"'\n";
           wcerr<<L"         This is because of an incomplete tagset definition or a dictionary error\n";
 	}
-        vwords[ivwords]->add_tag(ca_tag_kundef, str.substr(floor) , td->getPreferRules());
+        vwords[ivwords]->add_tag(ca_tag_kundef, str.substr(floor) , td->getPreferPatterns());
 	return;
       }
     }
@@ -249,7 +245,7 @@ FileMorphoStream::lrlmClassify(wstring const &str, int &ivwords)
 	{
 	  vwords[ivwords]->add_tag(last_type, 
                                    str.substr(floor, last_pos - floor + 1),
-                                   td->getPreferRules());
+                                   td->getPreferPatterns());
           if(str[last_pos+1] == L'+' && last_pos+1 < limit )
           {	
             floor = last_pos + 1;
@@ -269,7 +265,7 @@ FileMorphoStream::lrlmClassify(wstring const &str, int &ivwords)
 	    wcerr<<L"Warning: There is not coarse tag for the fine tag '"<< str.substr(floor) <<L"'\n";
             wcerr<<L"         This is because of an incomplete tagset definition or a dictionary error\n";
 	  }
-          vwords[ivwords]->add_tag(ca_tag_kundef, str.substr(floor) , td->getPreferRules());
+          vwords[ivwords]->add_tag(ca_tag_kundef, str.substr(floor) , td->getPreferPatterns());
 	  return;
         }
       }
@@ -287,7 +283,7 @@ FileMorphoStream::lrlmClassify(wstring const &str, int &ivwords)
     }
 
   }    
-  vwords[ivwords]->add_tag(val, str.substr(floor), td->getPreferRules());
+  vwords[ivwords]->add_tag(val, str.substr(floor), td->getPreferPatterns());
 }
 
 void
@@ -309,7 +305,7 @@ FileMorphoStream::readRestOfWord(int &ivwords)
         wcerr<<L"Word being read: "<<vwords[ivwords]->get_superficial_form()<<L"\n";
         wcerr<<L"Debug: "<< str <<L"\n";
       }
-      vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferRules());
+      vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferPatterns());
       return;
     }
     else if(symbol == L'\\')
@@ -351,7 +347,7 @@ FileMorphoStream::readRestOfWord(int &ivwords)
         wcerr<<L"Word being read: "<<vwords[ivwords]->get_superficial_form()<<L"\n";
         wcerr<<L"Debug: "<< str <<L"\n";
       }
-      vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferRules());
+      vwords[ivwords]->add_tag(ca_tag_keof, L"", td->getPreferPatterns());
       return;
     }
     else if(symbol == L'\\')
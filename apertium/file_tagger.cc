@@ -24,7 +24,8 @@
 #include <cstdio>
 
 namespace Apertium {
-FILE_Tagger::FILE_Tagger() : debug(false), show_sf(false), null_flush(false) {}
+FILE_Tagger::FILE_Tagger()
+    : debug(false), show_sf(false), null_flush(false), threads(1) {}
 
 FILE_Tagger::~FILE_Tagger() {}
 
@@ -38,6 +39,10 @@ void FILE_Tagger::setNullFlush(const bool &NullFlush) {
   null_flush = NullFlush;
 }
 
+void FILE_Tagger::set_threads(const unsigned int &Threads) {
+  threads = Threads;
+}
+
 void FILE_Tagger::tagger(FILE *Input, FILE *Output, const bool &First) {
   FileMorphoStream morpho_stream(Input, debug, &get_tagger_data());
 
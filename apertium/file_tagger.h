@@ -32,6 +32,10 @@ public:
   void set_debug(const bool &Debug);
   void set_show_sf(const bool &ShowSuperficial);
   void setNullFlush(const bool &NullFlush);
+
+  /** Number of threads used for unsupervised training
+   */
+  void set_threads(const unsigned int &Threads);
   virtual void tagger(FILE *Input, FILE *Output, const bool &First = false);
   virtual void tagger(MorphoStream &morpho_stream, FILE *Output,
                       const bool &First = false) = 0;
@@ -65,6 +69,7 @@ protected:
   bool debug;
   bool show_sf;
   bool null_flush;
+  unsigned int threads;
 };
 }
 
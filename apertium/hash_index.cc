@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/hash_index.h>
+
+using namespace std;
+
+unsigned int const HashIndex::basis = 2166136261U;
+
+void
+HashIndex::place(int n)
+{
+  size_t const mask = slots.size() - 1;
+  size_t slot = hashes[n] & mask;
+  while(slots[slot] != -1)
+  {
+    slot = (slot + 1) & mask;
+  }
+  slots[slot] = n;
+}
+
+int
+HashIndex::push_back(unsigned int item_hash)
+{
+  int const n = hashes.size();
+  hashes.push_back(item_hash);
+  if(2 * hashes.size() > slots.size())
+  {
+    slots.assign(slots.empty() ? 16 : 2 * slots.size(), -1);
+    for(int i = 0; i <= n; i++)
+    {
+      place(i);
+    }
+  }
+  else
+  {
+    place(n);
+  }
+  return n;
+}
+
+void
+HashIndex::clear()
+{
+  hashes.clear();
+  slots.clear();
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _HASH_INDEX_
+#define _HASH_INDEX_
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Open addressing hash table of the positions of items that the owner
+ * keeps in a sequence of its own, with FNV-1a to hash them.  A lookup
+ * probes by hash and compares items only on a hash match.  The table
+ * size is a power of two at least twice the number of items.
+ */
+class HashIndex
+{
+private:
+  /** The hash of each item, by position */
+  vector<unsigned int> hashes;
+  /** Positions, -1 for empty slots */
+  vector<int> slots;
+
+  void place(int n);
+public:
+  /** The FNV-1a offset basis, what hashing starts from */
+  static unsigned int const basis;
+
+  /**
+   * @param value the hash so far
+   * @param datum the next byte or integer of the item
+   * @return value with datum folded in
+   */
+  static unsigned int mix(unsigned int value, unsigned int datum)
+  {
+    return (value ^ datum) * 16777619U;
+  }
+
+  /**
+   * @param items the indexed items, by position
+   * @param item the item to look for
+   * @param item_hash its hash
+   * @return the position of item, or -1 if it is not indexed
+   */
+  template <typename Items, typename Item>
+  int find(Items const &items, Item const &item, unsigned int item_hash) const
+  {
+    if(slots.empty())
+    {
+      return -1;
+    }
+    size_t const mask = slots.size() - 1;
+    for(size_t slot = item_hash & mask;; slot = (slot + 1) & mask)
+    {
+      int const n = slots[slot];
+      if(n == -1)
+      {
+        return -1;
+      }
+      if(hashes[n] == item_hash && items[n] == item)
+      {
+        return n;
+      }
+    }
+  }
+
+  /**
+   * Index the item at the next position; the owner appends the item
+   * itself
+   * @param item_hash the hash of the item
+   * @return its position, the number of items indexed before
+   */
+  int push_back(unsigned int item_hash);
+
+  /**
+   * @param n a position
+   * @return the hash of the item at position n
+   */
+  unsigned int hash(int n) const
+  {
+    return hashes[n];
+  }
+
+  void clear();
+};
+
+#endif
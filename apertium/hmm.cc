@@ -31,8 +31,11 @@
 #include <unistd.h>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <apertium/string_utils.h>
 #include <apertium/file_morpho_stream.h>
+#include <apertium/parallel.h>
 
 inline bool p_isnan(double v) {
 #if __cplusplus >= 201103L
@@ -194,16 +197,19 @@ HMM::init_probabilities_kupiec(MorphoStream &lexmorfo)
   while((word)) {
     if (++nw%10000==0) wcerr<<L'.'<<flush; 
     
-    tags=word->get_tags();
+    k2 = find_ambiguity_class(tdhmm, *word);
+    if (k2 == -1) {
+      tags=word->get_tags();
 
-    if (tags.size()==0) { //This is an unknown word
-      tags = tdhmm.getOpenClass();
-    }
-    else {
-      require_ambiguity_class(tdhmm, tags, *word, nw);
-    }
+      if (tags.size()==0) { //This is an unknown word
+        tags = tdhmm.getOpenClass();
+      }
+      else {
+        require_ambiguity_class(tdhmm, tags, *word, nw);
+      }
 
-    k2=output[tags];
+      k2=output[tags];
+    }
 
     classes_ocurrences[k1]++;
     classes_pair_ocurrences[k1][k2]++;  //k1 followed by k2
@@ -441,145 +447,301 @@ HMM::filter_ambiguity_classes(FILE *in, FILE *out) {
   }
 }
 
+namespace {
+
+/**
+ * Expected counts gathered by the expectation step of Baum-Welch, as dense
+ * matrices
+ */
+struct BaumWelchCounts {
+  vector<double> xsi;   // N x N, xsi[j*N + i] for the transition j -> i
+  vector<double> phi;   // N x M
+  vector<double> gamma; // N
+  double loli;
+
+  BaumWelchCounts(int N, int M) :
+    xsi(N*N, 0), phi(N*M, 0), gamma(N, 0), loli(0) {}
+};
+
+/**
+ * Expectation step over a batch of the corpus.  The corpus is split at
+ * unambiguous words, which cut the forward-backward computation into
+ * independent segments; every worker takes a contiguous share of them and
+ * adds to counts of its own, so that the result only depends on the
+ * number of threads.
+ */
+class BaumWelchTask : public ParallelTask {
+private:
+  int N, M;
+  double const * const *a;
+  double const * const *b;
+  vector<vector<TTag> > const &class_tags;
+
+  vector<TTag> start_tags;
+  vector<size_t> starts;     // first word of each segment, in classes
+  vector<int> classes;       // ambiguity class of every word
+
+  vector<size_t> shards;     // first segment of each worker, and the end
+  vector<BaumWelchCounts *> counts;
+  vector<vector<double> > alphas, betas;
+
+  void expect(size_t segment, unsigned int thread);
+public:
+  BaumWelchTask(int N, int M, double const * const *a,
+                double const * const *b,
+                vector<vector<TTag> > const &class_tags,
+                unsigned int num_threads) :
+    N(N), M(M), a(a), b(b), class_tags(class_tags),
+    shards(num_threads + 1), counts(num_threads),
+    alphas(num_threads), betas(num_threads * 2) {
+    for (unsigned int i = 0; i < num_threads; i++) {
+      counts[i] = new BaumWelchCounts(N, M);
+    }
+  }
+
+  ~BaumWelchTask() {
+    for (unsigned int i = 0; i < counts.size(); i++) {
+      delete counts[i];
+    }
+  }
+
+  /** Start a segment after an unambiguous word with tag 'tag' */
+  void startSegment(TTag tag) {
+    start_tags.push_back(tag);
+    starts.push_back(classes.size());
+  }
+
+  void addWord(int k) {
+    classes.push_back(k);
+  }
+
+  /** Drop the words of the segment left open */
+  void dropOpenSegment() {
+    classes.resize(starts.back());
+    start_tags.pop_back();
+    starts.pop_back();
+  }
+
+  size_t size() const {
+    return classes.size();
+  }
+
+  /** Run the expectation step over the complete segments read so far */
+  void runBatch() {
+    size_t const num_segments = starts.size();
+    starts.push_back(classes.size());
+
+    // equal shares of words, cut at segment boundaries
+    unsigned int const num_threads = counts.size();
+    size_t segment = 0;
+    for (unsigned int i = 0; i < num_threads; i++) {
+      shards[i] = segment;
+      size_t const goal = classes.size() * (i + 1) / num_threads;
+      while (segment < num_segments && starts[segment + 1] <= goal) {
+        segment++;
+      }
+    }
+    shards[num_threads] = num_segments;
+
+    runParallel(*this, num_threads);
+
+    start_tags.clear();
+    starts.clear();
+    classes.clear();
+  }
+
+  void run(unsigned int thread) {
+    for (size_t i = shards[thread]; i < shards[thread + 1]; i++) {
+      expect(i, thread);
+    }
+  }
+
+  /** Add the counts of every worker to the first one's, and return it */
+  BaumWelchCounts & reduce() {
+    BaumWelchCounts &total = *counts[0];
+    for (unsigned int t = 1; t < counts.size(); t++) {
+      BaumWelchCounts const &c = *counts[t];
+      for (size_t i = 0; i < total.xsi.size(); i++) {
+        total.xsi[i] += c.xsi[i];
+      }
+      for (size_t i = 0; i < total.phi.size(); i++) {
+        total.phi[i] += c.phi[i];
+      }
+      for (size_t i = 0; i < total.gamma.size(); i++) {
+        total.gamma[i] += c.gamma[i];
+      }
+      total.loli += c.loli;
+    }
+    return total;
+  }
+};
+
+void
+BaumWelchTask::expect(size_t segment, unsigned int thread) {
+  BaumWelchCounts &c = *counts[thread];
+  int const *ks = &classes[starts[segment]];
+  size_t const len = starts[segment + 1] - starts[segment];
+  TTag const start_tag = start_tags[segment];
+
+  // alpha[off[p] + n] is the forward probability of the n-th tag of the
+  // word at position p; position 0 is the unambiguous word before
+  vector<size_t> off(len + 2);
+  off[0] = 0;
+  off[1] = 1;
+  for (size_t p = 1; p <= len; p++) {
+    off[p + 1] = off[p] + class_tags[ks[p - 1]].size();
+  }
+  vector<double> &alpha = alphas[thread];
+  alpha.assign(off[len + 1], 0);
+  alpha[0] = 1;
+
+  //Forward probabilities
+  for (size_t p = 1; p <= len; p++) {
+    int const k = ks[p - 1];
+    vector<TTag> const &tags = class_tags[k];
+    TTag const *pretags = p == 1 ? &start_tag : &class_tags[ks[p - 2]][0];
+    size_t const npre = p == 1 ? 1 : class_tags[ks[p - 2]].size();
+    double const *prev = &alpha[off[p - 1]];
+    double *cur = &alpha[off[p]];
+
+    for (size_t n = 0; n < tags.size(); n++) {
+      int const i = tags[n];
+      for (size_t m = 0; m < npre; m++) {
+        cur[n] += prev[m]*a[pretags[m]][i]*b[i][k];
+      }
+      if (cur[n] == 0) {
+        cur[n] = DBL_MIN;
+      }
+    }
+  }
+
+  double const prob = alpha[off[len]];
+  c.loli -= log(prob);
+
+  vector<double> &beta = betas[2*thread];
+  vector<double> &prebeta = betas[2*thread + 1];
+  beta.assign(1, 1);
+
+  for (size_t p = len; p > 0; p--) {  // loop from T-1 to 0
+    int const k = ks[p - 1];
+    vector<TTag> const &tags = class_tags[k];
+    TTag const *pretags = p == 1 ? &start_tag : &class_tags[ks[p - 2]][0];
+    size_t const npre = p == 1 ? 1 : class_tags[ks[p - 2]].size();
+    double const *prev = &alpha[off[p - 1]];
+    double const *cur = &alpha[off[p]];
+    prebeta.assign(npre, 0);
+
+    for (size_t n = 0; n < tags.size(); n++) {
+      int const i = tags[n];
+      for (size_t m = 0; m < npre; m++) {
+        int const j = pretags[m];
+        prebeta[m] += a[j][i]*b[i][k]*beta[n];
+        c.xsi[j*N + i] += prev[m]*a[j][i]*b[i][k]*beta[n]/prob;
+      }
+      double &gamma = c.gamma[i];
+      double previous_value = gamma;
+
+      gamma += cur[n]*beta[n]/prob;
+      if (p_isnan(gamma)) {
+        wcerr<<L"NAN(3) gamma["<<i<<L"] = "<<gamma<<L" alpha["<<p<<L"]["<<i<<L"]= "<<cur[n]
+             <<L" beta["<<i<<L"] = "<<beta[n]<<L" prob = "<<prob<<L" previous gamma = "<<previous_value<<L"\n";
+        exit(1);
+      }
+      if (p_isinf(gamma)) {
+        wcerr<<L"INF(3) gamma["<<i<<L"] = "<<gamma<<L" alpha["<<p<<L"]["<<i<<L"]= "<<cur[n]
+             <<L" beta["<<i<<L"] = "<<beta[n]<<L" prob = "<<prob<<L" previous gamma = "<<previous_value<<L"\n";
+        exit(1);
+      }
+      if (gamma == 0) {
+        gamma = DBL_MIN;
+      }
+      c.phi[i*M + k] += cur[n]*beta[n]/prob;
+    }
+    beta.swap(prebeta);
+  }
+}
+
+/**
+ * Words read before the expectation step is run on them
+ */
+size_t const BAUM_WELCH_BATCH = 1 << 20;
+
+}
+
 void
 HMM::train(MorphoStream &morpho_stream) {
-  int i, j, k, t, len, nw = 0;
+  int i, j, k, nw = 0;
   TaggerWord *word=NULL;
   TTag tag; 
-  set<TTag> tags, pretags;
-  set<TTag>::iterator itag, jtag;
-  map <int, double> gamma;
-  map <int, double>::iterator jt, kt;
-  map < int, map <int, double> > alpha, beta, xsi, phi;
-  map < int, map <int, double> >::iterator it;
-  double prob, loli;              
-  vector < set<TTag> > pending;
+  set<TTag> tags;
+  int pending = 1;
   Collection &output = tdhmm.getOutput();
-  
+  int N = tdhmm.getN();
+  int M = tdhmm.getM();
+
+  vector<vector<TTag> > class_tags(M);
+  for (k = 0; k < M; k++) {
+    class_tags[k].assign(output[k].begin(), output[k].end());
+  }
+
+  BaumWelchTask task(N, M, tdhmm.getA(), tdhmm.getB(), class_tags,
+                     threads);
+
   int ndesconocidas=0;
-  // alpha => forward probabilities
-  // beta  => backward probabilities
 
-  loli = 0;
   tag = eos;
-  tags.clear();
-  tags.insert(tag);
-  pending.push_back(tags);
-
-  alpha[0].clear();      
-  alpha[0][tag] = 1;
+  task.startSegment(tag);
 
   word = morpho_stream.get_next_word();
 
   while (word) {   
-
-    //wcerr<<L"Enter para continuar\n";
-    //getchar();
-
     if (++nw%10000==0) wcerr<<L'.'<<flush;
 
-    //wcerr<<*word<<L"\n";
-
-    pretags = pending.back();
-
-    tags = word->get_tags();    
-    
-    if (tags.size()==0) { // This is an unknown word
-      tags = tdhmm.getOpenClass();
+    if (word->get_tags().empty()) { // This is an unknown word
       ndesconocidas++;
     }
 
-    require_ambiguity_class(tdhmm, tags, *word, nw);
-    
-    k = output[tags];    
-    len = pending.size();
-    alpha[len].clear();     
-      
-    //Forward probabilities
-    for (itag=tags.begin(); itag!=tags.end(); itag++) {
-      i=*itag;
-      for (jtag=pretags.begin(); jtag!=pretags.end(); jtag++) {
-         j=*jtag;
-         //wcerr<<"previous alpha["<<len<<"]["<<i<<"]="<<alpha[len][i]<<"\n";
-	 //wcerr<<"alpha["<<len-1<<"]["<<j<<"]="<<alpha[len-1][j]<<"\n";
-         //wcerr<<"a["<<j<<"]["<<i<<"]="<<a[j][i]<<"\n";
-         //wcerr<<"b["<<i<<"]["<<k<<"]="<<b[i][k]<<"\n";
-	 alpha[len][i] += alpha[len-1][j]*(tdhmm.getA())[j][i]*(tdhmm.getB())[i][k];
+    k = find_ambiguity_class(tdhmm, *word);
+    if (k == -1) {
+      tags = word->get_tags();
+      if (tags.size()==0) {
+        tags = tdhmm.getOpenClass();
       }
-      if (alpha[len][i]==0)
-        alpha[len][i]=DBL_MIN;
-      //wcerr<<"alpha["<<len<<"]["<<i<<"]="<<alpha[len][i]<<"\n--------\n";
+      require_ambiguity_class(tdhmm, tags, *word, nw);
+      k = output[tags];
     }
+    
+    task.addWord(k);
 
-    if (tags.size()>1) {
-      pending.push_back(tags);
+    if (output[k].size()>1) {
+      pending++;
     } else {  // word is unambiguous
-      tag = *tags.begin(); 
-      beta[0].clear();
-      beta[0][tag] = 1;   
-      
-      prob = alpha[len][tag];
-      
-      //wcerr<<"prob="<<prob<<"\n";
-      //wcerr<<"alpha["<<len<<"]["<<tag<<"]="<<alpha[len][tag]<<"\n";
-      loli -= log(prob);  
-      
-      for (t=0; t<len; t++) {  // loop from T-1 to 0	
-	  pretags = pending.back();
-	  pending.pop_back();
-   	  k = output[tags];
-	     beta[1-t%2].clear();
-	     for (itag=tags.begin(); itag!=tags.end(); itag++) {
-	       i=*itag;
-	       for (jtag=pretags.begin(); jtag!=pretags.end(); jtag++) {
-	         j = *jtag;	      
-	         beta[1-t%2][j] += (tdhmm.getA())[j][i]*(tdhmm.getB())[i][k]*beta[t%2][i];
-	         xsi[j][i] += alpha[len-t-1][j]*(tdhmm.getA())[j][i]*(tdhmm.getB())[i][k]*beta[t%2][i]/prob;
-	       }
-	       double previous_value = gamma[i];
-       
-	       gamma[i] +=  alpha[len-t][i]*beta[t%2][i]/prob;		       
-	       if (p_isnan(gamma[i])) {
-	          wcerr<<L"NAN(3) gamma["<<i<<L"] = "<<gamma[i]<<L" alpha["<<len-t<<L"]["<<i<<L"]= "<<alpha[len-t][i]
-	               <<L" beta["<<t%2<<L"]["<<i<<L"] = "<<beta[t%2][i]<<L" prob = "<<prob<<L" previous gamma = "<<previous_value<<L"\n";
-	          exit(1);	               
-	       }
-	       if (p_isinf(gamma[i])) {
-	          wcerr<<L"INF(3) gamma["<<i<<L"] = "<<gamma[i]<<L" alpha["<<len-t<<L"]["<<i<<L"]= "<<alpha[len-t][i]
-	               <<L" beta["<<t%2<<L"]["<<i<<L"] = "<<beta[t%2][i]<<L" prob = "<<prob<<L" previous gamma = "<<previous_value<<L"\n";
-	          exit(1);	               
-	       }
-	       if (gamma[i]==0) {
-	          //cout<<"ZERO(3) gamma["<<i<<"] = "<<gamma[i]<<" alpha["<<len-t<<"]["<<i<<"]= "<<alpha[len-t][i]
-	          //    <<" beta["<<t%2<<"]["<<i<<"] = "<<beta[t%2][i]<<" prob = "<<prob<<" previous gamma = "<<previous_value<<"\n";
-	          gamma[i]=DBL_MIN;
-	          //exit(1);	               
-	       }
-	        phi[i][k] += alpha[len-t][i]*beta[t%2][i]/prob;
-	     }
-	     tags=pretags;
+      tag = *output[k].begin(); 
+      pending = 1;
+      if (task.size() >= BAUM_WELCH_BATCH) {
+        task.runBatch();
       }
-	
-      tags.clear();
-      tags.insert(tag);
-      pending.push_back(tags);
-      alpha[0].clear();
-      alpha[0][tag] = 1;
+      task.startSegment(tag);
     }
     
     delete word; 
     word = morpho_stream.get_next_word();
   }  
 
-  if ((pending.size()>1) || ((tag!=eos)&&(tag != (tdhmm.getTagIndex())[L"TAG_kEOF"]))) {
+  task.dropOpenSegment();
+  task.runBatch();
+
+  if ((pending>1) || ((tag!=eos)&&(tag != (tdhmm.getTagIndex())[L"TAG_kEOF"]))) {
     wcerr << L"Warning: The last tag is not the end-of-sentence-tag "
           << L"but rather " << tdhmm.getArrayTags()[tag] << L". Line: " << nw
-	  << L". Pending: " << pending.size() << ". Tags: ";
+	  << L". Pending: " << pending << ". Tags: ";
     wcerr << "\n";
   }
   
-  int N = tdhmm.getN();
-  int M = tdhmm.getM();
+  BaumWelchCounts &counts = task.reduce();
+  vector<double> &xsi = counts.xsi;
+  vector<double> &phi = counts.phi;
+  vector<double> &gamma = counts.gamma;
   
   //Clean previous values  
   for(i=0; i<N; i++) {
@@ -590,55 +752,43 @@ HMM::train(MorphoStream &morpho_stream) {
   }
   
   // new parameters
-  for (it=xsi.begin(); it!=xsi.end(); it++) {
-    i = it->first;
-    for (jt=xsi[i].begin(); jt!=xsi[i].end(); jt++) {
-      j = jt->first;
-      if (xsi[i][j]>0) {        
+  for (i=0; i<N; i++) {
+    for (j=0; j<N; j++) {
+      if (xsi[i*N+j]>0) {        
         if (gamma[i]==0) {
           wcerr<<L"Warning: gamma["<<i<<L"]=0\n";
           gamma[i]=DBL_MIN;
         }
         
-        (tdhmm.getA())[i][j] = xsi[i][j]/gamma[i];
+        (tdhmm.getA())[i][j] = xsi[i*N+j]/gamma[i];
 	
         if (p_isnan((tdhmm.getA())[i][j])) {
           wcerr<<L"NAN\n";
-          wcerr <<L"Error: BW - NAN(1) a["<<i<<L"]["<<j<<L"]="<<(tdhmm.getA())[i][j]<<L"\txsi["<<i<<L"]["<<j<<L"]="<<xsi[i][j]<<L"\tgamma["<<i<<L"]="<<gamma[i]<<L"\n";
+          wcerr <<L"Error: BW - NAN(1) a["<<i<<L"]["<<j<<L"]="<<(tdhmm.getA())[i][j]<<L"\txsi["<<i<<L"]["<<j<<L"]="<<xsi[i*N+j]<<L"\tgamma["<<i<<L"]="<<gamma[i]<<L"\n";
 	  exit(1);
         }
 	if (p_isinf((tdhmm.getA())[i][j])) {
 	  wcerr<<L"INF\n"; 
-          wcerr <<L"Error: BW - INF(1) a["<<i<<L"]["<<j<<L"]="<<(tdhmm.getA())[i][j]<<L"\txsi["<<i<<L"]["<<j<<L"]="<<xsi[i][j]<<L"\tgamma["<<i<<L"]="<<gamma[i]<<L"\n";
+          wcerr <<L"Error: BW - INF(1) a["<<i<<L"]["<<j<<L"]="<<(tdhmm.getA())[i][j]<<L"\txsi["<<i<<L"]["<<j<<L"]="<<xsi[i*N+j]<<L"\tgamma["<<i<<L"]="<<gamma[i]<<L"\n";
           exit(1);
         }
-	if ((tdhmm.getA())[i][j]==0) {
-          //wcerr <<"Error: BW - ZERO(1) a["<<i<<"]["<<j<<"]="<<(tdhmm.getA())[i][j]<<"\txsi["<<i<<"]["<<j<<"]="<<xsi[i][j]<<"\tgamma["<<i<<"]="<<gamma[i]<<"\n";
-	  //     exit(1);
-        }
       }
     }
   }
 
-  for (it=phi.begin(); it!=phi.end(); it++) {
-    i = it->first;
-    for (kt=phi[i].begin(); kt!=phi[i].end(); kt++) {
-      k = kt->first;
-      if (phi[i][k]>0) {
-        (tdhmm.getB())[i][k] = phi[i][k]/gamma[i];	
+  for (i=0; i<N; i++) {
+    for (k=0; k<M; k++) {
+      if (phi[i*M+k]>0) {
+        (tdhmm.getB())[i][k] = phi[i*M+k]/gamma[i];	
         
 	if (p_isnan((tdhmm.getB())[i][k])) {
-          wcerr<<L"Error: BW - NAN(2) b["<<i<<L"]["<<k<<L"]="<<(tdhmm.getB())[i][k]<<L"\tphi["<<i<<L"]["<<k<<L"]="<<phi[i][k]<<L"\tgamma["<<i<<L"]="<<gamma[i]<<L"\n";
+          wcerr<<L"Error: BW - NAN(2) b["<<i<<L"]["<<k<<L"]="<<(tdhmm.getB())[i][k]<<L"\tphi["<<i<<L"]["<<k<<L"]="<<phi[i*M+k]<<L"\tgamma["<<i<<L"]="<<gamma[i]<<L"\n";
 	       exit(1);
         }
 	if (p_isinf((tdhmm.getB())[i][k])) {
-          wcerr<<L"Error: BW - INF(2) b["<<i<<L"]["<<k<<L"]="<<(tdhmm.getB())[i][k]<<L"\tphi["<<i<<L"]["<<k<<L"]="<<phi[i][k]<<L"\tgamma["<<i<<L"]="<<gamma[i]<<L"\n";
+          wcerr<<L"Error: BW - INF(2) b["<<i<<L"]["<<k<<L"]="<<(tdhmm.getB())[i][k]<<L"\tphi["<<i<<L"]["<<k<<L"]="<<phi[i*M+k]<<L"\tgamma["<<i<<L"]="<<gamma[i]<<L"\n";
 	       exit(1);
         }
-	if ((tdhmm.getB())[i][k]==0) {
-          //wcerr <<"Error: BW - ZERO(2) b["<<i<<"]["<<k<<"]="<<(tdhmm.getB())[i][k]<<"\tphi["<<i<<"]["<<k<<"]="<<phi[i][k]<<"\tgamma["<<i<<"]="<<gamma[i]<<"\n";
-	  //     exit(1);
-        }
       }
     }
   }
@@ -665,109 +815,138 @@ HMM::train(MorphoStream &morpho_stream) {
     }
   }
 
-  wcerr<<L"Log="<<loli<<L"\n";
+  wcerr<<L"Log="<<counts.loli<<L"\n";
 }
 
 void 
 HMM::tagger(MorphoStream &morpho_stream, FILE *Output, const bool &First) {
-  int i, j, k, nw;
+  int i, j, k, t;
   TaggerWord *word = NULL;
   TTag tag;
   
-  set <TTag> ambg_class_tags, tags, pretags;
-  set <TTag>::iterator itag, jtag;
+  set <TTag> ambg_class_tags, tags;
   
-  double prob, loli, x;
+  double prob, loli, x, best;
+  double const zero = -numeric_limits<double>::infinity();
   int N = tdhmm.getN();  
-  vector <vector <double> > alpha(2, vector<double>(N));
-  vector <vector <vector<TTag> > > best(2, vector <vector <TTag> >(N));
+  double **b = tdhmm.getB();
+
+  // Transposed log A, so that the transitions into a tag are contiguous
+  vector <double> loga(N*N);
+  for (i=0; i<N; i++)
+    for (j=0; j<N; j++)
+      loga[i*N+j] = log((tdhmm.getA())[j][i]);
+
+  // Trellis of the words pending disambiguation: the tags of the current
+  // and previous word with their log-probabilities, and for every pending
+  // word and tag the tag of the word before it on the best path
+  vector <TTag> cur_tags, prev_tags;
+  vector <double> cur_score, prev_score;
+  vector <int> back;
+  vector <TTag> path;
   
-  vector <TaggerWord> wpend; 
+  vector <TaggerWord *> wpend; 
   int nwpend;
 
   morpho_stream.setNullFlush(null_flush);
   
   Collection &output = tdhmm.getOutput();
   
-  loli = nw = 0;
+  loli = 0;
   
   //Initialization
-  tags.insert(eos);
-  alpha[0][eos] = 1;
+  cur_tags.assign(1, eos);
+  cur_score.assign(1, 0);
    
   word = morpho_stream.get_next_word();
 
   while (word) {
-    wpend.push_back(*word);    	    
+    wpend.push_back(word);    	    
     nwpend = wpend.size();
+    if (back.size() < (size_t) nwpend*N)
+      back.resize(nwpend*N);
     
-    pretags = tags; // Tags from the previous word
-
-    tags = word->get_tags();
+    // Tags from the previous word
+    prev_tags.swap(cur_tags);
+    prev_score.swap(cur_score);
+
+    k = find_ambiguity_class(tdhmm, *word);  //Ambiguity class the word belongs to
+    if (k != -1) {
+      cur_tags.assign(output[k].begin(), output[k].end());
+    } else {
+      tags = word->get_tags();
   
-    if (tags.size()==0) // This is an unknown word
-      tags = tdhmm.getOpenClass();
+      if (tags.size()==0) // This is an unknown word
+        tags = tdhmm.getOpenClass();
                        
-    ambg_class_tags = require_similar_ambiguity_class(tdhmm, tags, *word, debug);
+      ambg_class_tags = require_similar_ambiguity_class(tdhmm, tags, *word, debug);
          
-    k = output[ambg_class_tags];  //Ambiguity class the word belongs to
-    
-    clear_array_double(&alpha[nwpend%2][0], N);    
-    clear_array_vector(&best[nwpend%2][0], N);
+      k = output[ambg_class_tags];
     
+      cur_tags.assign(tags.begin(), tags.end());
+    }
+    cur_score.resize(cur_tags.size());
+    int *row = &back[(nwpend-1)*N];
+    int const nprev = prev_tags.size();
+
     //Induction
-    for (itag=tags.begin(); itag!=tags.end(); itag++) { //For all tag from the current word
-      i=*itag;
-      for (jtag=pretags.begin(); jtag!=pretags.end(); jtag++) {	//For all tags from the previous word
-	j=*jtag;
-	x = alpha[1-nwpend%2][j]*(tdhmm.getA())[j][i]*(tdhmm.getB())[i][k];
-	if (alpha[nwpend%2][i]<=x) {
-	  if (nwpend>1) 
-	    best[nwpend%2][i] = best[1-nwpend%2][j];
-	  best[nwpend%2][i].push_back(i);
-	  alpha[nwpend%2][i] = x;
+    for (size_t ii=0; ii<cur_tags.size(); ii++) { //For all tag from the current word
+      i=cur_tags[ii];
+      double const logb = log(b[i][k]);
+      double const *into = &loga[i*N];
+      best = zero;
+      for (int jj=0; jj<nprev; jj++) {	//For all tags from the previous word
+	x = prev_score[jj] + into[prev_tags[jj]] + logb;
+	if (best<=x) {
+	  row[i] = prev_tags[jj];
+	  best = x;
 	}
       }
+      cur_score[ii] = best;
     }
     
     //Backtracking
-    if (tags.size() == 1) {
-      tag = *tags.begin();
-      prob = alpha[nwpend%2][tag];
+    if (cur_tags.size() == 1) {
+      tag = cur_tags[0];
+      prob = cur_score[0];
       
-      if (prob>0) 
-	loli -= log(prob);
+      if (prob>zero) 
+	loli -= prob;
       else {
         if (debug)
 	  wcerr<<L"Problem with word '"<<word->get_superficial_form()<<L"' "<<word->get_string_tags()<<L"\n";
       }
-      for (unsigned t=0; t<best[nwpend%2][tag].size(); t++) {
+
+      path.resize(nwpend);
+      path[nwpend-1] = tag;
+      for (t=nwpend-1; t>0; t--)
+        path[t-1] = back[t*N+path[t]];
+
+      for (t=0; t<nwpend; t++) {
 	if (First) {
-	  wstring const &micad = wpend[t].get_all_chosen_tag_first(best[nwpend%2][tag][t], (tdhmm.getTagIndex())[L"TAG_kEOF"]);
+	  wstring const &micad = wpend[t]->get_all_chosen_tag_first(path[t], (tdhmm.getTagIndex())[L"TAG_kEOF"]);
 	  fputws_unlocked(micad.c_str(), Output); 
 	} else {
 	  // print Output
-	  wpend[t].set_show_sf(show_sf);
-	  wstring const &micad = wpend[t].get_lexical_form(best[nwpend%2][tag][t], (tdhmm.getTagIndex())[L"TAG_kEOF"]);
+	  wpend[t]->set_show_sf(show_sf);
+	  wstring const &micad = wpend[t]->get_lexical_form(path[t], (tdhmm.getTagIndex())[L"TAG_kEOF"]);
 	  fputws_unlocked(micad.c_str(), Output); 
 	}
+	delete wpend[t];
       }
       
       //Return to the initial state
       wpend.clear();   
-      alpha[0][tag] = 1;
+      cur_score[0] = 0;
     }
     
-    delete word;
-    
     if(morpho_stream.getEndOfFile())
     {
       if(null_flush)
       { 
         fputwc_unlocked(L'\0', Output);
-        tags.clear();
-        tags.insert(eos);
-        alpha[0][eos] = 1;
+        cur_tags.assign(1, eos);
+        cur_score.assign(1, 0);
       }
       
       fflush(Output);
@@ -776,12 +955,15 @@ HMM::tagger(MorphoStream &morpho_stream, FILE *Output, const bool &First) {
     word = morpho_stream.get_next_word();    
   }
   
-  if ((tags.size()>1)&&(debug)) {
+  if ((cur_tags.size()>1)&&(debug)) {
     wstring errors;
     errors = L"The text to disambiguate has finished, but there are ambiguous words that has not been disambiguated.\n";
     errors+= L"This message should never appears. If you are reading this ..... these are very bad news.\n";
     wcerr<<L"Error: "<<errors;
   }  
+
+  for (t=0; t<(int) wpend.size(); t++)
+    delete wpend[t];
 }
 
 
@@ -50,6 +50,9 @@ blank(0),
 lword(0),
 lblank(0),
 output(0),
+output_tokens(0),
+input_text(0),
+input_pos(0),
 any_char(0),
 any_tag(0),
 nwords(0)
@@ -91,44 +94,7 @@ Interchunk::readData(FILE *in)
   
   me = new MatchExe(t, finals);
  
-  // attr_items
-  bool recompile_attrs = Compression::string_read(in) != string(pcre_version());
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-    attr_items[cad_k].read(in);
-    wstring fallback = Compression::wstring_read(in);
-    if(recompile_attrs) {
-      attr_items[cad_k].compile(UtfConverter::toUtf8(fallback));
-    }
-  }
-
-  // variables
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-    variables[cad_k] = UtfConverter::toUtf8(Compression::wstring_read(in));
-  }
-
-  // macros
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-    macros[cad_k] = Compression::multibyte_read(in);
-  }
-
-  // lists
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-
-    for(int j = 0, limit2 = Compression::multibyte_read(in); j != limit2; j++)
-    {
-      wstring const cad_v = Compression::wstring_read(in);
-      lists[cad_k].insert(UtfConverter::toUtf8(cad_v));
-      listslow[cad_k].insert(UtfConverter::toUtf8(StringUtils::tolower(cad_v)));
-    }  
-  }
+  tables.read(in);
 }
 
 void
@@ -145,6 +111,7 @@ Interchunk::read(string const &transferfile, string const &datafile)
   }
   readData(in);
   fclose(in);
+  tables.resolve(root_element);
 
 }
 
@@ -250,18 +217,18 @@ Interchunk::evalString(xmlNode *element)
         {
           if(ti.getContent() == "content") // jacob's new 'part'
           { 
-            string wf = word[ti.getPos()]->chunkPart(attr_items[ti.getContent()]);
+            string wf = word[ti.getPos()]->chunkPart(TransferTables::attrOf(element));
             return wf.substr(1, wf.length()-2); // trim away the { and }  
           }
           else
           {
-            return word[ti.getPos()]->chunkPart(attr_items[ti.getContent()]);
+            return word[ti.getPos()]->chunkPart(TransferTables::attrOf(element));
           }
         }
         break;
         
       case ti_var:
-        return variables[ti.getContent()];
+        return TransferTables::varOf(element);
         
       case ti_lit_tag:
       case ti_lit:
@@ -280,7 +247,7 @@ Interchunk::evalString(xmlNode *element)
       case ti_get_case_from:
         if(checkIndex(element, ti.getPos(), lword))
         {
-          return copycase(word[ti.getPos()]->chunkPart(attr_items[ti.getContent()]),
+          return copycase(word[ti.getPos()]->chunkPart(TransferTables::attrOf(element)),
                           evalString((xmlNode *) ti.getPointer()));
         }
         break;
@@ -288,7 +255,7 @@ Interchunk::evalString(xmlNode *element)
       case ti_case_of_tl:
         if(checkIndex(element, ti.getPos(), lword))
         {
-          return caseOf(word[ti.getPos()]->chunkPart(attr_items[ti.getContent()]));
+          return caseOf(word[ti.getPos()]->chunkPart(TransferTables::attrOf(element)));
         }
         break;
       
@@ -410,11 +377,12 @@ Interchunk::processOut(xmlNode *localroot)
     {
       if(!xmlStrcmp(i->name, (const xmlChar *) "chunk"))
       {
-        fputws_unlocked(UtfConverter::fromUtf8(processChunk(i)).c_str(), output);
+        wstring const chunk = UtfConverter::fromUtf8(processChunk(i));
+        writeWord(chunk.substr(1, chunk.size() - 2));
       }
       else // 'b'
       {
-        fputws_unlocked(UtfConverter::fromUtf8(evalString(i)).c_str(), output);
+        writeBlank(UtfConverter::fromUtf8(evalString(i)));
       }
     }
   }
@@ -495,11 +463,11 @@ Interchunk::processLet(xmlNode *localroot)
     switch(ti.getType())
     {
       case ti_var:
-        variables[ti.getContent()] = evalString(rightSide);
+        TransferTables::varOf(leftSide) = evalString(rightSide);
         return;
         
       case ti_clip_tl:
-        word[ti.getPos()]->setChunkPart(attr_items[ti.getContent()], evalString(rightSide));
+        word[ti.getPos()]->setChunkPart(TransferTables::attrOf(leftSide), evalString(rightSide));
         return;      
         
       default:
@@ -509,7 +477,7 @@ Interchunk::processLet(xmlNode *localroot)
   if(!xmlStrcmp(leftSide->name, (const xmlChar *) "var"))
   {
     string const val = (const char *) leftSide->properties->children->content;
-    variables[val] = evalString(rightSide);
+    TransferTables::varOf(leftSide) = evalString(rightSide);
     evalStringCache[leftSide] = TransferInstr(ti_var, val, 0);
   }
   else if(!xmlStrcmp(leftSide->name, (const xmlChar *) "clip"))
@@ -530,7 +498,7 @@ Interchunk::processLet(xmlNode *localroot)
     }
     
 
-    word[pos]->setChunkPart(attr_items[(const char *) part], 
+    word[pos]->setChunkPart(TransferTables::attrOf(leftSide), 
 			    evalString(rightSide));
     evalStringCache[leftSide] = TransferInstr(ti_clip_tl, 
 					      (const char *) part, 
@@ -541,21 +509,13 @@ Interchunk::processLet(xmlNode *localroot)
 void
 Interchunk::processAppend(xmlNode *localroot)
 {
-  string name;
-  for(xmlAttr *i = localroot->properties; i != NULL; i = i->next)
-  {
-    if(!xmlStrcmp(i->name, (const xmlChar *) "n"))
-    {
-      name = (char *) i->children->content; 
-      break;
-    }
-  }
+  string &var = TransferTables::varOf(localroot);
 
   for(xmlNode *i = localroot->children; i != NULL; i = i->next)
   {
     if(i->type == XML_ELEMENT_NODE)
     {
-      variables[name].append(evalString(i));
+      var.append(evalString(i));
     }
   }
 }
@@ -584,38 +544,32 @@ Interchunk::processModifyCase(xmlNode *localroot)
   if(leftSide->name != NULL && !xmlStrcmp(leftSide->name, (const xmlChar *) "clip"))
   {
     int pos = 0;
-    xmlChar *part = NULL;
 
     for(xmlAttr *i = leftSide->properties; i != NULL; i = i->next)
     {
-      if(!xmlStrcmp(i->name, (const xmlChar *) "part"))
-      {
-	part = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "pos"))
+      if(!xmlStrcmp(i->name, (const xmlChar *) "pos"))
       {
 	pos = atoi((const char *) i->children->content) - 1;
       }
     }
 
     string const result = copycase(evalString(rightSide), 
-				   word[pos]->chunkPart(attr_items[(const char *) part]));
-    word[pos]->setChunkPart(attr_items[(const char *) part], result);
+				   word[pos]->chunkPart(TransferTables::attrOf(leftSide)));
+    word[pos]->setChunkPart(TransferTables::attrOf(leftSide), result);
   }
   else if(!xmlStrcmp(leftSide->name, (const xmlChar *) "var"))
   {
-    string const val = (const char *) leftSide->properties->children->content;
-    variables[val] = copycase(evalString(rightSide), variables[val]);
+    string &var = TransferTables::varOf(leftSide);
+    var = copycase(evalString(rightSide), var);
   }
 }
 
 void
 Interchunk::processCallMacro(xmlNode *localroot)
 {
-  const char *n = (const char *) localroot->properties->children->content;
   int npar = 0;
 
-  xmlNode *macro = macro_map[macros[n]];
+  xmlNode *macro = macro_map[TransferTables::macroOf(localroot)];
 
   for(xmlAttr *i = macro->properties; i != NULL; i = i->next)
   {
@@ -779,7 +733,7 @@ bool
 Interchunk::processIn(xmlNode *localroot)
 {
   xmlNode *value = NULL;
-  xmlChar *idlist = NULL;
+  xmlNode *idlist = NULL;
 
   for(xmlNode *i = localroot->children; i != NULL; i = i->next)
   {
@@ -791,7 +745,7 @@ Interchunk::processIn(xmlNode *localroot)
       }
       else
       {
-	idlist = i->properties->children->content;
+	idlist = i;
 	break;
       }
     }
@@ -804,8 +758,7 @@ Interchunk::processIn(xmlNode *localroot)
     if(!xmlStrcmp(localroot->properties->children->content, 
 		  (const xmlChar *) "yes"))
     {
-      set<string, Ltstr> &myset = listslow[(const char *) idlist];
-      if(myset.find(tolower(sval)) != myset.end())
+      if(TransferTables::listOf(idlist).containsLower(tolower(sval)))
       {
 	return true;
       }
@@ -816,8 +769,7 @@ Interchunk::processIn(xmlNode *localroot)
     }
   }
 
-  set<string, Ltstr> &myset = lists[(const char *) idlist];
-  if(myset.find(sval) != myset.end())
+  if(TransferTables::listOf(idlist).contains(sval))
   {
     return true;
   }
@@ -1062,26 +1014,23 @@ Interchunk::processBeginsWithList(xmlNode *localroot)
     }
   }
 
-  xmlChar *idlist = second->properties->children->content;
   string needle = evalString(first);
-  set<string, Ltstr>::iterator it, limit;
+  vector<string> const *items;
 
   if(localroot->properties == NULL || 
      xmlStrcmp(localroot->properties->children->content, (const xmlChar *) "yes"))
   {
-    it = lists[(const char *) idlist].begin();
-    limit = lists[(const char *) idlist].end();
+    items = &TransferTables::listOf(second).getItems();
   }
   else
   {
     needle = tolower(needle);
-    it = listslow[(const char *) idlist].begin();
-    limit = listslow[(const char *) idlist].end();
+    items = &TransferTables::listOf(second).getLowItems();
   }
   
-  for(; it != limit; it++)
+  for(unsigned int i = 0; i != items->size(); i++)
   {
-    if(beginsWith(needle, *it))
+    if(beginsWith(needle, (*items)[i]))
     {
       return true;
     }
@@ -1110,26 +1059,23 @@ Interchunk::processEndsWithList(xmlNode *localroot)
     }
   }
 
-  xmlChar *idlist = second->properties->children->content;
   string needle = evalString(first);
-  set<string, Ltstr>::iterator it, limit;
+  vector<string> const *items;
 
   if(localroot->properties == NULL || 
      xmlStrcmp(localroot->properties->children->content, (const xmlChar *) "yes"))
   {
-    it = lists[(const char *) idlist].begin();
-    limit = lists[(const char *) idlist].end();
+    items = &TransferTables::listOf(second).getItems();
   }
   else
   {
     needle = tolower(needle);
-    it = listslow[(const char *) idlist].begin();
-    limit = listslow[(const char *) idlist].end();
+    items = &TransferTables::listOf(second).getLowItems();
   }
   
-  for(; it != limit; it++)
+  for(unsigned int i = 0; i != items->size(); i++)
   {
-    if(endsWith(needle, *it))
+    if(endsWith(needle, (*items)[i]))
     {
       return true;
     }
@@ -1293,26 +1239,26 @@ Interchunk::readToken(FILE *in)
   wstring content;
   while(true)
   {
-    int val = fgetwc_unlocked(in);
-    if(feof(in) || (internal_null_flush && val == 0))
+    int val = readChar(in);
+    if(endOfInput(in) || (internal_null_flush && val == 0))
     {
       return input_buffer.add(TransferToken(content, tt_eof));
     }
     if(val == L'\\')
     {  
       content += L'\\';
-      content += wchar_t(fgetwc_unlocked(in));
+      content += wchar_t(readChar(in));
     }
     else if(val == L'[')
     {
       content += L'[';
       while(true)
       {
-	int val2 = fgetwc_unlocked(in);
+	int val2 = readChar(in);
 	if(val2 == L'\\')
 	{
 	  content += L'\\';
-	  content += wchar_t(fgetwc_unlocked(in));
+	  content += wchar_t(readChar(in));
 	}
 	else if(val2 == L']')
 	{
@@ -1330,16 +1276,16 @@ Interchunk::readToken(FILE *in)
       content += L'{';
       while(true)
       {
-	int val2 = fgetwc_unlocked(in);
+	int val2 = readChar(in);
 	if(val2 == L'\\')
 	{
 	  content += L'\\';
-	  content += wchar_t(fgetwc_unlocked(in));
+	  content += wchar_t(readChar(in));
 	}
 	else if(val2 == L'}')
 	{
-	  wint_t val3 = wchar_t(fgetwc_unlocked(in));
-	  ungetwc(val3, in);
+	  wint_t val3 = wchar_t(readChar(in));
+	  unreadChar(val3, in);
 	  
 	  content += L'}';
 	  if(val3 == L'$')
@@ -1409,6 +1355,116 @@ Interchunk::interchunk_wrapper_null_flush(FILE *in, FILE *out)
 }    
 
 
+wint_t
+Interchunk::readChar(FILE *in)
+{
+  if(input_text == NULL)
+  {
+    return fgetwc_unlocked(in);
+  }
+  if(input_pos < input_text->size())
+  {
+    return (*input_text)[input_pos++];
+  }
+  // one past the end, so that endOfInput() holds like feof() would
+  input_pos = input_text->size() + 1;
+  return WEOF;
+}
+
+void
+Interchunk::unreadChar(wint_t c, FILE *in)
+{
+  if(input_text == NULL)
+  {
+    ungetwc(c, in);
+  }
+  else if(c != WEOF)
+  {
+    input_pos--;
+  }
+}
+
+bool
+Interchunk::endOfInput(FILE *in)
+{
+  if(input_text == NULL)
+  {
+    return feof(in);
+  }
+  return input_pos > input_text->size();
+}
+
+void
+Interchunk::writeWord(wstring const &content)
+{
+  if(output_tokens == NULL)
+  {
+    fputwc_unlocked(L'^', output);
+    fputws_unlocked(content.c_str(), output);
+    fputwc_unlocked(L'$', output);
+    return;
+  }
+
+  // words are always separated by a blank, even an empty one, as they
+  // are when read from "$^"
+  if(output_tokens->empty() || output_tokens->back().getType() != tt_blank)
+  {
+    output_tokens->push_back(TransferToken(L"", tt_blank));
+  }
+  output_tokens->push_back(TransferToken(content, tt_word));
+}
+
+void
+Interchunk::writeBlank(wstring const &content)
+{
+  if(output_tokens == NULL)
+  {
+    fputws_unlocked(content.c_str(), output);
+  }
+  else if(!output_tokens->empty() &&
+          output_tokens->back().getType() == tt_blank)
+  {
+    output_tokens->back().getContent().append(content);
+  }
+  else
+  {
+    output_tokens->push_back(TransferToken(content, tt_blank));
+  }
+}
+
+void
+Interchunk::interchunk(wstring const &in, vector<TransferToken> &out)
+{
+  output_tokens = &out;
+  interchunk(in, (FILE *) NULL);
+  output_tokens = NULL;
+
+  // whatever follows the last word is what would be read at the end of
+  // the text
+  if(out.empty() || out.back().getType() != tt_blank)
+  {
+    out.push_back(TransferToken(L"", tt_eof));
+  }
+  else
+  {
+    out.back().setType(tt_eof);
+  }
+}
+
+void
+Interchunk::interchunk(wstring const &in, FILE *out)
+{
+  bool const was_null_flush = null_flush;
+  null_flush = false;
+  input_text = &in;
+  input_pos = 0;
+
+  interchunk((FILE *) NULL, out);
+
+  input_text = NULL;
+  null_flush = was_null_flush;
+}
+
 void
 Interchunk::interchunk(FILE *in, FILE *out)
 {
@@ -1435,9 +1491,7 @@ Interchunk::interchunk(FILE *in, FILE *out)
       {
 	if(tmpword.size() != 0)
 	{
-          fputwc_unlocked(L'^', output);
-          fputws_unlocked(tmpword[0]->c_str(), output);
-          fputwc_unlocked(L'$', output);
+          writeWord(*tmpword[0]);
 	  tmpword.clear();
 	  input_buffer.setPos(last);
 	  input_buffer.next();       
@@ -1446,7 +1500,7 @@ Interchunk::interchunk(FILE *in, FILE *out)
 	}
 	else if(tmpblank.size() != 0)
 	{
-	  fputws_unlocked(tmpblank[0]->c_str(), output);
+	  writeBlank(*tmpblank[0]);
 	  tmpblank.clear();
 	  last = input_buffer.getPos();
 	  ms.init(me->getInitial());
@@ -1496,7 +1550,7 @@ Interchunk::interchunk(FILE *in, FILE *out)
 	}
 	else
 	{
-	  fputws_unlocked(current.getContent().c_str(), output);
+	  writeBlank(current.getContent());
 	  tmpblank.clear();
 	  return;
 	}
@@ -1513,51 +1567,24 @@ void
 Interchunk::applyRule()
 {
   unsigned int limit = tmpword.size();
-  
+
+  word = word_pool.get(limit);
+  lword = limit;
+  blank = limit > 1 ? blank_pool.get(limit - 1) : NULL;
+  lblank = limit > 1 ? limit - 1 : 0;
+
   for(unsigned int i = 0; i != limit; i++)
   {
-    if(i == 0)
+    if(i != 0)
     {
-      word = new InterchunkWord *[limit];
-      lword = limit;
-      if(limit != 1)
-      {
-        blank = new string *[limit - 1];
-        lblank = limit - 1;
-      }
-      else
-      {
-        blank = NULL;
-        lblank = 0;
-      }
+      blank[i-1]->assign(UtfConverter::toUtf8(*tmpblank[i-1]));
     }
-    else
-    {
-      blank[i-1] = new string(UtfConverter::toUtf8(*tmpblank[i-1]));
-    }
-    
-    word[i] = new InterchunkWord(UtfConverter::toUtf8(*tmpword[i]));
+
+    word[i]->init(UtfConverter::toUtf8(*tmpword[i]));
   }
 
   processRule(lastrule);
   lastrule = NULL;
-
-  if(word)
-  {
-    for(unsigned int i = 0; i != limit; i++)
-    {
-      delete word[i];
-    }
-    delete[] word;
-  }
-  if(blank)
-  {
-    for(unsigned int i = 0; i != limit - 1; i++)
-    {
-      delete blank[i];
-    }
-    delete[] blank;
-  }
   word = NULL;
   blank = NULL;
   tmpword.clear();
@@ -18,6 +18,8 @@
 #define _INTERCHUNK_
 
 #include <apertium/transfer_instr.h>
+#include <apertium/transfer_pool.h>
+#include <apertium/transfer_tables.h>
 #include <apertium/transfer_token.h>
 #include <apertium/interchunk_word.h>
 #include <apertium/apertium_re.h>
@@ -44,11 +46,7 @@ private:
   Alphabet alphabet;
   MatchExe *me;
   MatchState ms;
-  map<string, ApertiumRE, Ltstr> attr_items;
-  map<string, string, Ltstr> variables;
-  map<string, int, Ltstr> macros;
-  map<string, set<string, Ltstr>, Ltstr> lists;
-  map<string, set<string, Ltstr>, Ltstr> listslow;
+  TransferTables tables;
   vector<xmlNode *> macro_map;
   vector<xmlNode *> rule_map;
   xmlDoc *doc;
@@ -56,11 +54,16 @@ private:
   InterchunkWord **word;
   string **blank;
   int lword, lblank;
+  TransferPool<InterchunkWord> word_pool;
+  TransferPool<string> blank_pool;
   Buffer<TransferToken> input_buffer;
   vector<wstring *> tmpword;
   vector<wstring *> tmpblank;
 
   FILE *output;
+  vector<TransferToken> *output_tokens;
+  wstring const *input_text;
+  size_t input_pos;
   int any_char;
   int any_tag;
 
@@ -117,6 +120,11 @@ private:
   TransferToken & readToken(FILE *in);
   bool checkIndex(xmlNode *element, int index, int limit); 
   void interchunk_wrapper_null_flush(FILE *in, FILE *out);
+  wint_t readChar(FILE *in);
+  void unreadChar(wint_t c, FILE *in);
+  bool endOfInput(FILE *in);
+  void writeWord(wstring const &content);
+  void writeBlank(wstring const &content);
 
 public:
   Interchunk();
@@ -124,6 +132,22 @@ public:
   
   void read(string const &transferfile, string const &datafile);
   void interchunk(FILE *in, FILE *out);
+
+  /**
+   * Process a whole input held in memory, as read from the previous stage
+   * of a TransferPipeline, handing the chunks and blanks over as the tokens
+   * Postchunk would read from the text, ending in a tt_eof one
+   * @param in the input
+   * @param out where the tokens are appended
+   */
+  void interchunk(wstring const &in, vector<TransferToken> &out);
+
+  /**
+   * Process a whole input held in memory, writing to a file
+   * @param in the input
+   * @param out the output file
+   */
+  void interchunk(wstring const &in, FILE *out);
   bool getNullFlush(void);
   void setNullFlush(bool null_flush);
   void setTrace(bool trace);
@@ -79,24 +79,42 @@ LexTor::trainwrd(wistream& is, int left, int right, double weigth_exponent) {
   set<wstring> words2workwith=lextor_data->get_words();
   set<wstring>::iterator itword;
 
-  map<wstring, COUNT_DATA_TYPE> wordsum;
-
   wcerr<<L"Words to work with:\n";
   for(itword=words2workwith.begin(); itword!=words2workwith.end(); itword++) {
     wcerr<<*itword<<L"\n";
   }
   wcerr<<L"\n";
 
+  //Words to work with, sorted; the position of a word is its target index
+  vector<wstring> targets(words2workwith.begin(), words2workwith.end());
+
+  //Each word read from the corpus is mapped to the id of its reduced
+  //form (-1 for stopwords), so that reduce and the stopword lookup are
+  //done once per distinct word. Counts are then kept by id.
+  map<wstring, int> surface_ids;
+  map<wstring, int> reduced_ids;
+  vector<wstring> reduced_words;
+  vector<COUNT_DATA_TYPE> wordsum;
+  //For each reduced word id, its target index or -1 if it is not a word
+  //to work with
+  vector<int> target_of;
+
   is.clear();
   is.seekg(ios::beg);
 
   int nw=0;
 
-  map<wstring, map<wstring, COUNT_DATA_TYPE> > context;
-  deque<wstring> buffer;
+  vector<map<int, COUNT_DATA_TYPE> > context(targets.size());
+  deque<int> buffer;
   unsigned word_index=(unsigned)left;
 
   unsigned buffer_max_size=(unsigned)(left+1+right);
+
+  //Count added by the word at each position of the window
+  vector<COUNT_DATA_TYPE> weights(buffer_max_size);
+  for(unsigned i=0; i<buffer_max_size; i++) {
+    weights[i]=1.0/pow(fabs((double)((int)i-left)),weigth_exponent);
+  }
   
   LexTorWord *ltword;
   ltword=LexTorWord::next_word(is);
@@ -110,49 +128,69 @@ LexTor::trainwrd(wistream& is, int left, int right, double weigth_exponent) {
       getchar();
     }
 
-    wstring reduced_word=lextor_data->reduce(ltword->get_word_string());
+    int id;
+    map<wstring, int>::iterator itsurf=surface_ids.find(ltword->get_word_string());
+    if (itsurf!=surface_ids.end()) {
+      id=itsurf->second;
+    } else {
+      wstring reduced_word=lextor_data->reduce(ltword->get_word_string());
+      id=-1;
+      if (!lextor_data->is_stopword(reduced_word)) {
+	map<wstring, int>::iterator itred=reduced_ids.find(reduced_word);
+	if (itred!=reduced_ids.end()) {
+	  id=itred->second;
+	} else {
+	  id=reduced_words.size();
+	  reduced_ids[reduced_word]=id;
+	  reduced_words.push_back(reduced_word);
+	  wordsum.push_back(0);
+
+	  vector<wstring>::iterator ittarget=lower_bound(targets.begin(), targets.end(), reduced_word);
+	  if ((ittarget!=targets.end()) && (*ittarget==reduced_word))
+	    target_of.push_back(ittarget-targets.begin());
+	  else
+	    target_of.push_back(-1);
+	}
+      }
+      surface_ids[ltword->get_word_string()]=id;
+    }
 
-    if (!lextor_data->is_stopword(reduced_word)) {
+    if (id>=0) {
       if (buffer.size()>=buffer_max_size) {
 	buffer.pop_front();
       }
-      buffer.push_back(reduced_word);
+      buffer.push_back(id);
 
-      wordsum[reduced_word]+=1.0;
+      wordsum[id]+=1.0;
 
       //The buffer is already full
-      if (buffer.size()==buffer_max_size) {
-	for(itword=words2workwith.begin(); itword!=words2workwith.end(); itword++) {
-	  if (buffer[word_index]==(*itword)) {
-	    if(debug) {
-	      wcerr<<L"WINDOW: ";
-	      for (unsigned i=0; i<buffer.size(); i++) {
-		if(i==word_index)
-		  wcerr<<L"[>>>>"<<buffer[i]<<L"<<<<] ";
-		else
-		  wcerr<<L"["<<buffer[i]<<L"] ";
-	      }
-	      wcerr<<L"\n";
-	    }
+      if ((buffer.size()==buffer_max_size) && (target_of[buffer[word_index]]>=0)) {
+	int target=target_of[buffer[word_index]];
+	if(debug) {
+	  wcerr<<L"WINDOW: ";
+	  for (unsigned i=0; i<buffer.size(); i++) {
+	    if(i==word_index)
+	      wcerr<<L"[>>>>"<<reduced_words[buffer[i]]<<L"<<<<] ";
+	    else
+	      wcerr<<L"["<<reduced_words[buffer[i]]<<L"] ";
+	  }
+	  wcerr<<L"\n";
+	}
 
-	    int distance=(-1)*left;
-	    for(unsigned i=0; i<buffer.size(); i++) {
-	      if ((i!=word_index) && (buffer[i]!=(*itword))) {
-		if (debug) {
-		  wcerr<<L"   WORD: ["<<buffer[i]<<L"] ";
-		  wcerr<<L"   DISTANCE: "<<distance<<L" ";
-		  wcerr<<L"   ADDED COUNT: "<<1.0/pow(fabs((double)distance),weigth_exponent)<<L" ";
-		  wcerr<<L"   TO ["<<*itword<<L"]\n";
-		}
-		context[*itword][buffer[i]]+=1.0/pow(fabs((double)distance),weigth_exponent);
-	      }
-	      distance++;
+	map<int, COUNT_DATA_TYPE>& target_context=context[target];
+	for(unsigned i=0; i<buffer.size(); i++) {
+	  if ((i!=word_index) && (buffer[i]!=buffer[word_index])) {
+	    if (debug) {
+	      wcerr<<L"   WORD: ["<<reduced_words[buffer[i]]<<L"] ";
+	      wcerr<<L"   DISTANCE: "<<(int)i-left<<L" ";
+	      wcerr<<L"   ADDED COUNT: "<<weights[i]<<L" ";
+	      wcerr<<L"   TO ["<<targets[target]<<L"]\n";
 	    }
-	    if (debug)
-	      getchar();
-	    break;
+	    target_context[buffer[i]]+=weights[i];
 	  }
 	}
+	if (debug)
+	  getchar();
       }
     }
 
@@ -163,34 +201,36 @@ LexTor::trainwrd(wistream& is, int left, int right, double weigth_exponent) {
   wcerr<<L"Corpus has "<<nw<<L" words\n";
 
   //Set the count of each word
-  map<wstring, COUNT_DATA_TYPE>::iterator itws;
-  for(itws=wordsum.begin(); itws!=wordsum.end(); itws++) {
-    lextor_data->set_wordcount(itws->first,itws->second);
+  map<wstring, int>::iterator itws;
+  for(itws=reduced_ids.begin(); itws!=reduced_ids.end(); itws++) {
+    lextor_data->set_wordcount(itws->first,wordsum[itws->second]);
     //if(debug) {
-    wcerr<<L"wordcount("<<itws->first<<L") = "<<itws->second<<L"\n";
+    wcerr<<L"wordcount("<<itws->first<<L") = "<<wordsum[itws->second]<<L"\n";
     //}
   }
 
   //All co-occurrences have been collected. We need to filter them
   //so as to take into account only the n most frequents
-  for(itword=words2workwith.begin(); itword!=words2workwith.end(); itword++) {
+  for(unsigned t=0; t<targets.size(); t++) {
     PairStringCountComparer comparer;
     vector<pair<wstring, COUNT_DATA_TYPE> > context_v;
-    map<wstring, COUNT_DATA_TYPE>::iterator itm;
+    map<int, COUNT_DATA_TYPE>::iterator itm;
 
-    while(context[*itword].size()>0) {
-      itm=context[*itword].begin();
-      context_v.push_back(*itm);
-      context[*itword].erase(itm);
+    context_v.reserve(context[t].size());
+    for(itm=context[t].begin(); itm!=context[t].end(); itm++) {
+      context_v.push_back(make_pair(reduced_words[itm->first], itm->second));
     }
+    context[t].clear();
 
     sort(context_v.begin(), context_v.end(), comparer);
-    wstring w=*itword;
+    wstring w=targets[t];
+    itws=reduced_ids.find(w);
+    COUNT_DATA_TYPE sum=(itws==reduced_ids.end())?0:wordsum[itws->second];
     lextor_data->set_cooccurrence_context(w, context_v);
-    lextor_data->set_lexchoice_sum(w, wordsum[w]);
+    lextor_data->set_lexchoice_sum(w, sum);
 
     //if (debug) {
-    wcerr<<L"lexchoice_sum("<<w<<L") = "<<wordsum[w]<<L"\n";
+    wcerr<<L"lexchoice_sum("<<w<<L") = "<<sum<<L"\n";
     //}
   }
 }
@@ -273,8 +313,8 @@ LexTor::trainlch(wistream& is, int left, int right, LexTorData& tlwordmodel,
 
 	wstring reduced_buffer_word=lextor_data->reduce(buffer[word_index].get_word_string());
 
-        for(itword=words2workwith.begin(); itword!=words2workwith.end(); itword++) {
-	  if (reduced_buffer_word==(*itword)) {
+        itword=words2workwith.find(reduced_buffer_word);
+	if (itword!=words2workwith.end()) {
 	    //We translate each word in the context
 	    //Note: Words in the context can also be ambiguous (with more than one lexical choice)
 	    //In that case the count will come from all the possible
@@ -457,9 +497,6 @@ LexTor::trainlch(wistream& is, int left, int right, LexTorData& tlwordmodel,
 	      wcerr<<L"\n";
 	      getchar();
 	    }
-
-	    break;
-	  }
 	}
       }
     } 
@@ -814,6 +851,17 @@ LexTor::estimate_winner_lch_cosine(deque<LexTorWord>& window, int word_index, do
       wcerr<<it->first<<L", "<<it->second<<L"\n";
   }
 
+  //The context vector is mapped to word indexes, and its module
+  //computed, once for all the lexical choices
+  vector<pair<WORD_DATA_TYPE, double> > vcontext_index;
+  double module_vcontext=0;
+  map<wstring, double>::iterator itc;
+  for(itc=vcontext.begin(); itc!=vcontext.end(); itc++) {
+    vcontext_index.push_back(make_pair(lextor_data->get_word_index(itc->first), itc->second));
+    module_vcontext+=(itc->second)*(itc->second);
+  }
+  module_vcontext=sqrt(module_vcontext);
+
   ////double max_cosine=-2;
   double min_angle=360;
   int winner=-1;
@@ -821,7 +869,7 @@ LexTor::estimate_winner_lch_cosine(deque<LexTorWord>& window, int word_index, do
   for(int i=0; i<window[word_index].n_lexical_choices(); i++) {
     wstring reduced_lexchoice=lextor_data->reduce_lexical_choice(window[word_index].get_lexical_choice(i,false));
 
-    double aux_cosine=cosine(vcontext, reduced_lexchoice);
+    double aux_cosine=cosine(vcontext, vcontext_index, module_vcontext, reduced_lexchoice);
     double aux_angle=(acos(aux_cosine)*180)/PI;
     if (debug) {
       wcerr<<L"cos("<<lextor_data->reduce(window[word_index].get_word_string())<<L", "
@@ -999,24 +1047,18 @@ LexTor::estimate_winner_lch_votingtl(deque<LexTorWord>& window, int word_index,
 }
 
 double 
-LexTor::cosine(map<wstring, double>& vcontext, const wstring& reduced_lexchoice) {
-  map<wstring, double>::iterator itc;
+LexTor::cosine(map<wstring, double>& vcontext, const vector<pair<WORD_DATA_TYPE, double> >& vcontext_index,
+               double module_vcontext, const wstring& reduced_lexchoice) {
+  WORD_DATA_TYPE ind_lexchoice=lextor_data->get_word_index(reduced_lexchoice);
 
   //We calculate the scalar product between vcontext and the lexchoice vector
   double scalar_product=0;
-  for(itc=vcontext.begin(); itc!=vcontext.end(); itc++) {
-    scalar_product+=(itc->second)*(lextor_data->vote_from_word(reduced_lexchoice, itc->first));
+  for(unsigned i=0; i<vcontext_index.size(); i++) {
+    scalar_product+=(vcontext_index[i].second)*(lextor_data->vote_from_word(ind_lexchoice, vcontext_index[i].first));
   }
 
-  //We calculate the module of vcontext, ||vcontext||
-  double module_vcontext=0;
-  for(itc=vcontext.begin(); itc!=vcontext.end(); itc++) {
-    module_vcontext+=(itc->second)*(itc->second);
-  }
-  module_vcontext=sqrt(module_vcontext);
-
   //We get the module of the lexchoice vector, ||lexchoice vector||
-  double module_lexchoice_vector=lextor_data->get_module_lexchoice_vector(reduced_lexchoice);
+  double module_lexchoice_vector=lextor_data->get_module_lexchoice_vector(ind_lexchoice);
 
   if (module_vcontext==0) { 
     wcerr<<L"Error in LexTor::vectors_cosine: module_vcontext is equal to zero.\n"
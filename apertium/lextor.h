@@ -46,7 +46,8 @@ private:
   int estimate_winner_lch_mostprob(deque<LexTorWord>& window, int word_index,  double weigth_exponent);
   int estimate_winner_lch_votingtl(deque<LexTorWord>& window, int word_index,  double weigth_exponent);
 
-  double cosine(map<wstring, double>& vcontext, const wstring& reduced_lexchoice);
+  double cosine(map<wstring, double>& vcontext, const vector<pair<WORD_DATA_TYPE, double> >& vcontext_index,
+                double module_vcontext, const wstring& reduced_lexchoice);
 public:
 
   static bool debug;
@@ -48,6 +48,7 @@ LexTorData::LexTorData(const LexTorData& ltd) {
 
   lexchoice_set=ltd.lexchoice_set;
   lexchoice_sum=ltd.lexchoice_sum;
+  lexchoice_module=ltd.lexchoice_module;
   //lexchoice_prob=ltd.lexchoice_prob;
 
   stopwords=ltd.stopwords;
@@ -59,16 +60,29 @@ LexTorData::LexTorData(const LexTorData& ltd) {
 LexTorData::~LexTorData() {
 }
 
+WORD_DATA_TYPE
+LexTorData::get_word_index(const wstring& word) {
+  map<wstring, WORD_DATA_TYPE>::iterator it=word2index.find(StringUtils::tolower(word));
+  if (it==word2index.end())
+    return word2index[NULLWORD];
+  return it->second;
+}
+
 COUNT_DATA_TYPE
 LexTorData::vote_from_word(const wstring& lexical_choice, const wstring& word) {
-  WORD_DATA_TYPE ind_lexchoice=word2index[StringUtils::tolower(lexical_choice)];
-  WORD_DATA_TYPE ind_word=word2index[StringUtils::tolower(word)];
+  return vote_from_word(get_word_index(lexical_choice), get_word_index(word));
+}
 
-  //To avoid creating a null entry in lexchoice_set[lexical_choice]
-  if (lexchoice_set[ind_lexchoice].find(ind_word)==lexchoice_set[ind_lexchoice].end())
+COUNT_DATA_TYPE
+LexTorData::vote_from_word(WORD_DATA_TYPE lexical_choice, WORD_DATA_TYPE word) {
+  map<WORD_DATA_TYPE, map<WORD_DATA_TYPE, COUNT_DATA_TYPE> >::iterator itlch=lexchoice_set.find(lexical_choice);
+  if (itlch==lexchoice_set.end())
     return 0;
-  else
-    return lexchoice_set[ind_lexchoice][ind_word];
+
+  map<WORD_DATA_TYPE, COUNT_DATA_TYPE>::iterator itw=itlch->second.find(word);
+  if (itw==itlch->second.end())
+    return 0;
+  return itw->second;
 }
 
 //double 
@@ -166,6 +180,7 @@ LexTorData::read(FILE *is) {
       //wcerr<<"     word: "<<word<<" count: "<<count<<"\n";
       lexchoice_set[lexchoice][word]=count;
     }
+    update_lexchoice_module(lexchoice);
   }
 
   //First we read the number of words to take into account
@@ -345,6 +360,8 @@ LexTorData::set_cooccurrence_context(const wstring& lexical_choice,
 
     //////wordcount[word2index[StringUtils::tolower(context[i].first)]]+=context[i].second;
   }
+
+  update_lexchoice_module(word2index[StringUtils::tolower(lexical_choice)]);
 }
 
 void
@@ -470,39 +487,68 @@ LexTorData::get_cooccurrence_vector(const string& lexical_choice) {
 */
 
 
-double 
-LexTorData::get_module_lexchoice_vector(const wstring& lexical_choice) {
-  WORD_DATA_TYPE ind_lexchoice=word2index[StringUtils::tolower(lexical_choice)];
+void
+LexTorData::update_lexchoice_module(WORD_DATA_TYPE lexical_choice) {
+  //An empty co-occurrence model must not get an entry in lexchoice_set,
+  //write() would save it in addition to the n_set models
+  map<WORD_DATA_TYPE, map<WORD_DATA_TYPE, COUNT_DATA_TYPE> >::iterator itlch=lexchoice_set.find(lexical_choice);
+  if (itlch==lexchoice_set.end()) {
+    lexchoice_module.erase(lexical_choice);
+    return;
+  }
+
   map<WORD_DATA_TYPE, COUNT_DATA_TYPE>::iterator it;
 
   double module=0;
 
-  for(it=lexchoice_set[ind_lexchoice].begin(); it!= lexchoice_set[ind_lexchoice].end(); it++) 
+  for(it=itlch->second.begin(); it!= itlch->second.end(); it++) 
     module+=(it->second)*(it->second);
 
-  module=sqrt(module);
+  lexchoice_module[lexical_choice]=sqrt(module);
+}
 
-  return module;
+double 
+LexTorData::get_module_lexchoice_vector(const wstring& lexical_choice) {
+  return get_module_lexchoice_vector(get_word_index(lexical_choice));
+}
+
+double 
+LexTorData::get_module_lexchoice_vector(WORD_DATA_TYPE lexical_choice) {
+  map<WORD_DATA_TYPE, double>::iterator it=lexchoice_module.find(lexical_choice);
+  if (it==lexchoice_module.end())
+    return 0;
+  return it->second;
 }
 
 double 
 LexTorData::cosine(const wstring& reduced_lexch1, const wstring& reduced_lexch2) {
-  WORD_DATA_TYPE ind_lexchoice1=word2index[StringUtils::tolower(reduced_lexch1)];
-  WORD_DATA_TYPE ind_lexchoice2=word2index[StringUtils::tolower(reduced_lexch2)];
-  map<WORD_DATA_TYPE, COUNT_DATA_TYPE>::iterator it;
+  WORD_DATA_TYPE ind_lexchoice1=get_word_index(reduced_lexch1);
+  WORD_DATA_TYPE ind_lexchoice2=get_word_index(reduced_lexch2);
 
-  //We calculate the scalar product
+  //Both co-occurrence vectors are sorted by word index, so the scalar
+  //product is computed by merging them
   double scalar_product=0;
-  for(it=lexchoice_set[ind_lexchoice1].begin(); it!= lexchoice_set[ind_lexchoice1].end(); it++) {
-    if (lexchoice_set[ind_lexchoice2].find(it->first)!=
-        lexchoice_set[ind_lexchoice2].end()) {
-      scalar_product+=(it->second)*lexchoice_set[ind_lexchoice2][it->first];
+  if ((lexchoice_set.find(ind_lexchoice1)!=lexchoice_set.end()) &&
+      (lexchoice_set.find(ind_lexchoice2)!=lexchoice_set.end())) {
+    map<WORD_DATA_TYPE, COUNT_DATA_TYPE>& v1=lexchoice_set[ind_lexchoice1];
+    map<WORD_DATA_TYPE, COUNT_DATA_TYPE>& v2=lexchoice_set[ind_lexchoice2];
+    map<WORD_DATA_TYPE, COUNT_DATA_TYPE>::iterator it1=v1.begin(), it2=v2.begin();
+    while ((it1!=v1.end()) && (it2!=v2.end())) {
+      if (it1->first<it2->first)
+        it1++;
+      else if (it2->first<it1->first)
+        it2++;
+      else {
+        scalar_product+=(it1->second)*(it2->second);
+        it1++;
+        it2++;
+      }
     }
   }
 
   //We get the module of the lexchoice vectors, ||lexchoice vector||
-  double module_lexch1_vector=get_module_lexchoice_vector(reduced_lexch1);
-  double module_lexch2_vector=get_module_lexchoice_vector(reduced_lexch2);
+  double module_lexch1_vector=get_module_lexchoice_vector(ind_lexchoice1);
+  double module_lexch2_vector=get_module_lexchoice_vector(ind_lexchoice2);
 
 
   if (module_lexch1_vector==0) {
@@ -62,6 +62,10 @@ private:
   //For a given lexical choice it contains the sum of all co-appearing words
   map<WORD_DATA_TYPE, COUNT_DATA_TYPE> lexchoice_sum;
 
+  //For a given lexical choice it contains the module (L2 norm) of its
+  //co-occurrence vector, kept up to date with lexchoice_set
+  map<WORD_DATA_TYPE, double> lexchoice_module;
+
   //For a given lexical choice it contains its probability  
   //map<WORD_DATA_TYPE, double> lexchoice_prob;
 
@@ -77,6 +81,8 @@ private:
   set<wstring> reduced_lexical_choices;
 
   void new_word_register(const wstring& w);
+
+  void update_lexchoice_module(WORD_DATA_TYPE lexical_choice);
 public:
 
   LexTorData();
@@ -85,7 +91,12 @@ public:
   
   ~LexTorData();
 
+  //Index of a word (or lexical choice), or the index of NULLWORD if
+  //it is unknown
+  WORD_DATA_TYPE get_word_index(const wstring& word);
+
   COUNT_DATA_TYPE vote_from_word(const wstring& lexical_choice, const wstring& word);
+  COUNT_DATA_TYPE vote_from_word(WORD_DATA_TYPE lexical_choice, WORD_DATA_TYPE word);
 
   //double get_lexchoice_prob(const string& lexical_choice);
 
@@ -116,6 +127,7 @@ public:
   //vector<pair<WORD_DATA_TYPE, double> >
   //get_cooccurrence_vector(const string& lexical_choice);
   double get_module_lexchoice_vector(const wstring& lexical_choice);
+  double get_module_lexchoice_vector(WORD_DATA_TYPE lexical_choice);
 
   double cosine(const wstring& reduced_lexch1, const wstring& reduced_lexch2);
 
@@ -54,6 +54,7 @@ TaggerData& LSWPoST::get_tagger_data() {
 void LSWPoST::deserialise(FILE *Serialised_FILE_Tagger) {
   tdlsw.read(Serialised_FILE_Tagger);
   eos = (tdlsw.getTagIndex())[L"TAG_SENT"];
+  rules_N = -1;
 }
 
 std::vector<std::wstring> &LSWPoST::getArrayTags() {
@@ -65,6 +66,7 @@ void LSWPoST::serialise(FILE *Stream_) { tdlsw.write(Stream_); }
 void LSWPoST::deserialise(const TaggerData &Deserialised_FILE_Tagger) {
   tdlsw = TaggerDataLSW(Deserialised_FILE_Tagger);
   eos = (tdlsw.getTagIndex())[L"TAG_SENT"];
+  rules_N = -1;
 }
 
 void LSWPoST::init_probabilities_from_tagged_text_(MorphoStream &, MorphoStream &) {
@@ -82,16 +84,16 @@ void LSWPoST::train(MorphoStream &morpho_stream, unsigned long count) {
   }
 }
 
-LSWPoST::LSWPoST() {}
+LSWPoST::LSWPoST() : rules_N(-1) {}
 
-LSWPoST::LSWPoST(TaggerDataLSW t) {
+LSWPoST::LSWPoST(TaggerDataLSW t) : rules_N(-1) {
   tdlsw = t;
   eos = (tdlsw.getTagIndex())[L"TAG_SENT"];  
 }
 
 LSWPoST::~LSWPoST() {}
 
-LSWPoST::LSWPoST(TaggerDataLSW *tdlsw) : tdlsw(*tdlsw) {}
+LSWPoST::LSWPoST(TaggerDataLSW *tdlsw) : tdlsw(*tdlsw), rules_N(-1) {}
 
 void
 LSWPoST::set_eos(TTag t) { 
@@ -106,11 +108,11 @@ LSWPoST::init_probabilities(MorphoStream &morpho_stream) {
   TaggerWord *word = NULL;
   set<TTag> tags_left, tags_mid, tags_right;
   set<TTag>::iterator iter_left, iter_mid, iter_right;
-  vector<vector<vector<double> > > para_matrix(N, vector<vector<double> >(N, vector<double>(N, 0)));
+  map<pair<int, TTag>, double> para_matrix; // ((left*N + mid), right)
   int num_valid_seq = 0;
   
   word = new TaggerWord();          // word for tags left
-  word->add_tag(eos, L"sent", tdlsw.getPreferRules());
+  word->add_tag(eos, L"sent", tdlsw.getPreferPatterns());
   tags_left = word->get_tags();     // tags left
   if (tags_left.size()==0) { //This is an unknown word
     tags_left = tdlsw.getOpenClass();
@@ -161,7 +163,7 @@ LSWPoST::init_probabilities(MorphoStream &morpho_stream) {
         for (iter_mid = tags_mid.begin(); iter_mid != tags_mid.end(); ++iter_mid) {
           for (iter_right = tags_right.begin(); iter_right != tags_right.end(); ++iter_right) {
             if (is_valid_seq(*iter_left, *iter_mid, *iter_right)) {
-              para_matrix[*iter_left][*iter_mid][*iter_right] += 1.0 / num_valid_seq;
+              para_matrix[make_pair(*iter_left*N + *iter_mid, *iter_right)] += 1.0 / num_valid_seq;
             }
           } // for iter_right
         } // for iter_mid
@@ -174,56 +176,89 @@ LSWPoST::init_probabilities(MorphoStream &morpho_stream) {
     word = morpho_stream.get_next_word();
   } // while word != NULL
 
-  for (int i = 0; i < N; ++i) {
-    for (int j = 0; j < N; ++j) {
-      for (int k = 0; k < N; ++k) {
-        tdlsw.getD()[i][j][k] = para_matrix[i][j][k];
-      }
-    }
+  vector<TaggerDataLSW::Cell> cells;
+  cells.reserve(para_matrix.size());
+  for (map<pair<int, TTag>, double>::iterator it = para_matrix.begin();
+       it != para_matrix.end(); ++it) {
+    TaggerDataLSW::Cell cell;
+    cell.i = it->first.first / N;
+    cell.j = it->first.first % N;
+    cell.k = it->first.second;
+    cell.value = it->second;
+    cells.push_back(cell);
   }
+  tdlsw.setProbabilities(N, cells);
 
   wcerr << L"\n";
 }
 
-bool LSWPoST::is_valid_seq(TTag left, TTag mid, TTag right) {
-
+void LSWPoST::compile_rules() {
+  int N = tdlsw.getN();
   vector<TForbidRule> &forbid_rules = tdlsw.getForbidRules();
   vector<TEnforceAfterRule> &enforce_rules = tdlsw.getEnforceRules();
 
+  rules_N = N;
+  forbidden.assign(N*N, false);
   for (size_t r = 0; r < forbid_rules.size(); ++r) {
-    if ((left == forbid_rules[r].tagi && mid == forbid_rules[r].tagj)
-        || (mid == forbid_rules[r].tagi && right == forbid_rules[r].tagj)) {
-      return false;
-    }
-  }// for r in forbid rules
+    forbidden[forbid_rules[r].tagi*N + forbid_rules[r].tagj] = true;
+  }
 
+  // a pair (i, j) breaks an enforce rule for i unless j is among its tags
+  unenforced.assign(N*N, false);
   for (size_t r = 0; r < enforce_rules.size(); ++r) {
-    if (left == enforce_rules[r].tagi) {
-      bool found = false;
-      for (size_t j = 0; j < enforce_rules[r].tagsj.size(); ++j) {
-        if (enforce_rules[r].tagsj[j] == mid) {
-          found = true;
-          break;
-        }
-      }
-      if (!found) {
-        return false;
-      }
-    } else if (mid == enforce_rules[r].tagi) {
-      bool found = false;
-      for (size_t j = 0; j < enforce_rules[r].tagsj.size(); ++j) {
-        if (enforce_rules[r].tagsj[j] == right) {
-          found = true;
-          break;
-        }
-      }
-      if (!found) {
-        return false;
+    vector<bool> allowed(N, false);
+    for (size_t j = 0; j < enforce_rules[r].tagsj.size(); ++j) {
+      allowed[enforce_rules[r].tagsj[j]] = true;
+    }
+    for (int j = 0; j < N; ++j) {
+      if (!allowed[j]) {
+        unenforced[enforce_rules[r].tagi*N + j] = true;
       }
     }
-  } // for r in enforce rules
+  }
+}
+
+bool LSWPoST::is_valid_seq(TTag left, TTag mid, TTag right) {
+  if (rules_N != tdlsw.getN()) {
+    compile_rules();
+  }
+  int N = rules_N;
 
-  return true;
+  if (forbidden[left*N + mid] || forbidden[mid*N + right]) {
+    return false;
+  }
+
+  // when left and mid are the same tag, its enforce rules are only
+  // checked against mid
+  return !unenforced[left*N + mid] &&
+         (left == mid || !unenforced[mid*N + right]);
+}
+
+double
+LSWPoST::sum_cells(TTag left, TTag mid, set<TTag> const &right,
+                   vector<unsigned int> *cells) {
+  vector<double> const &values = tdlsw.getCellValues();
+  unsigned int c = tdlsw.getRowBegin(left, mid);
+  unsigned int const end = tdlsw.getRowEnd(left, mid);
+  set<TTag>::const_iterator iter_right = right.begin();
+  double sum = 0;
+
+  while (c != end && iter_right != right.end()) {
+    TTag const k = tdlsw.getCellTag(c);
+    if (k < *iter_right) {
+      ++c;
+    } else if (*iter_right < k) {
+      ++iter_right;
+    } else {
+      sum += values[c];
+      if (cells != NULL) {
+        cells->push_back(c);
+      }
+      ++c;
+      ++iter_right;
+    }
+  }
+  return sum;
 }
 
 void
@@ -234,20 +269,22 @@ LSWPoST::post_ambg_class_scan() {
 
   // set up the probability matrix of tdlsw, the pointer to the TaggerDataLSW object
   tdlsw.setProbabilities(N);
+  rules_N = -1;
 }
 
 void
 LSWPoST::train(MorphoStream &morpho_stream) {
 
-  int N = tdlsw.getN();
   int nw = 0;
   TaggerWord *word = NULL;
   set<TTag> tags_left, tags_mid, tags_right;
   set<TTag>::iterator iter_left, iter_mid, iter_right;
-  vector<vector<vector<double> > > para_matrix_new(N, vector<vector<double> >(N, vector<double>(N, 0)));
+  vector<double> &values = tdlsw.getCellValues();
+  vector<double> para_matrix_new(values.size(), 0);
+  vector<unsigned int> cells;
 
   word = new TaggerWord();          // word for tags left
-  word->add_tag(eos, L"sent", tdlsw.getPreferRules());
+  word->add_tag(eos, L"sent", tdlsw.getPreferPatterns());
   tags_left = word->get_tags();     // tags left
   if (tags_left.size()==0) { //This is an unknown word
     tags_left = tdlsw.getOpenClass();
@@ -281,23 +318,18 @@ LSWPoST::train(MorphoStream &morpho_stream) {
     require_ambiguity_class(tdlsw, tags_right, *word, nw);
 
     double normalization = 0;
+    cells.clear();
 
+    // only the stored, non-zero cells of D can match
     for (iter_left = tags_left.begin(); iter_left != tags_left.end(); ++iter_left) {
       for (iter_mid = tags_mid.begin(); iter_mid != tags_mid.end(); ++iter_mid) {
-        for (iter_right = tags_right.begin(); iter_right != tags_right.end(); ++iter_right) {
-          normalization += tdlsw.getD()[*iter_left][*iter_mid][*iter_right];
-        }
+        normalization += sum_cells(*iter_left, *iter_mid, tags_right, &cells);
       }
     }
 
-    for (iter_left = tags_left.begin(); iter_left != tags_left.end(); ++iter_left) {
-      for (iter_mid = tags_mid.begin(); iter_mid != tags_mid.end(); ++iter_mid) {
-        for (iter_right = tags_right.begin(); iter_right != tags_right.end(); ++iter_right) {
-          if (normalization > ZERO) {
-            para_matrix_new[*iter_left][*iter_mid][*iter_right] +=
-                tdlsw.getD()[*iter_left][*iter_mid][*iter_right] / normalization;
-          }
-        }
+    if (normalization > ZERO) {
+      for (size_t c = 0; c < cells.size(); ++c) {
+        para_matrix_new[cells[c]] += values[cells[c]] / normalization;
       }
     }
 
@@ -307,13 +339,7 @@ LSWPoST::train(MorphoStream &morpho_stream) {
     word = morpho_stream.get_next_word();
   }
 
-  for (int i = 0; i < N; ++i) {
-    for (int j = 0; j < N; ++j) {
-      for (int k = 0; k < N; ++k) {
-        tdlsw.getD()[i][j][k] = para_matrix_new[i][j][k];
-      }
-    }
-  }
+  values.swap(para_matrix_new);
 }
 
 void
@@ -323,7 +349,7 @@ LSWPoST::print_para_matrix() {
     for (int j = 0; j < tdlsw.getN(); ++j) {
       for (int k = 0; k < tdlsw.getN(); ++k) {
         wcout << L"D[" << i << L"][" << j << L"][" << k << L"] = "
-            << tdlsw.getD()[i][j][k] << "\n";
+            << tdlsw.getD(i, j, k) << "\n";
       }
     }
   }
@@ -337,7 +363,7 @@ LSWPoST::tagger(MorphoStream &morpho_stream, FILE *Output, const bool &First) {
   morpho_stream.setNullFlush(null_flush);                      
  
   word_left = new TaggerWord();          // word left
-  word_left->add_tag(eos, L"sent", tdlsw.getPreferRules());
+  word_left->add_tag(eos, L"sent", tdlsw.getPreferPatterns());
   word_left->set_show_sf(show_sf);
   tags_left = word_left->get_tags();          // tags left
 
@@ -368,9 +394,7 @@ LSWPoST::tagger(MorphoStream &morpho_stream, FILE *Output, const bool &First) {
     for (iter_mid = tags_avail->begin(); iter_mid != tags_avail->end(); ++iter_mid) {
       double n = 0;
       for (iter_left = tags_left.begin(); iter_left != tags_left.end(); ++iter_left) {
-        for (iter_right = tags_right.begin(); iter_right != tags_right.end(); ++iter_right) {
-          n += tdlsw.getD()[*iter_left][*iter_mid][*iter_right];
-        }
+        n += sum_cells(*iter_left, *iter_mid, tags_right);
       }
       if (n > max) {
         max = n;
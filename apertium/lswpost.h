@@ -52,6 +52,22 @@ class LSWPoST : public Apertium::FILE_Tagger {
 private:
   TaggerDataLSW tdlsw;
   TTag eos; // end-of-sentence tag
+
+  /** The forbid and enforce rules as N x N bit matrices: forbidden pairs
+   *  of consecutive tags, and pairs whose first tag has an enforce rule
+   *  that the second does not satisfy
+   */
+  int rules_N;
+  vector<bool> forbidden;
+  vector<bool> unenforced;
+  void compile_rules();
+
+  /** Sum of D[left][mid][right] for every right tag
+   *  @param cells if not NULL, the stored cells that were added up are
+   *  appended to it
+   */
+  double sum_cells(TTag left, TTag mid, set<TTag> const &right,
+                   vector<unsigned int> *cells = NULL);
 protected:
   void post_ambg_class_scan();
 public:
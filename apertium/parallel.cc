@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/parallel.h>
+#include "apertium_config.h"
+
+#include <vector>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+using namespace std;
+
+ParallelTask::~ParallelTask()
+{
+}
+
+#ifdef HAVE_PTHREAD
+
+Mutex::Mutex()
+{
+  pthread_mutex_t *m = new pthread_mutex_t;
+  pthread_mutex_init(m, NULL);
+  impl = m;
+}
+
+Mutex::~Mutex()
+{
+  pthread_mutex_t *m = static_cast<pthread_mutex_t *>(impl);
+  pthread_mutex_destroy(m);
+  delete m;
+}
+
+void
+Mutex::lock()
+{
+  pthread_mutex_lock(static_cast<pthread_mutex_t *>(impl));
+}
+
+void
+Mutex::unlock()
+{
+  pthread_mutex_unlock(static_cast<pthread_mutex_t *>(impl));
+}
+
+namespace
+{
+  struct Worker
+  {
+    ParallelTask *task;
+    unsigned int thread;
+  };
+
+  void * runWorker(void *arg)
+  {
+    Worker *worker = static_cast<Worker *>(arg);
+    worker->task->run(worker->thread);
+    return NULL;
+  }
+}
+
+void
+runParallel(ParallelTask &task, unsigned int num_threads)
+{
+  if(num_threads <= 1)
+  {
+    task.run(0);
+    return;
+  }
+
+  vector<Worker> workers(num_threads);
+  vector<pthread_t> threads(num_threads);
+  vector<bool> started(num_threads, false);
+
+  // worker 0 runs in the calling thread
+  for(unsigned int i = 1; i < num_threads; i++)
+  {
+    workers[i].task = &task;
+    workers[i].thread = i;
+    started[i] = pthread_create(&threads[i], NULL, runWorker, &workers[i]) == 0;
+  }
+
+  task.run(0);
+
+  for(unsigned int i = 1; i < num_threads; i++)
+  {
+    if(started[i])
+    {
+      pthread_join(threads[i], NULL);
+    }
+    else
+    {
+      task.run(i);
+    }
+  }
+}
+
+bool
+parallelSupported()
+{
+  return true;
+}
+
+#else
+
+Mutex::Mutex() :
+impl(0)
+{
+}
+
+Mutex::~Mutex()
+{
+}
+
+void
+Mutex::lock()
+{
+}
+
+void
+Mutex::unlock()
+{
+}
+
+void
+runParallel(ParallelTask &task, unsigned int num_threads)
+{
+  for(unsigned int i = 0; i < num_threads || i == 0; i++)
+  {
+    task.run(i);
+  }
+}
+
+bool
+parallelSupported()
+{
+  return false;
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _PARALLEL_
+#define _PARALLEL_
+
+/**
+ * The work done by each thread of a runParallel() call
+ */
+class ParallelTask
+{
+public:
+  virtual ~ParallelTask();
+
+  /**
+   * @param thread number of the worker, from 0 to the number of threads
+   * minus one
+   */
+  virtual void run(unsigned int thread) = 0;
+};
+
+/**
+ * Mutual exclusion lock; it does nothing when the library is built
+ * without thread support
+ */
+class Mutex
+{
+private:
+  void *impl;
+
+  Mutex(Mutex const &o);
+  Mutex & operator =(Mutex const &o);
+public:
+  Mutex();
+  ~Mutex();
+  void lock();
+  void unlock();
+};
+
+/**
+ * Call task.run(i) for every i below num_threads, each in its own thread,
+ * and wait for all of them to finish.  Without thread support the calls
+ * are made one after the other, so a task that takes its work from a
+ * shared queue still gets all of it done.
+ * @param task the work
+ * @param num_threads the number of workers
+ */
+void runParallel(ParallelTask &task, unsigned int num_threads);
+
+/**
+ * @return whether runParallel() really runs its workers in parallel
+ */
+bool parallelSupported();
+
+/**
+ * The largest number of threads the programs accept.  Each thread gets
+ * its own copy of the working data before any input is read, so a
+ * mistyped count would only exhaust the memory.
+ */
+unsigned int const maxThreads = 256;
+
+#endif
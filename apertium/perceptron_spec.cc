@@ -85,7 +85,7 @@ static LexicalUnit make_sentinel_token(
   return lu;
 }
 
-PerceptronSpec::PerceptronSpec() {
+PerceptronSpec::PerceptronSpec() : history_dependent_pred(false) {
   if (!static_constructed) {
     num_opcodes = sizeof(opcode_names) / sizeof(opcode_names[0]);
     for (size_t i=0; i < num_opcodes; i++) {
@@ -108,25 +108,41 @@ std::vector<Morpheme> PerceptronSpec::untagged_sentinel;
 LexicalUnit PerceptronSpec::token_wordoids_underflow;
 LexicalUnit PerceptronSpec::token_wordoids_overflow;
 
-void PerceptronSpec::get_features(
+bool PerceptronSpec::get_features(
     const TaggedSentence &tagged, const Sentence &untagged,
     int token_idx, int wordoid_idx,
-    UnaryFeatureVec &feat_vec_out) const {
+    UnaryFeatureVec &feat_vec_out,
+    FeatureSelection selection) const {
   size_t i;
+  bool dependent_part = selection == HISTORY_DEPENDENT_FEATURES;
+  assert(feature_progs.size() == features.size());
   global_results.clear();
-  if (global_pred.size() > 0) {
+  if (global_pred.size() > 0 &&
+      (selection == ALL_FEATURES || history_dependent_pred == dependent_part)) {
     Machine machine(
-      *this, global_pred, 0, false,
+      *this, pred_prog, 0, false,
       tagged, untagged, token_idx, wordoid_idx);
     StackValue result = machine.getValue();
     assert(result.type == BVAL);
     if (!result.boolVal()) {
-      return;
+      return false;
     }
   }
+  if (dependent_part &&
+      std::find(history_dependent_features.begin(),
+                history_dependent_features.end(),
+                true) == history_dependent_features.end()) {
+    return true;
+  }
   for (i = 0; i < global_defns.size(); i++) {
+    if (selection == HISTORY_INDEPENDENT_FEATURES &&
+        history_dependent_globals[i]) {
+      // Only ever read by history dependent programs
+      global_results.push_back(StackValue(0));
+      continue;
+    }
     Machine machine(
-      *this, global_defns[i], i, false,
+      *this, global_progs[i], i, false,
       tagged, untagged, token_idx, wordoid_idx);
     global_results.push_back(machine.getValue());
   }
@@ -134,6 +150,10 @@ void PerceptronSpec::get_features(
   UnaryFeatureVec feat_vec_delta;
   for (i = 0; i < features.size(); i++) {
     //feat_it = features.begin(); feat_it != features.end(); feat_it++) {
+    if (selection != ALL_FEATURES &&
+        history_dependent_features[i] != dependent_part) {
+      continue;
+    }
     feat_vec_delta.clear();
     feat_vec_delta.push_back(FeatureKey());
     FeatureKey &fk = feat_vec_delta.back();
@@ -141,12 +161,13 @@ void PerceptronSpec::get_features(
     prg_id = i;
     fk.push_back(prg_id); // Each feature is tagged with the <feat> which created it to avoid collisions
     Machine machine(
-      *this, features[i], i, true,
+      *this, feature_progs[i], i, true,
       tagged, untagged, token_idx, wordoid_idx);
     machine.getFeature(feat_vec_delta);
     feat_vec_out.insert(feat_vec_out.end(),
                         feat_vec_delta.begin(), feat_vec_delta.end());
   }
+  return true;
 }
 
 std::string
@@ -166,30 +187,423 @@ void PerceptronSpec::clearCache() const
   coarsen_cache.clear();
 }
 
-std::string PerceptronSpec::dot = ".";
+namespace {
+/* An integer on the stack of a program as far as the history analysis can
+ * tell: an offset from the token or wordoid address being predicted, a
+ * constant, or anything else. */
+struct AbstractInt {
+  enum Base { TOKEN, WORDOID, CONSTANT, UNKNOWN };
+  Base base;
+  int offset;
+  AbstractInt(Base base = UNKNOWN, int offset = 0)
+    : base(base), offset(offset) {}
+};
 
-const std::string&
-PerceptronSpec::Machine::get_str_operand() {
-  size_t idx = *(++bytecode_iter);
-  if (idx == 255) {
-    return dot;
+AbstractInt
+operator+(AbstractInt a, AbstractInt b) {
+  if (a.base == AbstractInt::CONSTANT) {
+    std::swap(a, b);
+  }
+  if (a.base == AbstractInt::UNKNOWN || b.base != AbstractInt::CONSTANT) {
+    return AbstractInt();
   }
-  return spec.str_consts[idx];
+  return AbstractInt(a.base, a.offset + b.offset);
 }
 
-const VMSet&
-PerceptronSpec::Machine::get_set_operand() {
-  return spec.set_consts[*(++bytecode_iter)];
+/* The tagged token at this address is the one being predicted or a sentinel,
+ * never one from the history. */
+bool
+isOutsideHistory(const AbstractInt &tok) {
+  return (tok.base == AbstractInt::TOKEN && tok.offset >= 0) ||
+         (tok.base == AbstractInt::CONSTANT && tok.offset < 0);
+}
+
+bool
+isNonNegative(const AbstractInt &wrd) {
+  return (wrd.base == AbstractInt::WORDOID ||
+          wrd.base == AbstractInt::CONSTANT) && wrd.offset >= 0;
+}
+
+/* Walks a program once, following the addresses it computes closely enough
+ * to tell whether any tagged token it reads might be from the history.
+ * Anything it can not follow counts as reading the history. */
+class HistoryAnalysis {
+  const PerceptronSpec::Program &prog;
+  const std::vector<bool> &history_dependent_globals;
+  std::vector<AbstractInt> stack;
+  std::vector<size_t> loop_depths;
+  bool lost;
+
+  AbstractInt pop() {
+    if (stack.empty()) {
+      lost = true;
+      return AbstractInt();
+    }
+    AbstractInt top = stack.back();
+    stack.pop_back();
+    return top;
+  }
+  void pop(size_t n) {
+    while (n-- > 0) {
+      pop();
+    }
+  }
+  void push(const AbstractInt &val) {
+    stack.push_back(val);
+  }
+  void pushUnknown(size_t n) {
+    stack.resize(stack.size() + n);
+  }
+  bool step(const PerceptronSpec::Instruction &instr);
+public:
+  HistoryAnalysis(const PerceptronSpec::Program &prog,
+                  const std::vector<bool> &history_dependent_globals)
+    : prog(prog), history_dependent_globals(history_dependent_globals),
+      lost(false) {}
+  bool readsHistory();
+};
+
+bool
+HistoryAnalysis::readsHistory() {
+  PerceptronSpec::Program::const_iterator it;
+  for (it = prog.begin(); it != prog.end(); it++) {
+    if (step(*it) || lost) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Returns true if instr might read the history */
+bool
+HistoryAnalysis::step(const PerceptronSpec::Instruction &instr) {
+  typedef PerceptronSpec VM;
+  switch (instr.op) {
+    /* Address arithmetic */
+    case VM::PUSHINT:
+      push(AbstractInt(AbstractInt::CONSTANT, instr.operand));
+      break;
+    case VM::PUSHTOKADDR:
+      push(AbstractInt(AbstractInt::TOKEN));
+      break;
+    case VM::PUSHWRDADDR:
+      push(AbstractInt(AbstractInt::WORDOID));
+      break;
+    case VM::PUSHADDR:
+      push(AbstractInt(AbstractInt::TOKEN));
+      push(AbstractInt(AbstractInt::WORDOID));
+      break;
+    case VM::ADI: {
+      AbstractInt a = pop();
+      push(a + AbstractInt(AbstractInt::CONSTANT, instr.operand));
+    } break;
+    case VM::ADD: {
+      AbstractInt b = pop();
+      AbstractInt a = pop();
+      push(a + b);
+    } break;
+    case VM::ADD2: {
+      AbstractInt b2 = pop();
+      AbstractInt b1 = pop();
+      AbstractInt a2 = pop();
+      AbstractInt a1 = pop();
+      push(a1 + b1);
+      push(a2 + b2);
+    } break;
+    case VM::DUP: {
+      AbstractInt a = pop();
+      push(a);
+      push(a);
+    } break;
+    case VM::DUP2: {
+      AbstractInt b = pop();
+      AbstractInt a = pop();
+      push(a);
+      push(b);
+      push(a);
+      push(b);
+    } break;
+    case VM::SWAP: {
+      AbstractInt b = pop();
+      AbstractInt a = pop();
+      push(b);
+      push(a);
+    } break;
+    case VM::SENTLENTAGGEDTOK:
+      // The tagged sentence ends with the token being predicted
+      push(AbstractInt(AbstractInt::TOKEN, 1));
+      break;
+    case VM::CLAMPTAGGEDTOKADDR: {
+      AbstractInt tok = pop();
+      if (tok.base == AbstractInt::TOKEN && tok.offset >= 0) {
+        push(AbstractInt(AbstractInt::TOKEN));
+      } else {
+        push(AbstractInt());
+      }
+    } break;
+
+    /* Tagged input */
+    case VM::CLAMPADDR: {
+      pop();
+      AbstractInt tok = pop();
+      if (tok.base != AbstractInt::TOKEN || tok.offset < 0) {
+        return true;
+      }
+      push(AbstractInt(AbstractInt::TOKEN));
+      push(AbstractInt());
+    } break;
+    case VM::ADJADDR: {
+      // Only moves between tokens from within the tagged sentence, and then
+      // backwards for a negative wordoid address
+      AbstractInt wrd = pop();
+      AbstractInt tok = pop();
+      bool outside = (tok.base == AbstractInt::TOKEN && tok.offset > 0) ||
+                     (tok.base == AbstractInt::CONSTANT && tok.offset < 0);
+      bool current = tok.base == AbstractInt::TOKEN && tok.offset == 0 &&
+                     isNonNegative(wrd);
+      if (!outside && !current) {
+        return true;
+      }
+      push(tok);
+      push(wrd);
+    } break;
+    case VM::GETWRD:
+    case VM::ISVALIDADDR:
+      pop();
+      if (!isOutsideHistory(pop())) {
+        return true;
+      }
+      pushUnknown(1);
+      break;
+    case VM::EXWRDARR:
+    case VM::TOKLENWRD:
+      if (!isOutsideHistory(pop())) {
+        return true;
+      }
+      pushUnknown(1);
+      break;
+    case VM::GETGVAR: {
+      size_t slot = instr.operand;
+      if (slot >= history_dependent_globals.size() ||
+          history_dependent_globals[slot]) {
+        return true;
+      }
+      pushUnknown(1);
+    } break;
+
+    /* Flow control */
+    case VM::FOREACHINIT:
+      pop();
+      loop_depths.push_back(stack.size());
+      break;
+    case VM::FOREACH:
+      break;
+    case VM::ENDFOREACH:
+      // The body leaves at most one value for the accumulator, which replaces
+      // it once the loop finishes
+      if (loop_depths.empty()) {
+        return true;
+      }
+      stack.resize(loop_depths.back());
+      loop_depths.pop_back();
+      pushUnknown(1);
+      break;
+
+    /* Everything else */
+    case VM::SENTLENTOK:
+    case VM::SENTLENWRD:
+      pushUnknown(1);
+      break;
+    case VM::GETVAR:
+      pushUnknown(1);
+      break;
+    case VM::NOT:
+    case VM::CLAMPTOKADDR:
+    case VM::EXTOKSURF:
+    case VM::EXWRDLEMMA:
+    case VM::EXWRDCOARSETAG:
+    case VM::EXAMBGSET:
+    case VM::EXTAGS:
+    case VM::ISVALIDTOKADDR:
+    case VM::ISVALIDTAGGEDTOKADDR:
+    case VM::CPYSTR:
+    case VM::LOWER:
+    case VM::LOWERARR:
+    case VM::STRLEN:
+    case VM::ARRLEN:
+      pop();
+      pushUnknown(1);
+      break;
+    case VM::STREQ:
+    case VM::STRIN:
+    case VM::FILTERIN:
+    case VM::SETHAS:
+    case VM::SETHASANY:
+    case VM::SETHASALL:
+    case VM::HASSUBSTR:
+    case VM::HASANYSUBSTR:
+    case VM::SUBSCRIPT:
+    case VM::JOIN:
+    case VM::SLICE:
+      pop();
+      pushUnknown(1);
+      break;
+    case VM::OR:
+    case VM::AND:
+    case VM::LT:
+    case VM::LTE:
+    case VM::GT:
+    case VM::GTE:
+    case VM::EQ:
+    case VM::NEQ:
+      pop(2);
+      pushUnknown(1);
+      break;
+    case VM::DIEIFFALSE:
+    case VM::FCATSTRARR:
+    case VM::FCATSTR:
+    case VM::FCATBOOL:
+    case VM::FCATINT:
+      pop();
+      break;
+    default:
+      return true;
+  }
+  return false;
+}
+}
+
+bool
+PerceptronSpec::readsHistory(const Program &prog) const
+{
+  return HistoryAnalysis(prog, history_dependent_globals).readsHistory();
+}
+
+void
+PerceptronSpec::analyseHistory()
+{
+  size_t i;
+  history_dependent_globals.clear();
+  for (i = 0; i < global_defns.size(); i++) {
+    // Globals may only read the ones before them
+    history_dependent_globals.push_back(readsHistory(global_progs[i]));
+  }
+  history_dependent_pred = pred_prog.size() > 0 && readsHistory(pred_prog);
+  history_dependent_features.clear();
+  for (i = 0; i < features.size(); i++) {
+    history_dependent_features.push_back(readsHistory(feature_progs[i]));
+  }
+}
+
+void
+PerceptronSpec::decodeProgram(const FeatureDefn &defn, Program &prog)
+{
+  prog.clear();
+  // The instruction each byte belongs to, to resolve jumps
+  std::vector<size_t> instr_idx(defn.size());
+  size_t addr = 0;
+  while (addr < defn.size()) {
+    Instruction instr;
+    instr.op = defn[addr];
+    instr.operand = 0;
+    instr.operand2 = 0;
+    instr.address = addr;
+    size_t num_operands = 0;
+    switch (instr.op) {
+      case FOREACH:
+      case SLICE:
+        num_operands = 2;
+        break;
+      case ADI:
+      case PUSHINT:
+      case ENDFOREACH:
+      case GETGVAR:
+      case GETVAR:
+      case STREQ:
+      case STRIN:
+      case FILTERIN:
+      case SETHAS:
+      case SETHASANY:
+      case SETHASALL:
+      case HASSUBSTR:
+      case HASANYSUBSTR:
+      case SUBSCRIPT:
+      case JOIN:
+        num_operands = 1;
+        break;
+      default:
+        break;
+    }
+    assert(addr + num_operands < defn.size());
+    switch (instr.op) {
+      case ADI:
+      case PUSHINT:
+        instr.operand = (signed char)defn[addr + 1];
+        break;
+      case SLICE:
+        instr.operand = (signed char)defn[addr + 1];
+        instr.operand2 = (signed char)defn[addr + 2];
+        break;
+      case FOREACH:
+        instr.operand = defn[addr + 1];
+        instr.operand2 = defn[addr + 2];
+        break;
+      default:
+        if (num_operands > 0) {
+          instr.operand = defn[addr + 1];
+        }
+        break;
+    }
+    for (size_t i = 0; i <= num_operands; i++) {
+      instr_idx[addr + i] = prog.size();
+    }
+    prog.push_back(instr);
+    addr += num_operands + 1;
+  }
+  // Jump offsets are relative to the last operand byte of the jump
+  Program::iterator it;
+  for (it = prog.begin(); it != prog.end(); it++) {
+    if (it->op == FOREACH) {
+      size_t target = it->address + 2 + it->operand2;
+      assert(target < defn.size());
+      it->operand2 = instr_idx[target];
+    } else if (it->op == ENDFOREACH) {
+      size_t target = it->address + 1 - it->operand;
+      assert(target < defn.size());
+      it->operand = instr_idx[target];
+    }
+  }
+}
+
+void
+PerceptronSpec::decode()
+{
+  size_t i;
+  decodeProgram(global_pred, pred_prog);
+  global_progs.resize(global_defns.size());
+  for (i = 0; i < global_defns.size(); i++) {
+    decodeProgram(global_defns[i], global_progs[i]);
+  }
+  feature_progs.resize(features.size());
+  for (i = 0; i < features.size(); i++) {
+    decodeProgram(features[i], feature_progs[i]);
+  }
+  analyseHistory();
 }
 
-int
-PerceptronSpec::Machine::get_int_operand() {
-  return (Bytecode){.uintbyte=*(++bytecode_iter)}.intbyte;
+std::string PerceptronSpec::dot = ".";
+
+const std::string&
+PerceptronSpec::Machine::get_str_operand(const Instruction &instr) {
+  if (instr.operand == 255) {
+    return dot;
+  }
+  return spec.str_consts[instr.operand];
 }
 
-unsigned int
-PerceptronSpec::Machine::get_uint_operand() {
-  return (Bytecode){.uintbyte=*(++bytecode_iter)}.uintbyte;
+const VMSet&
+PerceptronSpec::Machine::get_set_operand(const Instruction &instr) {
+  return spec.set_consts[instr.operand];
 }
 
 const LexicalUnit&
@@ -237,7 +651,7 @@ PerceptronSpec::Machine::get_wordoid(const TaggedSentence &tagged) {
 
 PerceptronSpec::Machine::Machine(
     const PerceptronSpec &spec,
-    const FeatureDefn &feat,
+    const Program &prog,
     size_t feat_idx,
     bool is_feature,
     const TaggedSentence &tagged,
@@ -245,8 +659,8 @@ PerceptronSpec::Machine::Machine(
     int token_idx,
     int wordoid_idx
     )
-  : spec(spec), is_feature(is_feature), feat(feat), feat_idx(feat_idx),
-    bytecode_iter(feat.begin()), tagged(tagged), untagged(untagged),
+  : spec(spec), is_feature(is_feature), prog(prog), feat_idx(feat_idx),
+    pc(0), tagged(tagged), untagged(untagged),
     token_idx(token_idx), wordoid_idx(wordoid_idx) {}
 
 
@@ -273,8 +687,8 @@ slice(T &vec, int begin, int end) {
   vec.assign(vec.begin() + begin, vec.begin() + end);
 }
 
-template <typename T> static T
-subscript(std::vector<T> vec, int idx) {
+template <typename T> static const T&
+subscript(const std::vector<T> &vec, int idx) {
   if (idx < 0) {
     idx = vec.size() - idx;
   }
@@ -285,21 +699,21 @@ subscript(std::vector<T> vec, int idx) {
 void
 PerceptronSpec::Machine::traceMachineState()
 {
-  std::wcerr << "pc: " << bytecode_iter - feat.begin() << "\n";
+  std::wcerr << "pc: " << pc << " address: " << prog[pc].address << "\n";
   std::wcerr << "peek: ";
-  std::wcerr << *bytecode_iter;
-  if (*bytecode_iter < num_opcodes) {
-    std::wcerr << " (" << opcode_names[*bytecode_iter].c_str() << ")";
+  std::wcerr << prog[pc].op;
+  if (prog[pc].op < num_opcodes) {
+    std::wcerr << " (" << opcode_names[prog[pc].op].c_str() << ")";
   }
   std::wcerr << "\n";
   std::wcerr << "stack: " << stack << "\n";
 }
 
 bool
-PerceptronSpec::Machine::execCommonOp(Opcode op)
+PerceptronSpec::Machine::execCommonOp(const Instruction &instr)
 {
   //traceMachineState();
-  switch (op) {
+  switch (instr.op) {
     case OR:
       stack.push(stack.pop_off().boolVal() || stack.pop_off().boolVal());
       break;
@@ -310,7 +724,7 @@ PerceptronSpec::Machine::execCommonOp(Opcode op)
       stack.push(!stack.pop_off().boolVal());
       break;
     case ADI:
-      stack.push(stack.pop_off().intVal() + get_int_operand());
+      stack.push(stack.pop_off().intVal() + instr.operand);
       break;
     case ADD:
       stack.push(stack.pop_off().intVal() + stack.pop_off().intVal());
@@ -324,7 +738,7 @@ PerceptronSpec::Machine::execCommonOp(Opcode op)
       stack.push(a2 + b2);
     } break;
     case PUSHINT:
-      stack.push(get_int_operand());
+      stack.push(instr.operand);
       break;
     case LT:
       stack.push(stack.pop_off().intVal() < stack.pop_off().intVal());
@@ -356,23 +770,23 @@ PerceptronSpec::Machine::execCommonOp(Opcode op)
       stack.push(b);
     } break;
     case FOREACHINIT: {
-      loop_stack.push_back((LoopState){
-          .initial_stack=stack.size() - 1,
-          .iterable=stack.pop_off(),
-          .iteration=0,
-          .accumulator=StackValue(0)});
+      loop_stack.push_back(LoopState());
+      LoopState &loop_state = loop_stack.back();
+      loop_state.initial_stack = stack.size() - 1;
+      swap(loop_state.iterable, stack.top());
+      stack.pop();
+      loop_state.iteration = 0;
     } break;
     case FOREACH: {
       //std::wcerr << "size: " << loop_stack.back().iterable.size()
                  //<< " iteration: " << loop_stack.back().iteration << "\n";
-      //std::wcerr << "foreach pc: " << bytecode_iter - feat.begin() << "\n";
-      size_t slot = get_uint_operand();
-      size_t end_offset = get_uint_operand();
-      //std::wcerr << "after foreach pc: " << bytecode_iter - feat.begin() << "\n";
+      //std::wcerr << "foreach pc: " << pc << "\n";
+      size_t slot = instr.operand;
       if (loop_stack.back().iteration == loop_stack.back().iterable.size()) {
-        stack.push(loop_stack.back().accumulator);
+        stack.push(StackValue());
+        swap(stack.top(), loop_stack.back().accumulator);
         loop_stack.pop_back();
-        bytecode_iter += end_offset;
+        pc = instr.operand2;
         break;
       }
       if (slots.size() <= slot) {
@@ -407,23 +821,22 @@ PerceptronSpec::Machine::execCommonOp(Opcode op)
         stack.pop();
         loop_state.iteration++;
       }
-      size_t begin_offset = get_uint_operand();
-      bytecode_iter -= begin_offset;
+      pc = instr.operand;
     } break;
     case GETGVAR: {
-      int slot = get_uint_operand();
+      int slot = instr.operand;
       //std::wcerr << "GETGVAR " << slot << " " << spec.global_results[slot] << "\n";
       stack.push(spec.global_results[slot]);
     } break;
     case GETVAR: {
-      int slot = get_uint_operand();
+      int slot = instr.operand;
       stack.push(slots[slot]);
     } break;
     case STREQ:
-      stack.push(get_str_operand() == stack.pop_off().str());
+      stack.push(get_str_operand(instr) == stack.pop_off().str());
       break;
     case STRIN: {
-      stack.push(In(get_set_operand())(stack.pop_off().str()));
+      stack.push(In(get_set_operand(instr))(stack.pop_off().str()));
     } break;
     case PUSHTOKADDR:
       stack.push(token_idx);
@@ -473,7 +886,7 @@ PerceptronSpec::Machine::execCommonOp(Opcode op)
       break;
     case GETWRD: {
       //std::wcerr << "GETWRD start\n";
-      stack.push(get_wordoid(tagged));
+      stack.push(StackValue::borrow(get_wordoid(tagged)));
       //std::wcerr << "GETWRD done\n";
     } break;
     case EXTOKSURF: {
@@ -532,7 +945,7 @@ PerceptronSpec::Machine::execCommonOp(Opcode op)
     case SENTLENTAGGEDTOK:
       stack.push((int)tagged.size());
       break;
-    case SENTLENWRD: unimplemented_opcode("SENTLENWRD"); break; // How can we know?
+    case SENTLENWRD: unimplemented_opcode(SENTLENWRD); break; // How can we know?
     case TOKLENWRD: {
       int target_token_idx = stack.pop_off().intVal();
       assert(0 <= target_token_idx && (size_t)target_token_idx < tagged.size());
@@ -560,85 +973,94 @@ PerceptronSpec::Machine::execCommonOp(Opcode op)
     case EXWRDARR: {
       int token_idx = stack.pop_off().intVal();
       if (token_idx < 0) {
-        stack.push(token_wordoids_underflow.TheAnalyses[0].TheMorphemes);
+        stack.push(StackValue::borrow(
+            token_wordoids_underflow.TheAnalyses[0].TheMorphemes));
       } else if ((size_t)token_idx >= tagged.size()) {
-        stack.push(token_wordoids_overflow.TheAnalyses[0].TheMorphemes);
+        stack.push(StackValue::borrow(
+            token_wordoids_overflow.TheAnalyses[0].TheMorphemes));
       } else {
-        stack.push(tagged_to_wordoids(tagged[token_idx]));
+        stack.push(StackValue::borrow(tagged_to_wordoids(tagged[token_idx])));
       }
     } break;
     case FILTERIN: {
-      const VMSet& set_op = get_set_operand();
+      const VMSet& set_op = get_set_operand(instr);
       std::vector<std::string> &str_arr = stack.top().strArr();
       str_arr.erase(std::remove_if(
           str_arr.begin(), str_arr.end(), std::not1(In(set_op))));
     } break;
     /*
     case SETHAS: {
-      const VMSet& set_op = get_set_operand();
+      const VMSet& set_op = get_set_operand(instr);
       std::string str = stack.pop_off().str();
       stack.push(set_op.find(str) != set_op.end());
     } break;
     */
     case SETHASANY: {
-      const VMSet& set_op = get_set_operand();
-      std::vector<std::string> str_arr = stack.pop_off().strArr();
+      const VMSet& set_op = get_set_operand(instr);
+      StackValue arr = stack.pop_off();
+      std::vector<std::string> &str_arr = arr.strArr();
       stack.push(
         std::find_if(str_arr.begin(), str_arr.end(), In(set_op)) !=
         str_arr.end()
       );
     } break;
     case SETHASALL: {
-      const VMSet& set_op = get_set_operand();
-      std::vector<std::string> str_arr = stack.pop_off().strArr();
+      const VMSet& set_op = get_set_operand(instr);
+      StackValue arr = stack.pop_off();
+      std::vector<std::string> &str_arr = arr.strArr();
       stack.push(
         std::find_if(str_arr.begin(), str_arr.end(), std::not1(In(set_op))) ==
         str_arr.end()
       );
     } break;
     case HASSUBSTR: {
-      std::string haystack = stack.pop_off().str();
-      std::string needle = get_str_operand();
-      stack.push(haystack.find(needle) != std::string::npos);
+      bool found = stack.top().str().find(get_str_operand(instr)) != std::string::npos;
+      stack.pop();
+      stack.push(found);
     } break;
-    case HASANYSUBSTR: unimplemented_opcode("HASANYSUBSTR"); break;
-    case CPYSTR: unimplemented_opcode("CPYSTR"); break;
+    case HASANYSUBSTR: unimplemented_opcode(HASANYSUBSTR); break;
+    case CPYSTR: unimplemented_opcode(CPYSTR); break;
     case LOWER: {
       // XXX: Eek! Bad! No Unicode. ICU please.
       std::string &str = stack.top().str();
       std::transform(str.begin(), str.end(), str.begin(), ::tolower);
     } break;
     case SLICE: {
-      int begin = get_int_operand();
-      int end = get_int_operand();
+      int begin = instr.operand;
+      int end = instr.operand2;
       if (stack.top().type == STRVAL) {
         slice(stack.top().str(), begin, end);
       } else if (stack.top().type == STRARRVAL) {
         slice(stack.top().strArr(), begin, end);
       } else if (stack.top().type == WRDARRVAL) {
+        stack.top().own();
         slice(stack.top().wrdArr(), begin, end);
       }
     } break;
     case SUBSCRIPT: {
-      size_t idx = get_uint_operand();
+      size_t idx = instr.operand;
       if (stack.top().type == STRARRVAL) {
-        stack.push(subscript(stack.pop_off().strArr(), idx));
+        StackValue arr = stack.pop_off();
+        stack.push(subscript(arr.strArr(), idx));
       } else if (stack.top().type == WRDARRVAL) {
-        stack.push(subscript(stack.pop_off().wrdArr(), idx));
+        StackValue arr = stack.pop_off();
+        const Morpheme &wrd = subscript(arr.wrdArr(), idx);
+        stack.push(arr.borrowed ? StackValue::borrow(wrd) : StackValue(wrd));
       }
     } break;
     case STRLEN: {
-      std::string str = stack.pop_off().str();
-      stack.push((int)str.length());
+      int str_len = stack.pop_off().str().length();
+      stack.push(str_len);
     } break;
     case ARRLEN: {
       int str_arr_len = stack.pop_off().strArr().size();
       stack.push(str_arr_len);
     } break;
     case JOIN: {
-      const std::string &sep = get_str_operand();
+      const std::string &sep = get_str_operand(instr);
       std::stringstream ss;
-      std::vector<std::string> str_arr = stack.pop_off().strArr();
+      StackValue arr = stack.pop_off();
+      std::vector<std::string> &str_arr = arr.strArr();
       std::vector<std::string>::const_iterator it;
       for (it = str_arr.begin(); it != str_arr.end(); it++) {
         ss << *it;
@@ -657,12 +1079,12 @@ PerceptronSpec::Machine::execCommonOp(Opcode op)
 void
 PerceptronSpec::Machine::getFeature(
     UnaryFeatureVec &feat_vec_out) {
-  for (; bytecode_iter != feat.end(); bytecode_iter++) {
-    Opcode op = (Bytecode){.intbyte=static_cast<signed char>(*bytecode_iter)}.op;
-    if (execCommonOp(op)) {
+  for (; pc < prog.size(); pc++) {
+    const Instruction &instr = prog[pc];
+    if (execCommonOp(instr)) {
       continue;
     }
-    switch ((Bytecode){.intbyte=static_cast<signed char>(*bytecode_iter)}.op) {
+    switch (instr.op) {
       case DIEIFFALSE:
         if (!stack.pop_off().boolVal()) {
           feat_vec_out.clear();
@@ -707,7 +1129,7 @@ PerceptronSpec::Machine::getFeature(
         stack.pop();
       } break;
       default:
-        unimplemented_opcode(opcode_names[*bytecode_iter]);
+        unimplemented_opcode(instr.op);
         break;
     }
   }
@@ -717,12 +1139,11 @@ PerceptronSpec::Machine::getFeature(
 PerceptronSpec::StackValue
 PerceptronSpec::Machine::getValue()
 {
-  for (; bytecode_iter != feat.end(); bytecode_iter++) {
-    Opcode op = (Bytecode){.intbyte=static_cast<signed char>(*bytecode_iter)}.op;
-    if (execCommonOp(op)) {
+  for (; pc < prog.size(); pc++) {
+    if (execCommonOp(prog[pc])) {
       continue;
     }
-    unimplemented_opcode(opcode_names[*bytecode_iter]);
+    unimplemented_opcode(prog[pc].op);
   }
   StackValue result = stack.pop_off();
   assert(stack.empty());
@@ -730,11 +1151,16 @@ PerceptronSpec::Machine::getValue()
 }
 
 void
-PerceptronSpec::Machine::unimplemented_opcode(std::string opstr) {
-  int bytecode_idx = bytecode_iter - feat.begin();
+PerceptronSpec::Machine::unimplemented_opcode(unsigned char op) {
+  int bytecode_idx = prog[pc].address;
   std::stringstream msg;
-  msg << "Unimplemented opcode: " << opstr
-      << " at " << (is_feature ? "feature" : "global") << " #" << feat_idx << " address #" << bytecode_idx;
+  msg << "Unimplemented opcode: ";
+  if (op < num_opcodes) {
+    msg << opcode_names[op];
+  } else {
+    msg << (int)op;
+  }
+  msg << " at " << (is_feature ? "feature" : "global") << " #" << feat_idx << " address #" << bytecode_idx;
   throw Apertium::Exception::apertium_tagger::UnimplementedOpcode(msg);
 }
 
@@ -821,6 +1247,7 @@ void PerceptronSpec::deserialise(std::istream &serialised) {
   deserialiseFeatDefnVec(serialised, features);
   deserialiseFeatDefnVec(serialised, global_defns);
   deserialiseFeatDefn(serialised, global_pred);
+  decode();
   if (serialised.eof()) {
     return;
   }
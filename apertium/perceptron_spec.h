@@ -220,14 +220,22 @@ public:
 
       swap(a.payload, b.payload);
       swap(a.type, b.type);
+      swap(a.borrowed, b.borrowed);
     }
     // Smart pointer + tagged union safe to store in STL types
-    StackValue() {}
+    StackValue() : type(INTVAL), borrowed(false) {
+      payload.intval = 0;
+    }
     StackValue(const StackValue &other) {
       // C++11: Probably reference counting with shared_ptr would be better
       // than all this copying if it were available
       //std::wcerr << "StackValue init\n";
       type = other.type;
+      borrowed = other.borrowed;
+      if (borrowed) {
+        payload = other.payload;
+        return;
+      }
       switch (type) {
         case STRVAL:
           payload.strval = new std::string(*other.payload.strval);
@@ -255,18 +263,22 @@ public:
     StackValue(int intval) {
       payload.intval = intval;
       type = INTVAL;
+      borrowed = false;
     }
     StackValue(bool bval) {
       payload.bval = bval;
       type = BVAL;
+      borrowed = false;
     }
     StackValue(const std::string &strval) {
       payload.strval = new std::string(strval);
       type = STRVAL;
+      borrowed = false;
     }
     StackValue(const std::vector<std::string> &strarrval) {
       payload.strarrval = new std::vector<std::string>(strarrval);
       type = STRARRVAL;
+      borrowed = false;
     }
     StackValue(const Morpheme &wordoid) {
       /*std::wcerr << L"Before ";
@@ -285,28 +297,67 @@ public:
       }
       std::wcerr << L"\n";*/
       type = WRDVAL;
+      borrowed = false;
     }
     StackValue(const std::vector<Morpheme> &wordoids) {
       payload.wrdarrval = new std::vector<Morpheme>(wordoids);
       type = WRDARRVAL;
+      borrowed = false;
     }
     StackValue(std::string *strval) {
       payload.strval = strval;
       type = STRVAL;
+      borrowed = false;
     }
     StackValue(std::vector<std::string> *strarrval) {
       payload.strarrval = strarrval;
       type = STRARRVAL;
+      borrowed = false;
     }
     StackValue(Morpheme *wordoid) {
       payload.wrdval = wordoid;
       type = WRDVAL;
+      borrowed = false;
     }
     StackValue(std::vector<Morpheme> *wordoids) {
       payload.wrdarrval = wordoids;
       type = WRDARRVAL;
+      borrowed = false;
+    }
+    /**
+     * Refer to a wordoid from the sentence or a sentinel, which outlive the
+     * machine, instead of copying it.  Copies are borrowed as well.
+     */
+    static StackValue borrow(const Morpheme &wordoid) {
+      StackValue val;
+      val.payload.wrdval = const_cast<Morpheme*>(&wordoid);
+      val.type = WRDVAL;
+      val.borrowed = true;
+      return val;
+    }
+    static StackValue borrow(const std::vector<Morpheme> &wordoids) {
+      StackValue val;
+      val.payload.wrdarrval = const_cast<std::vector<Morpheme>*>(&wordoids);
+      val.type = WRDARRVAL;
+      val.borrowed = true;
+      return val;
+    }
+    // Copy a borrowed value before modifying it
+    void own() {
+      if (!borrowed) {
+        return;
+      }
+      if (type == WRDVAL) {
+        payload.wrdval = new Morpheme(*payload.wrdval);
+      } else if (type == WRDARRVAL) {
+        payload.wrdarrval = new std::vector<Morpheme>(*payload.wrdarrval);
+      }
+      borrowed = false;
     }
     ~StackValue() {
+      if (borrowed) {
+        return;
+      }
       switch (type) {
         case STRVAL:
           delete payload.strval;
@@ -360,6 +411,9 @@ public:
       if (type == STRARRVAL) {
         return StackValue(strArr()[n]);
       } else if (type == WRDARRVAL) {
+        if (borrowed) {
+          return borrow(wrdArr()[n]);
+        }
         return StackValue(wrdArr()[n]);
       } else {
         assert(false);
@@ -374,12 +428,25 @@ public:
       std::vector<Morpheme>* wrdarrval;
     } payload;
     StackValueType type;
+    bool borrowed;
   };
   union Bytecode {
     Opcode op : 8;
     unsigned char uintbyte : 8;
     signed char intbyte : 8;
   };
+  /**
+   * An instruction decoded from the bytecode along with its operands.  The
+   * loop instructions hold the index of the instruction to jump to, from
+   * where execution carries on with the one after it.
+   */
+  struct Instruction {
+    unsigned char op; // an Opcode unless the bytecode is corrupt
+    int operand;
+    int operand2;
+    size_t address;
+  };
+  typedef std::vector<Instruction> Program;
   Optional<TaggerDataPercepCoarseTags> coarse_tags;
   static std::string dot;
   std::vector<std::string> str_consts;
@@ -388,26 +455,61 @@ public:
   std::vector<FeatureDefn> global_defns;
   std::vector<FeatureDefn> features;
   FeatureDefn global_pred;
-  void get_features(
+  /**
+   * Which features get_features() gathers.  History independent programs
+   * never read a tagged token before the one being predicted, so every
+   * agenda item extended with the same analysis gets the same features
+   * from them.
+   */
+  enum FeatureSelection {
+    ALL_FEATURES, HISTORY_INDEPENDENT_FEATURES, HISTORY_DEPENDENT_FEATURES
+  };
+  /**
+   * Gather the features of a wordoid of the last token of tagged.
+   *
+   * With HISTORY_INDEPENDENT_FEATURES or HISTORY_DEPENDENT_FEATURES only the
+   * global predicate of the same kind is checked, so the history dependent
+   * features of a wordoid only count if the history independent call for it
+   * returned true as well.
+   * @return false if the global predicate rules the wordoid out
+   */
+  bool get_features(
     const TaggedSentence &tagged, const Sentence &untagged,
     int token_idx, int wordoid_idx,
-    UnaryFeatureVec &feat_vec_out) const;
+    UnaryFeatureVec &feat_vec_out,
+    FeatureSelection selection = ALL_FEATURES) const;
+  /**
+   * Decode the bytecode of the global predicate, globals and features for
+   * execution and classify them as history dependent or not.  Must be
+   * called once the programs are compiled or deserialised.
+   */
+  void decode();
+  bool history_dependent_pred;
+  std::vector<bool> history_dependent_globals;
+  std::vector<bool> history_dependent_features;
   std::string coarsen(const Morpheme &wrd) const;
   void clearCache() const;
   int beam_width;
   mutable std::map<const Morpheme, std::string> coarsen_cache;
 private:
+  Program pred_prog;
+  std::vector<Program> global_progs;
+  std::vector<Program> feature_progs;
   class MachineStack {
-    std::deque<StackValue> data;
+    std::vector<StackValue> data;
     template <typename OStream> friend OStream& operator<<(OStream & out, MachineStack const &pt) {
       out << pt.data.size() << ": ";
-      std::deque<StackValue>::const_iterator it;
+      std::vector<StackValue>::const_iterator it;
       for (it = pt.data.begin(); it != pt.data.end(); it++) {
         out << it->payload.intval << " ";
       }
       return out;
     }
   public:
+    MachineStack() {
+      // Growing copies every value on the stack
+      data.reserve(16);
+    }
     void pop() {
       data.pop_back();
     }
@@ -426,7 +528,8 @@ private:
     }
     StackValue pop_off() {
       //std::wcerr << L"Top value: " << top().payload.intval << "\n";
-      StackValue ret = top();
+      StackValue ret;
+      swap(ret, top());
       pop();
       return ret;
     }
@@ -440,9 +543,9 @@ private:
   class Machine {
     const PerceptronSpec &spec;
     bool is_feature;
-    const FeatureDefn &feat;
+    const Program &prog;
     const size_t &feat_idx;
-    std::vector<unsigned char>::const_iterator bytecode_iter;
+    size_t pc;
     const TaggedSentence &tagged;
     const Sentence &untagged;
     int token_idx;
@@ -454,25 +557,23 @@ private:
       size_t iteration;
       StackValue accumulator;
     };
-    std::deque<LoopState> loop_stack;
+    std::vector<LoopState> loop_stack;
     std::vector<StackValue> slots;
-    void unimplemented_opcode(std::string opstr);
+    void unimplemented_opcode(unsigned char op);
     const LexicalUnit& get_token(const Sentence &untagged);
     const std::vector<Morpheme>& tagged_to_wordoids(const TaggedToken &tt);
     const Morpheme& get_wordoid(const TaggedSentence &tagged);
-    const VMSet& get_set_operand();
-    int get_int_operand();
-    unsigned int get_uint_operand();
-    const std::string& get_str_operand();
+    const VMSet& get_set_operand(const Instruction &instr);
+    const std::string& get_str_operand(const Instruction &instr);
     static std::string get_tag(const Tag &in);
-    bool execCommonOp(Opcode op);
+    bool execCommonOp(const Instruction &instr);
   public:
     void traceMachineState();
     void getFeature(UnaryFeatureVec &feat_vec_out);
     StackValue getValue();
     Machine(
       const PerceptronSpec &spec,
-      const FeatureDefn &feat,
+      const Program &prog,
       size_t feat_idx,
       bool is_feature,
       const TaggedSentence &tagged,
@@ -498,6 +599,9 @@ private:
     std::ostream &serialised, const std::vector<FeatureDefn> &defn_vec) const;
   void deserialiseFeatDefnVec(
     std::istream &serialised, std::vector<FeatureDefn> &defn_vec);
+  static void decodeProgram(const FeatureDefn &defn, Program &prog);
+  void analyseHistory();
+  bool readsHistory(const Program &prog) const;
 public:
   void serialise(std::ostream &serialised) const;
   void deserialise(std::istream &serialised);
@@ -1,4 +1,6 @@
+#include <apertium/exception.h>
 #include <apertium/mtx_reader.h>
+#include <apertium/parallel.h>
 #include <apertium/perceptron_tagger.h>
 #include <apertium/perceptron_spec.h>
 #include <apertium/wchar_t_exception.h>
@@ -8,7 +10,8 @@
 
 namespace Apertium {
 
-PerceptronTagger::PerceptronTagger(basic_Tagger::Flags flags) : basic_Tagger(flags) {};
+PerceptronTagger::PerceptronTagger(basic_Tagger::Flags flags)
+    : basic_Tagger(flags), threads(1), seed(0), evaluate_(false) {};
 
 PerceptronTagger::~PerceptronTagger() {};
 
@@ -18,6 +21,19 @@ void PerceptronTagger::tag(Stream &in, std::wostream &out) const {
 
 void PerceptronTagger::read_spec(const std::string &filename) {
   MTXReader(spec).read(filename);
+  spec.decode();
+}
+
+void PerceptronTagger::set_threads(const unsigned int &threads_) {
+  threads = threads_;
+}
+
+void PerceptronTagger::set_seed(const unsigned long &seed_) {
+  seed = seed_;
+}
+
+void PerceptronTagger::set_evaluate(const bool &evaluate) {
+  evaluate_ = evaluate;
 }
 
 std::wostream &
@@ -29,6 +45,30 @@ operator<<(std::wostream &out, PerceptronTagger const &pt) {
   return out;
 }
 
+void
+PerceptronTagger::getSharedFeatures(
+    const TaggedSentence &history, const Sentence &untagged_sent,
+    size_t token_idx, SharedFeatureTable &shared) const {
+  const std::vector<Analysis> &analyses =
+      untagged_sent[token_idx].TheLexicalUnit->TheAnalyses;
+  TaggedSentence tagged(history);
+  tagged.push_back(TaggedToken());
+  shared.resize(analyses.size());
+  for (size_t analys_idx = 0; analys_idx < analyses.size(); analys_idx++) {
+    tagged.back() = analyses[analys_idx];
+    size_t num_wordoids = analyses[analys_idx].TheMorphemes.size();
+    shared[analys_idx].resize(num_wordoids);
+    for (size_t wordoid_idx = 0; wordoid_idx < num_wordoids; wordoid_idx++) {
+      SharedFeatures &wordoid_shared = shared[analys_idx][wordoid_idx];
+      wordoid_shared.features.clear();
+      wordoid_shared.pred = spec.get_features(
+          tagged, untagged_sent, token_idx, wordoid_idx,
+          wordoid_shared.features, PerceptronSpec::HISTORY_INDEPENDENT_FEATURES);
+      wordoid_shared.score = weights * wordoid_shared.features;
+    }
+  }
+}
+
 TaggedSentence
 PerceptronTagger::tagSentence(const Sentence &untagged_sent) const {
   const size_t sent_len = untagged_sent.size();
@@ -39,6 +79,7 @@ PerceptronTagger::tagSentence(const Sentence &untagged_sent) const {
   agenda.back().tagged.reserve(sent_len);
 
   UnaryFeatureVec feat_vec_delta;
+  SharedFeatureTable shared;
   std::vector<Analysis>::const_iterator analys_it;
   std::vector<AgendaItem>::const_iterator agenda_it;
   std::vector<Morpheme>::const_iterator wordoid_it;
@@ -58,9 +99,13 @@ PerceptronTagger::tagSentence(const Sentence &untagged_sent) const {
       continue;
     }
 
+    getSharedFeatures(agenda.front().tagged, untagged_sent, token_idx, shared);
+
     for (agenda_it = agenda.begin(); agenda_it != agenda.end(); agenda_it++) {
       for (analys_it = analyses.begin(); analys_it != analyses.end(); analys_it++) {
         const std::vector<Morpheme> &wordoids = analys_it->TheMorphemes;
+        const std::vector<SharedFeatures> &analys_shared =
+            shared[analys_it - analyses.begin()];
 
         new_agenda.push_back(*agenda_it);
         AgendaItem &new_agenda_item = new_agenda.back();
@@ -68,16 +113,23 @@ PerceptronTagger::tagSentence(const Sentence &untagged_sent) const {
 
         for (wordoid_it = wordoids.begin(); wordoid_it != wordoids.end(); wordoid_it++) {
           int wordoid_idx = wordoid_it - wordoids.begin();
+          const SharedFeatures &wordoid_shared = analys_shared[wordoid_idx];
           feat_vec_delta.clear();
-          spec.get_features(new_agenda_item.tagged, untagged_sent,
-                            token_idx, wordoid_idx, feat_vec_delta);
+          if (!wordoid_shared.pred ||
+              !spec.get_features(new_agenda_item.tagged, untagged_sent,
+                                 token_idx, wordoid_idx, feat_vec_delta,
+                                 PerceptronSpec::HISTORY_DEPENDENT_FEATURES)) {
+            continue;
+          }
+          double score = wordoid_shared.score + weights * feat_vec_delta;
           if (TheFlags.getDebug()) {
-            FeatureVec fv(feat_vec_delta);
+            FeatureVec fv(wordoid_shared.features);
+            fv += feat_vec_delta;
             std::wcerr << "Token " << token_idx << "\t\tWordoid " << wordoid_idx << "\n";
             std::wcerr << fv;
-            std::wcerr << "Score: " << weights * feat_vec_delta << "\n";
+            std::wcerr << "Score: " << score << "\n";
           }
-          new_agenda_item.score += weights * feat_vec_delta;
+          new_agenda_item.score += score;
         }
       }
     }
@@ -124,6 +176,7 @@ bool PerceptronTagger::trainSentence(
   correct_sentence.tagged.reserve(sent_len);
 
   UnaryFeatureVec feat_vec_delta;
+  SharedFeatureTable shared;
   std::vector<Analysis>::const_iterator analys_it;
   std::vector<TrainingAgendaItem>::const_iterator agenda_it;
   std::vector<Morpheme>::const_iterator wordoid_it;
@@ -154,11 +207,15 @@ bool PerceptronTagger::trainSentence(
       }
     }
 
+    getSharedFeatures(agenda.front().tagged, untagged_sent, token_idx, shared);
+
     bool correct_available = false;
     for (agenda_it = agenda.begin(); agenda_it != agenda.end(); agenda_it++) {
       //std::wcerr << *agenda_it;
       for (analys_it = analyses.begin(); analys_it != analyses.end(); analys_it++) {
         const std::vector<Morpheme> &wordoids = analys_it->TheMorphemes;
+        const std::vector<SharedFeatures> &analys_shared =
+            shared[analys_it - analyses.begin()];
 
         new_agenda.push_back(*agenda_it);
         TrainingAgendaItem &new_agenda_item = new_agenda.back();
@@ -166,11 +223,17 @@ bool PerceptronTagger::trainSentence(
 
         for (wordoid_it = wordoids.begin(); wordoid_it != wordoids.end(); wordoid_it++) {
           int wordoid_idx = wordoid_it - wordoids.begin();
+          const SharedFeatures &wordoid_shared = analys_shared[wordoid_idx];
           feat_vec_delta.clear();
-          spec.get_features(new_agenda_item.tagged, untagged_sent,
-                            token_idx, wordoid_idx, feat_vec_delta);
-          new_agenda_item.vec += feat_vec_delta;
-          new_agenda_item.score += weights * feat_vec_delta;
+          if (wordoid_shared.pred &&
+              spec.get_features(new_agenda_item.tagged, untagged_sent,
+                                token_idx, wordoid_idx, feat_vec_delta,
+                                PerceptronSpec::HISTORY_DEPENDENT_FEATURES)) {
+            new_agenda_item.vec += wordoid_shared.features;
+            new_agenda_item.vec += feat_vec_delta;
+            new_agenda_item.score +=
+                wordoid_shared.score + weights * feat_vec_delta;
+          }
           if (agenda_it == correct_agenda_it && *analys_it == *tagged_tok) {
             correct_sentence = new_agenda_item;
             correct_available = true;
@@ -244,29 +307,181 @@ void PerceptronTagger::train(
     Stream &tagged,
     Stream &untagged,
     int iterations) {
-  FeatureVecAverager avg_weights(weights);
   TrainingCorpus tc(tagged, untagged, TheFlags.getSkipErrors(), TheFlags.getSentSeg());
-  size_t avail_skipped;
-  for (int i = 0; i < iterations; i++) {
-    std::wcerr << "Iteration " << i + 1 << " of " << iterations << "\n";
-    avail_skipped = 0;
-    tc.shuffle();
-    std::vector<TrainingSentence>::const_iterator si;
-    for (si = tc.sentences.begin(); si != tc.sentences.end(); si++) {
-      avail_skipped += trainSentence(*si, avg_weights);
-      spec.clearCache();
+  tc.seed(seed);
+  size_t avail_skipped = 0;
+  if (threads > 1) {
+    avail_skipped = trainParallel(tc, iterations);
+  } else {
+    FeatureVecAverager avg_weights(weights);
+    for (int i = 0; i < iterations; i++) {
+      std::wcerr << "Iteration " << i + 1 << " of " << iterations << "\n";
+      tc.shuffle();
+      avail_skipped = trainShard(tc.sentences.begin(), tc.sentences.end(),
+                                 avg_weights);
     }
+    avg_weights.average();
   }
-  avg_weights.average();
   if (avail_skipped) {
     std::wcerr << "Skipped " << tc.skipped << " sentences due to token "
                << "misalignment and " << avail_skipped << " sentences due to "
                << "tagged token being unavailable in untagged file out of "
                << tc.sentences.size() << " total sentences.\n";
   }
+  if (evaluate_) {
+    evaluate(tc.sentences);
+  }
   //std::wcerr << *this;
 }
 
+size_t PerceptronTagger::trainShard(
+    std::vector<TrainingSentence>::const_iterator begin,
+    std::vector<TrainingSentence>::const_iterator end,
+    FeatureVecAverager &avg_weights) {
+  size_t avail_skipped = 0;
+  std::vector<TrainingSentence>::const_iterator si;
+  for (si = begin; si != end; si++) {
+    avail_skipped += trainSentence(*si, avg_weights);
+    spec.clearCache();
+  }
+  return avail_skipped;
+}
+
+/**
+ * Trains a copy of the tagger on each shard of the corpus.  The copies have
+ * their own spec since its caches are not shared between threads.
+ */
+class PerceptronTagger::ShardTrainer : public ParallelTask {
+public:
+  struct Worker {
+    PerceptronTagger tagger;
+    FeatureVec totals;
+    unsigned int updates;
+    size_t avail_skipped;
+    Optional<wchar_t_Exception::PerceptronTagger::CorrectAnalysisUnavailable>
+        unavailable;
+    Optional<Exception::apertium_tagger::UnimplementedOpcode> unimplemented;
+    Worker(const PerceptronTagger &tagger_)
+        : tagger(tagger_), updates(0), avail_skipped(0) {}
+  };
+  std::vector<Worker> workers;
+
+  ShardTrainer(const PerceptronTagger &tagger,
+               const std::vector<TrainingSentence> &sentences_)
+      : workers(tagger.threads, Worker(tagger)), sentences(sentences_) {}
+
+  void run(unsigned int thread) {
+    Worker &worker = workers[thread];
+    size_t const num_shards = workers.size();
+    std::vector<TrainingSentence>::const_iterator begin =
+        sentences.begin() + sentences.size() * thread / num_shards;
+    std::vector<TrainingSentence>::const_iterator end =
+        sentences.begin() + sentences.size() * (thread + 1) / num_shards;
+    FeatureVecAverager avg_weights(worker.tagger.weights);
+    try {
+      worker.avail_skipped = worker.tagger.trainShard(begin, end, avg_weights);
+    } catch (const wchar_t_Exception::PerceptronTagger::CorrectAnalysisUnavailable &e) {
+      worker.unavailable = e;
+    } catch (const Exception::apertium_tagger::UnimplementedOpcode &e) {
+      worker.unimplemented = e;
+    }
+    avg_weights.addTotals(worker.totals);
+    worker.updates = avg_weights.getIterations();
+  }
+
+  /** Throw the error of the first shard which failed, if any */
+  void rethrow() const {
+    std::vector<Worker>::const_iterator worker;
+    for (worker = workers.begin(); worker != workers.end(); worker++) {
+      if (worker->unavailable) {
+        throw *worker->unavailable;
+      }
+      if (worker->unimplemented) {
+        throw *worker->unimplemented;
+      }
+    }
+  }
+private:
+  const std::vector<TrainingSentence> &sentences;
+};
+
+size_t PerceptronTagger::trainParallel(TrainingCorpus &tc, int iterations) {
+  // every weight vector over all the updates, summed
+  FeatureVec totals;
+  unsigned long updates = 0;
+  size_t avail_skipped = 0;
+  for (int i = 0; i < iterations; i++) {
+    std::wcerr << "Iteration " << i + 1 << " of " << iterations << "\n";
+    tc.shuffle();
+    ShardTrainer trainer(*this, tc.sentences);
+    runParallel(trainer, threads);
+    trainer.rethrow();
+
+    FeatureVec mixed;
+    avail_skipped = 0;
+    std::vector<ShardTrainer::Worker>::const_iterator worker;
+    for (worker = trainer.workers.begin(); worker != trainer.workers.end();
+         worker++) {
+      mixed += worker->tagger.weights;
+      totals += worker->totals;
+      updates += worker->updates;
+      avail_skipped += worker->avail_skipped;
+    }
+    for (size_t id = 0; id < mixed.size(); id++) {
+      mixed.values[id] /= trainer.workers.size();
+    }
+    weights = mixed;
+  }
+  if (updates > 0) {
+    FeatureVec averaged;
+    for (size_t id = 0; id < totals.size(); id++) {
+      if (totals.values[id] != 0) {
+        averaged.add(totals.keys[id], totals.values[id] / updates);
+      }
+    }
+    weights = averaged;
+  }
+  return avail_skipped;
+}
+
+void PerceptronTagger::evaluate(
+    const std::vector<TrainingSentence> &sentences) const {
+  size_t correct = 0;
+  size_t total = 0;
+  size_t ambiguous_correct = 0;
+  size_t ambiguous_total = 0;
+  std::vector<TrainingSentence>::const_iterator si;
+  for (si = sentences.begin(); si != sentences.end(); si++) {
+    const TaggedSentence &gold = si->first;
+    TaggedSentence tagged = tagSentence(si->second);
+    for (size_t token_idx = 0; token_idx < gold.size(); token_idx++) {
+      if (!gold[token_idx]) {
+        continue;
+      }
+      bool ambiguous =
+          si->second[token_idx].TheLexicalUnit->TheAnalyses.size() > 1;
+      bool match = tagged[token_idx] && *tagged[token_idx] == *gold[token_idx];
+      total++;
+      correct += match;
+      if (ambiguous) {
+        ambiguous_total++;
+        ambiguous_correct += match;
+      }
+    }
+  }
+  std::wcerr << "Accuracy on the training corpus: " << correct << " of "
+             << total << " tokens";
+  if (total) {
+    std::wcerr << " (" << 100.0 * correct / total << "%)";
+  }
+  std::wcerr << ", " << ambiguous_correct << " of " << ambiguous_total
+             << " ambiguous tokens";
+  if (ambiguous_total) {
+    std::wcerr << " (" << 100.0 * ambiguous_correct / ambiguous_total << "%)";
+  }
+  std::wcerr << ".\n";
+}
+
 void PerceptronTagger::serialise(std::ostream &serialised) const
 {
   spec.serialise(serialised);
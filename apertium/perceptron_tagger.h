@@ -25,6 +25,21 @@ public:
   virtual void tag(Stream &input, std::wostream &output) const;
 
   void read_spec(const std::string &filename);
+  /**
+   * Train on this many shards of the corpus in parallel, mixing their
+   * weights after every iteration.  With one thread the training is serial.
+   */
+  void set_threads(const unsigned int &threads_);
+  /**
+   * Seed the shuffles of the training corpus, so that training is
+   * reproducible.
+   */
+  void set_seed(const unsigned long &seed_);
+  /**
+   * After training, report the accuracy of the model on the training
+   * corpus, e.g. to compare a parallel run with a serial one.
+   */
+  void set_evaluate(const bool &evaluate_);
 
   friend std::wostream& operator<<(std::wostream &out, PerceptronTagger const &pt);
 protected:
@@ -36,8 +51,28 @@ private:
   bool trainSentence(
     const TrainingSentence &sentence,
     FeatureVecAverager &avg_weights);
+  /** @return the number of sentences skipped */
+  size_t trainShard(
+    std::vector<TrainingSentence>::const_iterator begin,
+    std::vector<TrainingSentence>::const_iterator end,
+    FeatureVecAverager &avg_weights);
+  /**
+   * Iterative parameter mixing: every iteration trains a copy of the
+   * weights on each shard and takes the mean of the copies.
+   * @return the number of sentences skipped in the last iteration
+   */
+  size_t trainParallel(TrainingCorpus &tc, int iterations);
+  class ShardTrainer;
+  /**
+   * Tag the sentences and report the accuracy over the tokens which have a
+   * correct analysis.
+   */
+  void evaluate(const std::vector<TrainingSentence> &sentences) const;
   FeatureVec weights;
   PerceptronSpec spec;
+  unsigned int threads;
+  unsigned long seed;
+  bool evaluate_;
   struct AgendaItem {
     TaggedSentence tagged;
     double score;
@@ -45,6 +80,19 @@ private:
   struct TrainingAgendaItem : AgendaItem {
     FeatureVec vec;
   };
+  /**
+   * The history independent features of a wordoid of an analysis of the
+   * token being predicted, which are the same for every agenda item.
+   */
+  struct SharedFeatures {
+    bool pred;
+    UnaryFeatureVec features;
+    double score;
+  };
+  typedef std::vector<std::vector<SharedFeatures> > SharedFeatureTable;
+  void getSharedFeatures(const TaggedSentence &history,
+                         const Sentence &untagged_sent, size_t token_idx,
+                         SharedFeatureTable &shared) const;
   struct ExtendTagged {
     Optional<Analysis> analy;
     ExtendTagged(const Analysis &analy);
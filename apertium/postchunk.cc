@@ -52,6 +52,9 @@ blank(0),
 lword(0),
 lblank(0),
 output(0),
+input_text(0),
+input_tokens(0),
+input_pos(0),
 any_char(0),
 any_tag(0),
 nwords(0)
@@ -92,44 +95,7 @@ Postchunk::readData(FILE *in)
   
   me = new MatchExe(t, finals);
  
-  // attr_items
-  bool recompile_attrs = Compression::string_read(in) != string(pcre_version());
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-    attr_items[cad_k].read(in);
-    wstring fallback = Compression::wstring_read(in);
-    if(recompile_attrs) {
-      attr_items[cad_k].compile(UtfConverter::toUtf8(fallback));
-    }
-  }
-
-  // variables
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-    variables[cad_k] = UtfConverter::toUtf8(Compression::wstring_read(in));
-  }
-
-  // macros
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-    macros[cad_k] = Compression::multibyte_read(in);
-  }
-
-  // lists
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-
-    for(int j = 0, limit2 = Compression::multibyte_read(in); j != limit2; j++)
-    {
-      wstring const cad_v = Compression::wstring_read(in);
-      lists[cad_k].insert(UtfConverter::toUtf8(cad_v));
-      listslow[cad_k].insert(UtfConverter::toUtf8(StringUtils::tolower(cad_v)));
-    }  
-  }  
+  tables.read(in);
 }
 
 void
@@ -146,6 +112,7 @@ Postchunk::read(string const &transferfile, string const &datafile)
   }
   readData(in);
   fclose(in);
+  tables.resolve(root_element);
 
 }
 
@@ -244,7 +211,7 @@ Postchunk::evalString(xmlNode *element)
       case ti_clip_tl:
         if(checkIndex(element, ti.getPos(), lword))
         {
-          return word[ti.getPos()]->chunkPart(attr_items[ti.getContent()]);
+          return word[ti.getPos()]->chunkPart(TransferTables::attrOf(element));
         }
         break;
         
@@ -252,7 +219,7 @@ Postchunk::evalString(xmlNode *element)
         return StringUtils::itoa_string(tmpword.size());
 
       case ti_var:
-        return variables[ti.getContent()];
+        return TransferTables::varOf(element);
         
       case ti_lit_tag:
       case ti_lit:
@@ -271,7 +238,7 @@ Postchunk::evalString(xmlNode *element)
       case ti_get_case_from:
         if(checkIndex(element, ti.getPos(), lword))
         {
-          return copycase(word[ti.getPos()]->chunkPart(attr_items[ti.getContent()]),
+          return copycase(word[ti.getPos()]->chunkPart(TransferTables::attrOf(element)),
                           evalString((xmlNode *) ti.getPointer()));
         }
         break;
@@ -279,7 +246,7 @@ Postchunk::evalString(xmlNode *element)
       case ti_case_of_tl:
         if(checkIndex(element, ti.getPos(), lword))
         {
-          return caseOf(word[ti.getPos()]->chunkPart(attr_items[ti.getContent()]));
+          return caseOf(word[ti.getPos()]->chunkPart(TransferTables::attrOf(element)));
         }
         break;
         
@@ -607,11 +574,11 @@ Postchunk::processLet(xmlNode *localroot)
     switch(ti.getType())
     {
       case ti_var:
-        variables[ti.getContent()] = evalString(rightSide);
+        TransferTables::varOf(leftSide) = evalString(rightSide);
         return;
         
       case ti_clip_tl:
-        word[ti.getPos()]->setChunkPart(attr_items[ti.getContent()], evalString(rightSide));
+        word[ti.getPos()]->setChunkPart(TransferTables::attrOf(leftSide), evalString(rightSide));
         return;      
         
       default:
@@ -621,7 +588,7 @@ Postchunk::processLet(xmlNode *localroot)
   if(!xmlStrcmp(leftSide->name, (const xmlChar *) "var"))
   {
     string const val = (const char *) leftSide->properties->children->content;
-    variables[val] = evalString(rightSide);
+    TransferTables::varOf(leftSide) = evalString(rightSide);
     evalStringCache[leftSide] = TransferInstr(ti_var, val, 0);
   }
   else if(!xmlStrcmp(leftSide->name, (const xmlChar *) "clip"))
@@ -642,7 +609,7 @@ Postchunk::processLet(xmlNode *localroot)
     }
     
 
-    word[pos]->setChunkPart(attr_items[(const char *) part], 
+    word[pos]->setChunkPart(TransferTables::attrOf(leftSide), 
 			    evalString(rightSide));
     evalStringCache[leftSide] = TransferInstr(ti_clip_tl, (const char *) part, 
 					      pos, NULL);
@@ -652,21 +619,13 @@ Postchunk::processLet(xmlNode *localroot)
 void
 Postchunk::processAppend(xmlNode *localroot)
 {
-  string name;
-  for(xmlAttr *i = localroot->properties; i != NULL; i = i->next)
-  {
-    if(!xmlStrcmp(i->name, (const xmlChar *) "n"))
-    {
-      name = (char *) i->children->content; 
-      break;
-    }
-  }
+  string &var = TransferTables::varOf(localroot);
 
   for(xmlNode *i = localroot->children; i != NULL; i = i->next)
   {
     if(i->type == XML_ELEMENT_NODE)
     {
-      variables[name].append(evalString(i));
+      var.append(evalString(i));
     }
   }
 }
@@ -695,29 +654,24 @@ Postchunk::processModifyCase(xmlNode *localroot)
   if(!xmlStrcmp(leftSide->name, (const xmlChar *) "clip"))
   {
     int pos = 0;
-    xmlChar *part = NULL;
 
     for(xmlAttr *i = leftSide->properties; i != NULL; i = i->next)
     {
-      if(!xmlStrcmp(i->name, (const xmlChar *) "part"))
-      {
-	part = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "pos"))
+      if(!xmlStrcmp(i->name, (const xmlChar *) "pos"))
       {
 	pos = atoi((const char *) i->children->content);
       }
     }
 
     string const result = copycase(evalString(rightSide), 
-				   word[pos]->chunkPart(attr_items[(const char *) part]));
-    word[pos]->setChunkPart(attr_items[(const char *) part], result);
+				   word[pos]->chunkPart(TransferTables::attrOf(leftSide)));
+    word[pos]->setChunkPart(TransferTables::attrOf(leftSide), result);
 
   }
   else if(!xmlStrcmp(leftSide->name, (const xmlChar *) "var"))
   {
-    string const val = (const char *) leftSide->properties->children->content;
-    variables[val] = copycase(evalString(rightSide), variables[val]);
+    string &var = TransferTables::varOf(leftSide);
+    var = copycase(evalString(rightSide), var);
   }
 }
 
@@ -727,7 +681,7 @@ Postchunk::processCallMacro(xmlNode *localroot)
   const char *n = (const char *) localroot->properties->children->content;
   int npar = 0;
 
-  xmlNode *macro = macro_map[macros[n]];
+  xmlNode *macro = macro_map[TransferTables::macroOf(localroot)];
 
   for(xmlAttr *i = macro->properties; i != NULL; i = i->next)
   {
@@ -906,7 +860,7 @@ bool
 Postchunk::processIn(xmlNode *localroot)
 {
   xmlNode *value = NULL;
-  xmlChar *idlist = NULL;
+  xmlNode *idlist = NULL;
 
   for(xmlNode *i = localroot->children; i != NULL; i = i->next)
   {
@@ -918,7 +872,7 @@ Postchunk::processIn(xmlNode *localroot)
       }
       else
       {
-	idlist = i->properties->children->content;
+	idlist = i;
 	break;
       }
     }
@@ -931,8 +885,7 @@ Postchunk::processIn(xmlNode *localroot)
     if(!xmlStrcmp(localroot->properties->children->content, 
 		  (const xmlChar *) "yes"))
     {
-      set<string, Ltstr> &myset = listslow[(const char *) idlist];
-      if(myset.find(tolower(sval)) != myset.end())
+      if(TransferTables::listOf(idlist).containsLower(tolower(sval)))
       {
 	return true;
       }
@@ -943,8 +896,7 @@ Postchunk::processIn(xmlNode *localroot)
     }
   }
 
-  set<string, Ltstr> &myset = lists[(const char *) idlist];
-  if(myset.find(sval) != myset.end())
+  if(TransferTables::listOf(idlist).contains(sval))
   {
     return true;
   }
@@ -1189,26 +1141,23 @@ Postchunk::processBeginsWithList(xmlNode *localroot)
     }
   }
 
-  xmlChar *idlist = second->properties->children->content;
   string needle = evalString(first);
-  set<string, Ltstr>::iterator it, limit;
+  vector<string> const *items;
 
   if(localroot->properties == NULL || 
      xmlStrcmp(localroot->properties->children->content, (const xmlChar *) "yes"))
   {
-    it = lists[(const char *) idlist].begin();
-    limit = lists[(const char *) idlist].end();
+    items = &TransferTables::listOf(second).getItems();
   }
   else
   {
     needle = tolower(needle);
-    it = listslow[(const char *) idlist].begin();
-    limit = listslow[(const char *) idlist].end();
+    items = &TransferTables::listOf(second).getLowItems();
   }
   
-  for(; it != limit; it++)
+  for(unsigned int i = 0; i != items->size(); i++)
   {
-    if(beginsWith(needle, *it))
+    if(beginsWith(needle, (*items)[i]))
     {
       return true;
     }
@@ -1237,26 +1186,23 @@ Postchunk::processEndsWithList(xmlNode *localroot)
     }
   }
 
-  xmlChar *idlist = second->properties->children->content;
   string needle = evalString(first);
-  set<string, Ltstr>::iterator it, limit;
+  vector<string> const *items;
 
   if(localroot->properties == NULL || 
      xmlStrcmp(localroot->properties->children->content, (const xmlChar *) "yes"))
   {
-    it = lists[(const char *) idlist].begin();
-    limit = lists[(const char *) idlist].end();
+    items = &TransferTables::listOf(second).getItems();
   }
   else
   {
     needle = tolower(needle);
-    it = listslow[(const char *) idlist].begin();
-    limit = listslow[(const char *) idlist].end();
+    items = &TransferTables::listOf(second).getLowItems();
   }
   
-  for(; it != limit; it++)
+  for(unsigned int i = 0; i != items->size(); i++)
   {
-    if(endsWith(needle, *it))
+    if(endsWith(needle, (*items)[i]))
     {
       return true;
     }
@@ -1453,29 +1399,38 @@ Postchunk::readToken(FILE *in)
     return input_buffer.next();
   }
 
+  if(input_tokens != NULL)
+  {
+    if(input_pos < input_tokens->size())
+    {
+      return input_buffer.add((*input_tokens)[input_pos++]);
+    }
+    return input_buffer.add(TransferToken(L"", tt_eof));
+  }
+
   wstring content;
   while(true)
   {
-    int val = fgetwc_unlocked(in);
-    if(feof(in) || (internal_null_flush && val == 0))
+    int val = readChar(in);
+    if(endOfInput(in) || (internal_null_flush && val == 0))
     {
       return input_buffer.add(TransferToken(content, tt_eof));
     }
     if(val == L'\\')
     {  
       content += L'\\';
-      content += wchar_t(fgetwc_unlocked(in));
+      content += wchar_t(readChar(in));
     }
     else if(val == L'[')
     {
       content += L'[';
       while(true)
       {
-	int val2 = fgetwc_unlocked(in);
+	int val2 = readChar(in);
 	if(val2 == L'\\')
 	{
 	  content += L'\\';
-	  content += wchar_t(fgetwc_unlocked(in));
+	  content += wchar_t(readChar(in));
 	}
 	else if(val2 == L']')
 	{
@@ -1493,16 +1448,16 @@ Postchunk::readToken(FILE *in)
       content += L'{';
       while(true)
       {
-	int val2 = fgetwc_unlocked(in);
+	int val2 = readChar(in);
 	if(val2 == L'\\')
 	{
 	  content += L'\\';
-	  content += wchar_t(fgetwc_unlocked(in));
+	  content += wchar_t(readChar(in));
 	}
 	else if(val2 == L'}')
 	{
-	  int val3 = wchar_t(fgetwc_unlocked(in));
-	  ungetwc(val3, in);
+	  int val3 = wchar_t(readChar(in));
+	  unreadChar(val3, in);
 	  
 	  content += L'}';
 	  if(val3 == L'$')
@@ -1572,6 +1527,73 @@ Postchunk::postchunk_wrapper_null_flush(FILE *in, FILE *out)
   null_flush = true;
 }    
 
+wint_t
+Postchunk::readChar(FILE *in)
+{
+  if(input_text == NULL)
+  {
+    return fgetwc_unlocked(in);
+  }
+  if(input_pos < input_text->size())
+  {
+    return (*input_text)[input_pos++];
+  }
+  // one past the end, so that endOfInput() holds like feof() would
+  input_pos = input_text->size() + 1;
+  return WEOF;
+}
+
+void
+Postchunk::unreadChar(wint_t c, FILE *in)
+{
+  if(input_text == NULL)
+  {
+    ungetwc(c, in);
+  }
+  else if(c != WEOF)
+  {
+    input_pos--;
+  }
+}
+
+bool
+Postchunk::endOfInput(FILE *in)
+{
+  if(input_text == NULL)
+  {
+    return feof(in);
+  }
+  return input_pos > input_text->size();
+}
+
+void
+Postchunk::postchunk(wstring const &in, FILE *out)
+{
+  bool const was_null_flush = null_flush;
+  null_flush = false;
+  input_text = &in;
+  input_pos = 0;
+
+  postchunk((FILE *) NULL, out);
+
+  input_text = NULL;
+  null_flush = was_null_flush;
+}
+
+void
+Postchunk::postchunk(vector<TransferToken> const &in, FILE *out)
+{
+  bool const was_null_flush = null_flush;
+  null_flush = false;
+  input_tokens = &in;
+  input_pos = 0;
+
+  postchunk((FILE *) NULL, out);
+
+  input_tokens = NULL;
+  null_flush = was_null_flush;
+}
+
 void
 Postchunk::postchunk(FILE *in, FILE *out)
 {
@@ -1676,52 +1698,26 @@ Postchunk::applyRule()
   tmpword.clear();
   splitWordsAndBlanks(chunk, tmpword, tmpblank);
 
-  word = new InterchunkWord *[tmpword.size()+1];
+  unsigned int limit = tmpword.size() + 1;
+
+  word = word_pool.get(limit);
   lword = tmpword.size();
-  word[0] = new InterchunkWord(UtfConverter::toUtf8(wordzero(chunk)));
+  word[0]->init(UtfConverter::toUtf8(wordzero(chunk)));
+  blank = limit > 2 ? blank_pool.get(limit - 2) : NULL;
+  lblank = limit > 2 ? limit - 3 : 0;
 
-  for(unsigned int i = 1, limit = tmpword.size()+1; i != limit; i++)
+  for(unsigned int i = 1; i != limit; i++)
   {
-    if(i == 1)
-    {
-      if(limit != 2)
-      {
-        blank = new string *[limit - 2];
-        lblank = limit - 3;
-      }
-      else
-      {
-        blank = NULL;
-        lblank = 0;
-      }
-    }
-    else
+    if(i != 1)
     {
-      blank[i-2] = new string(UtfConverter::toUtf8(*tmpblank[i-1]));
+      blank[i-2]->assign(UtfConverter::toUtf8(*tmpblank[i-1]));
     }
-    
-    word[i] = new InterchunkWord(UtfConverter::toUtf8(*tmpword[i-1]));
+
+    word[i]->init(UtfConverter::toUtf8(*tmpword[i-1]));
   }
 
   processRule(lastrule);
   lastrule = NULL;
-
-  if(word)
-  {
-    for(unsigned int i = 0, limit = tmpword.size() + 1; i != limit; i++)
-    {
-      delete word[i];
-    }
-    delete[] word;
-  }
-  if(blank)
-  {
-    for(unsigned int i = 0, limit = tmpword.size() - 1; i != limit; i++)
-    {
-      delete blank[i];
-    }
-    delete[] blank;
-  }
   word = NULL;
   blank = NULL;
 
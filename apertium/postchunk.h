@@ -18,6 +18,8 @@
 #define _POSTCHUNK_
 
 #include <apertium/transfer_instr.h>
+#include <apertium/transfer_pool.h>
+#include <apertium/transfer_tables.h>
 #include <apertium/transfer_token.h>
 #include <apertium/interchunk_word.h>
 #include <apertium/apertium_re.h>
@@ -43,11 +45,7 @@ private:
   Alphabet alphabet;
   MatchExe *me;
   MatchState ms;
-  map<string, ApertiumRE, Ltstr> attr_items;
-  map<string, string, Ltstr> variables;
-  map<string, int, Ltstr> macros;
-  map<string, set<string, Ltstr>, Ltstr> lists;
-  map<string, set<string, Ltstr>, Ltstr> listslow;
+  TransferTables tables;
   vector<xmlNode *> macro_map;
   vector<xmlNode *> rule_map;
   xmlDoc *doc;
@@ -55,11 +53,16 @@ private:
   InterchunkWord **word;
   string **blank;
   int lword, lblank;
+  TransferPool<InterchunkWord> word_pool;
+  TransferPool<string> blank_pool;
   Buffer<TransferToken> input_buffer;
   vector<wstring *> tmpword;
   vector<wstring *> tmpblank;
 
   FILE *output;
+  wstring const *input_text;
+  vector<TransferToken> const *input_tokens;
+  size_t input_pos;
   int any_char;
   int any_tag;
 
@@ -125,6 +128,9 @@ private:
   static wstring wordzero(wstring const &chunk);
   bool checkIndex(xmlNode *element, int index, int limit);  
   void postchunk_wrapper_null_flush(FILE *in, FILE *out);
+  wint_t readChar(FILE *in);
+  void unreadChar(wint_t c, FILE *in);
+  bool endOfInput(FILE *in);
 
 public:
   Postchunk();
@@ -132,6 +138,22 @@ public:
   
   void read(string const &transferfile, string const &datafile);
   void postchunk(FILE *in, FILE *out);
+
+  /**
+   * Process a whole input held in memory, as read from the previous stage
+   * of a TransferPipeline
+   * @param in the input
+   * @param out the output file
+   */
+  void postchunk(wstring const &in, FILE *out);
+
+  /**
+   * Process the tokens written by Interchunk in a TransferPipeline, without
+   * reading them from text again
+   * @param in the tokens, ending in a tt_eof one
+   * @param out the output file
+   */
+  void postchunk(vector<TransferToken> const &in, FILE *out);
   bool getNullFlush(void);
   void setNullFlush(bool null_flush);
   void setTrace(bool trace);
@@ -180,9 +180,36 @@ void TrainingCorpus::prematureEnd()
   throw Exception::UnalignedStreams(what_);
 }
 
+TrainingCorpus::Random::Random() : state(1) {}
+
+void TrainingCorpus::Random::seed(unsigned long seed)
+{
+  state = seed % 2147483646 + 1;
+}
+
+ptrdiff_t TrainingCorpus::Random::operator()(ptrdiff_t n)
+{
+  // Schrage's method, so that the multiplication can't overflow
+  const long m = 2147483647, a = 48271, q = m / a, r = m % a;
+  state = a * (state % q) - r * (state / q);
+  if (state <= 0) {
+    state += m;
+  }
+  return state % n;
+}
+
+void TrainingCorpus::seed(unsigned long seed)
+{
+  generator.seed(seed);
+}
+
 void TrainingCorpus::shuffle()
 {
-  random_shuffle(sentences.begin(), sentences.end());
+  // Fisher-Yates, written out since the standard library doesn't say in
+  // which order random_shuffle draws its numbers
+  for (size_t i = sentences.size(); i > 1; i--) {
+    std::swap(sentences[i - 1], sentences[generator(i)]);
+  }
 }
 
 }
@@ -42,9 +42,25 @@ namespace SentenceStream {
     bool contToEndOfSent(Stream &stream, StreamedType token,
                          unsigned int &line);
     bool sent_seg;
+    /**
+     * Park and Miller's minimal standard generator, so that shuffles are
+     * the same everywhere for the same seed
+     */
+    class Random {
+      long state;
+    public:
+      Random();
+      void seed(unsigned long seed);
+      // A random number from 0 to n - 1
+      ptrdiff_t operator()(ptrdiff_t n);
+    } generator;
   public:
     unsigned int skipped;
     TrainingCorpus(Stream &tagged, Stream &untagged, bool skip_on_error, bool sent_seg);
+    /**
+     * Restart the sequence of shuffles from seed.
+     */
+    void seed(unsigned long seed);
     void shuffle();
     std::vector<TrainingSentence> sentences;
   };
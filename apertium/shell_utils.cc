@@ -1,6 +1,9 @@
 #include <apertium/exception.h>
 #include <apertium/shell_utils.h>
 
+#include <cerrno>
+#include <cstdlib>
+
 #ifdef _MSC_VER
 #include <fcntl.h>
 #include <io.h>
@@ -90,5 +93,21 @@ void try_close_file(const char *metavar, const char *filename,
     throw Exception::Shell::FcloseError(what_);
   }
 }
+
+unsigned long parse_number(const char *metavar, const char *arg,
+                           unsigned long min, unsigned long max) {
+  char *end;
+  errno = 0;
+  unsigned long value = std::strtoul(arg, &end, 10);
+  // strtoul would take "-1" as the largest unsigned long
+  if (*arg == '\0' || *arg == '-' || *end != '\0' || errno == ERANGE ||
+      value < min || value > max) {
+    std::stringstream what_;
+    what_ << "invalid " << metavar << " '" << arg << "', expected a number "
+          << "from " << min << " to " << max;
+    throw Exception::Shell::InvalidNumber(what_);
+  }
+  return value;
+}
 }
 }
@@ -29,6 +29,14 @@ try_open_file_utf8(const char *metavar, const char *filename,
 void try_close_file(const char *metavar, const char *filename,
                     FILE *file);
 
+/**
+ * Parse a whole decimal number from min to max, rejecting the values
+ * which don't fit in an unsigned long rather than wrapping them.
+ */
+unsigned long
+parse_number(const char *metavar, const char *arg,
+             unsigned long min, unsigned long max);
+
 }
 }
 
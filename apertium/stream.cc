@@ -20,8 +20,10 @@
 #include "streamed_type.h"
 #include "wchar_t_exception.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstdlib>
+#include <cwchar>
 #include <fstream>
 #include <iostream>
 #include <istream>
@@ -30,26 +32,59 @@
 #include <string>
 
 namespace Apertium {
+namespace {
+/**
+ * Which characters get() has to look at one by one: the reserved
+ * characters of the stream format, newline and, for null flushing, '\0'.
+ * Runs of the others are copied straight from the buffer.
+ */
+class CharacterClasses {
+public:
+  CharacterClasses() {
+    std::fill(isReserved, isReserved + 128, false);
+
+    for (const char *Reserved_ = "\\[]^/*<>#+$\n"; *Reserved_; ++Reserved_)
+      isReserved[static_cast<unsigned char>(*Reserved_)] = true;
+
+    isReserved[0] = true;
+  }
+
+  bool isPlain(const wchar_t &Character_) const {
+    return static_cast<unsigned long>(Character_) >= 128 ||
+           !isReserved[Character_];
+  }
+
+private:
+  bool isReserved[128];
+};
+
+const CharacterClasses TheCharacterClasses;
+}
+
 Stream::Stream(const basic_Tagger::Flags &Flags_)
-    : TheCharacterStream(std::wcin), TheFilename(), TheLineNumber(1), TheLine(),
-      TheFlags(Flags_), private_flush_(false), ThePreviousCase() {}
+    : TheCharacterStream(std::wcin), TheBuffer(), TheBufferPosition(0),
+      TheEndOfFile(false), isPeeking(false), TheFilename(), TheLineNumber(1),
+      TheLine(), TheFlags(Flags_), private_flush_(false), ThePreviousCase() {}
 
 Stream::Stream(const basic_Tagger::Flags &Flags_,
                std::wifstream &CharacterStream_, const char *const Filename_)
-    : TheCharacterStream(CharacterStream_), TheFilename(Filename_),
+    : TheCharacterStream(CharacterStream_), TheBuffer(), TheBufferPosition(0),
+      TheEndOfFile(false), isPeeking(false), TheFilename(Filename_),
       TheLineNumber(1), TheLine(), TheFlags(Flags_), private_flush_(false),
       ThePreviousCase() {}
 
 Stream::Stream(const basic_Tagger::Flags &Flags_,
                std::wifstream &CharacterStream_, const std::string &Filename_)
-    : TheCharacterStream(CharacterStream_), TheFilename(Filename_),
+    : TheCharacterStream(CharacterStream_), TheBuffer(), TheBufferPosition(0),
+      TheEndOfFile(false), isPeeking(false), TheFilename(Filename_),
       TheLineNumber(1), TheLine(), TheFlags(Flags_), private_flush_(false),
       ThePreviousCase() {}
 
 Stream::Stream(const basic_Tagger::Flags &Flags_,
                std::wifstream &CharacterStream_,
                const std::stringstream &Filename_)
-    : TheCharacterStream(CharacterStream_), TheFilename(Filename_.str()),
+    : TheCharacterStream(CharacterStream_), TheBuffer(), TheBufferPosition(0),
+      TheEndOfFile(false), isPeeking(false), TheFilename(Filename_.str()),
       TheLineNumber(1), TheLine(), TheFlags(Flags_), private_flush_(false),
       ThePreviousCase() {}
 
@@ -61,7 +96,7 @@ StreamedType Stream::get() {
   //TheCharacterStream.clear();
   if (!is_eof_throw_if_not_TheCharacterStream_good()) {
     while (true) {
-      const wchar_t Character_ = TheCharacterStream.get();
+      const wchar_t Character_ = get_Character();
 
       if (is_eof_throw_if_not_TheCharacterStream_good(TheStreamedType, Lemma,
                                                       Character_))
@@ -168,7 +203,7 @@ StreamedType Stream::get() {
           ThePreviousCase = PreviousCaseType(Character_);
 
           {
-            const wchar_t Character_ = TheCharacterStream.get();
+            const wchar_t Character_ = get_Character();
 
             if (is_eof_throw_if_not_TheCharacterStream_good(
                     TheStreamedType, Lemma, Character_)) {
@@ -598,6 +633,7 @@ StreamedType Stream::get() {
         continue;
       default:
         push_back_Character(TheStreamedType, Lemma, Character_);
+        push_back_Run(TheStreamedType, Lemma);
         continue;
       }
 
@@ -626,28 +662,33 @@ StreamedType Stream::get() {
 
 StreamedType Stream::peek() {
   bool prev_flush = private_flush_;
-  std::ios::iostate state = TheCharacterStream.rdstate();
-  int pos = TheCharacterStream.tellg();
+  bool prev_peeking = isPeeking;
+  bool prev_end = TheEndOfFile;
+  std::size_t position = TheBufferPosition;
+  isPeeking = true;
 
   StreamedType token = get();
 
-  TheCharacterStream.clear(state);
-  TheCharacterStream.seekg(pos);
+  TheBufferPosition = position;
+  TheEndOfFile = prev_end;
+  isPeeking = prev_peeking;
   private_flush_ = prev_flush;
   return token;
 }
 
 bool Stream::peekIsBlank() {
-  std::ios::iostate state = TheCharacterStream.rdstate();
-  int pos = TheCharacterStream.tellg();
-
-  const wchar_t newline1 = TheCharacterStream.get();
-  const wchar_t newline2 = TheCharacterStream.get();
-
-  TheCharacterStream.clear(state);
-  TheCharacterStream.seekg(pos);
+  while (TheBuffer.size() - TheBufferPosition < 2) {
+    bool prev_peeking = isPeeking;
+    isPeeking = true;
+    bool filled = fill_TheBuffer();
+    isPeeking = prev_peeking;
+
+    if (!filled)
+      return false;
+  }
 
-  return newline1 == L'\n' && newline2 == L'\n';
+  return TheBuffer[TheBufferPosition] == L'\n' &&
+         TheBuffer[TheBufferPosition + 1] == L'\n';
 }
 
 bool Stream::flush_() const { return private_flush_; }
@@ -692,11 +733,37 @@ void Stream::outputLexicalUnit(
 Stream::PreviousCaseType::PreviousCaseType(const wchar_t &PreviousCase_)
     : ThePreviousCase(PreviousCase_), isPreviousCharacter(true) {}
 
+bool Stream::fill_TheBuffer() {
+  if (!isPeeking) {
+    TheBuffer.erase(0, TheBufferPosition);
+    TheBufferPosition = 0;
+  }
+
+  if (!TheCharacterStream)
+    return false;
+
+  std::size_t const size = TheBuffer.size();
+  std::size_t const block = TheFlags.getNullFlush() ? 1 : 4096;
+  TheBuffer.resize(size + block);
+  TheCharacterStream.read(&TheBuffer[size], block);
+  TheBuffer.resize(size + TheCharacterStream.gcount());
+  return TheBuffer.size() > size;
+}
+
+wchar_t Stream::get_Character() {
+  if (TheBufferPosition == TheBuffer.size() && !fill_TheBuffer()) {
+    TheEndOfFile = TheCharacterStream.eof();
+    return WEOF;
+  }
+
+  return TheBuffer[TheBufferPosition++];
+}
+
 bool Stream::is_eof_throw_if_not_TheCharacterStream_good() const {
-  if (TheCharacterStream.eof())
+  if (TheEndOfFile)
     return true;
 
-  if (!TheCharacterStream) {
+  if (!TheCharacterStream && !TheCharacterStream.eof()) {
     std::wcerr << L"State bad " << TheCharacterStream.good() << " "
                                 << TheCharacterStream.eof() << " "
                                 << TheCharacterStream.fail() << " "
@@ -729,7 +796,7 @@ Stream::is_eof_throw_if_not_TheCharacterStream_good(StreamedType &StreamedType_,
   if (isTheCharacterStream_eof(StreamedType_, Lemma, Character_))
     return true;
 
-  if (!TheCharacterStream) {
+  if (!TheCharacterStream && !TheCharacterStream.eof()) {
     std::wstringstream Message;
     Message << L"can't get const wchar_t: TheCharacterStream not good";
     throw wchar_t_Exception::Stream::TheCharacterStream_not_good(
@@ -742,7 +809,7 @@ Stream::is_eof_throw_if_not_TheCharacterStream_good(StreamedType &StreamedType_,
 bool Stream::isTheCharacterStream_eof(StreamedType &StreamedType_,
                                       std::wstring &Lemma,
                                       const wchar_t &Character_) {
-  if (TheCharacterStream.eof())
+  if (TheEndOfFile)
     return true;
 
   if (TheFlags.getNullFlush()) {
@@ -756,67 +823,71 @@ bool Stream::isTheCharacterStream_eof(StreamedType &StreamedType_,
   return false;
 }
 
+std::wstring &Stream::Destination(StreamedType &StreamedType_,
+                                  std::wstring &Lemma,
+                                  const wchar_t &Character_) {
+  if (!ThePreviousCase)
+    return StreamedType_.TheString;
+
+  switch (ThePreviousCase->ThePreviousCase) {
+  case L'[':
+  case L']':
+  case L'$':
+    return StreamedType_.TheString;
+  case L'^':
+    return StreamedType_.TheLexicalUnit->TheSurfaceForm;
+  case L'/':
+  case L'#':
+  case L'+':
+    return StreamedType_.TheLexicalUnit->TheAnalyses.back()
+        .TheMorphemes.back()
+        .TheLemma;
+  case L'*':
+    return Lemma;
+  case L'<':
+    return StreamedType_.TheLexicalUnit->TheAnalyses.back()
+        .TheMorphemes.back()
+        .TheTags.back()
+        .TheTag;
+  case L'>': {
+    std::wstringstream Message;
+    Message << L"unexpected '" << Character_ << L"' immediately following '"
+            << ThePreviousCase->ThePreviousCase << L"'";
+    throw wchar_t_Exception::Stream::UnexpectedCharacter(
+        Message_what(Message));
+  }
+  default:
+    std::wstringstream Message;
+    Message << L"unexpected previous reserved or special character '"
+            << ThePreviousCase->ThePreviousCase << L"'";
+    throw wchar_t_Exception::Stream::UnexpectedPreviousCase(
+        Message_what(Message));
+  }
+}
+
 void Stream::push_back_Character(StreamedType &StreamedType_,
                                  std::wstring &Lemma,
                                  const wchar_t &Character_) {
-  if (ThePreviousCase) {
-    switch (ThePreviousCase->ThePreviousCase) {
-    case L'[':
-      StreamedType_.TheString += Character_;
-      break;
-    case L']':
-      StreamedType_.TheString += Character_;
-      break;
-    case L'^':
-      StreamedType_.TheLexicalUnit->TheSurfaceForm += Character_;
-      break;
-    case L'/':
-      StreamedType_.TheLexicalUnit->TheAnalyses.back()
-          .TheMorphemes.back()
-          .TheLemma.push_back(Character_);
-      break;
-    case L'*':
-      Lemma += Character_;
-      break;
-    case L'<':
-      StreamedType_.TheLexicalUnit->TheAnalyses.back()
-          .TheMorphemes.back()
-          .TheTags.back()
-          .TheTag += Character_;
-      break;
-    case L'>': {
-      std::wstringstream Message;
-      Message << L"unexpected '" << Character_ << L"' immediately following '"
-              << ThePreviousCase->ThePreviousCase << L"'";
-      throw wchar_t_Exception::Stream::UnexpectedCharacter(
-          Message_what(Message));
-    }
-    case L'#':
-      StreamedType_.TheLexicalUnit->TheAnalyses.back()
-          .TheMorphemes.back()
-          .TheLemma.push_back(Character_);
-      break;
-    case L'+':
-      StreamedType_.TheLexicalUnit->TheAnalyses.back()
-          .TheMorphemes.back()
-          .TheLemma.push_back(Character_);
-      break;
-    case L'$':
-      StreamedType_.TheString += Character_;
-      break;
-    default:
-      std::wstringstream Message;
-      Message << L"unexpected previous reserved or special character '"
-              << ThePreviousCase->ThePreviousCase << L"'";
-      throw wchar_t_Exception::Stream::UnexpectedPreviousCase(
-          Message_what(Message));
-    }
+  Destination(StreamedType_, Lemma, Character_) += Character_;
 
+  if (ThePreviousCase)
     ThePreviousCase->isPreviousCharacter = false;
+}
+
+void Stream::push_back_Run(StreamedType &StreamedType_, std::wstring &Lemma) {
+  std::size_t const begin = TheBufferPosition;
+  std::size_t end = begin;
+
+  while (end != TheBuffer.size() && TheCharacterClasses.isPlain(TheBuffer[end]))
+    ++end;
+
+  if (end == begin)
     return;
-  }
 
-  StreamedType_.TheString += Character_;
+  Destination(StreamedType_, Lemma, TheBuffer[begin])
+      .append(TheBuffer, begin, end - begin);
+  TheLine.append(TheBuffer, begin, end - begin);
+  TheBufferPosition = end;
 }
 
 void Stream::case_0x5c(StreamedType &StreamedType_, std::wstring &Lemma,
@@ -824,7 +895,7 @@ void Stream::case_0x5c(StreamedType &StreamedType_, std::wstring &Lemma,
   push_back_Character(StreamedType_, Lemma, Character_);
 
   {
-    const wchar_t Character_ = TheCharacterStream.get();
+    const wchar_t Character_ = get_Character();
 
     if (is_eof_throw_if_not_TheCharacterStream_good(StreamedType_, Lemma,
                                                     Character_)) {
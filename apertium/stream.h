@@ -59,11 +59,34 @@ private:
                                                    const wchar_t &Character_);
   bool isTheCharacterStream_eof(StreamedType &StreamedType_,
                                 std::wstring &Lemma, const wchar_t &Character_);
+  /** Where a plain character read in the current case goes */
+  std::wstring &Destination(StreamedType &StreamedType_, std::wstring &Lemma,
+                            const wchar_t &Character_);
   void push_back_Character(StreamedType &StreamedType_, std::wstring &Lemma,
                            const wchar_t &Character_);
+  /**
+   * Copy the plain characters that follow in TheBuffer, up to the next
+   * reserved one or the end of the buffer, to where the last character
+   * went
+   */
+  void push_back_Run(StreamedType &StreamedType_, std::wstring &Lemma);
   void case_0x5c(StreamedType &StreamedType_, std::wstring &Lemma,
                  const wchar_t &Character_);
+  bool fill_TheBuffer();
+  wchar_t get_Character();
   std::wistream &TheCharacterStream;
+  /**
+   * Characters read ahead from TheCharacterStream a block at a time, so
+   * that get() doesn't go through the stream for every character; with
+   * null flushing a block is a single character, so as not to wait for
+   * input after a null.
+   */
+  std::wstring TheBuffer;
+  std::size_t TheBufferPosition;
+  /** Whether reading has got past the end of TheCharacterStream */
+  bool TheEndOfFile : 1;
+  /** Whether peek() will come back to TheBufferPosition */
+  bool isPeeking : 1;
   Optional<std::string> TheFilename;
   std::wstring TheLine;
   const basic_Tagger::Flags &TheFlags;
@@ -49,10 +49,12 @@ long double Stream_5_3_1_Tagger::score(const Analysis &Analysis_) const {
 }
 
 long double Stream_5_3_1_Tagger::tokenCount_T(const Analysis &Analysis_) const {
-  if (Model.find(Analysis_) == Model.end())
+  std::map<Analysis, std::size_t>::const_iterator T = Model.find(Analysis_);
+
+  if (T == Model.end())
     return 1;
 
-  return 1 + Model.find(Analysis_)->second;
+  return 1 + T->second;
 }
 
 #if ENABLE_DEBUG
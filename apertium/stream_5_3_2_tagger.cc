@@ -41,49 +41,66 @@ void Stream_5_3_2_Tagger::deserialise(std::istream &Serialised_basic_Tagger) {
   Model =
       Deserialiser<std::map<a, std::map<Lemma, std::size_t> > >::deserialise(
           Serialised_basic_Tagger);
+
+  TokenCounts_a.clear();
+
+  for (std::map<a, std::map<Lemma, std::size_t> >::const_iterator a_ =
+           Model.begin();
+       a_ != Model.end(); ++a_) {
+    std::size_t &TokenCount_a = TokenCounts_a[a_->first];
+
+    for (std::map<Lemma, std::size_t>::const_iterator Lemma_ =
+             a_->second.begin();
+         Lemma_ != a_->second.end(); ++Lemma_) {
+      TokenCount_a += Lemma_->second;
+    }
+  }
 }
 
 long double Stream_5_3_2_Tagger::score(const Analysis &Analysis_) const {
-  return (tokenCount_r_a(Analysis_) * tokenCount_a(Analysis_)) /
-         (tokenCount_a(Analysis_) + typeCount_a(Analysis_));
+  const a a_(Analysis_);
+  const Lemma Lemma_(Analysis_);
+  return (tokenCount_r_a(a_, Lemma_) * tokenCount_a(a_)) /
+         (tokenCount_a(a_) + typeCount_a(a_, Lemma_));
 }
 
-long double
-Stream_5_3_2_Tagger::tokenCount_r_a(const Analysis &Analysis_) const {
-  if (Model.find(a(Analysis_)) == Model.end())
-    return 1;
+long double Stream_5_3_2_Tagger::tokenCount_r_a(const a &a_,
+                                                const Lemma &Lemma_) const {
+  std::map<a, std::map<Lemma, std::size_t> >::const_iterator Lemmas =
+      Model.find(a_);
 
-  if (Model.find(a(Analysis_))->second.find(Lemma(Analysis_)) ==
-      Model.find(a(Analysis_))->second.end())
+  if (Lemmas == Model.end())
     return 1;
 
-  return 1 + Model.find(a(Analysis_))->second.find(Lemma(Analysis_))->second;
-}
+  std::map<Lemma, std::size_t>::const_iterator r =
+      Lemmas->second.find(Lemma_);
 
-long double Stream_5_3_2_Tagger::tokenCount_a(const Analysis &Analysis_) const {
-  if (Model.find(a(Analysis_)) == Model.end())
+  if (r == Lemmas->second.end())
     return 1;
 
-  long double tokenCount_a_ = 1;
+  return 1 + r->second;
+}
 
-  for (std::map<Lemma, std::size_t>::const_iterator Lemma_ =
-           Model.find(a(Analysis_))->second.begin();
-       Lemma_ != Model.find(a(Analysis_))->second.end(); ++Lemma_) {
-    tokenCount_a_ += Lemma_->second;
-  }
+long double Stream_5_3_2_Tagger::tokenCount_a(const a &a_) const {
+  std::map<a, std::size_t>::const_iterator TokenCount_a =
+      TokenCounts_a.find(a_);
 
-  return tokenCount_a_;
+  if (TokenCount_a == TokenCounts_a.end())
+    return 1;
+
+  return 1 + TokenCount_a->second;
 }
 
-long double Stream_5_3_2_Tagger::typeCount_a(const Analysis &Analysis_) const {
-  if (Model.find(a(Analysis_)) == Model.end())
+long double Stream_5_3_2_Tagger::typeCount_a(const a &a_,
+                                             const Lemma &Lemma_) const {
+  std::map<a, std::map<Lemma, std::size_t> >::const_iterator Lemmas =
+      Model.find(a_);
+
+  if (Lemmas == Model.end())
     return 1;
 
-  return (Model.find(a(Analysis_))->second.find(Lemma(Analysis_)) ==
-                  Model.find(a(Analysis_))->second.end()
-              ? 1
-              : 0) +
-         Model.find(a(Analysis_))->second.size();
+  return (Lemmas->second.find(Lemma_) == Lemmas->second.end() ? 1 : 0) +
+         Lemmas->second.size();
 }
 
 #if ENABLE_DEBUG
@@ -91,9 +108,11 @@ long double Stream_5_3_2_Tagger::typeCount_a(const Analysis &Analysis_) const {
 std::wstring Stream_5_3_2_Tagger::score_DEBUG(const Analysis &Analysis_) const {
   std::wstringstream score_DEBUG_;
 
-  score_DEBUG_ << L"(" << tokenCount_r_a(Analysis_) << L" * "
-               << tokenCount_a(Analysis_) << L") /\n    ("
-               << tokenCount_a(Analysis_) << L" + " << typeCount_a(Analysis_)
+  const a a_(Analysis_);
+  const Lemma Lemma_(Analysis_);
+  score_DEBUG_ << L"(" << tokenCount_r_a(a_, Lemma_) << L" * "
+               << tokenCount_a(a_) << L") /\n    ("
+               << tokenCount_a(a_) << L" + " << typeCount_a(a_, Lemma_)
                << L")";
 
   return score_DEBUG_.str();
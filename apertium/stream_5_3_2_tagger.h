@@ -18,11 +18,15 @@
 
 #include "apertium_config.h"
 
+#include "a.h"
 #include "analysis.h"
 #include "basic_5_3_2_tagger.h"
 #include "basic_stream_tagger.h"
+#include "lemma.h"
 
+#include <cstddef>
 #include <istream>
+#include <map>
 
 #if ENABLE_DEBUG
 
@@ -39,9 +43,12 @@ public:
 
 private:
   long double score(const Analysis &Analysis_) const;
-  long double tokenCount_r_a(const Analysis &Analysis_) const;
-  long double tokenCount_a(const Analysis &Analysis_) const;
-  long double typeCount_a(const Analysis &Analysis_) const;
+  long double tokenCount_r_a(const a &a_, const Lemma &Lemma_) const;
+  long double tokenCount_a(const a &a_) const;
+  long double typeCount_a(const a &a_, const Lemma &Lemma_) const;
+  /** The count of each a summed over its lemmas, worked out by
+   *  deserialise() so that scoring needn't walk the lemmas */
+  std::map<a, std::size_t> TokenCounts_a;
 
 #if ENABLE_DEBUG
 
@@ -33,6 +33,68 @@
 #endif // ENABLE_DEBUG
 
 namespace Apertium {
+template <typename Key, typename Value>
+static void sumCounts(const std::map<Key, std::map<Value, std::size_t> > &Counts,
+                      std::map<Key, std::size_t> &Sums) {
+  Sums.clear();
+
+  for (typename std::map<Key, std::map<Value, std::size_t> >::const_iterator
+           Key_ = Counts.begin();
+       Key_ != Counts.end(); ++Key_) {
+    std::size_t &Sum = Sums[Key_->first];
+
+    for (typename std::map<Value, std::size_t>::const_iterator Value_ =
+             Key_->second.begin();
+         Value_ != Key_->second.end(); ++Value_) {
+      Sum += Value_->second;
+    }
+  }
+}
+
+template <typename Key, typename Value>
+static long double
+tokenCount(const std::map<Key, std::map<Value, std::size_t> > &Counts,
+           const Key &Key_, const Value &Value_) {
+  typename std::map<Key, std::map<Value, std::size_t> >::const_iterator
+      Values = Counts.find(Key_);
+
+  if (Values == Counts.end())
+    return 1;
+
+  typename std::map<Value, std::size_t>::const_iterator Count =
+      Values->second.find(Value_);
+
+  if (Count == Values->second.end())
+    return 1;
+
+  return 1 + Count->second;
+}
+
+template <typename Key>
+static long double tokenCount(const std::map<Key, std::size_t> &Sums,
+                              const Key &Key_) {
+  typename std::map<Key, std::size_t>::const_iterator Sum = Sums.find(Key_);
+
+  if (Sum == Sums.end())
+    return 1;
+
+  return 1 + Sum->second;
+}
+
+template <typename Key, typename Value>
+static long double
+typeCount(const std::map<Key, std::map<Value, std::size_t> > &Counts,
+          const Key &Key_, const Value &Value_) {
+  typename std::map<Key, std::map<Value, std::size_t> >::const_iterator
+      Values = Counts.find(Key_);
+
+  if (Values == Counts.end())
+    return 1;
+
+  return (Values->second.find(Value_) == Values->second.end() ? 1 : 0) +
+         Values->second.size();
+}
+
 Stream_5_3_3_Tagger::Stream_5_3_3_Tagger(const Flags &Flags_)
     : basic_Tagger(Flags_) {}
 
@@ -42,145 +104,77 @@ void Stream_5_3_3_Tagger::deserialise(std::istream &Serialised_basic_Tagger) {
                 std::pair<std::map<i, std::map<Lemma, std::size_t> >,
                           std::map<Lemma, std::map<i, std::size_t> > > > >::
       deserialise(Serialised_basic_Tagger);
+  sumCounts(Model.first, TokenCounts_i);
+  sumCounts(Model.second.first, TokenCounts_i_Morpheme);
+  sumCounts(Model.second.second, TokenCounts_d_Morpheme);
 }
 
 long double Stream_5_3_3_Tagger::score(const Analysis &Analysis_) const {
-  long double score = tokenCount_r_i(Analysis_) * tokenCount_i(Analysis_),
-              score_Divisor = tokenCount_i(Analysis_) + typeCount_i(Analysis_);
+  const i i_(Analysis_);
+  const Lemma Lemma_(Analysis_);
+  long double score = tokenCount_r_i(i_, Lemma_) * tokenCount_i(i_),
+              score_Divisor = tokenCount_i(i_) + typeCount_i(i_, Lemma_);
 
   for (std::vector<Morpheme>::const_iterator Morpheme_ =
            Analysis_.TheMorphemes.begin() + 1;
        Morpheme_ != Analysis_.TheMorphemes.end(); ++Morpheme_) {
-    score *= tokenCount_d_i_Morpheme(Lemma(*Morpheme_), i(*(Morpheme_ - 1))) *
-             tokenCount_i_d_Morpheme(i(*Morpheme_), Lemma(*Morpheme_));
+    const i Previous_i(*(Morpheme_ - 1)), Morpheme_i(*Morpheme_);
+    const Lemma Morpheme_Lemma(*Morpheme_);
+    score *= tokenCount_d_i_Morpheme(Morpheme_Lemma, Previous_i) *
+             tokenCount_i_d_Morpheme(Morpheme_i, Morpheme_Lemma);
     score_Divisor *=
-        (tokenCount_i_Morpheme(i(*(Morpheme_ - 1))) +
-         typeCount_i_Morpheme(i(*(Morpheme_ - 1)), Lemma(*Morpheme_))) *
-        (tokenCount_d_Morpheme(Lemma(*Morpheme_)) +
-         typeCount_d_Morpheme(Lemma(*Morpheme_), i(*Morpheme_)));
+        (tokenCount_i_Morpheme(Previous_i) +
+         typeCount_i_Morpheme(Previous_i, Morpheme_Lemma)) *
+        (tokenCount_d_Morpheme(Morpheme_Lemma) +
+         typeCount_d_Morpheme(Morpheme_Lemma, Morpheme_i));
   }
 
   return score / score_Divisor;
 }
 
-long double
-Stream_5_3_3_Tagger::tokenCount_r_i(const Analysis &Analysis_) const {
-  if (Model.first.find(i(Analysis_)) == Model.first.end())
-    return 1;
-
-  if (Model.first.find(i(Analysis_))->second.find(Lemma(Analysis_)) ==
-      Model.first.find(i(Analysis_))->second.end())
-    return 1;
-
-  return 1 +
-         Model.first.find(i(Analysis_))->second.find(Lemma(Analysis_))->second;
+long double Stream_5_3_3_Tagger::tokenCount_r_i(const i &i_,
+                                                const Lemma &Lemma_) const {
+  return tokenCount(Model.first, i_, Lemma_);
 }
 
-long double Stream_5_3_3_Tagger::tokenCount_i(const Analysis &Analysis_) const {
-  if (Model.first.find(i(Analysis_)) == Model.first.end())
-    return 1;
-
-  long double tokenCount_i_ = 1;
-
-  for (std::map<Lemma, std::size_t>::const_iterator Lemma_ =
-           Model.first.find(i(Analysis_))->second.begin();
-       Lemma_ != Model.first.find(i(Analysis_))->second.end(); ++Lemma_) {
-    tokenCount_i_ += Lemma_->second;
-  }
-
-  return tokenCount_i_;
+long double Stream_5_3_3_Tagger::tokenCount_i(const i &i_) const {
+  return tokenCount(TokenCounts_i, i_);
 }
 
-long double Stream_5_3_3_Tagger::typeCount_i(const Analysis &Analysis_) const {
-  if (Model.first.find(i(Analysis_)) == Model.first.end())
-    return 1;
-
-  return (Model.first.find(i(Analysis_))->second.find(Lemma(Analysis_)) ==
-                  Model.first.find(i(Analysis_))->second.end()
-              ? 1
-              : 0) +
-         Model.first.find(i(Analysis_))->second.size();
+long double Stream_5_3_3_Tagger::typeCount_i(const i &i_,
+                                             const Lemma &Lemma_) const {
+  return typeCount(Model.first, i_, Lemma_);
 }
 
 long double Stream_5_3_3_Tagger::tokenCount_d_i_Morpheme(const Lemma &Lemma_,
                                                          const i &i_) const {
-  if (Model.second.first.find(i_) == Model.second.first.end())
-    return 1;
-
-  if (Model.second.first.find(i_)->second.find(Lemma_) ==
-      Model.second.first.find(i_)->second.end())
-    return 1;
-
-  return 1 + Model.second.first.find(i_)->second.find(Lemma_)->second;
+  return tokenCount(Model.second.first, i_, Lemma_);
 }
 
 long double
 Stream_5_3_3_Tagger::tokenCount_i_d_Morpheme(const i &i_,
                                              const Lemma &Lemma_) const {
-  if (Model.second.second.find(Lemma_) == Model.second.second.end())
-    return 1;
-
-  if (Model.second.second.find(Lemma_)->second.find(i_) ==
-      Model.second.second.find(Lemma_)->second.end())
-    return 1;
-
-  return 1 + Model.second.second.find(Lemma_)->second.find(i_)->second;
+  return tokenCount(Model.second.second, Lemma_, i_);
 }
 
 long double Stream_5_3_3_Tagger::tokenCount_i_Morpheme(const i &i_) const {
-  if (Model.second.first.find(i_) == Model.second.first.end())
-    return 1;
-
-  long double typeCount_i_Morpheme_ = 1;
-
-  for (std::map<Lemma, std::size_t>::const_iterator Lemma_ =
-           Model.second.first.find(i_)->second.begin();
-       Lemma_ != Model.second.first.find(i_)->second.end(); ++Lemma_) {
-    typeCount_i_Morpheme_ += Lemma_->second;
-  }
-
-  return typeCount_i_Morpheme_;
+  return tokenCount(TokenCounts_i_Morpheme, i_);
 }
 
 long double
 Stream_5_3_3_Tagger::typeCount_i_Morpheme(const i &i_,
                                           const Lemma &Lemma_) const {
-  if (Model.second.first.find(i_) == Model.second.first.end())
-    return 1;
-
-  return (Model.second.first.find(i_)->second.find(Lemma_) ==
-                  Model.second.first.find(i_)->second.end()
-              ? 1
-              : 0) +
-         Model.second.first.find(i_)->second.size();
+  return typeCount(Model.second.first, i_, Lemma_);
 }
 
 long double
 Stream_5_3_3_Tagger::tokenCount_d_Morpheme(const Lemma &Lemma_) const {
-  if (Model.second.second.find(Lemma_) == Model.second.second.end())
-    return 1;
-
-  long double tokenCount_d_Morpheme_ = 1;
-
-  for (std::map<i, std::size_t>::const_iterator i_ =
-           Model.second.second.find(Lemma_)->second.begin();
-       i_ != Model.second.second.find(Lemma_)->second.end(); ++i_) {
-    tokenCount_d_Morpheme_ += i_->second;
-  }
-
-  return tokenCount_d_Morpheme_;
+  return tokenCount(TokenCounts_d_Morpheme, Lemma_);
 }
 
 long double Stream_5_3_3_Tagger::typeCount_d_Morpheme(const Lemma &Lemma_,
                                                       const i &i_) const {
-  if (Model.second.second.find(Lemma_) == Model.second.second.end())
-    return 1;
-
-  return (Model.second.second.find(Lemma_)->second.find(i_) ==
-                  Model.second.second.find(Lemma_)->second.end()
-              ? 1
-              : 0) +
-         Model.second.second.find(Lemma_)->second.size();
+  return typeCount(Model.second.second, Lemma_, i_);
 }
 
 #if ENABLE_DEBUG
@@ -188,8 +182,10 @@ long double Stream_5_3_3_Tagger::typeCount_d_Morpheme(const Lemma &Lemma_,
 std::wstring Stream_5_3_3_Tagger::score_DEBUG(const Analysis &Analysis_) const {
   std::wstringstream score_DEBUG_;
 
-  score_DEBUG_ << L"(" << tokenCount_r_i(Analysis_) << L" * "
-               << tokenCount_i(Analysis_);
+  const i i_(Analysis_);
+  const Lemma Lemma_(Analysis_);
+  score_DEBUG_ << L"(" << tokenCount_r_i(i_, Lemma_) << L" * "
+               << tokenCount_i(i_);
 
   for (std::vector<Morpheme>::const_iterator Morpheme_ =
            Analysis_.TheMorphemes.begin() + 1;
@@ -200,8 +196,8 @@ std::wstring Stream_5_3_3_Tagger::score_DEBUG(const Analysis &Analysis_) const {
                  << tokenCount_i_d_Morpheme(i(*Morpheme_), Lemma(*Morpheme_));
   }
 
-  score_DEBUG_ << L") /\n    [(" << tokenCount_i(Analysis_) << L" + "
-               << typeCount_i(Analysis_) << L")";
+  score_DEBUG_ << L") /\n    [(" << tokenCount_i(i_) << L" + "
+               << typeCount_i(i_, Lemma_) << L")";
 
   for (std::vector<Morpheme>::const_iterator Morpheme_ =
            Analysis_.TheMorphemes.begin() + 1;
@@ -24,7 +24,9 @@
 #include "i.h"
 #include "lemma.h"
 
+#include <cstddef>
 #include <istream>
+#include <map>
 
 #if ENABLE_DEBUG
 
@@ -41,15 +43,20 @@ public:
 
 private:
   long double score(const Analysis &Analysis_) const;
-  long double tokenCount_r_i(const Analysis &Analysis_) const;
-  long double tokenCount_i(const Analysis &Analysis_) const;
-  long double typeCount_i(const Analysis &Analysis_) const;
+  long double tokenCount_r_i(const i &i_, const Lemma &Lemma_) const;
+  long double tokenCount_i(const i &i_) const;
+  long double typeCount_i(const i &i_, const Lemma &Lemma_) const;
   long double tokenCount_d_i_Morpheme(const Lemma &Lemma_, const i &i_) const;
   long double tokenCount_i_d_Morpheme(const i &i_, const Lemma &Lemma_) const;
   long double tokenCount_i_Morpheme(const i &i_) const;
   long double typeCount_i_Morpheme(const i &i_, const Lemma &Lemma_) const;
   long double tokenCount_d_Morpheme(const Lemma &Lemma_) const;
   long double typeCount_d_Morpheme(const Lemma &Lemma_, const i &i_) const;
+  /** The counts of Model summed over the inner maps, worked out by
+   *  deserialise() so that scoring needn't walk them */
+  std::map<i, std::size_t> TokenCounts_i;
+  std::map<i, std::size_t> TokenCounts_i_Morpheme;
+  std::map<Lemma, std::size_t> TokenCounts_d_Morpheme;
 
 #if ENABLE_DEBUG
 
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/tag_bitset.h>
+#include <apertium/hash_index.h>
+
+#include <climits>
+
+using namespace std;
+
+static unsigned int const word_bits = sizeof(unsigned long) * CHAR_BIT;
+
+TagBitset::TagBitset()
+{
+}
+
+TagBitset::TagBitset(set<TTag> const &tags)
+{
+  for(set<TTag>::const_iterator it = tags.begin(); it != tags.end(); it++)
+  {
+    insert(*it);
+  }
+}
+
+void
+TagBitset::insert(TTag t)
+{
+  if(words.size() <= t / word_bits)
+  {
+    words.resize(t / word_bits + 1, 0);
+  }
+  words[t / word_bits] |= 1UL << (t % word_bits);
+}
+
+void
+TagBitset::clear()
+{
+  words.clear();
+}
+
+unsigned int
+TagBitset::hash() const
+{
+  unsigned int value = HashIndex::basis;
+  for(unsigned int i = 0; i != words.size(); i++)
+  {
+    // fold in every bit of the word, whatever the width of a long
+    for(unsigned long w = words[i], n = 0; n < word_bits; w >>= 16, n += 16)
+    {
+      value = HashIndex::mix(value, w & 0xffffU);
+    }
+  }
+  return value;
+}
+
+bool
+TagBitset::operator==(TagBitset const &other) const
+{
+  return words == other.words;
+}
+
+bool
+TagBitset::operator!=(TagBitset const &other) const
+{
+  return words != other.words;
+}
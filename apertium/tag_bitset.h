@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TAG_BITSET_
+#define _TAG_BITSET_
+
+#include <set>
+#include <vector>
+
+#include <apertium/ttag.h>
+
+using namespace std;
+
+/**
+ * A set of tags as a bitset, one bit per tag, so that ambiguity classes
+ * can be hashed and compared a machine word at a time.  The tags must
+ * not be negative.
+ */
+class TagBitset
+{
+private:
+  /** The bits, without trailing zero words so that equal sets of tags
+   *  have equal words
+   */
+  vector<unsigned long> words;
+public:
+  TagBitset();
+  explicit TagBitset(set<TTag> const &tags);
+
+  void insert(TTag t);
+  void clear();
+
+  /** @return the FNV-1a hash of the words */
+  unsigned int hash() const;
+
+  bool operator==(TagBitset const &other) const;
+  bool operator!=(TagBitset const &other) const;
+};
+
+#endif
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/tag_pattern_set.h>
+#include <apertium/utf_converter.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+
+static wchar_t
+lowerAscii(wchar_t c)
+{
+  if(c >= L'A' && c <= L'Z')
+  {
+    return c - L'A' + L'a';
+  }
+  return c;
+}
+
+TagPatternSet::TagPatternSet()
+{
+}
+
+TagPatternSet::TagPatternSet(TagPatternSet const &o)
+{
+  compile(o.patterns);
+}
+
+TagPatternSet::~TagPatternSet()
+{
+  destroy();
+}
+
+TagPatternSet &
+TagPatternSet::operator =(TagPatternSet const &o)
+{
+  if(this != &o)
+  {
+    compile(o.patterns);
+  }
+  return *this;
+}
+
+void
+TagPatternSet::destroy()
+{
+  for(unsigned int i = 0; i != regexps.size(); i++)
+  {
+    delete regexps[i];
+  }
+  regexps.clear();
+  complex.clear();
+  by_any.clear();
+  by_first.clear();
+  elements.clear();
+  patterns.clear();
+}
+
+bool
+TagPatternSet::parse(wstring const &pattern, vector<wstring> &result)
+{
+  // only sequences of plain ASCII tags are handled here; anything PCRE
+  // could read as syntax is left to it
+  result.clear();
+  size_t i = 0;
+  while(i != pattern.size())
+  {
+    if(pattern[i] != L'<')
+    {
+      return false;
+    }
+    size_t const end = pattern.find(L'>', i + 1);
+    if(end == wstring::npos || end == i + 1)
+    {
+      return false;
+    }
+    wstring const tag = pattern.substr(i, end - i + 1);
+    if(tag == L"<*>")
+    {
+      result.push_back(L"");
+    }
+    else
+    {
+      wstring lower = L"<";
+      for(size_t j = i + 1; j != end; j++)
+      {
+        wchar_t const c = pattern[j];
+        if(c >= 0x80 || c == L'<' || iswspace(c) ||
+           strchr("\\^$.|?*+()[]{}#", c) != NULL)
+        {
+          return false;
+        }
+        lower += lowerAscii(c);
+      }
+      lower += L'>';
+      result.push_back(lower);
+    }
+    i = end + 1;
+  }
+  return !result.empty();
+}
+
+void
+TagPatternSet::compile(vector<wstring> const &rules)
+{
+  destroy();
+  patterns = rules;
+  elements.resize(rules.size());
+
+  for(unsigned int i = 0; i != rules.size(); i++)
+  {
+    if(!parse(rules[i], elements[i]))
+    {
+      elements[i].clear();
+
+      string utfpattern = UtfConverter::toUtf8(rules[i]);
+      while(true)
+      {
+        size_t pos = utfpattern.find("<*>");
+        if(pos == string::npos)
+        {
+          break;
+        }
+        utfpattern.replace(pos, 3, "(<[^>]+>)+");
+      }
+      complex.push_back(i);
+      regexps.push_back(new ApertiumRE());
+      regexps.back()->compile(utfpattern);
+    }
+    else if(elements[i][0].empty())
+    {
+      by_any.push_back(i);
+    }
+    else
+    {
+      by_first[elements[i][0]].push_back(i);
+    }
+  }
+}
+
+unsigned int
+TagPatternSet::size() const
+{
+  return patterns.size();
+}
+
+wstring const &
+TagPatternSet::pattern(unsigned int index) const
+{
+  return patterns[index];
+}
+
+size_t
+TagPatternSet::tagEnd(wstring const &str, size_t pos)
+{
+  // the end of the tag <[^>]+> at pos, or npos if there is none
+  if(pos >= str.size() || str[pos] != L'<')
+  {
+    return wstring::npos;
+  }
+  size_t const end = str.find(L'>', pos + 1);
+  if(end == wstring::npos || end == pos + 1)
+  {
+    return wstring::npos;
+  }
+  return end + 1;
+}
+
+bool
+TagPatternSet::matchAt(vector<wstring> const &rule, unsigned int element,
+                       wstring const &lf, size_t pos) const
+{
+  if(element == rule.size())
+  {
+    return true;
+  }
+
+  wstring const &tag = rule[element];
+  if(tag.empty())
+  {
+    // <*>: one or more tags, trying every length
+    for(size_t end = tagEnd(lf, pos); end != wstring::npos;
+        end = tagEnd(lf, end))
+    {
+      if(matchAt(rule, element + 1, lf, end))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  if(lf.size() - pos < tag.size())
+  {
+    return false;
+  }
+  for(size_t i = 0; i != tag.size(); i++)
+  {
+    if(lowerAscii(lf[pos + i]) != tag[i])
+    {
+      return false;
+    }
+  }
+  return matchAt(rule, element + 1, lf, pos + tag.size());
+}
+
+bool
+TagPatternSet::matchComplex(unsigned int index, wstring const &lf,
+                            string &utf_lf) const
+{
+  if(utf_lf.empty() && !lf.empty())
+  {
+    utf_lf = UtfConverter::toUtf8(lf);
+  }
+  return regexps[index]->match(utf_lf) != "";
+}
+
+bool
+TagPatternSet::scan(wstring const &lf, vector<unsigned int> *found) const
+{
+  vector<bool> seen(found == NULL ? 0 : patterns.size(), false);
+  wstring key;
+
+  for(size_t pos = lf.find(L'<'); pos != wstring::npos;
+      pos = lf.find(L'<', pos + 1))
+  {
+    // a tag of a rule has no '>' but the last one, so the rules that can
+    // match here are those beginning with the text up to the first '>'
+    size_t const end = lf.find(L'>', pos + 1);
+    if(end != wstring::npos && !by_first.empty())
+    {
+      key.clear();
+      for(size_t i = pos; i <= end; i++)
+      {
+        key += lowerAscii(lf[i]);
+      }
+      map<wstring, vector<unsigned int> >::const_iterator it = by_first.find(key);
+      if(it != by_first.end())
+      {
+        for(unsigned int i = 0; i != it->second.size(); i++)
+        {
+          unsigned int const r = it->second[i];
+          if((found == NULL || !seen[r]) && matchAt(elements[r], 1, lf, end + 1))
+          {
+            if(found == NULL)
+            {
+              return true;
+            }
+            seen[r] = true;
+            found->push_back(r);
+          }
+        }
+      }
+    }
+
+    for(unsigned int i = 0; i != by_any.size(); i++)
+    {
+      unsigned int const r = by_any[i];
+      if((found == NULL || !seen[r]) && matchAt(elements[r], 0, lf, pos))
+      {
+        if(found == NULL)
+        {
+          return true;
+        }
+        seen[r] = true;
+        found->push_back(r);
+      }
+    }
+  }
+
+  string utf_lf;
+  for(unsigned int i = 0; i != complex.size(); i++)
+  {
+    if(matchComplex(i, lf, utf_lf))
+    {
+      if(found == NULL)
+      {
+        return true;
+      }
+      found->push_back(complex[i]);
+    }
+  }
+
+  return found != NULL && !found->empty();
+}
+
+void
+TagPatternSet::match(wstring const &lf, vector<unsigned int> &found) const
+{
+  found.clear();
+  if(!patterns.empty())
+  {
+    scan(lf, &found);
+    sort(found.begin(), found.end());
+  }
+}
+
+bool
+TagPatternSet::matchAny(wstring const &lf) const
+{
+  return !patterns.empty() && scan(lf, NULL);
+}
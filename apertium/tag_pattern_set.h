@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TAG_PATTERN_SET_
+#define _TAG_PATTERN_SET_
+
+#include <apertium/apertium_re.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * The prefer or discard rules of a tagger, compiled together.  A rule is
+ * a sequence of tags such as <n><*><pl>, where <*> stands for one or more
+ * tags, and it matches a lexical form that contains it, ignoring case.
+ * The rules are indexed by their first tag, so a lexical form is scanned
+ * once for all of them; rules that are not plain tag sequences are left
+ * to PCRE, as before.
+ */
+class TagPatternSet
+{
+private:
+  /**
+   * The rules as they were given
+   */
+  vector<wstring> patterns;
+
+  /**
+   * For every rule, its tags in lower case, with an empty string for
+   * <*>; empty for the rules that need PCRE
+   */
+  vector<vector<wstring> > elements;
+
+  /**
+   * The rules that begin with each tag
+   */
+  map<wstring, vector<unsigned int> > by_first;
+
+  /**
+   * The rules that begin with <*>
+   */
+  vector<unsigned int> by_any;
+
+  /**
+   * The rules that need PCRE, and their compiled expressions
+   */
+  vector<unsigned int> complex;
+  vector<ApertiumRE *> regexps;
+
+  void destroy();
+  static bool parse(wstring const &pattern, vector<wstring> &result);
+  static size_t tagEnd(wstring const &str, size_t pos);
+  bool matchAt(vector<wstring> const &rule, unsigned int element,
+               wstring const &lf, size_t pos) const;
+  bool matchComplex(unsigned int index, wstring const &lf,
+                    string &utf_lf) const;
+
+  /**
+   * Look for the rules matching a lexical form
+   * @param lf the lexical form
+   * @param found where to add the rules found, or NULL to stop at the
+   * first one
+   * @return whether any rule matches
+   */
+  bool scan(wstring const &lf, vector<unsigned int> *found) const;
+public:
+  TagPatternSet();
+  TagPatternSet(TagPatternSet const &o);
+  ~TagPatternSet();
+  TagPatternSet & operator =(TagPatternSet const &o);
+
+  /**
+   * Compile a list of rules, replacing the current ones
+   * @param rules the rules, in the format of TaggerData
+   */
+  void compile(vector<wstring> const &rules);
+
+  /**
+   * @return the number of rules
+   */
+  unsigned int size() const;
+
+  /**
+   * @param index the index of a rule
+   * @return the rule, as it was given
+   */
+  wstring const & pattern(unsigned int index) const;
+
+  /**
+   * Find the rules matching a lexical form
+   * @param lf the lexical form
+   * @param found the indexes of the rules found, in increasing order
+   */
+  void match(wstring const &lf, vector<unsigned int> &found) const;
+
+  /**
+   * @param lf the lexical form
+   * @return whether any rule matches the lexical form
+   */
+  bool matchAny(wstring const &lf) const;
+};
+
+#endif
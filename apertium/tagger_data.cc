@@ -33,9 +33,11 @@ TaggerData::copy(TaggerData const &o)
   constants = o.constants;
   output = o.output;  
   plist = o.plist;
+  patterns_ok = false;
 }
 
-TaggerData::TaggerData()
+TaggerData::TaggerData() :
+patterns_ok(false)
 {
 }
 
@@ -43,7 +45,8 @@ TaggerData::~TaggerData()
 {
 }
 
-TaggerData::TaggerData(TaggerData const &o)
+TaggerData::TaggerData(TaggerData const &o) :
+patterns_ok(false)
 {
   copy(o);
 }
@@ -151,6 +154,7 @@ TaggerData::setEnforceRules(vector<TEnforceAfterRule> const &tear)
 vector<wstring> &
 TaggerData::getPreferRules()
 {
+  patterns_ok = false;
   return prefer_rules;
 }
 
@@ -164,11 +168,13 @@ void
 TaggerData::setPreferRules(vector<wstring> const &pr)
 {
   prefer_rules = pr;
+  patterns_ok = false;
 }
 
 vector<wstring> &
 TaggerData::getDiscardRules()
 {
+  patterns_ok = false;
   return discard;
 }
 
@@ -182,6 +188,7 @@ void
 TaggerData::setDiscardRules(vector<wstring> const &v)
 {
   discard = v;
+  patterns_ok = false;
 }
 
 ConstantManager &
@@ -236,4 +243,30 @@ void
 TaggerData::addDiscard(wstring const &tags)
 {
   discard.push_back(tags);
+  patterns_ok = false;
+}
+
+void
+TaggerData::compilePatterns() const
+{
+  if(!patterns_ok)
+  {
+    prefer_patterns.compile(prefer_rules);
+    discard_patterns.compile(discard);
+    patterns_ok = true;
+  }
+}
+
+const TagPatternSet &
+TaggerData::getPreferPatterns() const
+{
+  compilePatterns();
+  return prefer_patterns;
+}
+
+const TagPatternSet &
+TaggerData::getDiscardPatterns() const
+{
+  compilePatterns();
+  return discard_patterns;
 }
@@ -21,6 +21,7 @@
 #include <apertium/ttag.h>
 #include <apertium/collection.h>
 #include <apertium/collection.h>
+#include <apertium/tag_pattern_set.h>
 #include <lttoolbox/pattern_list.h>
 #include <lttoolbox/ltstr.h>
 
@@ -44,8 +45,17 @@ protected:
   Collection output;
   PatternList plist;
   vector<wstring> discard;
+
+  /**
+   * prefer_rules and discard compiled for matching, rebuilt on demand
+   * after any of them may have changed
+   */
+  mutable TagPatternSet prefer_patterns;
+  mutable TagPatternSet discard_patterns;
+  mutable bool patterns_ok;
   
   void copy(TaggerData const &o);
+  void compilePatterns() const;
 public:
   TaggerData();
   virtual ~TaggerData();
@@ -80,6 +90,12 @@ public:
   const vector<wstring> & getDiscardRules() const;
   void setDiscardRules(vector<wstring> const &dr);
 
+  /**
+   * The prefer and discard rules, compiled to be matched together
+   */
+  const TagPatternSet & getPreferPatterns() const;
+  const TagPatternSet & getDiscardPatterns() const;
+
   ConstantManager & getConstants();
   const ConstantManager & getConstants() const;
   void setConstants(ConstantManager const &c);
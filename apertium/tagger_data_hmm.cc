@@ -20,29 +20,46 @@
 #include <apertium/endian_double_util.h>
 #include <apertium/string_utils.h>
 
+#include <algorithm>
+
 using namespace Apertium;
 
-void
-TaggerDataHMM::destroy()
+double **
+TaggerDataHMM::newMatrix(int rows, int cols)
 {
-  if(a != NULL)
+  // one block for the whole matrix, rows point into it
+  double **m = new double * [rows];
+  if(rows != 0)
   {
-    for(int i = 0; i != N; i++)
+    m[0] = new double[rows * cols];
+    for(int i = 1; i != rows; i++)
     {
-      delete [] a[i];
+      m[i] = m[0] + i * cols;
     }
-    delete [] a;
   }
-  a = NULL;
+  return m;
+}
 
-  if(b != NULL)
+void
+TaggerDataHMM::deleteMatrix(double **m, int rows)
+{
+  if(m != NULL)
   {
-    for(int i = 0; i != N; i++)
+    if(rows != 0)
     {
-      delete [] b[i];
+      delete [] m[0];
     }
-    delete [] b;
+    delete [] m;
   }
+}
+
+void
+TaggerDataHMM::destroy()
+{
+  deleteMatrix(a, N);
+  a = NULL;
+
+  deleteMatrix(b, N);
   b = NULL;
 
   N = 0;
@@ -107,11 +124,10 @@ TaggerDataHMM::setProbabilities(int const myN, int const myM,
   if(N != 0 && M != 0)
   {
     // NxN matrix
-    a = new double * [N];
-    for(int i = 0; i != N; i++)
+    a = newMatrix(N, N);
+    if(myA != NULL)
     {
-      a[i] = new double[N];
-      if(myA != NULL)
+      for(int i = 0; i != N; i++)
       {
         for(int j = 0; j != N; j++) // ToDo: N should be M? Check use of N and M in this function
         { 
@@ -121,11 +137,10 @@ TaggerDataHMM::setProbabilities(int const myN, int const myM,
     }
   
     // NxM matrix
-    b = new double * [N];
-    for(int i = 0; i != N; i++)
+    b = newMatrix(N, M);
+    if(myB != NULL)
     {
-      b[i] = new double[M];
-      if(myB != NULL)
+      for(int i = 0; i != N; i++)
       {
         for(int j = 0; j != M; j++)
         {
@@ -230,13 +245,8 @@ TaggerDataHMM::read(FILE *in)
   M = Compression::multibyte_read(in);
 
   
-  a = new double * [N];
-  b = new double * [N];
-  for(int i = 0; i != N; i++)
-  {
-    a[i] = new double[N];
-    b[i] = new double[M];
-  }
+  a = newMatrix(N, N);
+  b = newMatrix(N, M);
    
   // read a
   for(int i = 0; i != N; i++)
@@ -248,12 +258,9 @@ TaggerDataHMM::read(FILE *in)
   }
 
   // initializing b matrix
-  for(int i = 0 ; i != N; i++)
+  if(N != 0)
   {
-    for(int j = 0; j != M; j++)
-    {
-      b[i][j] = ZERO;
-    }
+    fill(b[0], b[0] + N * M, (double) ZERO);
   }
 
   // read nonZERO values of b
@@ -271,6 +278,7 @@ TaggerDataHMM::read(FILE *in)
     
   // read discards on ambiguity
   discard.clear();
+  patterns_ok = false;
 
   unsigned int limit = Compression::multibyte_read(in);  
   if(feof(in))
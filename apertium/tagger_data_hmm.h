@@ -27,6 +27,12 @@ private:
   double **a;
   double **b;
 
+  /**
+   * Matrices are allocated as one contiguous row-major block, with the
+   * row pointers of getA() and getB() pointing into it
+   */
+  static double ** newMatrix(int rows, int cols);
+  static void deleteMatrix(double **m, int rows);
   void destroy();
 public:
   TaggerDataHMM();
@@ -20,28 +20,35 @@
 #include <apertium/endian_double_util.h>
 #include <apertium/string_utils.h>
 
+#include <algorithm>
+
 using namespace Apertium;
 
+namespace {
+  bool cellLess(TaggerDataLSW::Cell const &a, TaggerDataLSW::Cell const &b)
+  {
+    if (a.i != b.i) {
+      return a.i < b.i;
+    }
+    if (a.j != b.j) {
+      return a.j < b.j;
+    }
+    return a.k < b.k;
+  }
+}
+
 void
 TaggerDataLSW::destroy()
 {
-  if (d != NULL) {
-    for (int i = 0; i < N; ++i) {
-      for (int j = 0; j < N; ++j) {
-        delete [] d[i][j];
-      }
-      delete [] d[i];
-    }
-  delete [] d;
-  }
-  d = NULL;
+  row_start.clear();
+  cell_tags.clear();
+  cell_values.clear();
   
   N = 0;
 }
 
 TaggerDataLSW::TaggerDataLSW()
 {
-  d = NULL;
   N = 0;
 }
 
@@ -50,17 +57,18 @@ TaggerDataLSW::~TaggerDataLSW()
   destroy();
 }
 
-TaggerDataLSW::TaggerDataLSW(TaggerDataLSW const &o)
+TaggerDataLSW::TaggerDataLSW(TaggerDataLSW const &o) :
+TaggerData(),
+N(o.N),
+row_start(o.row_start),
+cell_tags(o.cell_tags),
+cell_values(o.cell_values)
 {
-  d = NULL;
-  N = 0;
   TaggerData::copy(o);
-  this->setProbabilities(o.N, o.d);
 }
 
 TaggerDataLSW::TaggerDataLSW(TaggerData const &o)
 {
-  d = NULL;
   N = 0;
   TaggerData::copy(o);
 }
@@ -72,36 +80,66 @@ TaggerDataLSW::operator =(TaggerDataLSW const &o)
   {
     destroy();
     TaggerData::copy(o);
-    this->setProbabilities(o.N, o.d);
+    N = o.N;
+    row_start = o.row_start;
+    cell_tags = o.cell_tags;
+    cell_values = o.cell_values;
   }
   return *this;
 }
 
 void
-TaggerDataLSW::setProbabilities(int const myN, double ***myD) {
-   this->destroy();
-   N = myN;
-   if(N != 0) {
-     d = new double ** [N];
-     for (int i = 0; i < N; ++i) {
-       d[i] = new double * [N];
-       for (int j = 0; j < N; ++j) {
-           d[i][j] = new double [N];
-           if (myD != NULL) {
-              for (int k = 0; k < N; ++k) {
-                d[i][j][k] = myD[i][j][k];
-              }
-           }
-       }
-     }
-   } else {
-     d = NULL;
-   }
+TaggerDataLSW::setProbabilities(int const myN, vector<Cell> const &cells) {
+  this->destroy();
+  N = myN;
+
+  vector<Cell> sorted(cells);
+  sort(sorted.begin(), sorted.end(), cellLess);
+
+  row_start.assign(N*N + 1, 0);
+  for (size_t c = 0; c < sorted.size(); c++) {
+    if (c > 0 && !cellLess(sorted[c-1], sorted[c])) {
+      cell_values.back() += sorted[c].value;
+      continue;
+    }
+    row_start[sorted[c].i*N + sorted[c].j + 1]++;
+    cell_tags.push_back(sorted[c].k);
+    cell_values.push_back(sorted[c].value);
+  }
+  for (int r = 0; r < N*N; r++) {
+    row_start[r + 1] += row_start[r];
+  }
 }
 
-double ***
-TaggerDataLSW::getD() {
-  return d;
+double
+TaggerDataLSW::getD(TTag i, TTag j, TTag k) const {
+  vector<TTag>::const_iterator first = cell_tags.begin() + row_start[i*N + j];
+  vector<TTag>::const_iterator last = cell_tags.begin() + row_start[i*N + j + 1];
+  vector<TTag>::const_iterator it = lower_bound(first, last, k);
+  if (it == last || *it != k) {
+    return 0;
+  }
+  return cell_values[it - cell_tags.begin()];
+}
+
+unsigned int
+TaggerDataLSW::getRowBegin(TTag i, TTag j) const {
+  return row_start[i*N + j];
+}
+
+unsigned int
+TaggerDataLSW::getRowEnd(TTag i, TTag j) const {
+  return row_start[i*N + j + 1];
+}
+
+TTag
+TaggerDataLSW::getCellTag(unsigned int cell) const {
+  return cell_tags[cell];
+}
+
+vector<double> &
+TaggerDataLSW::getCellValues() {
+  return cell_values;
 }
 
 int 
@@ -171,38 +209,23 @@ TaggerDataLSW::read(FILE *in)
   output.read(in); 
 
   // dimensions
-  N = Compression::multibyte_read(in);
+  int myN = Compression::multibyte_read(in);
 
-  d = new double ** [N];
-  for ( int i = 0; i < N; ++i) {
-    d[i] = new double * [N];
-    for (int j = 0; j < N; ++j) {
-      d[i][j] = new double [N];
-    }
-  }
-
-  // initializing d matrix
-  for (int i = 0; i < N; ++i) {
-    for (int j = 0; j < N; ++j) {
-      for (int k = 0; k < N; ++k) {
-        d[i][j][k] = 0;
-      }
-    }
-  }
-
-  int nval = Compression::multibyte_read(in);
-  for(; nval != 0; nval--) {
-    int i = Compression::multibyte_read(in);
-    int j = Compression::multibyte_read(in);
-    int k = Compression::multibyte_read(in);
-    d[i][j][k] = EndianDoubleUtil::read(in);
+  vector<Cell> cells(Compression::multibyte_read(in));
+  for(size_t c = 0; c < cells.size(); c++) {
+    cells[c].i = Compression::multibyte_read(in);
+    cells[c].j = Compression::multibyte_read(in);
+    cells[c].k = Compression::multibyte_read(in);
+    cells[c].value = EndianDoubleUtil::read(in);
   }
+  setProbabilities(myN, cells);
    
   // read pattern list
   plist.read(in);
     
   // read discards on ambiguity
   discard.clear();
+  patterns_ok = false;
 
   unsigned int limit = Compression::multibyte_read(in);  
   if(feof(in))
@@ -283,25 +306,21 @@ TaggerDataLSW::write(FILE *out)
   Compression::multibyte_write(N, out);
 
   int nval = 0;
-  for (int i = 0; i < N; ++i) {
-    for (int j = 0; j < N; ++j) {
-      for (int k = 0; k < N; ++k) {
-        if (d[i][j][k] > ZERO) {
-          ++nval;
-        }
-      }
+  for (size_t c = 0; c < cell_values.size(); ++c) {
+    if (cell_values[c] > ZERO) {
+      ++nval;
     }
   }
   Compression::multibyte_write(nval, out);
 
   for (int i = 0; i < N; ++i) {
     for (int j = 0; j < N; ++j) {
-      for (int k = 0; k < N; ++k) {
-        if (d[i][j][k] > ZERO) {
+      for (unsigned int c = getRowBegin(i, j); c != getRowEnd(i, j); ++c) {
+        if (cell_values[c] > ZERO) {
           Compression::multibyte_write(i, out);
           Compression::multibyte_write(j, out);
-          Compression::multibyte_write(k, out);
-          EndianDoubleUtil::write(out, d[i][j][k]);
+          Compression::multibyte_write(cell_tags[c], out);
+          EndianDoubleUtil::write(out, cell_values[c]);
         }
       }
     }
@@ -21,9 +21,27 @@
 
 class TaggerDataLSW : public TaggerData
 {
+public:
+  /**
+   * A non-zero cell D[i][j][k] of the probability tensor
+   */
+  struct Cell
+  {
+    TTag i, j, k;
+    double value;
+  };
+
 private:
   int N;
-  double ***d;
+
+  /**
+   * D is stored sparsely, row by row: the cells D[i][j][.] that are not
+   * zero are cell_tags and cell_values from row_start[i*N+j] up to
+   * row_start[i*N+j+1], by increasing third tag
+   */
+  vector<unsigned int> row_start;
+  vector<TTag> cell_tags;
+  vector<double> cell_values;
   
   void destroy();
 
@@ -34,9 +52,35 @@ public:
   TaggerDataLSW(TaggerData const &o);
   TaggerDataLSW & operator =(TaggerDataLSW const &o);
   
-  void setProbabilities(int const myN, double ***myD = NULL);
+  /**
+   * Set the number of tags and the non-zero cells of D; cells given twice
+   * are added up
+   */
+  void setProbabilities(int const myN,
+                        vector<Cell> const &cells = vector<Cell>());
+
+  /**
+   * @return D[i][j][k], zero for cells that are not stored
+   */
+  double getD(TTag i, TTag j, TTag k) const;
+
+  /**
+   * The cells D[i][j][.] are the indices from getRowBegin(i, j) to
+   * getRowEnd(i, j)
+   */
+  unsigned int getRowBegin(TTag i, TTag j) const;
+  unsigned int getRowEnd(TTag i, TTag j) const;
+
+  /**
+   * @return the third tag of a cell
+   */
+  TTag getCellTag(unsigned int cell) const;
+
+  /**
+   * @return the values of all the cells, which can be changed in place
+   */
+  vector<double> & getCellValues();
 
-  virtual double *** getD();
   virtual int getN();
   
   void read(FILE *in);
@@ -133,7 +133,6 @@ void tagger_utils::scan_for_ambg_classes(FILE *fdic, TaggerData &td) {
 
 void tagger_utils::scan_for_ambg_classes(Collection &output, MorphoStream &morpho_stream) {
   int nw = 0;
-  set <TTag> tags;
   TaggerWord *word = NULL;
 
   // In the input dictionary there must be all punctuation marks, including the end-of-sentence mark
@@ -144,10 +143,8 @@ void tagger_utils::scan_for_ambg_classes(Collection &output, MorphoStream &morph
     if (++nw % 10000 == 0)
       wcerr << L'.' << flush;
 
-    tags = word->get_tags();
-
-    if (tags.size() > 0)
-      output[tags];
+    if (!word->get_tags().empty() && output.find(word->get_tag_bits()) == -1)
+      output[word->get_tags()];
 
     delete word;
     word = morpho_stream.get_next_word();
@@ -175,24 +172,24 @@ tagger_utils::add_neccesary_ambg_classes(TaggerData &td) {
   }
 }
 
-set<TTag> &
+const set<TTag> &
 tagger_utils::find_similar_ambiguity_class(TaggerData &td, set<TTag> &c) {
-  set<TTag> &ret = td.getOpenClass();
+  const set<TTag> &open_class = td.getOpenClass();
   Collection &output = td.getOutput();
-  int ret_idx = output[ret];
 
-  for (int k=0; k<output.size(); k++) {
-    const set<TTag> &ambg_class = output[k];
-    if (ambg_class.size() > ret.size() ||
-        (ambg_class.size() == ret.size())) {
-      continue;
-    }
-    if (includes(ambg_class.begin(), ambg_class.end(), c.begin(), c.end())) {
-      ret_idx = k;
-      ret = ambg_class;
-    }
+  int k = output.find_superset(c);
+  if (k == -1 || output[k].size() >= open_class.size()) {
+    return open_class;
+  }
+  return output[k];
+}
+
+int
+tagger_utils::find_ambiguity_class(TaggerData &td, TaggerWord &word) {
+  if (word.get_tags().empty()) {
+    return td.getOutput().find(TagBitset(td.getOpenClass()));
   }
-  return ret;
+  return td.getOutput().find(word.get_tag_bits());
 }
 
 void
@@ -221,7 +218,7 @@ static void _warn_absent_ambiguity_class(TaggerWord &word) {
   wcerr << L"Error: " << errors;
 }
 
-set<TTag> &
+const set<TTag> &
 tagger_utils::require_similar_ambiguity_class(TaggerData &td, set<TTag> &tags, TaggerWord &word, bool warn) {
   if (td.getOutput().has_not(tags)) {
     if (warn) {
@@ -232,7 +229,7 @@ tagger_utils::require_similar_ambiguity_class(TaggerData &td, set<TTag> &tags, T
   return tags;
 }
 
-set<TTag> &
+const set<TTag> &
 tagger_utils::require_similar_ambiguity_class(TaggerData &td, set<TTag> &tags) {
   if (td.getOutput().has_not(tags)) {
     return find_similar_ambiguity_class(td, tags);
@@ -20,6 +20,8 @@
 #include "apertium_config.h"
 #include <apertium/unlocked_cstdio.h>
 
+#include <algorithm>
+
 using namespace Apertium;
 
 bool TaggerWord::generate_marks=false;
@@ -28,8 +30,6 @@ vector<wstring> TaggerWord::array_tags;
 
 bool TaggerWord::show_ignored_string=true;
 
-map<wstring, ApertiumRE, Ltstr> TaggerWord::patterns;
-
 TaggerWord::TaggerWord(bool prev_plus_cut) :
 show_sf(false)
 {
@@ -41,6 +41,7 @@ show_sf(false)
 TaggerWord::TaggerWord(const TaggerWord &w){
   superficial_form = w.superficial_form;
   tags = w.tags;
+  tag_bits = w.tag_bits;
   show_sf = false;
   lexical_forms = w.lexical_forms;
   ignored_string = w.ignored_string;
@@ -71,52 +72,20 @@ TaggerWord::get_superficial_form() {
   return superficial_form;
 }
 
-bool
-TaggerWord::match(wstring const &s, wstring const &pattern)
-{
-  map<wstring, ApertiumRE, Ltstr>::iterator it = patterns.find(pattern);
-  string const utfs = UtfConverter::toUtf8(s);
-
-  if(it == patterns.end())
-  {
-    string utfpattern = UtfConverter::toUtf8(pattern);
-    string regexp = "";
-    
-    while(true)
-    {
-      size_t pos = utfpattern.find("<*>");
-      if(pos == string::npos)
-      {
-        break;
-      }
-      utfpattern.replace(pos, 3, "(<[^>]+>)+");
-    }
-    patterns[pattern].compile(utfpattern);
-    return patterns[pattern].match(utfs) != "";
-  }
-  else
-  {
-    return it->second.match(utfs) != "";
-  }
-}
-
 void
-TaggerWord::add_tag(TTag &t, const wstring &lf, vector<wstring> const &prefer_rules){
+TaggerWord::add_tag(TTag &t, const wstring &lf, TagPatternSet const &prefer_rules){
 
   //Tag is added only is it is not present yet
   //Sometime one word can have more than one lexical form assigned to the same tag
   if (tags.find(t)==tags.end()) {
     tags.insert(t);
+    tag_bits.insert(t);
     lexical_forms[t]=lf;
   } else {
     //Take a look at the prefer rules
-    for(int i=0; i < (int) prefer_rules.size(); i++)
+    if (prefer_rules.matchAny(lf))
     {
-      if (match(lf, prefer_rules[i])) 
-      {
-	lexical_forms[t]=lf;
-	break;
-      }
+      lexical_forms[t]=lf;
     }
   }
 }
@@ -126,6 +95,11 @@ TaggerWord::get_tags() {
   return tags;
 }
 
+TagBitset const &
+TaggerWord::get_tag_bits() const {
+  return tag_bits;
+}
+
 bool
 TaggerWord::isAmbiguous() const
 {
@@ -350,16 +324,33 @@ TaggerWord::outputOriginal(FILE *output) {
 }
 
 void
-TaggerWord::discardOnAmbiguity(wstring const &tags)
+TaggerWord::discardOnAmbiguity(TagPatternSet const &discard)
 {
-  if(isAmbiguous())
+  if(!isAmbiguous() || discard.size() == 0)
+  {
+    return;
+  }
+
+  // every lexical form is scanned once for all the rules
+  map<TTag, vector<unsigned int> > matches;
+  for(map<TTag, wstring>::iterator it = lexical_forms.begin(),
+                                   limit = lexical_forms.end();
+      it != limit; it++)
+  {
+    discard.match(it->second, matches[it->first]);
+  }
+
+  // the rules are applied one after another, as they were when each of
+  // them was matched on its own
+  for(unsigned int rule = 0; rule != discard.size() && isAmbiguous(); rule++)
   {
     map<TTag, wstring>::iterator it = lexical_forms.begin(),
                               limit = lexical_forms.end();
     set<TTag> newsettag;
     while(it != limit)
     {
-      if(match(it->second, tags))
+      vector<unsigned int> const &found = matches[it->first];
+      if(binary_search(found.begin(), found.end(), rule))
       {
         lexical_forms.erase(it);
         it = lexical_forms.begin();
@@ -368,7 +359,7 @@ TaggerWord::discardOnAmbiguity(wstring const &tags)
       {
         newsettag.insert(it->first);
       }
-        
+
       if(lexical_forms.size() == 1)
       {
         newsettag.insert(lexical_forms.begin()->first);
@@ -376,9 +367,10 @@ TaggerWord::discardOnAmbiguity(wstring const &tags)
       }
       it++;
     }
-    if(tags.size() != newsettag.size())
-    { 
-      this->tags = newsettag;
+    if(discard.pattern(rule).size() != newsettag.size())
+    {
+      tags = newsettag;
+      tag_bits = TagBitset(tags);
     }
   }
 }
@@ -25,7 +25,8 @@
 
 #include <lttoolbox/ltstr.h>
 #include <apertium/ttag.h>
-#include <apertium/apertium_re.h>
+#include <apertium/tag_bitset.h>
+#include <apertium/tag_pattern_set.h>
 
 using namespace std;
 
@@ -39,6 +40,7 @@ private:
   wstring superficial_form; 
   
   set<TTag> tags;  //Set of all possible tags
+  TagBitset tag_bits;  //The same tags as a bitset
   map<TTag, wstring> lexical_forms;  //For a given coarse tag it stores the fine tag 
                                     //delevered by the morphological analyzer
   wstring ignored_string;
@@ -50,9 +52,6 @@ private:
 			  //previous word was ended. It has the same
 			  //plus_cut meaning
   bool show_sf; // Show the superficial form in the output
-  static map<wstring, ApertiumRE, Ltstr> patterns;
-
-  bool match(wstring const &s, wstring const &pattern);
 public:
   static bool generate_marks;
   static vector<wstring> array_tags;
@@ -88,12 +87,18 @@ public:
     *  @param t the coarse tag
     *  @param lf the lexical form (fine tag)
     */
-   virtual void add_tag(TTag &t, const wstring &lf, vector<wstring> const &prefer_rules);
+   virtual void add_tag(TTag &t, const wstring &lf, TagPatternSet const &prefer_rules);
 
    /** Get the set of tags of this word.
     *  @return  set of tags.
     */  
    virtual set<TTag>& get_tags();
+
+   /** Get the tags of this word as a bitset, to look up its ambiguity
+    *  class without copying the set
+    *  @return  bitset of tags.
+    */
+   TagBitset const & get_tag_bits() const;
   
    /** Get a wstring with the set of tags
     */
@@ -146,7 +151,11 @@ public:
   bool isAmbiguous() const;  // CAUTION: unknown words are not considered to 
                              // be ambiguous by this method
   
-  void discardOnAmbiguity(wstring const &tags);
+  /** Discard the lexical forms matching the discard rules, one rule
+   *  after another, as long as the word is ambiguous.
+   *  @param discard the discard rules
+   */
+  void discardOnAmbiguity(TagPatternSet const &discard);
 };
 
 #endif
@@ -34,39 +34,46 @@
 using namespace Apertium;
 using namespace std;
 
+Transfer::Rules::Rules() :
+me(NULL),
+isExtended(false),
+any_char(0),
+any_tag(0),
+defaultAttrs(lu)
+{
+}
+
+Transfer::Rules::~Rules()
+{
+  delete me;
+}
+
 void
 Transfer::destroy()
 {
-  if(me)
+  if(owns_rules)
   {
-    delete me;
-    me = NULL;
-  }
-  if(doc)
-  {
-    xmlFreeDoc(doc);
-    doc = NULL;
+    delete rules;
   }
+  rules = NULL;
 }
 
 Transfer::Transfer() :
+rules(new Rules()),
+owns_rules(true),
 word(0),
 blank(0),
 lword(0),
 lblank(0),
 output(0),
-any_char(0),
-any_tag(0),
+output_text(0),
+input_text(0),
+input_pos(0),
 nwords(0)
 {
-  me = NULL;
-  doc = NULL;
-  root_element = NULL;
-  lastrule = NULL;
-  defaultAttrs = lu;
+  lastrule = -1;
   useBilingual = true;
   preBilingual = false;
-  isExtended = false;
   null_flush = false;
   internal_null_flush = false;
   trace = false;
@@ -79,15 +86,32 @@ Transfer::~Transfer()
   destroy();
 }
 
+Transfer *
+Transfer::makeWorker() const
+{
+  Transfer *t = new Transfer();
+  delete t->rules;
+  t->rules = rules;
+  t->owns_rules = false;
+  t->vars = rules->var_defaults;
+  t->useBilingual = useBilingual;
+  t->preBilingual = preBilingual;
+  t->null_flush = null_flush;
+  t->trace = trace;
+  t->trace_att = trace_att;
+  t->biltrans_cache.setCapacity(biltrans_cache.getCapacity());
+  return t;
+}
+
 void
 Transfer::readData(FILE *in)
 {
-  alphabet.read(in);
-  any_char = alphabet(TRXReader::ANY_CHAR);
-  any_tag = alphabet(TRXReader::ANY_TAG);
+  rules->alphabet.read(in);
+  rules->any_char = rules->alphabet(TRXReader::ANY_CHAR);
+  rules->any_tag = rules->alphabet(TRXReader::ANY_TAG);
 
   Transducer t;
-  t.read(in, alphabet.size());
+  t.read(in, rules->alphabet.size());
 
   map<int, int> finals;
 
@@ -98,46 +122,9 @@ Transfer::readData(FILE *in)
     finals[key] = Compression::multibyte_read(in);
   }
 
-  me = new MatchExe(t, finals);
-
-  // attr_items
-  bool recompile_attrs = Compression::string_read(in) != string(pcre_version());
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-    attr_items[cad_k].read(in);
-    wstring fallback = Compression::wstring_read(in);
-    if(recompile_attrs) {
-      attr_items[cad_k].compile(UtfConverter::toUtf8(fallback));
-    }
-  }
-
-  // variables
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-    variables[cad_k] = UtfConverter::toUtf8(Compression::wstring_read(in));
-  }
-
-  // macros
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
-    macros[cad_k] = Compression::multibyte_read(in);
-  }
-
-  // lists
-  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
-  {
-    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
+  rules->me = new MatchExe(t, finals);
 
-    for(int j = 0, limit2 = Compression::multibyte_read(in); j != limit2; j++)
-    {
-      wstring const cad_v = Compression::wstring_read(in);
-      lists[cad_k].insert(UtfConverter::toUtf8(cad_v));
-      listslow[cad_k].insert(UtfConverter::toUtf8(StringUtils::tolower(cad_v)));
-    }
-  }
+  rules->tables.read(in);
 }
 
 void
@@ -149,8 +136,8 @@ Transfer::readBil(string const &fstfile)
     wcerr << "Error: Could not open file '" << fstfile << "'." << endl;
     exit(EXIT_FAILURE);
   }
-  fstp.load(in);
-  fstp.initBiltrans();
+  rules->fstp.load(in);
+  rules->fstp.initBiltrans();
   fclose(in);
 }
 
@@ -163,18 +150,16 @@ Transfer::setExtendedDictionary(string const &fstfile)
     wcerr << "Error: Could not open extended dictionary file '" << fstfile << "'." << endl;
     exit(EXIT_FAILURE);
   }
-  extended.load(in);
-  extended.initBiltrans();
+  rules->extended.load(in);
+  rules->extended.initBiltrans();
   fclose(in);
-  isExtended = true;
+  rules->isExtended = true;
 }
 
 void
 Transfer::read(string const &transferfile, string const &datafile,
 	       string const &fstfile)
 {
-  readTransfer(transferfile);
-
   // datafile
   FILE *in = fopen(datafile.c_str(), "rb");
   if(!in)
@@ -183,7 +168,17 @@ Transfer::read(string const &transferfile, string const &datafile,
     exit(EXIT_FAILURE);
   }
   readData(in);
+
+  // data files written by apertium-preprocess-transfer carry the compiled
+  // rules; older ones need the rules file to be parsed
+  bool const precompiled = rules->bytecode.read(in);
   fclose(in);
+  if(!precompiled)
+  {
+    readTransfer(transferfile);
+  }
+  rules->defaultAttrs = rules->bytecode.isChunkDefault() ? chunk : lu;
+  bindSlots();
 
   if(fstfile != "")
   {
@@ -194,7 +189,7 @@ Transfer::read(string const &transferfile, string const &datafile,
 void
 Transfer::readTransfer(string const &in)
 {
-  doc = xmlReadFile(in.c_str(), NULL, 0);
+  xmlDoc *doc = xmlReadFile(in.c_str(), NULL, 0);
 
   if(doc == NULL)
   {
@@ -202,1487 +197,518 @@ Transfer::readTransfer(string const &in)
     exit(EXIT_FAILURE);
   }
 
-  root_element = xmlDocGetRootElement(doc);
-
-  // search for root element attributes
-  for(xmlAttr *i = root_element->properties; i != NULL; i = i->next)
-  {
-    if(!xmlStrcmp(i->name, (const xmlChar *) "default"))
-    {
-      if(!xmlStrcmp(i->children->content, (const xmlChar *) "chunk"))
-      {
-        defaultAttrs = chunk;
-      }
-      else
-      {
-        defaultAttrs = lu; // default value for 'default'
-      }
-    }
-  }
-
-  // search for macros & rules
-  for(xmlNode *i = root_element->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(!xmlStrcmp(i->name, (const xmlChar *) "section-def-macros"))
-      {
-        collectMacros(i);
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "section-rules"))
-      {
-        collectRules(i);
-      }
-    }
-  }
+  rules->bytecode.compile(doc);
+  xmlFreeDoc(doc);
 }
 
 void
-Transfer::collectRules(xmlNode *localroot)
+Transfer::bindSlots()
 {
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  vector<string> const &attr_names = rules->bytecode.getAttrNames();
+  for(unsigned int i = 0; i != attr_names.size(); i++)
   {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      for(xmlNode *j = i->children; ; j = j->next)
-      {
-        if(j->type == XML_ELEMENT_NODE && !xmlStrcmp(j->name, (const xmlChar *) "action"))
-        {
-          rule_map.push_back(j);
-          break;
-        }
-      }
-    }
+    rules->attr_slots.push_back(&rules->tables.attr(rules->tables.attrSlot(attr_names[i])));
   }
-}
 
-void
-Transfer::collectMacros(xmlNode *localroot)
-{
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  vector<string> const &var_names = rules->bytecode.getVarNames();
+  for(unsigned int i = 0; i != var_names.size(); i++)
   {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      macro_map.push_back(i);
-    }
+    rules->var_defaults.push_back(rules->tables.var(rules->tables.varSlot(var_names[i])));
+  }
+  vars = rules->var_defaults;
+
+  vector<string> const &list_names = rules->bytecode.getListNames();
+  for(unsigned int i = 0; i != list_names.size(); i++)
+  {
+    rules->list_slots.push_back(&rules->tables.list(rules->tables.listSlot(list_names[i])));
   }
 }
 
 bool
-Transfer::checkIndex(xmlNode *element, int index, int limit)
+Transfer::checkIndex(int line, int index, int limit)
 {
+  wstring const filename = UtfConverter::fromUtf8(rules->bytecode.getFilename());
+
   if(index >= limit)
   {
-    wcerr << L"Error in " << UtfConverter::fromUtf8((char *) doc->URL) << L": line " << element->line << L": index >= limit" << endl;
+    wcerr << L"Error in " << filename << L": line " << line << L": index >= limit" << endl;
     return false;
   }
   if(index < 0) {
-    wcerr << L"Error in " << UtfConverter::fromUtf8((char *) doc->URL) << L": line " << element->line << L": index < 0" << endl;
+    wcerr << L"Error in " << filename << L": line " << line << L": index < 0" << endl;
     return false;
   }
   if(word[index] == 0)
   {
-    wcerr << L"Error in " << UtfConverter::fromUtf8((char *) doc->URL) << L": line " << element->line << L": Null access at word[index]" << endl;
+    wcerr << L"Error in " << filename << L": line " << line << L": Null access at word[index]" << endl;
     return false;
   }
   return true;
 }
 
-
 string
-Transfer::evalString(xmlNode *element)
+Transfer::pop()
+{
+  string value;
+  value.swap(string_stack.back());
+  string_stack.pop_back();
+  return value;
+}
+
+int
+Transfer::execute(int pc)
 {
-  map<xmlNode *, TransferInstr>::iterator it;
-  it = evalStringCache.find(element);
-  if(it != evalStringCache.end())
+  vector<int> const &code = rules->bytecode.getCode();
+  vector<string> const &literals = rules->bytecode.getLiterals();
+
+  while(true)
   {
-    TransferInstr &ti = it->second;
-    switch(ti.getType())
+    int const *op = &code[pc];
+    switch(op[0])
     {
-      case ti_clip_sl:
-        if(checkIndex(element, ti.getPos(), lword))
+      case bc_lit:
+        string_stack.push_back(literals[op[1]]);
+        pc += 2;
+        break;
+
+      case bc_var:
+        string_stack.push_back(vars[op[1]]);
+        pc += 2;
+        break;
+
+      case bc_clip_sl:
+      case bc_clip_tl:
+        if(checkIndex(op[4], op[1], lword))
+        {
+          if(op[0] == bc_clip_sl)
+          {
+            string_stack.push_back(word[op[1]]->source(*rules->attr_slots[op[2]], op[3]));
+          }
+          else
+          {
+            string_stack.push_back(word[op[1]]->target(*rules->attr_slots[op[2]], op[3]));
+          }
+        }
+        else
+        {
+          string_stack.push_back("");
+        }
+        pc += 5;
+        break;
+
+      case bc_linkto_sl:
+      case bc_linkto_tl:
+        if(checkIndex(op[5], op[1], lword) &&
+           (op[0] == bc_linkto_sl ?
+            word[op[1]]->source(*rules->attr_slots[op[2]], op[3]) :
+            word[op[1]]->target(*rules->attr_slots[op[2]], op[3])) != "")
         {
-          return word[ti.getPos()]->source(attr_items[ti.getContent()], ti.getCondition());
+          string_stack.push_back(literals[op[4]]);
         }
+        else
+        {
+          string_stack.push_back("");
+        }
+        pc += 6;
+        break;
+
+      case bc_b:
+        if(op[1] >= 0 && checkIndex(op[2], op[1], lblank))
+        {
+          string_stack.push_back(!blank?"":*(blank[op[1]]));
+        }
+        else
+        {
+          string_stack.push_back(" ");
+        }
+        pc += 3;
         break;
 
-      case ti_clip_tl:
-        if(checkIndex(element, ti.getPos(), lword))
+      case bc_get_case_from:
+        if(checkIndex(op[3], op[1], lword))
+        {
+          string_stack.back() = copycase(word[op[1]]->source(*rules->attr_slots[op[2]]),
+                                         string_stack.back());
+        }
+        else
         {
-          return word[ti.getPos()]->target(attr_items[ti.getContent()], ti.getCondition());
+          string_stack.back().clear();
         }
+        pc += 4;
         break;
 
-      case ti_linkto_sl:
-        if(checkIndex(element, ti.getPos(), lword))
+      case bc_case_of_sl:
+      case bc_case_of_tl:
+        if(checkIndex(op[3], op[1], lword))
         {
-          if(word[ti.getPos()]->source(attr_items[ti.getContent()], ti.getCondition()) != "")
+          if(op[0] == bc_case_of_sl)
           {
-            return "<" + string((char *) ti.getPointer()) + ">";
+            string_stack.push_back(caseOf(word[op[1]]->source(*rules->attr_slots[op[2]])));
           }
           else
           {
-            return "";
+            string_stack.push_back(caseOf(word[op[1]]->target(*rules->attr_slots[op[2]])));
           }
         }
+        else
+        {
+          string_stack.push_back("");
+        }
+        pc += 4;
         break;
 
-      case ti_linkto_tl:
-        if(checkIndex(element, ti.getPos(), lword))
+      case bc_concat:
+      case bc_lu:
+      {
+        int const n = op[1];
+        if(n == 0)
+        {
+          string_stack.push_back("");
+        }
+        else
         {
-          if(word[ti.getPos()]->target(attr_items[ti.getContent()], ti.getCondition()) != "")
+          unsigned int const first = string_stack.size() - n;
+          for(unsigned int i = first + 1; i != string_stack.size(); i++)
           {
-            return "<" + string((char *) ti.getPointer()) + ">";
+            string_stack[first].append(string_stack[i]);
           }
-          else
+          string_stack.resize(first + 1);
+        }
+        if(op[0] == bc_lu && string_stack.back() != "")
+        {
+          string_stack.back() = "^" + string_stack.back() + "$";
+        }
+        pc += 2;
+        break;
+      }
+
+      case bc_mlu:
+      {
+        unsigned int const first = string_stack.size() - op[1];
+        string value;
+        bool first_time = true;
+        for(unsigned int i = first; i != string_stack.size(); i++)
+        {
+          string const &myword = string_stack[i];
+          if(!first_time)
+          {
+            if(myword != "" && myword[0] != '#')  //'+#' problem
+            {
+              value += '+';
+            }
+          }
+          else if(myword != "" || op[2] == mlu_chunk)
           {
-            return "";
+            first_time = false;
           }
+          value.append(myword);
+        }
+        string_stack.resize(first);
+        if(value != "" || op[2] == mlu_out)
+        {
+          string_stack.push_back("^" + value + "$");
+        }
+        else
+        {
+          string_stack.push_back("");
+        }
+        pc += 3;
+        break;
+      }
+
+      case bc_chunk_name:
+      {
+        string const &name = op[1] == 0 ? literals[op[2]] : vars[op[2]];
+        if(op[3] >= 0)
+        {
+          string_stack.push_back("^" + copycase(vars[op[3]], name));
+        }
+        else
+        {
+          string_stack.push_back("^" + name);
         }
+        pc += 4;
         break;
+      }
 
-      case ti_var:
-        return variables[ti.getContent()];
+      case bc_error:
+        wcerr << L"Error: " << UtfConverter::fromUtf8(literals[op[1]]) << endl;
+        exit(EXIT_FAILURE);
 
-      case ti_lit_tag:
-      case ti_lit:
-        return ti.getContent();
+      case bc_true:
+      case bc_false:
+        test_stack.push_back(op[0] == bc_true);
+        pc += 1;
+        break;
 
-      case ti_b:
-        if(ti.getPos() >= 0 && checkIndex(element, ti.getPos(), lblank))
+      case bc_equal:
+      case bc_begins_with:
+      case bc_ends_with:
+      case bc_contains_substring:
+      {
+        string second = pop();
+        string first = pop();
+        if(op[1])
         {
-          return !blank?"":*(blank[ti.getPos()]);
+          first = tolower(first);
+          second = tolower(second);
         }
-        else {
-          return " ";
+        switch(op[0])
+        {
+          case bc_equal:
+            test_stack.push_back(first == second);
+            break;
+          case bc_begins_with:
+            test_stack.push_back(beginsWith(first, second));
+            break;
+          case bc_ends_with:
+            test_stack.push_back(endsWith(first, second));
+            break;
+          default:
+            test_stack.push_back(first.find(second) != string::npos);
+            break;
         }
+        pc += 2;
         break;
+      }
 
-      case ti_get_case_from:
-        if(checkIndex(element, ti.getPos(), lword))
+      case bc_in:
+        if(op[2])
+        {
+          test_stack.push_back(rules->list_slots[op[1]]->containsLower(tolower(pop())));
+        }
+        else
         {
-          return copycase(word[ti.getPos()]->source(attr_items[ti.getContent()]),
-                  evalString((xmlNode *) ti.getPointer()));
+          test_stack.push_back(rules->list_slots[op[1]]->contains(pop()));
         }
+        pc += 3;
         break;
 
-      case ti_case_of_sl:
-        if(checkIndex(element, ti.getPos(), lword))
+      case bc_begins_with_list:
+      case bc_ends_with_list:
+      {
+        string needle = pop();
+        if(op[2])
+        {
+          needle = tolower(needle);
+        }
+        vector<string> const &items = op[2] ? rules->list_slots[op[1]]->getLowItems() :
+                                              rules->list_slots[op[1]]->getItems();
+        bool found = false;
+        for(unsigned int i = 0; !found && i != items.size(); i++)
         {
-          return caseOf(word[ti.getPos()]->source(attr_items[ti.getContent()]));
+          found = op[0] == bc_begins_with_list ? beginsWith(needle, items[i]) : endsWith(needle, items[i]);
         }
+        test_stack.push_back(found);
+        pc += 3;
+        break;
+      }
+
+      case bc_not:
+        test_stack.back() = !test_stack.back();
+        pc += 1;
         break;
 
-      case ti_case_of_tl:
-        if(checkIndex(element, ti.getPos(), lword))
+      case bc_and_short:
+      case bc_or_short:
+        if(test_stack.back() == (op[0] == bc_or_short))
+        {
+          pc = op[1];
+        }
+        else
         {
-          return caseOf(word[ti.getPos()]->target(attr_items[ti.getContent()]));
+          test_stack.pop_back();
+          pc += 2;
         }
         break;
 
-      default:
-        return "";
-    }
-    return "";
-  }
+      case bc_out:
+        writeOutput(string_stack.back());
+        string_stack.pop_back();
+        pc += 1;
+        break;
 
-  if(!xmlStrcmp(element->name, (const xmlChar *) "clip"))
-  {
-    int pos = 0;
-    xmlChar *part = NULL, *side = NULL, *as = NULL;
-    bool queue = true;
+      case bc_let_var:
+        vars[op[1]].swap(string_stack.back());
+        string_stack.pop_back();
+        pc += 2;
+        break;
 
-    for(xmlAttr *i = element->properties; i != NULL; i = i->next)
-    {
-      if(!xmlStrcmp(i->name, (const xmlChar *) "side"))
+      case bc_let_clip_sl:
+      case bc_let_clip_tl:
       {
-	side = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "part"))
-      {
-	part = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "pos"))
-      {
-	pos = atoi((const char *)i->children->content) - 1;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "queue"))
-      {
-        if(!xmlStrcmp(i->children->content, (const xmlChar *) "no"))
+        string const value = pop();
+        if(checkIndex(op[4], op[1], lword))
         {
-          queue = false;
+          if(op[0] == bc_let_clip_sl)
+          {
+            word[op[1]]->setSource(*rules->attr_slots[op[2]], value, op[3]);
+          }
+          else
+          {
+            word[op[1]]->setTarget(*rules->attr_slots[op[2]], value, op[3]);
+          }
         }
+        pc += 5;
+        break;
       }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "link-to"))
-      {
-        as = i->children->content;
-      }
-    }
-
-    if(as != NULL)
-    {
-      if(!xmlStrcmp(side, (const xmlChar *) "sl"))
-      {
-        evalStringCache[element] = TransferInstr(ti_linkto_sl, (const char *) part, pos, (void *) as, queue);
-      }
-      else
-      {
-        evalStringCache[element] = TransferInstr(ti_linkto_tl, (const char *) part, pos, (void *) as, queue);
-      }
-    }
-    else if(!xmlStrcmp(side, (const xmlChar *) "sl"))
-    {
-      evalStringCache[element] = TransferInstr(ti_clip_sl, (const char *) part, pos, NULL, queue);
-    }
-    else
-    {
-      evalStringCache[element] = TransferInstr(ti_clip_tl, (const char *) part, pos, NULL, queue);
-    }
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "lit-tag"))
-  {
-    evalStringCache[element] = TransferInstr(ti_lit_tag,
-                                             tags((const char *) element->properties->children->content), 0);
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "lit"))
-  {
-    evalStringCache[element] = TransferInstr(ti_lit, string((char *) element->properties->children->content), 0);
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "b"))
-  {
-    if(element->properties == NULL)
-    {
-      evalStringCache[element] = TransferInstr(ti_b, " ", -1);
-    }
-    else
-    {
-      int pos = atoi((const char *) element->properties->children->content) - 1;
-      evalStringCache[element] = TransferInstr(ti_b, "", pos);
-    }
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "get-case-from"))
-  {
-    int pos = atoi((const char *) element->properties->children->content) - 1;
-    xmlNode *param = NULL;
-    for(xmlNode *i = element->children; i != NULL; i = i->next)
-    {
-      if(i->type == XML_ELEMENT_NODE)
-      {
-	param = i;
-	break;
-      }
-    }
 
-    evalStringCache[element] = TransferInstr(ti_get_case_from, "lem", pos, param);
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "var"))
-  {
-    evalStringCache[element] = TransferInstr(ti_var, (const char *) element->properties->children->content, 0);
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "case-of"))
-  {
-    int pos = 0;
-    xmlChar *part = NULL, *side = NULL;
+      case bc_append:
+        vars[op[1]].append(string_stack.back());
+        string_stack.pop_back();
+        pc += 2;
+        break;
 
-    for(xmlAttr *i = element->properties; i != NULL; i = i->next)
-    {
-      if(!xmlStrcmp(i->name, (const xmlChar *) "side"))
-      {
-	side = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "part"))
-      {
-	part = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "pos"))
+      case bc_modify_case_var:
       {
-	pos = atoi((const char *) i->children->content) - 1;
+        string &var = vars[op[1]];
+        var = copycase(pop(), var);
+        pc += 2;
+        break;
       }
-    }
 
-    if(!xmlStrcmp(side, (const xmlChar *) "sl"))
-    {
-      evalStringCache[element] = TransferInstr(ti_case_of_sl, (const char *) part, pos);
-    }
-    else
-    {
-      evalStringCache[element] = TransferInstr(ti_case_of_tl, (const char *) part, pos);
-    }
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "concat"))
-  {
-    string value;
-    for(xmlNode *i = element->children; i != NULL; i = i->next)
-    {
-      if(i->type == XML_ELEMENT_NODE)
+      case bc_modify_case_sl:
+      case bc_modify_case_tl:
       {
-        value.append(evalString(i));
+        string const value = pop();
+        if(checkIndex(op[4], op[1], lword))
+        {
+          ApertiumRE const &part = *rules->attr_slots[op[2]];
+          if(op[0] == bc_modify_case_sl)
+          {
+            word[op[1]]->setSource(part, copycase(value, word[op[1]]->source(part, op[3])));
+          }
+          else
+          {
+            word[op[1]]->setTarget(part, copycase(value, word[op[1]]->target(part, op[3])));
+          }
+        }
+        pc += 5;
+        break;
       }
-    }
-    return value;
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "lu"))
-  {
-    string myword;
-    for(xmlNode *i = element->children; i != NULL; i = i->next)
-    {
-       if(i->type == XML_ELEMENT_NODE)
-       {
-         myword.append(evalString(i));
-       }
-    }
 
-    if(myword != "")
-    {
-      return "^"+myword+"$";
-    }
-    else
-    {
-      return "";
-    }
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "mlu"))
-  {
-    string value;
+      case bc_call_macro:
+        callMacro(code, pc);
+        pc += 4 + op[3];
+        break;
 
-    bool first_time = true;
+      case bc_reject:
+        return op[1];
 
-    for(xmlNode *i = element->children; i != NULL; i = i->next)
-    {
-      if(i->type == XML_ELEMENT_NODE)
-      {
-        string myword;
-
-        for(xmlNode *j = i->children; j != NULL; j = j->next)
-        {
-          if(j->type == XML_ELEMENT_NODE)
-	  {
-            myword.append(evalString(j));
-	  }
-        }
-
-	if(!first_time)
-	{
-	  if(myword != "" && myword[0] != '#')  //'+#' problem
-	  {
-	    value.append("+");
-          }
-	}
-	else
-	{
-	  if(myword != "")
-	  {
-	    first_time = false;
-          }
-	}
-
-	value.append(myword);
-      }
-    }
-
-    if(value != "")
-    {
-      return "^"+value+"$";
-    }
-    else
-    {
-      return "";
-    }
-  }
-  else if(!xmlStrcmp(element->name, (const xmlChar *) "chunk"))
-  {
-    return processChunk(element);
-  }
-  else
-  {
-    wcerr << "Error: unexpected rvalue expression '" << element->name << "'" << endl;
-    exit(EXIT_FAILURE);
-  }
-
-  return evalString(element);
-}
-
-void
-Transfer::processOut(xmlNode *localroot)
-{
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(defaultAttrs == lu)
-      {
-        if(!xmlStrcmp(i->name, (const xmlChar *) "lu"))
-        {
-  	  string myword;
-	  for(xmlNode *j = i->children; j != NULL; j = j->next)
-	  {
-	    if(j->type == XML_ELEMENT_NODE)
-	    {
-	      myword.append(evalString(j));
-            }
-	  }
-	  if(myword != "")
-	  {
-  	    fputwc_unlocked(L'^', output);
-   	    fputws_unlocked(UtfConverter::fromUtf8(myword).c_str(), output);
-	    fputwc_unlocked(L'$', output);
-          }
-        }
-        else if(!xmlStrcmp(i->name, (const xmlChar *) "mlu"))
-        {
-	  fputwc_unlocked('^', output);
-	  bool first_time = true;
-	  for(xmlNode *j = i->children; j != NULL; j = j->next)
-	  {
-	    if(j->type == XML_ELEMENT_NODE)
-	    {
-              string myword;
-	      for(xmlNode *k = j->children; k != NULL; k = k->next)
-	      {
-	        if(k->type == XML_ELEMENT_NODE)
-	        {
-                  myword.append(evalString(k));
-	        }
-	      }
-
-	      if(!first_time)
-	      {
-	        if(myword != "" && myword[0] != '#')  //'+#' problem
-	        {
-	          fputwc_unlocked(L'+', output);
-                }
-	      }
-	      else
-	      {
-	        if(myword != "")
-	        {
-	          first_time = false;
-                }
-	      }
-	      fputws_unlocked(UtfConverter::fromUtf8(myword).c_str(), output);
-	    }
-	  }
-	  fputwc_unlocked(L'$', output);
-        }
-        else // 'b'
-        {
-          fputws_unlocked(UtfConverter::fromUtf8(evalString(i)).c_str(),
-			  output);
-        }
-      }
-      else
-      {
-        if(!xmlStrcmp(i->name, (const xmlChar *) "chunk"))
-        {
-          fputws_unlocked(UtfConverter::fromUtf8(processChunk(i)).c_str(), output);
-        }
-        else // 'b'
-        {
-          fputws_unlocked(UtfConverter::fromUtf8(evalString(i)).c_str(), output);
-        }
-      }
-    }
-  }
-}
-
-string
-Transfer::processChunk(xmlNode *localroot)
-{
-  string name, namefrom;
-  string caseofchunk = "aa";
-  string result;
-
-  for(xmlAttr *i = localroot->properties; i != NULL; i = i->next)
-  {
-    if(!xmlStrcmp(i->name, (const xmlChar *) "name"))
-    {
-      name = (const char *) i->children->content;
-    }
-    else if(!xmlStrcmp(i->name, (const xmlChar *) "namefrom"))
-    {
-      namefrom = (const char *) i->children->content;
-    }
-    else if(!xmlStrcmp(i->name, (const xmlChar *) "case"))
-    {
-      caseofchunk = (const char *) i->children->content;
-    }
-  }
-
-  result.append("^");
-  if(caseofchunk != "")
-  {
-    if(name != "")
-    {
-      result.append(copycase(variables[caseofchunk], name));
-    }
-    else if(namefrom != "")
-    {
-      result.append(copycase(variables[caseofchunk], variables[namefrom]));
-    }
-    else
-    {
-      wcerr << "Error: you must specify either 'name' or 'namefrom' for the 'chunk' element" << endl;
-      exit(EXIT_FAILURE);
-    }
-  }
-  else
-  {
-    if(name != "")
-    {
-      result.append(name);
-    }
-    else if(namefrom != "")
-    {
-      result.append(variables[namefrom]);
-    }
-    else
-    {
-      wcerr << "Error: you must specify either 'name' or 'namefrom' for the 'chunk' element" << endl;
-      exit(EXIT_FAILURE);
-    }
-  }
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(!xmlStrcmp(i->name, (const xmlChar *) "tags"))
-      {
-        result.append(processTags(i));
-        result.append("{");
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "lu"))
-      {
-        string myword;
-        for(xmlNode *j = i->children; j != NULL; j = j->next)
-        {
-          if(j->type == XML_ELEMENT_NODE)
-          {
-            myword.append(evalString(j));
-          }
-        }
-        if(myword != "")
-        {
-          result.append("^");
-          result.append(myword);
-          result.append("$");
-        }
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "mlu"))
-      {
-        bool first_time = true;
-        string myword;
-        for(xmlNode *j = i->children; j != NULL; j = j->next)
-        {
-          string mylocalword;
-          if(j->type == XML_ELEMENT_NODE)
-          {
-            for(xmlNode *k = j->children; k != NULL; k = k->next)
-            {
-              if(k->type == XML_ELEMENT_NODE)
-              {
-                mylocalword.append(evalString(k));
-              }
-            }
-
-            if(!first_time)
-            {
-              if(mylocalword != "" && mylocalword[0] != '#')  // '+#' problem
-              {
-                myword += '+';
-              }
-            }
-            else
-            {
-              first_time = false;
-            }
-          }
-          myword.append(mylocalword);
-        }
-        if(myword != "")
-        {
-          result.append("^");
-          result.append(myword);
-          result.append("$");
-        }
-      }
-      else // 'b'
-      {
-        result.append(evalString(i));
-      }
-    }
-  }
-  result.append("}$");
-  return result;
-}
+      case bc_jump:
+        pc = op[1];
+        break;
 
-string
-Transfer::processTags(xmlNode *localroot)
-{
-  string result;
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(!xmlStrcmp(i->name, (xmlChar const *) "tag"))
-      {
-        for(xmlNode *j = i->children; j != NULL; j = j->next)
+      case bc_jump_if_false:
+        if(test_stack.back())
         {
-          if(j->type == XML_ELEMENT_NODE)
-          {
-            result.append(evalString(j));
-          }
-        }
-      }
-    }
-  }
-  return result;
-}
-
-int
-Transfer::processInstruction(xmlNode *localroot)
-{
-  int words_to_consume = -1;
-  if(!xmlStrcmp(localroot->name, (const xmlChar *) "choose"))
-  {
-    words_to_consume = processChoose(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "let"))
-  {
-    processLet(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "append"))
-  {
-    processAppend(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "out"))
-  {
-    processOut(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "call-macro"))
-  {
-    processCallMacro(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "modify-case"))
-  {
-    processModifyCase(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "reject-current-rule"))
-  {
-    words_to_consume = processRejectCurrentRule(localroot);
-  }
-  return words_to_consume;
-}
-
-int
-Transfer::processRejectCurrentRule(xmlNode *localroot)
-{
-  bool shifting = true;
-  string value;
-  for(xmlAttr *i = localroot->properties; i != NULL; i = i->next)
-  {
-    if(!xmlStrcmp(i->name, (const xmlChar *) "shifting"))
-    {
-      value = (char *) i->children->content;
-      break;
-    }
-  }
-
-  if(value == "no")
-  {
-    shifting = false;
-  }
-
-  return shifting ? 1 : 0;
-}
-
-void
-Transfer::processLet(xmlNode *localroot)
-{
-  xmlNode *leftSide = NULL, *rightSide = NULL;
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(leftSide == NULL)
-      {
-	leftSide = i;
-      }
-      else
-      {
-	rightSide = i;
-	break;
-      }
-    }
-  }
-
-  map<xmlNode *, TransferInstr>::iterator it = evalStringCache.find(leftSide);
-  if(it != evalStringCache.end())
-  {
-    TransferInstr &ti = it->second;
-    switch(ti.getType())
-    {
-      case ti_var:
-        variables[ti.getContent()] = evalString(rightSide);
-        return;
-
-      case ti_clip_sl:
-        if (checkIndex(leftSide, ti.getPos(), lword)) {
-          word[ti.getPos()]->setSource(attr_items[ti.getContent()], evalString(rightSide), ti.getCondition());
-        }
-        return;
-
-      case ti_clip_tl:
-        if (checkIndex(leftSide, ti.getPos(), lword)) {
-          word[ti.getPos()]->setTarget(attr_items[ti.getContent()], evalString(rightSide), ti.getCondition());
+          pc += 2;
         }
-        return;
-
-      default:
-        return;
-    }
-  }
-  if(leftSide->name != NULL && !xmlStrcmp(leftSide->name, (const xmlChar *) "var"))
-  {
-    string const val = (const char *) leftSide->properties->children->content;
-    variables[val] = evalString(rightSide);
-    evalStringCache[leftSide] = TransferInstr(ti_var, val, 0);
-  }
-  else if(!xmlStrcmp(leftSide->name, (const xmlChar *) "clip"))
-  {
-    int pos = 0;
-    xmlChar *part = NULL, *side = NULL, *as = NULL;
-    bool queue = true;
-
-    for(xmlAttr *i = leftSide->properties; i != NULL; i = i->next)
-    {
-      if(!xmlStrcmp(i->name, (const xmlChar *) "side"))
-      {
-	side = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "part"))
-      {
-	part = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "pos"))
-      {
-	pos = atoi((const char *) i->children->content) - 1;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "queue"))
-      {
-        if(!xmlStrcmp(i->children->content, (const xmlChar *) "no"))
+        else
         {
-          queue = false;
-        }
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "link-to"))
-      {
-        as = i->children->content;
-      }
-    }
-
-    if (pos >= lword) {
-      wcerr << L"Error: Transfer::processLet() bad access on pos >= lword" << endl;
-      return;
-    }
-    if (word[pos] == 0) {
-      wcerr << L"Error: Transfer::processLet() null access on word[pos]" << endl;
-      return;
-    }
-
-    if(!xmlStrcmp(side, (const xmlChar *) "tl"))
-    {
-      word[pos]->setTarget(attr_items[(const char *) part], evalString(rightSide), queue);
-      evalStringCache[leftSide] = TransferInstr(ti_clip_tl, (const char *) part, pos, NULL, queue);
-    }
-    else
-    {
-      word[pos]->setSource(attr_items[(const char *) part], evalString(rightSide), queue);
-      evalStringCache[leftSide] = TransferInstr(ti_clip_sl, (const char *) part, pos, NULL, queue);
-    }
-  }
-}
-
-void
-Transfer::processAppend(xmlNode *localroot)
-{
-  string name;
-  for(xmlAttr *i = localroot->properties; i != NULL; i = i->next)
-  {
-    if(!xmlStrcmp(i->name, (const xmlChar *) "n"))
-    {
-      name = (char *) i->children->content;
-      break;
-    }
-  }
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      variables[name].append(evalString(i));
-    }
-  }
-}
-
-void
-Transfer::processModifyCase(xmlNode *localroot)
-{
-  xmlNode *leftSide = NULL, *rightSide = NULL;
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(leftSide == NULL)
-      {
-	leftSide = i;
-      }
-      else
-      {
-	rightSide = i;
-	break;
-      }
-    }
-  }
-
-  if(leftSide->name != NULL && !xmlStrcmp(leftSide->name, (const xmlChar *) "clip"))
-  {
-    int pos = 0;
-    xmlChar *part = NULL, *side = NULL, *as = NULL;
-    bool queue = true;
-
-    for(xmlAttr *i = leftSide->properties; i != NULL; i = i->next)
-    {
-      if(!xmlStrcmp(i->name, (const xmlChar *) "side"))
-      {
-	side = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "part"))
-      {
-	part = i->children->content;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "pos"))
-      {
-	pos = atoi((const char *) i->children->content) - 1;
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "queue"))
-      {
-        if(!xmlStrcmp(i->children->content, (xmlChar const *) "no"))
-        {
-          queue = false;
-        }
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "link-to"))
-      {
-        as = i->children->content;
-        (void)as; // ToDo, remove "as" and the whole else?
-      }
-    }
-    if(!xmlStrcmp(side, (const xmlChar *) "sl"))
-    {
-      string const result = copycase(evalString(rightSide),
-				      word[pos]->source(attr_items[(const char *) part], queue));
-      word[pos]->setSource(attr_items[(const char *) part], result);
-    }
-    else
-    {
-      string const result = copycase(evalString(rightSide),
-				     word[pos]->target(attr_items[(const char *) part], queue));
-      word[pos]->setTarget(attr_items[(const char *) part], result);
-    }
-  }
-  else if(!xmlStrcmp(leftSide->name, (const xmlChar *) "var"))
-  {
-    string const val = (const char *) leftSide->properties->children->content;
-    variables[val] = copycase(evalString(rightSide), variables[val]);
-  }
-}
-
-void
-Transfer::processCallMacro(xmlNode *localroot)
-{
-  string const n = (const char *) localroot->properties->children->content;
-  int npar = 0;
-
-  xmlNode *macro = macro_map[macros[n]];
-
-  for(xmlAttr *i = macro->properties; i != NULL; i = i->next)
-  {
-    if(!xmlStrcmp(i->name, (const xmlChar *) "npar"))
-    {
-      npar = atoi((const char *) i->children->content);
-      break;
-    }
-  }
-
-  // ToDo: Is it at all valid if npar <= 0 ?
-
-  TransferWord **myword = NULL;
-  if(npar > 0)
-  {
-    myword = new TransferWord *[npar];
-    std::fill(myword, myword+npar, (TransferWord *)(0));
-  }
-  string **myblank = NULL;
-  if(npar > 0)
-  {
-    myblank = new string *[npar];
-    myblank[npar-1] = &emptyblank;
-  }
-
-  int idx = 0;
-  int lastpos = 0;
-  for(xmlNode *i = localroot->children; npar && i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if (idx >= npar) {
-      	  wcerr << L"Error: processCallMacro() number of arguments >= npar at line " << i->line << endl;
-      	  return;
-      }
-      int pos = atoi((const char *) i->properties->children->content)-1;
-      myword[idx] = word[pos];
-      if(idx-1 >= 0)
-      {
-        myblank[idx-1] = blank[lastpos];
-      }
-      idx++;
-      lastpos = pos;
-    }
-  }
-
-  swap(myword, word);
-  swap(myblank, blank);
-  swap(npar, lword);
-
-  for(xmlNode *i = macro->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      processInstruction(i);
-    }
-  }
-
-  swap(myword, word);
-  swap(myblank, blank);
-  swap(npar, lword);
-
-  delete[] myword;
-  delete[] myblank;
-}
-
-int
-Transfer::processChoose(xmlNode *localroot)
-{
-  int words_to_consume = -1;
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(!xmlStrcmp(i->name, (const xmlChar *) "when"))
-      {
-        bool picked_option = false;
-
-	for(xmlNode *j = i->children; j != NULL; j = j->next)
-	{
-	  if(j->type == XML_ELEMENT_NODE)
-	  {
-	    if(!xmlStrcmp(j->name, (const xmlChar *) "test"))
-	    {
-	      if(!processTest(j))
-	      {
-		break;
-	      }
-	      else
-	      {
-	        picked_option = true;
-              }
-	    }
-	    else
-	    {
-              words_to_consume = processInstruction(j);
-              if(words_to_consume != -1)
-              {
-                return words_to_consume;
-              }
-	    }
-	  }
-	}
-        if(picked_option)
-        {
-          return words_to_consume;
-        }
-      }
-      else if(!xmlStrcmp(i->name, (const xmlChar *) "otherwise"))
-      {
-	for(xmlNode *j = i->children; j != NULL; j = j->next)
-	{
-	  if(j->type == XML_ELEMENT_NODE)
-	  {
-            words_to_consume = processInstruction(j);
-            if(words_to_consume != -1)
-            {
-              return words_to_consume;
-            }
-          }
-        }
-      }
-    }
-  }
-  return words_to_consume;
-}
-
-bool
-Transfer::processLogical(xmlNode *localroot)
-{
-  if(!xmlStrcmp(localroot->name, (const xmlChar *) "equal"))
-  {
-    return processEqual(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "begins-with"))
-  {
-    return processBeginsWith(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "begins-with-list"))
-  {
-    return processBeginsWithList(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "ends-with"))
-  {
-    return processEndsWith(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "ends-with-list"))
-  {
-    return processEndsWithList(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "contains-substring"))
-  {
-    return processContainsSubstring(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "or"))
-  {
-    return processOr(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "and"))
-  {
-    return processAnd(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "not"))
-  {
-    return processNot(localroot);
-  }
-  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "in"))
-  {
-    return processIn(localroot);
-  }
-
-  return false;
-}
-
-bool
-Transfer::processIn(xmlNode *localroot)
-{
-  xmlNode *value = NULL;
-  xmlChar *idlist = NULL;
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(value == NULL)
-      {
-        value = i;
-      }
-      else
-      {
-        idlist = i->properties->children->content;
-        break;
-      }
-    }
-  }
-
-  string sval = evalString(value);
-
-  if(localroot->properties != NULL)
-  {
-    if(!xmlStrcmp(localroot->properties->children->content,
-		  (const xmlChar *) "yes"))
-    {
-      set<string, Ltstr> &myset = listslow[(const char *) idlist];
-      if(myset.find(tolower(sval)) != myset.end())
-      {
-	return true;
-      }
-      else
-      {
-	return false;
-      }
-    }
-  }
-
-  set<string, Ltstr> &myset = lists[(const char *) idlist];
-  if(myset.find(sval) != myset.end())
-  {
-    return true;
-  }
-  else
-  {
-    return false;
-  }
-}
-
-bool
-Transfer::processTest(xmlNode *localroot)
-{
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      return processLogical(i);
-    }
-  }
-  return false;
-}
-
-bool
-Transfer::processAnd(xmlNode *localroot)
-{
-  bool val = true;
-  for(xmlNode *i = localroot->children; val && i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      val = val && processLogical(i);
-    }
-  }
-
-  return val;
-}
-
-bool
-Transfer::processOr(xmlNode *localroot)
-{
-  bool val = false;
-  for(xmlNode *i = localroot->children; !val && i != NULL ; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      val = val || processLogical(i);
-    }
-  }
-
-  return val;
-}
-
-bool
-Transfer::processNot(xmlNode *localroot)
-{
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      return !processLogical(i);
-    }
-  }
-  return false;
-}
-
-bool
-Transfer::processEqual(xmlNode *localroot)
-{
-  xmlNode *first = NULL, *second = NULL;
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(first == NULL)
-      {
-        first = i;
-      }
-      else
-      {
-	second = i;
-	break;
-      }
-    }
-  }
-
-  if(localroot->properties == NULL)
-  {
-    return evalString(first) == evalString(second);
-  }
-  else
-  {
-    if(!xmlStrcmp(localroot->properties->children->content,
-		  (const xmlChar *) "yes"))
-    {
-      return tolower(evalString(first)) == tolower(evalString(second));
-    }
-    else
-    {
-      return evalString(first) == evalString(second);
-    }
-  }
-}
-
-bool
-Transfer::beginsWith(string const &s1, string const &s2) const
-{
-  int const limit = s2.size(), constraint = s1.size();
-
-  if(constraint < limit)
-  {
-    return false;
-  }
-  for(int i = 0; i != limit; i++)
-  {
-    if(s1[i] != s2[i])
-    {
-      return false;
-    }
-  }
-
-  return true;
-}
-
-bool
-Transfer::endsWith(string const &s1, string const &s2) const
-{
-  int const limit = s2.size(), constraint = s1.size();
-
-  if(constraint < limit)
-  {
-    return false;
-  }
-  for(int i = limit-1, j = constraint - 1; i >= 0; i--, j--)
-  {
-    if(s1[j] != s2[i])
-    {
-      return false;
-    }
-  }
-
-  return true;
-}
-
-
-bool
-Transfer::processBeginsWith(xmlNode *localroot)
-{
-  xmlNode *first = NULL, *second = NULL;
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(first == NULL)
-      {
-        first = i;
-      }
-      else
-      {
-	second = i;
-	break;
-      }
-    }
-  }
-
-  if(localroot->properties == NULL)
-  {
-    return beginsWith(evalString(first), evalString(second));
-  }
-  else
-  {
-    if(!xmlStrcmp(localroot->properties->children->content,
-		  (const xmlChar *) "yes"))
-    {
-      return beginsWith(tolower(evalString(first)), tolower(evalString(second)));
-    }
-    else
-    {
-      return beginsWith(evalString(first), evalString(second));
+          pc = op[1];
+        }
+        test_stack.pop_back();
+        break;
+
+      case bc_return:
+        return -1;
+
+      default:
+        wcerr << L"Error: unknown opcode " << op[0] << endl;
+        exit(EXIT_FAILURE);
     }
   }
 }
 
-bool
-Transfer::processEndsWith(xmlNode *localroot)
+void
+Transfer::callMacro(vector<int> const &code, int pc)
 {
-  xmlNode *first = NULL, *second = NULL;
+  int const macro = code[pc+1];
+  int const nargs = code[pc+3];
+  int npar = rules->bytecode.getMacroNpar(macro);
 
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(first == NULL)
-      {
-        first = i;
-      }
-      else
-      {
-	second = i;
-	break;
-      }
-    }
-  }
+  // ToDo: Is it at all valid if npar <= 0 ?
 
-  if(localroot->properties == NULL)
+  if(npar > 0 && nargs > npar)
   {
-    return endsWith(evalString(first), evalString(second));
+    wcerr << L"Error: processCallMacro() number of arguments >= npar at line " << code[pc+2] << endl;
+    return;
   }
-  else
+
+  vector<TransferWord *> myword(npar > 0 ? npar : 1, (TransferWord *) 0);
+  vector<string *> myblank(npar > 0 ? npar : 1, &emptyblank);
+
+  for(int idx = 0, lastpos = 0; npar > 0 && idx != nargs; idx++)
   {
-    if(!xmlStrcmp(localroot->properties->children->content,
-		  (const xmlChar *) "yes"))
+    int const pos = code[pc+4+idx];
+    if(pos >= 0 && pos < lword)
     {
-      return endsWith(tolower(evalString(first)), tolower(evalString(second)));
+      myword[idx] = word[pos];
     }
-    else
+    if(idx > 0 && blank != NULL)
     {
-      return endsWith(evalString(first), evalString(second));
+      myblank[idx-1] = blank[lastpos];
     }
+    lastpos = pos;
   }
-}
 
-bool
-Transfer::processBeginsWithList(xmlNode *localroot)
-{
-  xmlNode *first = NULL, *second = NULL;
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(first == NULL)
-      {
-        first = i;
-      }
-      else
-      {
-	second = i;
-	break;
-      }
-    }
-  }
+  TransferWord **caller_word = word;
+  string **caller_blank = blank;
+  int const caller_lword = lword;
 
-  xmlChar *idlist = second->properties->children->content;
-  string needle = evalString(first);
-  set<string, Ltstr>::iterator it, limit;
+  word = npar > 0 ? &myword[0] : NULL;
+  blank = npar > 0 ? &myblank[0] : NULL;
+  lword = npar;
 
-  if(localroot->properties == NULL ||
-     xmlStrcmp(localroot->properties->children->content, (const xmlChar *) "yes"))
-  {
-    it = lists[(const char *) idlist].begin();
-    limit = lists[(const char *) idlist].end();
-  }
-  else
-  {
-    needle = tolower(needle);
-    it = listslow[(const char *) idlist].begin();
-    limit = listslow[(const char *) idlist].end();
-  }
+  execute(rules->bytecode.getMacroEntry(macro));
 
-  for(; it != limit; it++)
-  {
-    if(beginsWith(needle, *it))
-    {
-      return true;
-    }
-  }
-  return false;
+  word = caller_word;
+  blank = caller_blank;
+  lword = caller_lword;
 }
 
-
 bool
-Transfer::processEndsWithList(xmlNode *localroot)
+Transfer::beginsWith(string const &s1, string const &s2) const
 {
-  xmlNode *first = NULL, *second = NULL;
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(first == NULL)
-      {
-        first = i;
-      }
-      else
-      {
-	second = i;
-	break;
-      }
-    }
-  }
-
-  xmlChar *idlist = second->properties->children->content;
-  string needle = evalString(first);
-  set<string, Ltstr>::iterator it, limit;
+  int const limit = s2.size(), constraint = s1.size();
 
-  if(localroot->properties == NULL ||
-     xmlStrcmp(localroot->properties->children->content, (const xmlChar *) "yes"))
-  {
-    it = lists[(const char *) idlist].begin();
-    limit = lists[(const char *) idlist].end();
-  }
-  else
+  if(constraint < limit)
   {
-    needle = tolower(needle);
-    it = listslow[(const char *) idlist].begin();
-    limit = listslow[(const char *) idlist].end();
+    return false;
   }
-
-  for(; it != limit; it++)
+  for(int i = 0; i != limit; i++)
   {
-    if(endsWith(needle, *it))
+    if(s1[i] != s2[i])
     {
-      return true;
+      return false;
     }
   }
-  return false;
+
+  return true;
 }
 
 bool
-Transfer::processContainsSubstring(xmlNode *localroot)
+Transfer::endsWith(string const &s1, string const &s2) const
 {
-  xmlNode *first = NULL, *second = NULL;
-
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      if(first == NULL)
-      {
-        first = i;
-      }
-      else
-      {
-	second = i;
-	break;
-      }
-    }
-  }
+  int const limit = s2.size(), constraint = s1.size();
 
-  if(localroot->properties == NULL)
+  if(constraint < limit)
   {
-    return evalString(first).find(evalString(second)) != string::npos;
+    return false;
   }
-  else
+  for(int i = limit-1, j = constraint - 1; i >= 0; i--, j--)
   {
-    if(!xmlStrcmp(localroot->properties->children->content,
-		  (const xmlChar *) "yes"))
-    {
-      return tolower(evalString(first)).find(tolower(evalString(second))) != string::npos;
-    }
-    else
+    if(s1[j] != s2[i])
     {
-      return evalString(first).find(evalString(second)) != string::npos;
+      return false;
     }
   }
+
+  return true;
 }
 
+
 string
 Transfer::copycase(string const &source_word, string const &target_word)
 {
@@ -1756,50 +782,6 @@ Transfer::tolower(string const &str) const
   return UtfConverter::toUtf8(StringUtils::tolower(UtfConverter::fromUtf8(str)));
 }
 
-string
-Transfer::tags(string const &str) const
-{
-  string result = "<";
-
-  for(unsigned int i = 0, limit = str.size(); i != limit; i++)
-  {
-    if(str[i] == '.')
-    {
-      result.append("><");
-    }
-    else
-    {
-      result += str[i];
-    }
-  }
-
-  result += '>';
-
-  return result;
-}
-
-int
-Transfer::processRule(xmlNode *localroot)
-{
-  int instruction_return, words_to_consume = -1;
-  // localroot is suposed to be an 'action' tag
-  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
-  {
-    if(i->type == XML_ELEMENT_NODE)
-    {
-      instruction_return = processInstruction(i);
-      // When an instruction which modifies the number of words to be consumed
-      // from the input is found, execution of the rule is stopped
-      if(instruction_return != -1)
-      {
-        words_to_consume = instruction_return;
-        break;
-      }
-    }
-  }
-  return words_to_consume;
-}
-
 TransferToken &
 Transfer::readToken(FILE *in)
 {
@@ -1808,56 +790,58 @@ Transfer::readToken(FILE *in)
     return input_buffer.next();
   }
 
-  wstring content;
+  // the special characters are all ASCII, so the UTF-8 input can be
+  // scanned byte by byte; only words are decoded, for the matcher
+  string content;
   while(true)
   {
-    int val = fgetwc_unlocked(in);
-    if(feof(in) || (val == 0 && internal_null_flush))
+    int val = readChar(in);
+    if(endOfInput(in) || (val == 0 && internal_null_flush))
     {
-      return input_buffer.add(TransferToken(content, tt_eof));
+      return input_buffer.add(TransferToken(L"", content, tt_eof));
     }
     if(val == '\\')
     {
-      content += L'\\';
-      content += (wchar_t) fgetwc_unlocked(in);
+      content += '\\';
+      content += char(readChar(in));
     }
-    else if(val == L'[')
+    else if(val == '[')
     {
-      content += L'[';
+      content += '[';
       while(true)
       {
-	int val2 = fgetwc_unlocked(in);
-	if(val2 == L'\\')
+	int val2 = readChar(in);
+	if(val2 == '\\')
 	{
-	  content += L'\\';
-	  content += wchar_t(fgetwc_unlocked(in));
+	  content += '\\';
+	  content += char(readChar(in));
 	}
-	else if(val2 == L']')
+	else if(val2 == ']')
 	{
-	  content += L']';
+	  content += ']';
 	  break;
 	}
 	else
 	{
-	  content += wchar_t(val2);
+	  content += char(val2);
 	}
       }
     }
-    else if(val == L'$')
+    else if(val == '$')
     {
-      return input_buffer.add(TransferToken(content, tt_word));
+      return input_buffer.add(TransferToken(UtfConverter::fromUtf8(content), content, tt_word));
     }
-    else if(val == L'^')
+    else if(val == '^')
     {
-      return input_buffer.add(TransferToken(content, tt_blank));
+      return input_buffer.add(TransferToken(L"", content, tt_blank));
     }
-    else if(val == L'\0' && null_flush)
+    else if(val == '\0' && null_flush)
     {
       fflush(output);
     }
     else
     {
-      content += wchar_t(val);
+      content += char(val);
     }
   }
 }
@@ -1886,6 +870,24 @@ Transfer::setTraceATT(bool trace)
   this->trace_att = trace;
 }
 
+void
+Transfer::setBiltransCacheSize(unsigned int size)
+{
+  biltrans_cache.setCapacity(size);
+}
+
+unsigned long
+Transfer::getBiltransCacheHits() const
+{
+  return biltrans_cache.getHits();
+}
+
+unsigned long
+Transfer::getBiltransCacheMisses() const
+{
+  return biltrans_cache.getMisses();
+}
+
 void
 Transfer::transfer_wrapper_null_flush(FILE *in, FILE *out)
 {
@@ -1895,7 +897,7 @@ Transfer::transfer_wrapper_null_flush(FILE *in, FILE *out)
   while(!feof(in))
   {
     transfer(in, out);
-    fputwc_unlocked(L'\0', out);
+    fputc_unlocked('\0', out);
     int code = fflush(out);
     if(code != 0)
     {
@@ -1907,6 +909,95 @@ Transfer::transfer_wrapper_null_flush(FILE *in, FILE *out)
   null_flush = true;
 }
 
+void
+Transfer::writeOutput(char c)
+{
+  if(output_text != NULL)
+  {
+    *output_text += c;
+  }
+  else
+  {
+    fputc_unlocked(c, output);
+  }
+}
+
+void
+Transfer::writeOutput(string const &str)
+{
+  if(output_text != NULL)
+  {
+    *output_text += str;
+  }
+  else
+  {
+    fputs_unlocked(str.c_str(), output);
+  }
+}
+
+int
+Transfer::readChar(FILE *in)
+{
+  if(input_text == NULL)
+  {
+    return fgetc_unlocked(in);
+  }
+  if(input_pos < input_text->size())
+  {
+    return (unsigned char) (*input_text)[input_pos++];
+  }
+  // one past the end, so that endOfInput() holds like feof() would
+  input_pos = input_text->size() + 1;
+  return EOF;
+}
+
+bool
+Transfer::endOfInput(FILE *in)
+{
+  if(input_text == NULL)
+  {
+    return feof(in);
+  }
+  return input_pos > input_text->size();
+}
+
+void
+Transfer::transfer(string const &in, string &out)
+{
+  bool const was_null_flush = null_flush;
+  null_flush = false;
+  input_text = &in;
+  input_pos = 0;
+  output_text = &out;
+
+  transfer((FILE *) NULL, (FILE *) NULL);
+
+  output_text = NULL;
+  input_text = NULL;
+  null_flush = was_null_flush;
+}
+
+void
+Transfer::resetVariables()
+{
+  vars = rules->var_defaults;
+}
+
+void
+Transfer::transfer(FILE *in, string &out)
+{
+  bool const was_null_flush = null_flush;
+  null_flush = false;
+  internal_null_flush = was_null_flush;
+  output_text = &out;
+
+  transfer(in, (FILE *) NULL);
+
+  output_text = NULL;
+  internal_null_flush = false;
+  null_flush = was_null_flush;
+}
+
 void
 Transfer::transfer(FILE *in, FILE *out)
 {
@@ -1921,7 +1012,7 @@ Transfer::transfer(FILE *in, FILE *out)
   set<int> banned_rules;
 
   output = out;
-  ms.init(me->getInitial());
+  ms.init(rules->me->getInitial());
 
   while(true)
   {
@@ -1937,7 +1028,7 @@ Transfer::transfer(FILE *in, FILE *out)
         {
           wcerr << L" ";
         }
-        wcerr << *tmpword[ind];
+        wcerr << tmpword[ind]->getContent();
       }
       wcerr << endl;
 
@@ -1945,7 +1036,7 @@ Transfer::transfer(FILE *in, FILE *out)
       for (unsigned int ind = 0; ind < tmpblank.size(); ind++)
       {
         wcerr << L"'";
-        wcerr << *tmpblank[ind];
+        wcerr << UtfConverter::fromUtf8(*tmpblank[ind]);
         wcerr << L"' ";
       }
       wcerr << endl;
@@ -1956,7 +1047,7 @@ Transfer::transfer(FILE *in, FILE *out)
 
     if(ms.size() == 0)
     {
-      if(lastrule != NULL)
+      if(lastrule != -1)
       {
         int num_words_to_consume = applyRule();
 
@@ -2012,96 +1103,58 @@ Transfer::transfer(FILE *in, FILE *out)
             wcerr << "printing tmpword[0]" <<endl;
           }
 
-          pair<wstring, int> tr;
+          pair<string, int> tr;
           if(useBilingual && preBilingual == false)
           {
-	    if(isExtended && (*tmpword[0])[0] == L'*')
+	    if(rules->isExtended && tmpword[0]->getContent()[0] == L'*')
 	    {
-	      tr = extended.biltransWithQueue((*tmpword[0]).substr(1), false);
-              if(tr.first[0] == L'@')
+	      rules->bil_lock.lock();
+	      pair<wstring, int> wtr = rules->extended.biltransWithQueue(tmpword[0]->getContent().substr(1), false);
+	      rules->bil_lock.unlock();
+              if(wtr.first[0] == L'@')
               {
-                tr.first[0] = L'*';
+                wtr.first[0] = L'*';
               }
               else
               {
-                tr.first = L"%" + tr.first;
+                wtr.first = L"%" + wtr.first;
               }
+              tr = pair<string, int>(UtfConverter::toUtf8(wtr.first), wtr.second);
             }
             else
             {
-	      tr = fstp.biltransWithQueue(*tmpword[0], false);
+              tr = biltrans(*tmpword[0]);
             }
           }
           else if(preBilingual)
           {
-            wstring sl;
-            wstring tl;
-            int seenSlash = 0;
-            for(wstring::const_iterator it = tmpword[0]->begin(); it != tmpword[0]->end(); it++)
-            {
-              if(*it == L'\\')
-              {
-                if(seenSlash == 0)
-                {
-                  sl.push_back(*it);
-                  it++;
-                  sl.push_back(*it);
-                }
-                else
-                {
-                  tl.push_back(*it);
-                  it++;
-                  tl.push_back(*it);
-                }
-                continue;
-              }
-              else if(*it == L'/')
-              {
-                seenSlash++;
-                continue;
-              }
-              if(seenSlash == 0)
-              {
-                sl.push_back(*it);
-              }
-              else if(seenSlash == 1)
-              {
-                tl.push_back(*it);
-              }
-              else if(seenSlash > 1)
-              {
-                break;
-              }
-            }
-            //tmpword[0]->assign(sl);
-            tr = pair<wstring, int>(tl, false);
-            //wcerr << L"pb: " << *tmpword[0] << L" :: " << sl << L" >> " << tl << endl ;
+            tr = pair<string, int>(preBilingualTarget(tmpword[0]->getUtf8()), false);
           }
           else
           {
-            tr = pair<wstring, int>(*tmpword[0], 0);
+            tr = pair<string, int>(tmpword[0]->getUtf8(), 0);
           }
 
 	  if(tr.first.size() != 0)
 	  {
-	    if(defaultAttrs == lu)
+	    if(rules->defaultAttrs == lu)
 	    {
-	      fputwc_unlocked(L'^', output);
-	      fputws_unlocked(tr.first.c_str(), output);
-	      fputwc_unlocked(L'$', output);
+	      writeOutput('^');
+	      writeOutput(tr.first);
+	      writeOutput('$');
             }
             else
             {
               if(tr.first[0] == '*')
               {
-                fputws_unlocked(L"^unknown<unknown>{^", output);
+                writeOutput("^unknown<unknown>{^");
               }
               else
               {
-	        fputws_unlocked(L"^default<default>{^", output);
+	        writeOutput("^default<default>{^");
               }
-	      fputws_unlocked(tr.first.c_str(), output);
-	      fputws_unlocked(L"$}$", output);
+	      writeOutput(tr.first);
+	      writeOutput("$}$");
             }
 	  }
 	  banned_rules.clear();
@@ -2110,7 +1163,7 @@ Transfer::transfer(FILE *in, FILE *out)
 	  input_buffer.next();
 	  prev_last = last;
 	  last = input_buffer.getPos();
-	  ms.init(me->getInitial());
+	  ms.init(rules->me->getInitial());
 	}
 	else if(tmpblank.size() != 0)
 	{
@@ -2118,18 +1171,18 @@ Transfer::transfer(FILE *in, FILE *out)
           {
             wcerr << "printing tmpblank[0]" <<endl;
           }
-          fputws_unlocked(tmpblank[0]->c_str(), output);
+          writeOutput(*tmpblank[0]);
           tmpblank.clear();
           prev_last = last;
           last = input_buffer.getPos();
-          ms.init(me->getInitial());
+          ms.init(rules->me->getInitial());
 	}
       }
     }
-    int val = ms.classifyFinals(me->getFinals(), banned_rules);
+    int val = ms.classifyFinals(rules->me->getFinals(), banned_rules);
     if(val != -1)
     {
-      lastrule = rule_map[val-1];
+      lastrule = val-1;
       lastrule_id = val;
       last = input_buffer.getPos();
 
@@ -2142,7 +1195,7 @@ Transfer::transfer(FILE *in, FILE *out)
           {
             wcerr << L" ";
           }
-          fputws_unlocked(tmpword[ind]->c_str(), stderr);
+          fputws_unlocked(tmpword[ind]->getContent().c_str(), stderr);
         }
         wcerr << endl;
       }
@@ -2154,23 +1207,23 @@ Transfer::transfer(FILE *in, FILE *out)
     {
       case tt_word:
 	applyWord(current.getContent());
-        tmpword.push_back(&current.getContent());
+        tmpword.push_back(&current);
 	break;
 
       case tt_blank:
 	ms.step(L' ');
-	tmpblank.push_back(&current.getContent());
+	tmpblank.push_back(&current.getUtf8());
 	break;
 
       case tt_eof:
 	if(tmpword.size() != 0)
 	{
-	  tmpblank.push_back(&current.getContent());
+	  tmpblank.push_back(&current.getUtf8());
 	  ms.clear();
 	}
 	else
 	{
-	  fputws_unlocked(current.getContent().c_str(), output);
+	  writeOutput(current.getUtf8());
 	  return;
 	}
 	break;
@@ -2189,116 +1242,103 @@ Transfer::applyRule()
   unsigned int limit = tmpword.size();
   //wcerr << L"applyRule: " << tmpword.size() << endl;
 
+  word = word_pool.get(limit);
+  lword = limit;
+  blank = limit > 1 ? blank_pool.get(limit - 1) : NULL;
+  lblank = limit > 1 ? limit - 1 : 0;
+
   for(unsigned int i = 0; i != limit; i++)
   {
-    if(i == 0)
-    {
-      word = new TransferWord *[limit];
-      std::fill(word, word+limit, (TransferWord *)(0));
-      lword = limit;
-      if(limit != 1)
-      {
-        blank = new string *[limit - 1];
-        lblank = limit - 1;
-      }
-      else
-      {
-        blank = NULL;
-        lblank = 0;
-      }
-    }
-    else
+    if(i != 0)
     {
-      blank[i-1] = new string(UtfConverter::toUtf8(*tmpblank[i-1]));
+      blank[i-1]->assign(*tmpblank[i-1]);
     }
 
-    pair<wstring, int> tr;
+    pair<string, int> tr;
     if(useBilingual && preBilingual == false)
     {
-      tr = fstp.biltransWithQueue(*tmpword[i], false);
+      tr = biltrans(*tmpword[i]);
     }
     else if(preBilingual)
     {
-      //wcerr << "applyRule: " << *tmpword[i] << endl;
-      wstring sl;
-      wstring tl;
-      int seenSlash = 0;
-      for(wstring::const_iterator it = tmpword[i]->begin(); it != tmpword[i]->end(); it++)
-      {
-        if(*it == L'\\')
-        {
-          if(seenSlash == 0)
-          {
-            sl.push_back(*it);
-            it++;
-            sl.push_back(*it);
-          }
-          else
-          {
-            tl.push_back(*it);
-            it++;
-            tl.push_back(*it);
-          }
-          continue;
-        }
-
-        if(*it == L'/')
-        {
-          seenSlash++;
-          continue;
-        }
-        if(seenSlash == 0)
-        {
-          sl.push_back(*it);
-        }
-        else if(seenSlash == 1)
-        {
-          tl.push_back(*it);
-        }
-        else if(seenSlash > 1)
-        {
-          break;
-        }
-      }
-      //tmpword[i]->assign(sl);
-      tr = pair<wstring, int>(tl, false);
+      tr = pair<string, int>(preBilingualTarget(tmpword[i]->getUtf8()), false);
     }
     else
     {
-      tr = pair<wstring, int>(*tmpword[i], false);
+      tr = pair<string, int>(tmpword[i]->getUtf8(), false);
     }
 
-    word[i] = new TransferWord(UtfConverter::toUtf8(*tmpword[i]),
-			       UtfConverter::toUtf8(tr.first), tr.second);
+    word[i]->init(tmpword[i]->getUtf8(), tr.first, tr.second);
+  }
+
+  words_to_consume = execute(rules->bytecode.getRuleEntry(lastrule));
+  lastrule = -1;
+
+  word = NULL;
+  blank = NULL;
+  tmpword.clear();
+  tmpblank.clear();
+  ms.init(rules->me->getInitial());
+  return words_to_consume;
+}
+
+pair<string, int>
+Transfer::biltrans(TransferToken &word)
+{
+  pair<string, int> tr;
+  if(biltrans_cache.getCapacity() != 0 &&
+     biltrans_cache.find(word.getUtf8(), tr.first, tr.second))
+  {
+    return tr;
   }
 
-  words_to_consume = processRule(lastrule);
-  lastrule = NULL;
+  rules->bil_lock.lock();
+  pair<wstring, int> wtr = rules->fstp.biltransWithQueue(word.getContent(), false);
+  rules->bil_lock.unlock();
+  tr = pair<string, int>(UtfConverter::toUtf8(wtr.first), wtr.second);
+  biltrans_cache.insert(word.getUtf8(), tr.first, tr.second);
+  return tr;
+}
 
-  if(word)
+string
+Transfer::preBilingualTarget(string const &word_str) const
+{
+  // the input already carries the translation: ^sl/tl$ (escapes and
+  // separators are ASCII, so UTF-8 bytes can be copied as they are)
+  string tl;
+  int seenSlash = 0;
+  for(string::const_iterator it = word_str.begin(); it != word_str.end(); it++)
   {
-    for(unsigned int i = 0; i != limit; i++)
+    if(*it == '\\')
+    {
+      if(seenSlash != 0)
+      {
+        tl.push_back(*it);
+        it++;
+        tl.push_back(*it);
+      }
+      else
+      {
+        it++;
+      }
+      continue;
+    }
+
+    if(*it == '/')
     {
-      delete word[i];
-      word[i] = 0; // ToDo: That this changes things means there are much bigger problems elsewhere
+      seenSlash++;
+      continue;
     }
-    delete[] word;
-  }
-  if(blank)
-  {
-    for(unsigned int i = 0; i != limit - 1; i++)
+    if(seenSlash == 1)
     {
-      delete blank[i];
-      blank[i] = 0;
+      tl.push_back(*it);
+    }
+    else if(seenSlash > 1)
+    {
+      break;
     }
-    delete[] blank;
   }
-  word = NULL;
-  blank = NULL;
-  tmpword.clear();
-  tmpblank.clear();
-  ms.init(me->getInitial());
-  return words_to_consume;
+  return tl;
 }
 
 /* HERE */
@@ -2312,7 +1352,7 @@ Transfer::applyWord(wstring const &word_str)
     {
       case L'\\':
         i++;
-	ms.step(towlower(word_str[i]), any_char);
+	ms.step(towlower(word_str[i]), rules->any_char);
 	break;
 
       case L'/':
@@ -2324,14 +1364,17 @@ Transfer::applyWord(wstring const &word_str)
 	{
 	  if(word_str[j] == L'>')
 	  {
-	    int symbol = alphabet(word_str.substr(i, j-i+1));
+	    // the alphabet is shared between workers: look the tag up
+	    // without adding it
+	    wstring const tag = word_str.substr(i, j-i+1);
+	    int symbol = rules->alphabet.isSymbolDefined(tag) ? rules->alphabet(tag) : 0;
 	    if(symbol)
 	    {
-	      ms.step(symbol, any_tag);
+	      ms.step(symbol, rules->any_tag);
 	    }
 	    else
 	    {
-	      ms.step(any_tag);
+	      ms.step(rules->any_tag);
 	    }
 	    i = j;
 	    break;
@@ -2340,7 +1383,7 @@ Transfer::applyWord(wstring const &word_str)
 	break;
 
       default:
-	ms.step(towlower(word_str[i]), any_char);
+	ms.step(towlower(word_str[i]), rules->any_char);
 	break;
     }
   }
@@ -2374,5 +1417,5 @@ Transfer::getUseBilingual(void) const
 void
 Transfer::setCaseSensitiveness(bool value)
 {
-  fstp.setCaseSensitiveMode(value);
+  rules->fstp.setCaseSensitiveMode(value);
 }
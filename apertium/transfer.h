@@ -17,7 +17,11 @@
 #ifndef _TRANSFER_
 #define _TRANSFER_
 
-#include <apertium/transfer_instr.h>
+#include <apertium/biltrans_cache.h>
+#include <apertium/parallel.h>
+#include <apertium/transfer_bytecode.h>
+#include <apertium/transfer_pool.h>
+#include <apertium/transfer_tables.h>
 #include <apertium/transfer_token.h>
 #include <apertium/transfer_word.h>
 #include <apertium/apertium_re.h>
@@ -41,40 +45,59 @@ class Transfer
 {
 private:
 
-  Alphabet alphabet;
-  MatchExe *me;
+  enum OutputType{lu,chunk};
+
+  /**
+   * What is read from the rule and dictionary files.  It is only read
+   * while translating, and the dictionaries are looked up under
+   * bil_lock, so the chunkers made by makeWorker() share it with the one
+   * that read it.
+   */
+  struct Rules
+  {
+    Alphabet alphabet;
+    MatchExe *me;
+    TransferTables tables;
+    TransferBytecode bytecode;
+    vector<ApertiumRE *> attr_slots;
+    vector<string> var_defaults;
+    vector<TransferList *> list_slots;
+    FSTProcessor fstp;
+    FSTProcessor extended;
+    bool isExtended;
+    int any_char;
+    int any_tag;
+    OutputType defaultAttrs;
+    Mutex bil_lock;
+
+    Rules();
+    ~Rules();
+  };
+
+  Rules *rules;
+  bool owns_rules;
   MatchState ms;
-  map<string, ApertiumRE, Ltstr> attr_items;
-  map<string, string, Ltstr> variables;
-  map<string, int, Ltstr> macros;
-  map<string, set<string, Ltstr>, Ltstr> lists;
-  map<string, set<string, Ltstr>, Ltstr> listslow;
-  vector<xmlNode *> macro_map;
-  vector<xmlNode *> rule_map;
-  xmlDoc *doc;
-  xmlNode *root_element;
+  vector<string> vars;
+  vector<string> string_stack;
+  vector<bool> test_stack;
   TransferWord **word;
   string **blank;
   int lword, lblank;
+  TransferPool<TransferWord> word_pool;
+  TransferPool<string> blank_pool;
   Buffer<TransferToken> input_buffer;
-  vector<wstring *> tmpword;
-  vector<wstring *> tmpblank;
+  vector<TransferToken *> tmpword;
+  vector<string *> tmpblank;
 
-  FSTProcessor fstp;
-  FSTProcessor extended;
-  bool isExtended;
+  BiltransCache biltrans_cache;
   FILE *output;
-  int any_char;
-  int any_tag;
+  string *output_text;
+  string const *input_text;
+  size_t input_pos;
 
-  xmlNode *lastrule;
+  int lastrule;
   unsigned int nwords;
 
-  map<xmlNode *, TransferInstr> evalStringCache;
-
-  enum OutputType{lu,chunk};
-
-  OutputType defaultAttrs;
   bool preBilingual;
   bool useBilingual;
   bool null_flush;
@@ -87,55 +110,71 @@ private:
   void readData(FILE *input);
   void readBil(string const &filename);
   void readTransfer(string const &input);
-  void collectMacros(xmlNode *localroot);
-  void collectRules(xmlNode *localroot);
+  void bindSlots();
   string caseOf(string const &str);
   string copycase(string const &source_word, string const &target_word);
 
-  void processLet(xmlNode *localroot);
-  void processAppend(xmlNode *localroot);
-  int processRejectCurrentRule(xmlNode *localroot);
-  void processOut(xmlNode *localroot);
-  void processCallMacro(xmlNode *localroot);
-  void processModifyCase(xmlNode *localroot);
-  bool processLogical(xmlNode *localroot);
-  bool processTest(xmlNode *localroot);
-  bool processAnd(xmlNode *localroot);
-  bool processOr(xmlNode *localroot);
-  bool processEqual(xmlNode *localroot);
-  bool processBeginsWith(xmlNode *localroot);
-  bool processBeginsWithList(xmlNode *localroot);
-  bool processEndsWith(xmlNode *localroot);
-  bool processEndsWithList(xmlNode *local);
-  bool processContainsSubstring(xmlNode *localroot);
-  bool processNot(xmlNode *localroot);
-  bool processIn(xmlNode *localroot);
-  int processRule(xmlNode *localroot);
-  string evalString(xmlNode *localroot);
-  int processInstruction(xmlNode *localroot);
-  int processChoose(xmlNode *localroot);
-  string processChunk(xmlNode *localroot);
-  string processTags(xmlNode *localroot);
+  int execute(int pc);
+  void callMacro(vector<int> const &code, int pc);
+  string pop();
 
   bool beginsWith(string const &str1, string const &str2) const;
   bool endsWith(string const &str1, string const &str2) const;
   string tolower(string const &str) const;
-  string tags(string const &str) const;
   wstring readWord(FILE *in);
   wstring readBlank(FILE *in);
   wstring readUntil(FILE *in, int const symbol) const;
   void applyWord(wstring const &word_str);
+  string preBilingualTarget(string const &word_str) const;
+  pair<string, int> biltrans(TransferToken &word);
   int applyRule();
   TransferToken & readToken(FILE *in);
-  bool checkIndex(xmlNode *element, int index, int limit);
+  bool checkIndex(int line, int index, int limit);
   void transfer_wrapper_null_flush(FILE *in, FILE *out);
+  int readChar(FILE *in);
+  bool endOfInput(FILE *in);
+  void writeOutput(char c);
+  void writeOutput(string const &str);
+
+  Transfer(Transfer const &o);
+  Transfer & operator =(Transfer const &o);
 public:
   Transfer();
   ~Transfer();
+
+  /**
+   * Make a chunker that translates with the rules and dictionaries of
+   * this one, which must be read already and outlive it.  Only the
+   * matching state, the variables and the bilingual cache are its own;
+   * the options are copied.
+   * @return the new chunker, owned by the caller
+   */
+  Transfer * makeWorker() const;
   
   void read(string const &transferfile, string const &datafile,
 	    string const &fstfile = "");
   void transfer(FILE *in, FILE *out);
+
+  /**
+   * Transfer the input up to the end of file or, in null-flush mode, up
+   * to the next '\0', appending the output to a string instead of
+   * writing it to a file
+   * @param in the input
+   * @param out the output, UTF-8 encoded
+   */
+  void transfer(FILE *in, string &out);
+
+  /**
+   * Transfer a whole input held in memory
+   * @param in the input, UTF-8 encoded
+   * @param out the output, UTF-8 encoded
+   */
+  void transfer(string const &in, string &out);
+
+  /**
+   * Give every variable back the value it had just after read()
+   */
+  void resetVariables();
   void setUseBilingual(bool value);
   bool getUseBilingual(void) const;
   void setPreBilingual(bool value);
@@ -146,6 +185,9 @@ public:
   void setNullFlush(bool null_flush);
   void setTrace(bool trace);
   void setTraceATT(bool trace);
+  void setBiltransCacheSize(unsigned int size);
+  unsigned long getBiltransCacheHits() const;
+  unsigned long getBiltransCacheMisses() const;
 };
 
 #endif
@@ -0,0 +1,930 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/transfer_bytecode.h>
+#include <apertium/utf_converter.h>
+#include <lttoolbox/compression.h>
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+/**
+ * Header of the compiled rules section in the preprocessed transfer
+ * file.  Bump the version whenever the instruction set changes.
+ */
+static wstring const BYTECODE_MAGIC = L"apertium-transfer-bytecode";
+static unsigned int const BYTECODE_VERSION = 1;
+
+TransferBytecode::TransferBytecode() :
+chunk_default(false)
+{
+}
+
+int
+TransferBytecode::attrSlot(string const &name)
+{
+  map<string, int>::iterator it = attr_index.find(name);
+  if(it != attr_index.end())
+  {
+    return it->second;
+  }
+  attr_names.push_back(name);
+  return attr_index[name] = attr_names.size() - 1;
+}
+
+int
+TransferBytecode::varSlot(string const &name)
+{
+  map<string, int>::iterator it = var_index.find(name);
+  if(it != var_index.end())
+  {
+    return it->second;
+  }
+  var_names.push_back(name);
+  return var_index[name] = var_names.size() - 1;
+}
+
+int
+TransferBytecode::listSlot(string const &name)
+{
+  map<string, int>::iterator it = list_index.find(name);
+  if(it != list_index.end())
+  {
+    return it->second;
+  }
+  list_names.push_back(name);
+  return list_index[name] = list_names.size() - 1;
+}
+
+int
+TransferBytecode::literal(string const &value)
+{
+  map<string, int>::iterator it = literal_index.find(value);
+  if(it != literal_index.end())
+  {
+    return it->second;
+  }
+  literals.push_back(value);
+  return literal_index[value] = literals.size() - 1;
+}
+
+void
+TransferBytecode::emit(int op)
+{
+  code.push_back(op);
+}
+
+void
+TransferBytecode::emit(int op, int a)
+{
+  code.push_back(op);
+  code.push_back(a);
+}
+
+void
+TransferBytecode::emit(int op, int a, int b)
+{
+  code.push_back(op);
+  code.push_back(a);
+  code.push_back(b);
+}
+
+int
+TransferBytecode::emitJump(int op)
+{
+  code.push_back(op);
+  code.push_back(-1);
+  return code.size() - 1;
+}
+
+void
+TransferBytecode::patch(vector<int> const &jumps)
+{
+  for(unsigned int i = 0; i != jumps.size(); i++)
+  {
+    code[jumps[i]] = code.size();
+  }
+}
+
+string
+TransferBytecode::attrib(xmlNode *element, char const *name,
+                         string const &fallback)
+{
+  for(xmlAttr *i = element->properties; i != NULL; i = i->next)
+  {
+    if(!xmlStrcmp(i->name, (const xmlChar *) name))
+    {
+      return (const char *) i->children->content;
+    }
+  }
+  return fallback;
+}
+
+string
+TransferBytecode::firstAttrib(xmlNode *element)
+{
+  if(element->properties == NULL)
+  {
+    return "";
+  }
+  return (const char *) element->properties->children->content;
+}
+
+xmlNode *
+TransferBytecode::nthElement(xmlNode *localroot, int n)
+{
+  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  {
+    if(i->type == XML_ELEMENT_NODE)
+    {
+      if(n == 0)
+      {
+        return i;
+      }
+      n--;
+    }
+  }
+  return NULL;
+}
+
+string
+TransferBytecode::tags(string const &str)
+{
+  string result = "<";
+
+  for(unsigned int i = 0, limit = str.size(); i != limit; i++)
+  {
+    if(str[i] == '.')
+    {
+      result.append("><");
+    }
+    else
+    {
+      result += str[i];
+    }
+  }
+
+  result += '>';
+
+  return result;
+}
+
+void
+TransferBytecode::compile(xmlDoc *doc)
+{
+  xmlNode *root_element = xmlDocGetRootElement(doc);
+  filename = doc->URL != NULL ? (const char *) doc->URL : "";
+  chunk_default = attrib(root_element, "default") == "chunk";
+
+  // macros may be called before they are defined, so number them first
+  for(xmlNode *i = root_element->children; i != NULL; i = i->next)
+  {
+    if(i->type == XML_ELEMENT_NODE &&
+       !xmlStrcmp(i->name, (const xmlChar *) "section-def-macros"))
+    {
+      for(xmlNode *j = i->children; j != NULL; j = j->next)
+      {
+        if(j->type == XML_ELEMENT_NODE)
+        {
+          macro_index[attrib(j, "n")] = macro_npar.size();
+          macro_npar.push_back(atoi(attrib(j, "npar", "0").c_str()));
+        }
+      }
+    }
+  }
+
+  for(xmlNode *i = root_element->children; i != NULL; i = i->next)
+  {
+    if(i->type == XML_ELEMENT_NODE)
+    {
+      if(!xmlStrcmp(i->name, (const xmlChar *) "section-def-macros"))
+      {
+        for(xmlNode *j = i->children; j != NULL; j = j->next)
+        {
+          if(j->type == XML_ELEMENT_NODE)
+          {
+            compileMacro(j);
+          }
+        }
+      }
+      else if(!xmlStrcmp(i->name, (const xmlChar *) "section-rules"))
+      {
+        for(xmlNode *j = i->children; j != NULL; j = j->next)
+        {
+          if(j->type == XML_ELEMENT_NODE)
+          {
+            for(xmlNode *k = j->children; ; k = k->next)
+            {
+              if(k->type == XML_ELEMENT_NODE && !xmlStrcmp(k->name, (const xmlChar *) "action"))
+              {
+                compileAction(k);
+                break;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  attr_index.clear();
+  var_index.clear();
+  list_index.clear();
+  literal_index.clear();
+  macro_index.clear();
+}
+
+void
+TransferBytecode::compileAction(xmlNode *localroot)
+{
+  rule_entries.push_back(code.size());
+  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  {
+    if(i->type == XML_ELEMENT_NODE)
+    {
+      compileInstruction(i, NULL);
+    }
+  }
+  emit(bc_return);
+}
+
+void
+TransferBytecode::compileMacro(xmlNode *localroot)
+{
+  macro_entries.push_back(code.size());
+  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  {
+    if(i->type == XML_ELEMENT_NODE)
+    {
+      // a rejected rule inside a macro only abandons the current
+      // top-level instruction of the macro
+      vector<int> reject;
+      compileInstruction(i, &reject);
+      patch(reject);
+    }
+  }
+  emit(bc_return);
+}
+
+void
+TransferBytecode::compileInstruction(xmlNode *localroot, vector<int> *reject)
+{
+  if(!xmlStrcmp(localroot->name, (const xmlChar *) "choose"))
+  {
+    compileChoose(localroot, reject);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "let"))
+  {
+    compileLet(localroot);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "append"))
+  {
+    int const var = varSlot(attrib(localroot, "n"));
+    for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+    {
+      if(i->type == XML_ELEMENT_NODE)
+      {
+        compileExpression(i);
+        emit(bc_append, var);
+      }
+    }
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "out"))
+  {
+    compileOut(localroot);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "call-macro"))
+  {
+    compileCallMacro(localroot);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "modify-case"))
+  {
+    compileModifyCase(localroot);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "reject-current-rule"))
+  {
+    if(reject != NULL)
+    {
+      reject->push_back(emitJump(bc_jump));
+    }
+    else
+    {
+      emit(bc_reject, attrib(localroot, "shifting") == "no" ? 0 : 1);
+    }
+  }
+}
+
+void
+TransferBytecode::compileChoose(xmlNode *localroot, vector<int> *reject)
+{
+  vector<int> end;
+
+  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  {
+    if(i->type != XML_ELEMENT_NODE)
+    {
+      continue;
+    }
+
+    if(!xmlStrcmp(i->name, (const xmlChar *) "when"))
+    {
+      // only a failing first test moves on to the next option; once a
+      // test has passed the option is picked and later failures leave
+      // the whole 'choose'
+      vector<int> next;
+      bool tested = false;
+
+      for(xmlNode *j = i->children; j != NULL; j = j->next)
+      {
+        if(j->type != XML_ELEMENT_NODE)
+        {
+          continue;
+        }
+        if(!xmlStrcmp(j->name, (const xmlChar *) "test"))
+        {
+          xmlNode *cond = nthElement(j, 0);
+          if(cond != NULL)
+          {
+            compileLogical(cond);
+          }
+          else
+          {
+            emit(bc_false);
+          }
+          (tested ? end : next).push_back(emitJump(bc_jump_if_false));
+          tested = true;
+        }
+        else
+        {
+          compileInstruction(j, reject);
+        }
+      }
+      if(tested)
+      {
+        end.push_back(emitJump(bc_jump));
+      }
+      patch(next);
+    }
+    else if(!xmlStrcmp(i->name, (const xmlChar *) "otherwise"))
+    {
+      for(xmlNode *j = i->children; j != NULL; j = j->next)
+      {
+        if(j->type == XML_ELEMENT_NODE)
+        {
+          compileInstruction(j, reject);
+        }
+      }
+    }
+  }
+
+  patch(end);
+}
+
+void
+TransferBytecode::compileLet(xmlNode *localroot)
+{
+  xmlNode *leftSide = nthElement(localroot, 0);
+  xmlNode *rightSide = nthElement(localroot, 1);
+
+  if(leftSide == NULL)
+  {
+    return;
+  }
+
+  if(!xmlStrcmp(leftSide->name, (const xmlChar *) "var"))
+  {
+    compileExpression(rightSide);
+    emit(bc_let_var, varSlot(firstAttrib(leftSide)));
+  }
+  else if(!xmlStrcmp(leftSide->name, (const xmlChar *) "clip"))
+  {
+    compileExpression(rightSide);
+    if(attrib(leftSide, "side") == "tl")
+    {
+      compileClip(leftSide, bc_let_clip_tl, bc_let_clip_tl);
+    }
+    else
+    {
+      compileClip(leftSide, bc_let_clip_sl, bc_let_clip_sl);
+    }
+  }
+}
+
+void
+TransferBytecode::compileModifyCase(xmlNode *localroot)
+{
+  xmlNode *leftSide = nthElement(localroot, 0);
+  xmlNode *rightSide = nthElement(localroot, 1);
+
+  if(leftSide == NULL)
+  {
+    return;
+  }
+
+  if(!xmlStrcmp(leftSide->name, (const xmlChar *) "clip"))
+  {
+    compileExpression(rightSide);
+    compileClip(leftSide, bc_modify_case_sl, bc_modify_case_tl);
+  }
+  else if(!xmlStrcmp(leftSide->name, (const xmlChar *) "var"))
+  {
+    compileExpression(rightSide);
+    emit(bc_modify_case_var, varSlot(firstAttrib(leftSide)));
+  }
+}
+
+void
+TransferBytecode::compileCallMacro(xmlNode *localroot)
+{
+  map<string, int>::iterator it = macro_index.find(firstAttrib(localroot));
+
+  emit(bc_call_macro, it != macro_index.end() ? it->second : 0, localroot->line);
+  int const nargs = code.size();
+  code.push_back(0);
+
+  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  {
+    if(i->type == XML_ELEMENT_NODE)
+    {
+      code.push_back(atoi(firstAttrib(i).c_str()) - 1);
+      code[nargs]++;
+    }
+  }
+}
+
+void
+TransferBytecode::compileOut(xmlNode *localroot)
+{
+  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  {
+    if(i->type == XML_ELEMENT_NODE)
+    {
+      if(!chunk_default && !xmlStrcmp(i->name, (const xmlChar *) "mlu"))
+      {
+        compileMlu(i, mlu_out);
+      }
+      else
+      {
+        compileExpression(i);
+      }
+      emit(bc_out);
+    }
+  }
+}
+
+void
+TransferBytecode::compileChunk(xmlNode *localroot)
+{
+  string const name = attrib(localroot, "name");
+  string const namefrom = attrib(localroot, "namefrom");
+  string const caseofchunk = attrib(localroot, "case", "aa");
+  int const casevar = caseofchunk != "" ? varSlot(caseofchunk) : -1;
+
+  if(name != "")
+  {
+    emit(bc_chunk_name, 0, literal(name));
+  }
+  else if(namefrom != "")
+  {
+    emit(bc_chunk_name, 1, varSlot(namefrom));
+  }
+  else
+  {
+    emit(bc_error, literal("you must specify either 'name' or 'namefrom' for the 'chunk' element"));
+    return;
+  }
+  code.push_back(casevar);
+
+  int pieces = 1;
+  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  {
+    if(i->type != XML_ELEMENT_NODE)
+    {
+      continue;
+    }
+    if(!xmlStrcmp(i->name, (const xmlChar *) "tags"))
+    {
+      for(xmlNode *j = i->children; j != NULL; j = j->next)
+      {
+        if(j->type == XML_ELEMENT_NODE && !xmlStrcmp(j->name, (const xmlChar *) "tag"))
+        {
+          pieces += compileChildren(j);
+        }
+      }
+      emit(bc_lit, literal("{"));
+      pieces++;
+    }
+    else if(!xmlStrcmp(i->name, (const xmlChar *) "mlu"))
+    {
+      compileMlu(i, mlu_chunk);
+      pieces++;
+    }
+    else
+    {
+      compileExpression(i);
+      pieces++;
+    }
+  }
+  emit(bc_lit, literal("}$"));
+  emit(bc_concat, pieces + 1);
+}
+
+void
+TransferBytecode::compileMlu(xmlNode *localroot, TransferMluMode mode)
+{
+  int parts = 0;
+  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  {
+    if(i->type == XML_ELEMENT_NODE)
+    {
+      emit(bc_concat, compileChildren(i));
+      parts++;
+    }
+  }
+  emit(bc_mlu, parts, mode);
+}
+
+int
+TransferBytecode::compileChildren(xmlNode *localroot)
+{
+  int count = 0;
+  for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+  {
+    if(i->type == XML_ELEMENT_NODE)
+    {
+      compileExpression(i);
+      count++;
+    }
+  }
+  return count;
+}
+
+void
+TransferBytecode::compileClip(xmlNode *localroot, TransferOpcode sl,
+                              TransferOpcode tl)
+{
+  emit(attrib(localroot, "side") == "sl" ? sl : tl,
+       atoi(attrib(localroot, "pos", "1").c_str()) - 1,
+       attrSlot(attrib(localroot, "part")));
+  code.push_back(attrib(localroot, "queue") == "no" ? 0 : 1);
+  if(sl == bc_linkto_sl)
+  {
+    code.push_back(literal("<" + attrib(localroot, "link-to") + ">"));
+  }
+  code.push_back(localroot->line);
+}
+
+void
+TransferBytecode::compileLogical(xmlNode *localroot)
+{
+  if(!xmlStrcmp(localroot->name, (const xmlChar *) "equal"))
+  {
+    compileBinaryTest(localroot, bc_equal);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "begins-with"))
+  {
+    compileBinaryTest(localroot, bc_begins_with);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "begins-with-list"))
+  {
+    compileListTest(localroot, bc_begins_with_list);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "ends-with"))
+  {
+    compileBinaryTest(localroot, bc_ends_with);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "ends-with-list"))
+  {
+    compileListTest(localroot, bc_ends_with_list);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "contains-substring"))
+  {
+    compileBinaryTest(localroot, bc_contains_substring);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "in"))
+  {
+    compileListTest(localroot, bc_in);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "and") ||
+          !xmlStrcmp(localroot->name, (const xmlChar *) "or"))
+  {
+    bool const is_and = !xmlStrcmp(localroot->name, (const xmlChar *) "and");
+    vector<int> end;
+    bool first = true;
+    for(xmlNode *i = localroot->children; i != NULL; i = i->next)
+    {
+      if(i->type == XML_ELEMENT_NODE)
+      {
+        if(!first)
+        {
+          end.push_back(emitJump(is_and ? bc_and_short : bc_or_short));
+        }
+        compileLogical(i);
+        first = false;
+      }
+    }
+    if(first)
+    {
+      emit(is_and ? bc_true : bc_false);
+    }
+    patch(end);
+  }
+  else if(!xmlStrcmp(localroot->name, (const xmlChar *) "not"))
+  {
+    xmlNode *arg = nthElement(localroot, 0);
+    if(arg != NULL)
+    {
+      compileLogical(arg);
+      emit(bc_not);
+    }
+    else
+    {
+      emit(bc_false);
+    }
+  }
+  else
+  {
+    emit(bc_false);
+  }
+}
+
+void
+TransferBytecode::compileBinaryTest(xmlNode *localroot, TransferOpcode op)
+{
+  compileExpression(nthElement(localroot, 0));
+  compileExpression(nthElement(localroot, 1));
+  emit(op, firstAttrib(localroot) == "yes" ? 1 : 0);
+}
+
+void
+TransferBytecode::compileListTest(xmlNode *localroot, TransferOpcode op)
+{
+  compileExpression(nthElement(localroot, 0));
+  xmlNode *list = nthElement(localroot, 1);
+  emit(op, listSlot(list != NULL ? firstAttrib(list) : ""),
+       firstAttrib(localroot) == "yes" ? 1 : 0);
+}
+
+void
+TransferBytecode::compileExpression(xmlNode *element)
+{
+  if(element == NULL)
+  {
+    emit(bc_lit, literal(""));
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "clip"))
+  {
+    if(xmlHasProp(element, (const xmlChar *) "link-to") != NULL)
+    {
+      compileClip(element, bc_linkto_sl, bc_linkto_tl);
+    }
+    else
+    {
+      compileClip(element, bc_clip_sl, bc_clip_tl);
+    }
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "lit-tag"))
+  {
+    emit(bc_lit, literal(tags(firstAttrib(element))));
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "lit"))
+  {
+    emit(bc_lit, literal(firstAttrib(element)));
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "b"))
+  {
+    if(element->properties == NULL)
+    {
+      emit(bc_b, -1, element->line);
+    }
+    else
+    {
+      emit(bc_b, atoi(firstAttrib(element).c_str()) - 1, element->line);
+    }
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "get-case-from"))
+  {
+    compileExpression(nthElement(element, 0));
+    emit(bc_get_case_from, atoi(firstAttrib(element).c_str()) - 1, attrSlot("lem"));
+    code.push_back(element->line);
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "var"))
+  {
+    emit(bc_var, varSlot(firstAttrib(element)));
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "case-of"))
+  {
+    emit(attrib(element, "side") == "sl" ? bc_case_of_sl : bc_case_of_tl,
+         atoi(attrib(element, "pos", "1").c_str()) - 1,
+         attrSlot(attrib(element, "part")));
+    code.push_back(element->line);
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "concat"))
+  {
+    emit(bc_concat, compileChildren(element));
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "lu"))
+  {
+    emit(bc_lu, compileChildren(element));
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "mlu"))
+  {
+    compileMlu(element, mlu_expr);
+  }
+  else if(!xmlStrcmp(element->name, (const xmlChar *) "chunk"))
+  {
+    compileChunk(element);
+  }
+  else
+  {
+    emit(bc_error, literal("unexpected rvalue expression '" +
+                           string((const char *) element->name) + "'"));
+  }
+}
+
+vector<int> const &
+TransferBytecode::getCode() const
+{
+  return code;
+}
+
+vector<string> const &
+TransferBytecode::getLiterals() const
+{
+  return literals;
+}
+
+vector<string> const &
+TransferBytecode::getAttrNames() const
+{
+  return attr_names;
+}
+
+vector<string> const &
+TransferBytecode::getVarNames() const
+{
+  return var_names;
+}
+
+vector<string> const &
+TransferBytecode::getListNames() const
+{
+  return list_names;
+}
+
+int
+TransferBytecode::getRuleEntry(int rule) const
+{
+  return rule_entries[rule];
+}
+
+int
+TransferBytecode::getMacroEntry(int macro) const
+{
+  return macro_entries[macro];
+}
+
+int
+TransferBytecode::getMacroNpar(int macro) const
+{
+  return macro_npar[macro];
+}
+
+string const &
+TransferBytecode::getFilename() const
+{
+  return filename;
+}
+
+bool
+TransferBytecode::isChunkDefault() const
+{
+  return chunk_default;
+}
+
+bool
+TransferBytecode::compile(string const &filename)
+{
+  xmlDoc *doc = xmlReadFile(filename.c_str(), NULL, 0);
+  if(doc == NULL)
+  {
+    wcerr << "Error: Could not parse file '" << filename.c_str() << "'." << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  xmlNode *root_element = xmlDocGetRootElement(doc);
+  bool const is_transfer = root_element != NULL &&
+    !xmlStrcmp(root_element->name, (const xmlChar *) "transfer");
+  if(is_transfer)
+  {
+    compile(doc);
+  }
+  xmlFreeDoc(doc);
+  return is_transfer;
+}
+
+void
+TransferBytecode::writeStrings(vector<string> const &v, FILE *output)
+{
+  Compression::multibyte_write(v.size(), output);
+  for(unsigned int i = 0; i != v.size(); i++)
+  {
+    Compression::wstring_write(UtfConverter::fromUtf8(v[i]), output);
+  }
+}
+
+void
+TransferBytecode::readStrings(vector<string> &v, FILE *input)
+{
+  v.clear();
+  for(int i = 0, limit = Compression::multibyte_read(input); i != limit; i++)
+  {
+    v.push_back(UtfConverter::toUtf8(Compression::wstring_read(input)));
+  }
+}
+
+void
+TransferBytecode::writeInts(vector<int> const &v, FILE *output)
+{
+  // operands such as positions and case variables may be negative, so
+  // fold the sign into the lowest bit
+  Compression::multibyte_write(v.size(), output);
+  for(unsigned int i = 0; i != v.size(); i++)
+  {
+    unsigned int const value = v[i] < 0 ? ((unsigned int) (-(v[i] + 1)) << 1) | 1
+                                         : (unsigned int) v[i] << 1;
+    Compression::multibyte_write(value, output);
+  }
+}
+
+void
+TransferBytecode::readInts(vector<int> &v, FILE *input)
+{
+  v.clear();
+  for(int i = 0, limit = Compression::multibyte_read(input); i != limit; i++)
+  {
+    unsigned int const value = Compression::multibyte_read(input);
+    v.push_back(value & 1 ? -((int) (value >> 1)) - 1 : (int) (value >> 1));
+  }
+}
+
+void
+TransferBytecode::write(FILE *output) const
+{
+  Compression::wstring_write(BYTECODE_MAGIC, output);
+  Compression::multibyte_write(BYTECODE_VERSION, output);
+  Compression::wstring_write(UtfConverter::fromUtf8(filename), output);
+  Compression::multibyte_write(chunk_default ? 1 : 0, output);
+  writeInts(code, output);
+  writeStrings(literals, output);
+  writeStrings(attr_names, output);
+  writeStrings(var_names, output);
+  writeStrings(list_names, output);
+  writeInts(rule_entries, output);
+  writeInts(macro_entries, output);
+  writeInts(macro_npar, output);
+}
+
+bool
+TransferBytecode::read(FILE *input)
+{
+  int c = fgetc(input);
+  if(c == EOF)
+  {
+    return false;
+  }
+  ungetc(c, input);
+
+  if(Compression::wstring_read(input) != BYTECODE_MAGIC ||
+     Compression::multibyte_read(input) != BYTECODE_VERSION)
+  {
+    return false;
+  }
+
+  filename = UtfConverter::toUtf8(Compression::wstring_read(input));
+  chunk_default = Compression::multibyte_read(input) == 1;
+  readInts(code, input);
+  readStrings(literals, input);
+  readStrings(attr_names, input);
+  readStrings(var_names, input);
+  readStrings(list_names, input);
+  readInts(rule_entries, input);
+  readInts(macro_entries, input);
+  readInts(macro_npar, input);
+  return true;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TRANSFERBYTECODE_
+#define _TRANSFERBYTECODE_
+
+#include <libxml/tree.h>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Opcodes of the compiled transfer rules.  Operands follow the opcode
+ * in the code vector; the comment lists them in order.  Rvalue opcodes
+ * push a string, test opcodes push a boolean and the remaining ones are
+ * statements that consume what the former pushed.
+ */
+enum TransferOpcode
+{
+  bc_lit,                 // literal
+  bc_var,                 // var
+  bc_clip_sl,             // pos attr queue line
+  bc_clip_tl,             // pos attr queue line
+  bc_linkto_sl,           // pos attr queue literal line
+  bc_linkto_tl,           // pos attr queue literal line
+  bc_b,                   // pos line
+  bc_get_case_from,       // pos attr line
+  bc_case_of_sl,          // pos attr line
+  bc_case_of_tl,          // pos attr line
+  bc_concat,              // n
+  bc_lu,                  // n
+  bc_mlu,                 // n mode
+  bc_chunk_name,          // kind name casevar
+  bc_error,               // literal
+
+  bc_true,
+  bc_false,
+  bc_equal,               // caseless
+  bc_begins_with,         // caseless
+  bc_ends_with,           // caseless
+  bc_contains_substring,  // caseless
+  bc_in,                  // list caseless
+  bc_begins_with_list,    // list caseless
+  bc_ends_with_list,      // list caseless
+  bc_not,
+  bc_and_short,           // target
+  bc_or_short,            // target
+
+  bc_out,
+  bc_let_var,             // var
+  bc_let_clip_sl,         // pos attr queue line
+  bc_let_clip_tl,         // pos attr queue line
+  bc_append,              // var
+  bc_modify_case_var,     // var
+  bc_modify_case_sl,      // pos attr queue line
+  bc_modify_case_tl,      // pos attr queue line
+  bc_call_macro,          // macro line nargs pos...
+  bc_reject,              // shifting
+  bc_jump,                // target
+  bc_jump_if_false,       // target
+  bc_return
+};
+
+/**
+ * The three flavours of 'mlu' joining: as an rvalue, inside a 'chunk'
+ * and directly inside 'out'
+ */
+enum TransferMluMode
+{
+  mlu_expr,
+  mlu_chunk,
+  mlu_out
+};
+
+/**
+ * Transfer rules and macros compiled from the XML tree into a flat
+ * instruction stream.  Attribute, variable and list names are resolved
+ * to integer slots at compile time; the engine binds the slots to its
+ * own storage once the data file has been read.
+ */
+class TransferBytecode
+{
+private:
+  vector<int> code;
+  vector<string> literals;
+  vector<string> attr_names;
+  vector<string> var_names;
+  vector<string> list_names;
+  vector<int> rule_entries;
+  vector<int> macro_entries;
+  vector<int> macro_npar;
+  map<string, int> attr_index;
+  map<string, int> var_index;
+  map<string, int> list_index;
+  map<string, int> literal_index;
+  map<string, int> macro_index;
+  string filename;
+  bool chunk_default;
+
+  int attrSlot(string const &name);
+  int varSlot(string const &name);
+  int listSlot(string const &name);
+  int literal(string const &value);
+  void emit(int op);
+  void emit(int op, int a);
+  void emit(int op, int a, int b);
+  int emitJump(int op);
+  void patch(vector<int> const &jumps);
+
+  void compileAction(xmlNode *localroot);
+  void compileMacro(xmlNode *localroot);
+  void compileInstruction(xmlNode *localroot, vector<int> *reject);
+  void compileChoose(xmlNode *localroot, vector<int> *reject);
+  void compileLet(xmlNode *localroot);
+  void compileModifyCase(xmlNode *localroot);
+  void compileCallMacro(xmlNode *localroot);
+  void compileOut(xmlNode *localroot);
+  void compileChunk(xmlNode *localroot);
+  void compileMlu(xmlNode *localroot, TransferMluMode mode);
+  void compileLogical(xmlNode *localroot);
+  void compileBinaryTest(xmlNode *localroot, TransferOpcode op);
+  void compileListTest(xmlNode *localroot, TransferOpcode op);
+  void compileExpression(xmlNode *localroot);
+  int compileChildren(xmlNode *localroot);
+  void compileClip(xmlNode *localroot, TransferOpcode sl, TransferOpcode tl);
+
+  static string attrib(xmlNode *element, char const *name,
+                       string const &fallback = "");
+  static string firstAttrib(xmlNode *element);
+  static xmlNode * nthElement(xmlNode *localroot, int n);
+  static string tags(string const &str);
+  static void writeStrings(vector<string> const &v, FILE *output);
+  static void readStrings(vector<string> &v, FILE *input);
+  static void writeInts(vector<int> const &v, FILE *output);
+  static void readInts(vector<int> &v, FILE *input);
+public:
+  TransferBytecode();
+
+  /**
+   * Compile the rules and macros of a parsed transfer file
+   * @param doc the parsed .t1x document
+   */
+  void compile(xmlDoc *doc);
+
+  /**
+   * Compile the rules and macros of a transfer file, if its root
+   * element is 'transfer'
+   * @param filename the .t1x file
+   * @return true if the file was compiled
+   */
+  bool compile(string const &filename);
+
+  /**
+   * Write the compiled rules, to be appended to the preprocessed
+   * transfer data file
+   * @param output the output stream
+   */
+  void write(FILE *output) const;
+
+  /**
+   * Read compiled rules written by write()
+   * @param input the input stream
+   * @return false if the stream holds no compiled rules, or rules
+   *         compiled for a different version of the instruction set
+   */
+  bool read(FILE *input);
+
+  vector<int> const & getCode() const;
+  vector<string> const & getLiterals() const;
+  vector<string> const & getAttrNames() const;
+  vector<string> const & getVarNames() const;
+  vector<string> const & getListNames() const;
+  int getRuleEntry(int rule) const;
+  int getMacroEntry(int macro) const;
+  int getMacroNpar(int macro) const;
+  string const & getFilename() const;
+  bool isChunkDefault() const;
+};
+
+#endif
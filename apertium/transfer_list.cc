@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/transfer_list.h>
+
+using namespace std;
+
+unsigned int
+TransferList::hash(string const &str)
+{
+  unsigned int value = HashIndex::basis;
+  for(unsigned int i = 0, limit = str.size(); i != limit; i++)
+  {
+    value = HashIndex::mix(value, (unsigned char) str[i]);
+  }
+  return value;
+}
+
+void
+TransferList::add(vector<string> &v, HashIndex &idx, string const &str)
+{
+  unsigned int const str_hash = hash(str);
+  if(idx.find(v, str, str_hash) == -1)
+  {
+    idx.push_back(str_hash);
+    v.push_back(str);
+  }
+}
+
+void
+TransferList::insert(string const &item, string const &item_low)
+{
+  add(items, index, item);
+  add(items_low, index_low, item_low);
+}
+
+bool
+TransferList::contains(string const &str) const
+{
+  return index.find(items, str, hash(str)) != -1;
+}
+
+bool
+TransferList::containsLower(string const &str) const
+{
+  return index_low.find(items_low, str, hash(str)) != -1;
+}
+
+vector<string> const &
+TransferList::getItems() const
+{
+  return items;
+}
+
+vector<string> const &
+TransferList::getLowItems() const
+{
+  return items_low;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TRANSFERLIST_
+#define _TRANSFERLIST_
+
+#include <string>
+#include <vector>
+
+#include <apertium/hash_index.h>
+
+using namespace std;
+
+/**
+ * A 'def-list' of the transfer rules: a hashed set of items together
+ * with their lowercased forms, for the caseless tests
+ */
+class TransferList
+{
+private:
+  vector<string> items;
+  vector<string> items_low;
+  HashIndex index;
+  HashIndex index_low;
+
+  static unsigned int hash(string const &str);
+  static void add(vector<string> &v, HashIndex &idx, string const &str);
+public:
+  /**
+   * Add an item to the list
+   * @param item the item as written in the rules
+   * @param item_low the item in lowercase
+   */
+  void insert(string const &item, string const &item_low);
+
+  /**
+   * @param str the string to look for
+   * @return true if str is an item of the list
+   */
+  bool contains(string const &str) const;
+
+  /**
+   * @param str the lowercased string to look for
+   * @return true if str is the lowercased form of an item of the list
+   */
+  bool containsLower(string const &str) const;
+
+  vector<string> const & getItems() const;
+  vector<string> const & getLowItems() const;
+};
+
+#endif
@@ -47,7 +47,9 @@ blank(0),
 output(0),
 any_char(0),
 any_tag(0),
-nwords(0)
+nwords(0),
+max_paths(0),
+lattice(false)
 {
   me = NULL;
   isRule = false;
@@ -396,45 +398,93 @@ TransferMult::acceptions(wstring str)
   return result;
 }
 
-void
-TransferMult::writeMultiple(list<vector<wstring> >::iterator itwords,
-                            list<wstring>::iterator itblanks,
-                            list<vector<wstring> >::const_iterator limitwords,
-                            wstring acum , bool multiple)
+unsigned int
+TransferMult::writeMultiple(vector<vector<wstring> > const &words,
+                            vector<wstring> const &blanks)
 {
-  if(itwords == limitwords)
+  // The combinations are enumerated with the acceptions of the last word
+  // changing fastest.  Every translation shares with the previous one the
+  // prefix before the word that changed, which is copied from the output
+  // instead of being built again.
+  unsigned int const limit = words.size();
+  vector<unsigned int> choice(limit, 0);
+  vector<size_t> mark(limit, 0);
+  size_t path_begin = output_string.size();
+  unsigned int paths = 0;
+  unsigned int k = 0;
+
+  while(true)
   {
-    if(multiple)
+    for(; k != limit; k++)
     {
-      output_string.append(L"[|]");
+      mark[k] = output_string.size();
+      output_string += L'^';
+      output_string.append(words[k][choice[k]]);
+      output_string += L'$';
+      if(k + 1 != limit)
+      {
+        output_string.append(blanks[k]);
+      }
     }
-    output_string.append(acum);
-  }
-  else
-  {
-    vector<wstring> &refword = *itwords;
+    paths++;
 
-    itwords++;
+    if(paths == max_paths)
+    {
+      break;
+    }
 
-    if(itwords == limitwords)
+    while(k != 0 && choice[k-1] + 1 == words[k-1].size())
     {
-      for(unsigned int i = 0, limit = refword.size(); i != limit; i++)
-      {
-        writeMultiple(itwords, itblanks, limitwords,
-                      acum + L"^" + refword[i] + L"$", multiple || (i > 0));
-      }
+      k--;
+      choice[k] = 0;
     }
-    else
+    if(k == 0)
+    {
+      break;
+    }
+    k--;
+    choice[k]++;
+
+    output_string.append(L"[|]");
+    size_t const new_begin = output_string.size();
+    output_string.append(output_string, path_begin, mark[k] - path_begin);
+    for(unsigned int i = 0; i != k; i++)
     {
-      wstring &refblank = *itblanks;
-      itblanks++;
+      mark[i] += new_begin - path_begin;
+    }
+    path_begin = new_begin;
+  }
 
-      for(unsigned int i = 0, limit = refword.size(); i != limit; i++)
+  return paths;
+}
+
+void
+TransferMult::writeLattice(vector<vector<wstring> > const &words,
+                           vector<wstring> const &blanks)
+{
+  for(unsigned int i = 0, limit = words.size(); i != limit; i++)
+  {
+    if(words[i].size() > 1)
+    {
+      output_string.append(L"[{]");
+    }
+    for(unsigned int j = 0, limit2 = words[i].size(); j != limit2; j++)
+    {
+      if(j > 0)
       {
-        writeMultiple(itwords, itblanks, limitwords,
-                      acum + L"^" + refword[i] + L"$" + refblank,
-                      multiple || (i > 0));
+        output_string.append(L"[|]");
       }
+      output_string += L'^';
+      output_string.append(words[i][j]);
+      output_string += L'$';
+    }
+    if(words[i].size() > 1)
+    {
+      output_string.append(L".[][}]");
+    }
+    if(i + 1 != limit)
+    {
+      output_string.append(blanks[i]);
     }
   }
 }
@@ -442,8 +492,8 @@ TransferMult::writeMultiple(list<vector<wstring> >::iterator itwords,
 void
 TransferMult::applyRule()
 {
-  list<wstring> blanks;
-  list<vector<wstring> > words;
+  vector<wstring> blanks;
+  vector<vector<wstring> > words;
 
   pair<wstring, int> tr = fstp.biltransWithQueue(*tmpword[0], false);
   words.push_back(acceptions(tr.first));
@@ -456,9 +506,12 @@ TransferMult::applyRule()
   }
 
   output_string = L"";
-  writeMultiple(words.begin(), blanks.begin(), words.end());
-
-  if(output_string.find(L"[|]") != wstring::npos)
+  if(lattice)
+  {
+    writeLattice(words, blanks);
+    fputws_unlocked(output_string.c_str(), output);
+  }
+  else if(writeMultiple(words, blanks) > 1)
   {
     fputws_unlocked(L"[{]", output);
     fputws_unlocked(output_string.c_str(), output);
@@ -516,3 +569,15 @@ TransferMult::applyWord(wstring const &word_str)
   }
   ms.step(L'$');
 }
+
+void
+TransferMult::setMaxPaths(unsigned int value)
+{
+  max_paths = value;
+}
+
+void
+TransferMult::setLattice(bool value)
+{
+  lattice = value;
+}
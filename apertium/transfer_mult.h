@@ -60,6 +60,18 @@ private:
   unsigned int numwords;
   
   unsigned int nwords;
+
+  /**
+   * Maximum number of translations written for a matched segment, 0 for
+   * no limit
+   */
+  unsigned int max_paths;
+
+  /**
+   * Write the acceptions of every word of a matched segment as a group of
+   * its own instead of all their combinations
+   */
+  bool lattice;
   
   enum OutputType{lu,chunk};
   
@@ -81,10 +93,10 @@ private:
   void applyWord(wstring const &word_str);
   void applyRule();
   TransferToken & readToken(FILE *in);
-  void writeMultiple(list<vector<wstring> >::iterator itwords,
-                     list<wstring>::iterator itblanks, 
-                     list<vector<wstring> >::const_iterator limitwords, 
-                     wstring acum = L"", bool multiple = false);
+  unsigned int writeMultiple(vector<vector<wstring> > const &words,
+                             vector<wstring> const &blanks);
+  void writeLattice(vector<vector<wstring> > const &words,
+                    vector<wstring> const &blanks);
   vector<wstring> acceptions(wstring str);
   bool isDefaultWord(wstring const &str);
 public:
@@ -93,6 +105,8 @@ public:
   
   void read(string const &datafile, string const &fstfile);
   void transfer(FILE *in, FILE *out);
+  void setMaxPaths(unsigned int value);
+  void setLattice(bool value);
 };
 
 #endif
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/transfer_parallel.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+  /**
+   * Pieces are cut at the first sentence end after this many bytes
+   */
+  size_t const PIECE_SIZE = 4096;
+
+  /**
+   * Bytes read before the workers are started on a batch, per worker
+   */
+  size_t const BATCH_SIZE = 64 * PIECE_SIZE;
+}
+
+TransferParallel::TransferParallel(vector<Transfer *> const &workers) :
+workers(workers),
+null_flush(false),
+next_piece(0)
+{
+}
+
+void
+TransferParallel::setNullFlush(bool null_flush)
+{
+  this->null_flush = null_flush;
+}
+
+bool
+TransferParallel::getNullFlush()
+{
+  return null_flush;
+}
+
+TransferParallel::BatchEnd
+TransferParallel::readBatch(FILE *in)
+{
+  pieces.clear();
+
+  size_t const batch_size = BATCH_SIZE * workers.size();
+  size_t batch_bytes = 0;
+  string piece;
+
+  while(true)
+  {
+    int val = fgetc_unlocked(in);
+    if(val == EOF || (val == 0 && null_flush))
+    {
+      if(!piece.empty())
+      {
+        pieces.push_back(piece);
+      }
+      return val == EOF ? batch_eof : batch_null;
+    }
+
+    piece += char(val);
+    if(val == '\\')
+    {
+      val = fgetc_unlocked(in);
+      if(val != EOF)
+      {
+        piece += char(val);
+      }
+    }
+    else if(val == '[' || val == '^')
+    {
+      int const close = val == '[' ? ']' : '$';
+      size_t const start = piece.size();
+      while((val = fgetc_unlocked(in)) != EOF)
+      {
+        piece += char(val);
+        if(val == '\\')
+        {
+          val = fgetc_unlocked(in);
+          if(val == EOF)
+          {
+            break;
+          }
+          piece += char(val);
+        }
+        else if(val == close)
+        {
+          break;
+        }
+      }
+
+      if(close == '$' && val == '$' && piece.size() >= PIECE_SIZE &&
+         piece.find("<sent>", start) != string::npos)
+      {
+        batch_bytes += piece.size();
+        pieces.push_back(piece);
+        piece.clear();
+        if(batch_bytes >= batch_size)
+        {
+          return batch_full;
+        }
+      }
+    }
+  }
+}
+
+void
+TransferParallel::run(unsigned int thread)
+{
+  Transfer &t = *workers[thread];
+  while(true)
+  {
+    queue_lock.lock();
+    size_t const i = next_piece++;
+    queue_lock.unlock();
+
+    if(i >= pieces.size())
+    {
+      break;
+    }
+
+    t.resetVariables();
+    t.transfer(pieces[i], outputs[i]);
+  }
+}
+
+void
+TransferParallel::transfer(FILE *in, FILE *out)
+{
+  while(true)
+  {
+    BatchEnd const end = readBatch(in);
+
+    outputs.assign(pieces.size(), "");
+    next_piece = 0;
+    if(pieces.size() == 1)
+    {
+      run(0);
+    }
+    else if(!pieces.empty())
+    {
+      runParallel(*this, min(workers.size(), pieces.size()));
+    }
+
+    for(unsigned int i = 0; i != outputs.size(); i++)
+    {
+      fputs_unlocked(outputs[i].c_str(), out);
+    }
+
+    if(null_flush && end != batch_full)
+    {
+      fputc_unlocked('\0', out);
+      int code = fflush(out);
+      if(code != 0)
+      {
+        wcerr << L"Could not flush output " << errno << endl;
+      }
+    }
+
+    if(end == batch_eof)
+    {
+      break;
+    }
+  }
+}
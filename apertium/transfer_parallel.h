@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TRANSFERPARALLEL_
+#define _TRANSFERPARALLEL_
+
+#include <apertium/parallel.h>
+#include <apertium/transfer.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Sentence-parallel chunker.  The input is cut after the words tagged
+ * <sent> into pieces of at least a few kilobytes, the pieces of each batch
+ * are shared out between the workers, and their outputs are written back
+ * in input order.  The workers share one set of rules (see
+ * Transfer::makeWorker()) and each has its own variables, which are reset
+ * at the start of each piece, so no state goes from a sentence to the
+ * next.
+ */
+class TransferParallel : private ParallelTask
+{
+private:
+  enum BatchEnd
+  {
+    batch_full,
+    batch_null,
+    batch_eof
+  };
+
+  vector<Transfer *> workers;
+  bool null_flush;
+  vector<string> pieces;
+  vector<string> outputs;
+  size_t next_piece;
+  Mutex queue_lock;
+
+  BatchEnd readBatch(FILE *in);
+  void run(unsigned int thread);
+
+  TransferParallel(TransferParallel const &o);
+  TransferParallel & operator =(TransferParallel const &o);
+public:
+  /**
+   * @param workers one chunker per thread, already read or made with
+   * makeWorker(); they are not owned by this object
+   */
+  TransferParallel(vector<Transfer *> const &workers);
+
+  void setNullFlush(bool null_flush);
+  bool getNullFlush();
+
+  /**
+   * Transfer the input; in null-flush mode every '\0' is copied to the
+   * output after the translation of what precedes it, and the output is
+   * flushed
+   * @param in the input file
+   * @param out the output file
+   */
+  void transfer(FILE *in, FILE *out);
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/transfer_pipeline.h>
+#include <apertium/utf_converter.h>
+
+#include <cerrno>
+#include <cwchar>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+TransferPipeline::TransferPipeline(Transfer &t, Interchunk *ic, Postchunk *pc) :
+t(t),
+ic(ic),
+pc(pc),
+null_flush(false)
+{
+}
+
+void
+TransferPipeline::setNullFlush(bool null_flush)
+{
+  this->null_flush = null_flush;
+}
+
+bool
+TransferPipeline::getNullFlush()
+{
+  return null_flush;
+}
+
+void
+TransferPipeline::runSegment(FILE *in, FILE *out)
+{
+  string t_out;
+  t.transfer(in, t_out);
+
+  if(ic == NULL && pc == NULL)
+  {
+    fputs_unlocked(t_out.c_str(), out);
+    return;
+  }
+
+  wstring text = UtfConverter::fromUtf8(t_out);
+  t_out.clear();
+
+  if(ic != NULL && pc != NULL)
+  {
+    vector<TransferToken> ic_out;
+    ic->interchunk(text, ic_out);
+    pc->postchunk(ic_out, out);
+  }
+  else if(ic != NULL)
+  {
+    ic->interchunk(text, out);
+  }
+  else
+  {
+    pc->postchunk(text, out);
+  }
+}
+
+void
+TransferPipeline::run(FILE *in, FILE *out)
+{
+  // the stages never see the '\0' marks themselves; the chunker stops at
+  // each of them and the later stages get one segment at a time
+  bool const t_null_flush = t.getNullFlush();
+  t.setNullFlush(null_flush);
+
+  if(!null_flush)
+  {
+    runSegment(in, out);
+  }
+  else
+  {
+    while(!feof(in))
+    {
+      runSegment(in, out);
+      if(ic == NULL && pc == NULL)
+      {
+        fputc_unlocked('\0', out);
+      }
+      else
+      {
+        fputwc_unlocked(L'\0', out);
+      }
+      int code = fflush(out);
+      if(code != 0)
+      {
+        wcerr << L"Could not flush output " << errno << endl;
+      }
+    }
+  }
+
+  t.setNullFlush(t_null_flush);
+}
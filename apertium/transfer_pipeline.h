@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TRANSFERPIPELINE_
+#define _TRANSFERPIPELINE_
+
+#include <apertium/interchunk.h>
+#include <apertium/postchunk.h>
+#include <apertium/transfer.h>
+
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+/**
+ * Chunker, interchunk and postchunk run in a single process.  The output
+ * of each stage is handed to the next one in memory instead of going
+ * through a pipe.  Interchunk passes its chunks and blanks to postchunk as
+ * tokens, so they are not formatted and tokenised again; the chunker output
+ * is still handed over as text.  In null-flush mode the input is processed
+ * one '\0' terminated segment at a time.
+ */
+class TransferPipeline
+{
+private:
+  Transfer &t;
+  Interchunk *ic;
+  Postchunk *pc;
+  bool null_flush;
+
+  void runSegment(FILE *in, FILE *out);
+
+  TransferPipeline(TransferPipeline const &o);
+  TransferPipeline & operator =(TransferPipeline const &o);
+public:
+  /**
+   * @param t the chunker, already read
+   * @param ic the interchunk stage, or NULL to skip it
+   * @param pc the postchunk stage, or NULL to skip it
+   */
+  TransferPipeline(Transfer &t, Interchunk *ic = NULL, Postchunk *pc = NULL);
+
+  void setNullFlush(bool null_flush);
+  bool getNullFlush();
+
+  /**
+   * Run all the stages over the input
+   * @param in the input file
+   * @param out the output file
+   */
+  void run(FILE *in, FILE *out);
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TRANSFERPOOL_
+#define _TRANSFERPOOL_
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Objects kept alive between rule applications, so that the word and
+ * blank windows of the transfer modules are filled again with init() or
+ * assign() instead of being allocated for every rule
+ */
+template<class T>
+class TransferPool
+{
+private:
+  /**
+   * Objects owned by the pool
+   */
+  vector<T *> items;
+
+  TransferPool(TransferPool const &o);
+  TransferPool & operator =(TransferPool const &o);
+public:
+  /**
+   * Empty pool
+   */
+  TransferPool()
+  {
+  }
+
+  /**
+   * Destructor, frees all the objects
+   */
+  ~TransferPool()
+  {
+    for(size_t i = 0, limit = items.size(); i != limit; i++)
+    {
+      delete items[i];
+    }
+  }
+
+  /**
+   * Window of at least size objects, only valid until the next call.  The
+   * objects keep whatever value they had in the previous window.
+   * @param size number of objects needed
+   * @return array of size objects, or NULL if size is zero
+   */
+  T ** get(size_t size)
+  {
+    if(size == 0)
+    {
+      return NULL;
+    }
+    while(items.size() < size)
+    {
+      items.push_back(new T());
+    }
+    return &items[0];
+  }
+};
+
+#endif
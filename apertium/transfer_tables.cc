@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <apertium/transfer_tables.h>
+#include <apertium/string_utils.h>
+#include <apertium/utf_converter.h>
+#include <lttoolbox/compression.h>
+
+#include <pcre.h>
+
+using namespace Apertium;
+using namespace std;
+
+void
+TransferTables::read(FILE *in)
+{
+  // attr_items
+  bool recompile_attrs = Compression::string_read(in) != string(pcre_version());
+  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
+  {
+    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
+    ApertiumRE &re = attr(attrSlot(cad_k));
+    re.read(in);
+    wstring fallback = Compression::wstring_read(in);
+    if(recompile_attrs) {
+      re.compile(UtfConverter::toUtf8(fallback));
+    }
+    else {
+      re.recognise(UtfConverter::toUtf8(fallback));
+    }
+  }
+
+  // variables
+  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
+  {
+    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
+    var(varSlot(cad_k)) = UtfConverter::toUtf8(Compression::wstring_read(in));
+  }
+
+  // macros
+  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
+  {
+    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
+    macros[cad_k] = Compression::multibyte_read(in);
+  }
+
+  // lists
+  for(int i = 0, limit = Compression::multibyte_read(in); i != limit; i++)
+  {
+    string const cad_k = UtfConverter::toUtf8(Compression::wstring_read(in));
+    TransferList &l = list(listSlot(cad_k));
+
+    for(int j = 0, limit2 = Compression::multibyte_read(in); j != limit2; j++)
+    {
+      wstring const cad_v = Compression::wstring_read(in);
+      l.insert(UtfConverter::toUtf8(cad_v),
+               UtfConverter::toUtf8(StringUtils::tolower(cad_v)));
+    }
+  }
+}
+
+int
+TransferTables::attrSlot(string const &name)
+{
+  map<string, int, Ltstr>::iterator it = attr_index.find(name);
+  if(it != attr_index.end())
+  {
+    return it->second;
+  }
+  attr_items.push_back(ApertiumRE());
+  return attr_index[name] = attr_items.size() - 1;
+}
+
+int
+TransferTables::varSlot(string const &name)
+{
+  map<string, int, Ltstr>::iterator it = var_index.find(name);
+  if(it != var_index.end())
+  {
+    return it->second;
+  }
+  variables.push_back("");
+  return var_index[name] = variables.size() - 1;
+}
+
+int
+TransferTables::listSlot(string const &name)
+{
+  map<string, int, Ltstr>::iterator it = list_index.find(name);
+  if(it != list_index.end())
+  {
+    return it->second;
+  }
+  lists.push_back(TransferList());
+  return list_index[name] = lists.size() - 1;
+}
+
+ApertiumRE &
+TransferTables::attr(int slot)
+{
+  return attr_items[slot];
+}
+
+string &
+TransferTables::var(int slot)
+{
+  return variables[slot];
+}
+
+TransferList &
+TransferTables::list(int slot)
+{
+  return lists[slot];
+}
+
+xmlChar const *
+TransferTables::attrib(xmlNode *element, char const *name)
+{
+  for(xmlAttr *i = element->properties; i != NULL; i = i->next)
+  {
+    if(!xmlStrcmp(i->name, (const xmlChar *) name))
+    {
+      return i->children->content;
+    }
+  }
+  return NULL;
+}
+
+void
+TransferTables::resolve(xmlNode *localroot)
+{
+  for(xmlNode *i = localroot; i != NULL; i = i->next)
+  {
+    if(i->type != XML_ELEMENT_NODE)
+    {
+      continue;
+    }
+
+    if(!xmlStrcmp(i->name, (const xmlChar *) "clip") ||
+       !xmlStrcmp(i->name, (const xmlChar *) "case-of"))
+    {
+      xmlChar const *part = attrib(i, "part");
+      if(part != NULL)
+      {
+        i->_private = &attr(attrSlot((const char *) part));
+      }
+    }
+    else if(!xmlStrcmp(i->name, (const xmlChar *) "get-case-from"))
+    {
+      i->_private = &attr(attrSlot("lem"));
+    }
+    else if(!xmlStrcmp(i->name, (const xmlChar *) "var") ||
+            !xmlStrcmp(i->name, (const xmlChar *) "append"))
+    {
+      xmlChar const *n = attrib(i, "n");
+      if(n != NULL)
+      {
+        i->_private = &var(varSlot((const char *) n));
+      }
+    }
+    else if(!xmlStrcmp(i->name, (const xmlChar *) "list"))
+    {
+      xmlChar const *n = attrib(i, "n");
+      if(n != NULL)
+      {
+        i->_private = &list(listSlot((const char *) n));
+      }
+    }
+    else if(!xmlStrcmp(i->name, (const xmlChar *) "call-macro"))
+    {
+      xmlChar const *n = attrib(i, "n");
+      if(n != NULL)
+      {
+        i->_private = &macros[(const char *) n];
+      }
+    }
+
+    resolve(i->children);
+  }
+}
+
+ApertiumRE &
+TransferTables::attrOf(xmlNode *element)
+{
+  return *static_cast<ApertiumRE *>(element->_private);
+}
+
+string &
+TransferTables::varOf(xmlNode *element)
+{
+  return *static_cast<string *>(element->_private);
+}
+
+TransferList &
+TransferTables::listOf(xmlNode *element)
+{
+  return *static_cast<TransferList *>(element->_private);
+}
+
+int
+TransferTables::macroOf(xmlNode *element)
+{
+  return *static_cast<int *>(element->_private);
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2005--2015 Universitat d'Alacant / Universidad de Alicante
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TRANSFERTABLES_
+#define _TRANSFERTABLES_
+
+#include <apertium/apertium_re.h>
+#include <apertium/transfer_list.h>
+#include <lttoolbox/ltstr.h>
+
+#include <cstdio>
+#include <deque>
+#include <libxml/tree.h>
+#include <map>
+#include <string>
+
+using namespace std;
+
+/**
+ * Attribute regexps, variables, macros and lists of a transfer, interchunk
+ * or postchunk rules file.  Every name is given an integer slot the first
+ * time it is seen; slot storage never moves, so references to it can be
+ * kept for the lifetime of the tables.
+ */
+class TransferTables
+{
+private:
+  deque<ApertiumRE> attr_items;
+  deque<string> variables;
+  deque<TransferList> lists;
+  map<string, int, Ltstr> attr_index;
+  map<string, int, Ltstr> var_index;
+  map<string, int, Ltstr> list_index;
+  map<string, int, Ltstr> macros;
+
+  static xmlChar const * attrib(xmlNode *element, char const *name);
+public:
+  /**
+   * Read the attributes, variables, macros and lists sections of a
+   * preprocessed rules file
+   * @param in the input stream, just after the finals section
+   */
+  void read(FILE *in);
+
+  int attrSlot(string const &name);
+  int varSlot(string const &name);
+  int listSlot(string const &name);
+
+  ApertiumRE & attr(int slot);
+  string & var(int slot);
+  TransferList & list(int slot);
+
+  /**
+   * Annotate every element of the rules that names an attribute,
+   * variable, list or macro with a pointer to its storage (in the
+   * '_private' field of the node), so that they are not looked up by
+   * name while the rules are applied
+   * @param localroot the root of the rules document
+   */
+  void resolve(xmlNode *localroot);
+
+  static ApertiumRE & attrOf(xmlNode *element);
+  static string & varOf(xmlNode *element);
+  static TransferList & listOf(xmlNode *element);
+  static int macroOf(xmlNode *element);
+};
+
+#endif
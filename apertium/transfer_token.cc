@@ -24,6 +24,7 @@ TransferToken::copy(TransferToken const &o)
 {
   type = o.type;
   content = o.content;
+  utf8 = o.utf8;
 }
 
 void
@@ -43,6 +44,14 @@ TransferToken::TransferToken(wstring const &content,
   this->type = type;
 }
 
+TransferToken::TransferToken(wstring const &content, string const &utf8,
+                             TransferTokenType type)
+{
+  this->content = content;
+  this->utf8 = utf8;
+  this->type = type;
+}
+
 TransferToken::~TransferToken()
 {
   destroy();
@@ -76,6 +85,12 @@ TransferToken::getContent()
   return content;
 }
 
+string &
+TransferToken::getUtf8()
+{
+  return utf8;
+}
+
 void 
 TransferToken::setType(TransferTokenType type)
 {
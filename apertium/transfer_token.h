@@ -34,17 +34,21 @@ class TransferToken
 private:
   TransferTokenType type;
   wstring content;
+  string utf8;
 
   void copy(TransferToken const &o);
   void destroy();
 public:
   TransferToken();
   TransferToken(wstring const &content, TransferTokenType type);
+  TransferToken(wstring const &content, string const &utf8,
+                TransferTokenType type);
   ~TransferToken();
   TransferToken(TransferToken const &o);
   TransferToken & operator =(TransferToken const &o);
   TransferTokenType getType();
   wstring & getContent();
+  string & getUtf8();
   void setType(TransferTokenType type);
   void setContent(wstring const &content);
 };
@@ -40,8 +40,7 @@ queue_length(0)
 
 TransferWord::TransferWord(string const &src, string const &tgt, int queue)
 {
-  init(src, tgt);
-  queue_length = queue;
+  init(src, tgt, queue);
 }
 
 TransferWord::~TransferWord()
@@ -66,66 +65,57 @@ TransferWord::operator =(TransferWord const &o)
 }
 
 void
-TransferWord::init(string const &src, string const &tgt)
+TransferWord::init(string const &src, string const &tgt, int queue)
 {
   s_str = src;
   t_str = tgt;
+  queue_length = queue;
 }
 
 string
-TransferWord::source(ApertiumRE const &part, bool with_queue)
+TransferWord::access(string const &str, ApertiumRE const &part, bool with_queue)
 {
-  if(with_queue)
+  size_t begin, end;
+  if(part.search(str, with_queue ? str.size() : str.size() - queue_length, begin, end))
   {
-    return part.match(s_str);
+    return str.substr(begin, end - begin);
   }
-  else
+  return "";
+}
+
+void
+TransferWord::assign(string &str, ApertiumRE const &part, string const &value,
+                     bool with_queue)
+{
+  size_t begin, end;
+  if(part.search(str, with_queue ? str.size() : str.size() - queue_length, begin, end))
   {
-    return part.match(s_str.substr(0, s_str.size() - queue_length));
+    str.replace(begin, end - begin, value);
   }
 }
 
+string
+TransferWord::source(ApertiumRE const &part, bool with_queue)
+{
+  return access(s_str, part, with_queue);
+}
+
 string
 TransferWord::target(ApertiumRE const &part, bool with_queue)
 {
-  if(with_queue)
-  {
-    return part.match(t_str);
-  }
-  else
-  {
-    return part.match(t_str.substr(0, t_str.size() - queue_length));
-  }
+  return access(t_str, part, with_queue);
 }
 
 void
 TransferWord::setSource(ApertiumRE const &part, string const &value, 
 			bool with_queue)
 {
-  if(with_queue)
-  {
-    part.replace(s_str, value);
-  }
-  else
-  {
-    string mystring = s_str.substr(0, s_str.size() - queue_length);
-    part.replace(mystring, value);
-    s_str = mystring + s_str.substr(s_str.size() - queue_length);
-  }
+  assign(s_str, part, value, with_queue);
 }
 
 void
 TransferWord::setTarget(ApertiumRE const &part, string const &value, 
 			bool with_queue)
 {
-  if(with_queue)
-  {
-    part.replace(t_str, value);
-  }
-  else
-  {
-    string mystring = t_str.substr(0, t_str.size() - queue_length);
-    part.replace(mystring, value);
-    t_str = mystring + t_str.substr(t_str.size() - queue_length);
-  }
+  assign(t_str, part, value, with_queue);
 }
@@ -61,18 +61,21 @@ private:
    * Accesses the source/target side of a word using the specified part
    * @param str tipically s_str or t_str
    * @param part regular expression to match/access
+   * @param with_queue access taking into account the queue
    * @return reference to matched/accessed string
    */
-  string access(string const &str, ApertiumRE const &part);
+  string access(string const &str, ApertiumRE const &part, bool with_queue);
 
   /**
    * Assings a value to the source/target side of a word using the
-   * specified part 
+   * specified part, in place
    * @param str tipically s_str or t_str 
    * @param part regular expression to match/access 
    * @param value the string to be assigned
+   * @param with_queue access taking or not into account the queue
    */
-  void assign(string &str, ApertiumRE const &part, string const &value);
+  void assign(string &str, ApertiumRE const &part, string const &value,
+              bool with_queue);
 
 public:
   /**
@@ -110,8 +113,9 @@ public:
    * language
    * @param src source word
    * @param tgt target word
+   * @param queue queue length
    */
-  void init(string const &src, string const &tgt);
+  void init(string const &src, string const &tgt, int queue = 0);
   
   /**
    * Reference a source language word part
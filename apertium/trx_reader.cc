@@ -29,7 +29,8 @@ TRXReader::ANY_TAG = L"<ANY_TAG>";
 wstring const
 TRXReader::ANY_CHAR = L"<ANY_CHAR>";
 
-TRXReader::TRXReader()
+TRXReader::TRXReader() :
+has_bytecode(false)
 {
   td.getAlphabet().includeSymbol(ANY_TAG);
   td.getAlphabet().includeSymbol(ANY_CHAR);
@@ -180,6 +181,10 @@ TRXReader::parse()
       step();
     }
   }  
+
+  // precompiled rule bodies, so that apertium-transfer does not need to
+  // parse the XML again
+  has_bytecode = bytecode.compile(path);
 }
 
 void
@@ -315,6 +320,10 @@ TRXReader::write(string const &filename)
   }
   
   td.write(out);
+  if(has_bytecode)
+  {
+    bytecode.write(out);
+  }
 
   fclose(out);
 }
@@ -17,6 +17,7 @@
 #ifndef _TRXREADER_
 #define _TRXREADER_
 
+#include <apertium/transfer_bytecode.h>
 #include <apertium/transfer_data.h>
 #include <apertium/xml_reader.h>
 #include <lttoolbox/ltstr.h>
@@ -38,6 +39,8 @@ private:
 
   multimap<wstring, LemmaTags, Ltstr> cat_items;
   TransferData td;
+  TransferBytecode bytecode;
+  bool has_bytecode;
 
   void destroy();
   void clearTagIndex();
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import unittest
+import tempfile
+from os.path import join as pjoin
+from os.path import abspath, dirname
+from shutil import rmtree
+from subprocess import Popen, PIPE
+
+
+def rel(fn):
+    return abspath(pjoin(dirname(abspath(__file__)), fn))
+
+
+TEST_LEXTOR_DATA = rel("test-lextor-data")
+
+STOPWORDS = "./.<sent>\n"
+
+WORDS = """cat/cat<n>
+dog/dog<n>
+eat/eat<vblex>
+fish/fish<n>
+unicorn/unicorn<n>
+"""
+
+SENTENCES = ["^cat/cat<n>$ ^eat/eat<vblex>$ ^fish/fish<n>$^./.<sent>$",
+             "^dog/dog<n>$ ^eat/eat<vblex>$ ^cat/cat<n>$^./.<sent>$",
+             "^fish/fish<n>$ ^dog/dog<n>$ ^eat/eat<vblex>$^./.<sent>$"]
+
+
+class ModelRoundTripTest(unittest.TestCase):
+    """A word model trained with a word that never occurs in the corpus
+should read back the same as it was written."""
+
+    def setUp(self):
+        self.tmpd = tempfile.mkdtemp()
+
+    def tearDown(self):
+        rmtree(self.tmpd)
+
+    def write(self, name, contents):
+        fn = pjoin(self.tmpd, name)
+        with open(fn, "w") as f:
+            f.write(contents)
+        return fn
+
+    def test_unseen_word(self):
+        proc = Popen([TEST_LEXTOR_DATA,
+                      self.write("stopwords", STOPWORDS),
+                      self.write("words", WORDS),
+                      self.write("corpus", "\n".join(SENTENCES * 3) + "\n"),
+                      pjoin(self.tmpd, "model")],
+                     stdout=PIPE, stderr=PIPE, universal_newlines=True)
+        out, err = proc.communicate()
+        self.assertEqual(proc.returncode, 0, err)
+
+        modules = {"trained": {}, "read": {}}
+        for line in out.splitlines():
+            label, word, module = line.split(" ")
+            modules[label][word] = float(module)
+        self.assertEqual(modules["read"], modules["trained"])
+        self.assertEqual(modules["trained"]["unicorn/unicorn<n>"], 0)
+        for word in ["cat/cat<n>", "dog/dog<n>", "eat/eat<vblex>", "fish/fish<n>"]:
+            self.assertGreater(modules["trained"][word], 0)
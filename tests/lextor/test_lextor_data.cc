@@ -0,0 +1,68 @@
+#include "apertium/lextor.h"
+#include "apertium/lextor_data.h"
+#include <lttoolbox/lt_locale.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+
+using namespace std;
+
+void print_modules(const wchar_t *label, LexTorData &data)
+{
+  set<wstring> words = data.get_words();
+  for (set<wstring>::iterator it = words.begin(); it != words.end(); it++) {
+    wcout << label << L" " << *it << L" "
+          << data.get_module_lexchoice_vector(*it) << L"\n";
+  }
+}
+
+/**
+ * Train a word co-occurrence model on a corpus, write it to a file, read
+ * it back, and print the module of the co-occurrence vector of every
+ * word of both models.
+ */
+int main(int argc, char *argv[])
+{
+  LtLocale::tryToSetLocale();
+
+  if (argc != 5) {
+    cerr << "Usage: " << argv[0] << " <stopwords> <words> <corpus> <model>\n";
+    exit(-1);
+  }
+
+  LexTorData trained;
+  wifstream stopwords(argv[1]);
+  trained.read_stopwords(stopwords);
+  wifstream words(argv[2]);
+  trained.read_words(words);
+  trained.set_nwords_per_set(3);
+
+  LexTor lextor;
+  lextor.set_lextor_data(&trained);
+  wifstream corpus(argv[3]);
+  lextor.trainwrd(corpus, 2, 2);
+
+  FILE *output = fopen(argv[4], "wb");
+  if (!output) {
+    cerr << "Error: cannot open file '" << argv[4] << "'\n";
+    exit(-2);
+  }
+  trained.write(output);
+  fclose(output);
+
+  LexTorData read;
+  FILE *input = fopen(argv[4], "rb");
+  if (!input) {
+    cerr << "Error: cannot open file '" << argv[4] << "'\n";
+    exit(-2);
+  }
+  read.read(input);
+  fclose(input);
+
+  print_modules(L"trained", trained);
+  print_modules(L"read", read);
+  return 0;
+}
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import re
+import unittest
+
+from os.path import join as pjoin
+from subprocess import Popen, PIPE, call
+from tempfile import mkdtemp
+from shutil import rmtree
+
+
+class MultipleTranslationsTest(unittest.TestCase):
+    """The translations of a segment matched by a rule, with every word
+translated in two ways."""
+
+    t1xdata = "data/multiple.t1x"
+    bidixdata = "data/multiple.dix"
+    inp = "^big<adj>$ ^house<n>$\n"
+    adjs = set(["grande<adj>", "gran<adj>"])
+    nouns = set(["casa<n>", "hogar<n>"])
+
+    def setUp(self):
+        self.tmpd = mkdtemp()
+        self.bindata = pjoin(self.tmpd, "multiple.t1x.bin")
+        self.bidix = pjoin(self.tmpd, "multiple.autobil.bin")
+        self.assertEqual(call(["../apertium/apertium-preprocess-transfer",
+                               self.t1xdata, self.bindata]),
+                         0)
+        self.assertEqual(call(["lt-comp", "lr", self.bidixdata, self.bidix],
+                              stdout=PIPE),
+                         0)
+
+    def tearDown(self):
+        rmtree(self.tmpd)
+
+    def run_mult(self, flags):
+        proc = Popen(["../apertium/apertium-multiple-translations"] + flags +
+                     [self.bindata, self.bidix],
+                     stdin=PIPE, stdout=PIPE, stderr=PIPE,
+                     universal_newlines=True)
+        out, err = proc.communicate(self.inp)
+        self.assertEqual(proc.returncode, 0, err)
+        self.assertTrue(out.endswith("\n"))
+        return out[:-1]
+
+    def paths(self, flags):
+        out = self.run_mult(flags)
+        if out.startswith("[{]"):
+            self.assertTrue(out.endswith(".[][}]"))
+            return out[3:-6].split("[|]")
+        return [out]
+
+    def all_paths(self):
+        return set("^%s$ ^%s$" % (adj, noun)
+                   for adj in self.adjs for noun in self.nouns)
+
+    def test_every_combination(self):
+        paths = self.paths([])
+        self.assertEqual(len(paths), 4)
+        self.assertEqual(set(paths), self.all_paths())
+
+    def test_max_paths(self):
+        paths = self.paths([])
+        self.assertEqual(self.paths(["-m", "2"]), paths[:2])
+        self.assertEqual(self.paths(["-m", "1"]), paths[:1])
+        self.assertEqual(self.run_mult(["-m", "1"]), paths[0])
+        self.assertEqual(self.paths(["-m", "0"]), paths)
+        self.assertEqual(self.paths(["-m", "10"]), paths)
+
+    def test_max_paths_out_of_range(self):
+        for value in ["-1", "4294967296", "99999999999999999999", "2x"]:
+            proc = Popen(["../apertium/apertium-multiple-translations",
+                          "-m", value, self.bindata, self.bidix],
+                         stdin=PIPE, stdout=PIPE, stderr=PIPE)
+            proc.communicate(b"")
+            self.assertNotEqual(proc.returncode, 0, value)
+
+    def test_lattice(self):
+        out = self.run_mult(["-l"])
+        group = r"\[\{\]\^([^$]*)\$\[\|\]\^([^$]*)\$\.\[\]\[\}\]"
+        match = re.match("^" + group + " " + group + "$", out)
+        self.assertIsNotNone(match, out)
+        self.assertEqual(set(match.group(1, 2)), self.adjs)
+        self.assertEqual(set(match.group(3, 4)), self.nouns)
+        # the first translation of every word makes the first path
+        self.assertEqual("^%s$ ^%s$" % match.group(1, 3), self.paths([])[0])
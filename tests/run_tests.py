@@ -8,13 +8,19 @@ import unittest
 import tagger
 import pretransfer
 import postchunk
+import transfer
+import multiple_translations
+import lextor
 
 if __name__ == "__main__":
     os.chdir(os.path.dirname(__file__))
     failures = 0
     for module in [tagger,
                    pretransfer,
-                   postchunk]:
+                   postchunk,
+                   transfer,
+                   multiple_translations,
+                   lextor]:
         suite = unittest.TestLoader().loadTestsFromModule(module)
         res = unittest.TextTestRunner(verbosity = 2).run(suite)
         failures += len(res.failures)
@@ -22,6 +22,9 @@ def rel(fn):
 
 
 APERTIUM_TAGGER = rel("../../apertium/apertium-tagger")
+TEST_STREAM = rel("test-stream")
+TEST_DISCARD = rel("test-discard-on-ambiguity")
+TEST_PRINT_HMM = rel("test-print-hmm")
 
 def check_output(*popenargs, **kwargs):
     # Essentially a copypasted version of check_output with input backported
@@ -243,6 +246,217 @@ TEST_NEW_AMBG_CLASS = """
 ^./.<sent>$
 """.strip()
 
+# Every sentence starts a new Baum-Welch segment after "the", so that
+# the threads get several segments each
+BAUM_WELCH_UNTAGGED = "\n".join("""
+^The/the<det><def><sp>$
+^{0}$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^the/the<det><def><sp>$
+^{1}$
+^./.<sent>$
+""".strip().format(*words) for words in [
+    ("red/red<adj><sint>", "close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>"),
+    ("cat/cat<n><sg>", "room/room<n><sg>"),
+    ("close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>", "red/red<adj><sint>"),
+    ("booked/book<vblex><pp>/book<vblex><past>", "cat/cat<n><sg>"),
+] * 5)
+
+MTX = """
+<?xml version="1.0" encoding="utf-8"?>
+<metatag>
+  <feats>
+    <feat>
+      <out><ex-surf><tokaddr/></ex-surf></out>
+      <out><join><ex-tags><ex-wordoid><wrdaddr/></ex-wordoid></ex-tags></join></out>
+    </feat>
+  </feats>
+</metatag>
+""".strip()
+
+TSX_RULES = TSX.replace("</tagger>", """
+  <forbid>
+    <label-sequence>
+      <label-item label="DET"/>
+      <label-item label="VERB"/>
+    </label-sequence>
+    <label-sequence>
+      <label-item label="NOUN"/>
+      <label-item label="VERB"/>
+    </label-sequence>
+  </forbid>
+  <enforce-rules>
+    <enforce-after label="ADJ">
+      <label-set>
+        <label-item label="NOUN"/>
+      </label-set>
+    </enforce-after>
+  </enforce-rules>
+</tagger>
+""".strip())
+
+TAG_CONTEXTS = """
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^the/the<det><def><sp>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^./.<sent>$
+^Close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^the/the<det><def><sp>$
+^red/red<adj><sint>$
+^room/room<n><sg>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^cat/cat<n><sg>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^the/the<det><def><sp>$
+^red/red<adj><sint>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^room/room<n><sg>$
+^has/have<vbhaver><pres><p3><sg>$
+^booked/book<vblex><pp>/book<vblex><past>$
+^the/the<det><def><sp>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^booked/book<vblex><pp>/book<vblex><past>$
+^the/the<det><def><sp>$
+^close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^room/room<n><sg>$
+^./.<sent>$
+""".strip()
+
+# Ambiguous words right after ambiguous words, so that the items in the
+# beam disagree about the previous tag
+TAG_AMBIGUOUS_RUNS = """
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^booked/book<vblex><pp>/book<vblex><past>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^room/room<n><sg>$
+^./.<sent>$
+""".strip()
+
+# A single sentence, so that training doesn't depend on the order the
+# sentences are shuffled in
+PERCEPTRON_UNTAGGED = """
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^the/the<det><def><sp>$
+^room/room<n><sg>$
+^The/the<det><def><sp>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^Close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^the/the<det><def><sp>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^The/the<det><def><sp>$
+^red/red<adj><sint>$
+^books/book<n><pl>/book<vblex><pri><p3><sg>$
+^close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^the/the<det><def><sp>$
+^room/room<n><sg>$
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^has/have<vbhaver><pres><p3><sg>$
+^booked/book<vblex><pp>/book<vblex><past>$
+^the/the<det><def><sp>$
+^room/room<n><sg>$
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^booked/book<vblex><pp>/book<vblex><past>$
+^the/the<det><def><sp>$
+^room/room<n><sg>$
+^The/the<det><def><sp>$
+^close/close<adj><sint>/close<n><sg>/close<vblex><inf>/close<vblex><pres>/close<vblex><imp>$
+^room/room<n><sg>$
+^./.<sent>$
+""".strip()
+
+PERCEPTRON_TAGGED = """
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^books/book<vblex><pri><p3><sg>$
+^the/the<det><def><sp>$
+^room/room<n><sg>$
+^The/the<det><def><sp>$
+^books/book<n><pl>$
+^close/close<vblex><pres>$
+^Close/close<vblex><imp>$
+^the/the<det><def><sp>$
+^books/book<n><pl>$
+^The/the<det><def><sp>$
+^red/red<adj><sint>$
+^books/book<n><pl>$
+^close/close<vblex><pres>$
+^the/the<det><def><sp>$
+^room/room<n><sg>$
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^has/have<vbhaver><pres><p3><sg>$
+^booked/book<vblex><pp>$
+^the/the<det><def><sp>$
+^room/room<n><sg>$
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^booked/book<vblex><past>$
+^the/the<det><def><sp>$
+^room/room<n><sg>$
+^The/the<det><def><sp>$
+^close/close<adj><sint>$
+^room/room<n><sg>$
+^./.<sent>$
+""".strip()
+
+# Features that slice, loop over the tags and look at the previous word
+MTX_HISTORY = """
+<?xml version="1.0" encoding="utf-8"?>
+<metatag>
+  <feats>
+    <feat>
+      <out><ex-surf><tokaddr/></ex-surf></out>
+      <out><join><ex-tags><ex-wordoid><wrdaddr/></ex-wordoid></ex-tags></join></out>
+    </feat>
+    <feat>
+      <out><slice end="2"><ex-lemma><ex-wordoid><wrdaddr/></ex-wordoid></ex-lemma></slice></out>
+      <out-many><slice start="0" end="1"><ex-tags><ex-wordoid><wrdaddr/></ex-wordoid></ex-tags></slice></out-many>
+    </feat>
+    <feat>
+      <out-many>
+        <for-each as="tag">
+          <ex-tags><ex-wordoid><wrdaddr/></ex-wordoid></ex-tags>
+          <var name="tag"/>
+        </for-each>
+      </out-many>
+    </feat>
+    <feat>
+      <out><join><ex-tags><ex-wordoid><clamp><add><wrdaddr/><addr-of-ints><int val="-1"/><int val="0"/></addr-of-ints></add></clamp></ex-wordoid></ex-tags></join></out>
+      <out><join><ex-tags><ex-wordoid><wrdaddr/></ex-wordoid></ex-tags></join></out>
+    </feat>
+    <feat>
+      <pred><gt><tokaddr/><int val="0"/></gt></pred>
+      <out-many>
+        <for-each as="prev">
+          <ex-tags><ex-wordoid><clamp><add><wrdaddr/><addr-of-ints><int val="-1"/><int val="0"/></addr-of-ints></add></clamp></ex-wordoid></ex-tags>
+          <var name="prev"/>
+        </for-each>
+      </out-many>
+      <out><ex-lemma><ex-wordoid><wrdaddr/></ex-wordoid></ex-lemma></out>
+    </feat>
+  </feats>
+</metatag>
+""".strip()
+
 # Expected strings
 EXPECTED_SUBST = """
 Error: A new ambiguity class was found.
@@ -251,6 +465,88 @@ Word 'cat'.
 New ambiguity class: {NOUN,ADJ}
 """.strip().split("\n")
 
+EXPECTED_SLIDING_WINDOW = """
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^close/close<n><sg>$
+^the/the<det><def><sp>$
+^books/book<n><pl>$
+^./.<sent>$
+^Close/close<vblex><inf>$
+^the/the<det><def><sp>$
+^red/red<adj><sint>$
+^room/room<n><sg>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^close/close<n><sg>$
+^cat/cat<n><sg>$
+^books/book<n><pl>$
+^the/the<det><def><sp>$
+^red/red<adj><sint>$
+^books/book<vblex><pri><p3><sg>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^room/room<n><sg>$
+^has/have<vbhaver><pres><p3><sg>$
+^booked/book<vblex><pp>$
+^the/the<det><def><sp>$
+^books/book<n><pl>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^books/book<vblex><pri><p3><sg>$
+^booked/book<vblex><pp>$
+^the/the<det><def><sp>$
+^close/close<n><sg>$
+^room/room<n><sg>$
+^./.<sent>$
+""".strip()
+
+EXPECTED_PERCEPTRON = """
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^close/close<vblex><pres>$
+^the/the<det><def><sp>$
+^books/book<n><pl>$
+^./.<sent>$
+^Close/close<vblex><imp>$
+^the/the<det><def><sp>$
+^red/red<adj><sint>$
+^room/room<n><sg>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^close/close<vblex><pres>$
+^cat/cat<n><sg>$
+^books/book<vblex><pri><p3><sg>$
+^the/the<det><def><sp>$
+^red/red<adj><sint>$
+^books/book<n><pl>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^room/room<n><sg>$
+^has/have<vbhaver><pres><p3><sg>$
+^booked/book<vblex><past>$
+^the/the<det><def><sp>$
+^books/book<n><pl>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^books/book<n><pl>$
+^booked/book<vblex><past>$
+^the/the<det><def><sp>$
+^close/close<vblex><pres>$
+^room/room<n><sg>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^cat/cat<n><sg>$
+^books/book<vblex><pri><p3><sg>$
+^booked/book<vblex><pp>$
+^./.<sent>$
+^The/the<det><def><sp>$
+^close/close<vblex><pres>$
+^close/close<vblex><imp>$
+^room/room<n><sg>$
+^./.<sent>$
+""".strip()
+
 
 # Tests
 class AmbiguityClassTest(unittest.TestCase):
@@ -325,3 +621,205 @@ class AmbiguityClassTest(unittest.TestCase):
             acceptable,
             "'cat' must be output and tagged as an adjective or a noun.\n" +
             "Actual output:\n{}".format(subst_stdout))
+
+
+class PerceptronTrainingTest(unittest.TestCase):
+    def setUp(self):
+        self.mtx_fn = tmp(MTX)
+        self.untagged = tmp(TRAIN_NO_PROBLEM_UNTAGGED)
+        self.tagged = tmp(TRAIN_NO_PROBLEM_TAGGED)
+
+    def train(self, flags):
+        model_fn = tmp("")
+        check_call(
+            [APERTIUM_TAGGER, '-xs', '4'] + flags +
+            [model_fn, self.tagged, self.untagged, self.mtx_fn])
+        with open(model_fn, 'rb') as model:
+            return model_fn, model.read()
+
+    def tag(self, model_fn):
+        return check_output(
+            [APERTIUM_TAGGER, '-x', '-g', '-p', model_fn, self.untagged])
+
+    def test_same_seed_same_model(self):
+        for threads in ['1', '2']:
+            flags = ['-j', threads, '--seed', '7']
+            self.assertEqual(self.train(flags)[1], self.train(flags)[1])
+
+    def test_parallel_tags_like_serial(self):
+        serial_fn = self.train(['-j', '1'])[0]
+        parallel_fn = self.train(['-j', '2'])[0]
+        serial = self.tag(serial_fn)
+        self.assertEqual(self.tag(parallel_fn), serial)
+        self.assertEqual(serial.split(), TRAIN_NO_PROBLEM_TAGGED.split())
+
+    def test_evaluate(self):
+        for threads in ['1', '2']:
+            model_fn = tmp("")
+            args = [model_fn, self.tagged, self.untagged, self.mtx_fn]
+            report = check_stderr(
+                [APERTIUM_TAGGER, '-xs', '4', '-j', threads] + args)
+            self.assertNotIn("Accuracy", report)
+            report = check_stderr(
+                [APERTIUM_TAGGER, '-xs', '4', '-j', threads, '--evaluate'] +
+                args)
+            self.assertIn("Accuracy on the training corpus", report)
+
+
+class BaumWelchThreadsTest(unittest.TestCase):
+    """Baum-Welch training should give the same model, up to rounding,
+whatever the number of threads."""
+
+    def setUp(self):
+        self.tsx_fn = tmp(TSX)
+        self.dic_fn = tmp(DIC)
+        self.untagged = tmp(BAUM_WELCH_UNTAGGED)
+
+    def model(self, flags):
+        model_fn = tmp("")
+        check_call(
+            [APERTIUM_TAGGER] + flags +
+            [self.dic_fn, self.untagged, self.tsx_fn, model_fn])
+        return [line.split()
+                for line in check_output([TEST_PRINT_HMM, model_fn]).split("\n")
+                if line]
+
+    def assertSameModel(self, actual, expected):
+        self.assertEqual(len(actual), len(expected))
+        for actual_row, expected_row in zip(actual, expected):
+            # the size and the row names are compared as they are
+            self.assertEqual(actual_row[:2], expected_row[:2])
+            self.assertEqual(len(actual_row), len(expected_row))
+            for actual_value, expected_value in zip(actual_row[2:],
+                                                    expected_row[2:]):
+                if actual_row[0] in ("a", "b"):
+                    self.assertAlmostEqual(float(actual_value),
+                                           float(expected_value),
+                                           delta=1e-9 * abs(float(expected_value)))
+                else:
+                    self.assertEqual(actual_value, expected_value)
+
+    def test_train(self):
+        serial = self.model(['-t', '4', '-j', '1'])
+        self.assertSameModel(self.model(['-t', '4', '-j', '2']), serial)
+        self.assertSameModel(self.model(['-t', '4', '-j', '3']), serial)
+
+    def test_threads_out_of_range(self):
+        for value in ['0', '257', '1000000', '-1']:
+            with self.assertRaises(CalledProcessError):
+                check_call([APERTIUM_TAGGER, '-t', '1', '-j', value,
+                            self.dic_fn, self.untagged, self.tsx_fn, tmp("")],
+                           stderr=PIPE)
+
+
+class TaggingRegressionTest(unittest.TestCase):
+    """Training and tagging should give what they gave before the taggers
+were optimised; the expected output was produced by the unoptimised
+apertium-tagger."""
+
+    def setUp(self):
+        self.tsx_fn = tmp(TSX_RULES)
+        self.dic_fn = tmp(DIC)
+        self.contexts = tmp(TAG_CONTEXTS)
+
+    def test_sliding_window(self):
+        model_fn = tmp("")
+        untagged = tmp(BAUM_WELCH_UNTAGGED)
+        check_call(
+            [APERTIUM_TAGGER, '--sliding-window', '-t', '2', self.dic_fn,
+             untagged, self.tsx_fn, model_fn])
+        tagged = check_output(
+            [APERTIUM_TAGGER, '--sliding-window', '-g', '-p', model_fn,
+             self.contexts])
+        self.assertEqual(tagged.split(), EXPECTED_SLIDING_WINDOW.split())
+
+    def test_perceptron(self):
+        model_fn = tmp("")
+        check_call(
+            [APERTIUM_TAGGER, '-xs', '4', model_fn, tmp(PERCEPTRON_TAGGED),
+             tmp(PERCEPTRON_UNTAGGED), tmp(MTX_HISTORY)])
+        tagged = check_output(
+            [APERTIUM_TAGGER, '-x', '-g', '-p', model_fn,
+             tmp(TAG_CONTEXTS + "\n" + TAG_AMBIGUOUS_RUNS)])
+        self.assertEqual(tagged.split(), EXPECTED_PERCEPTRON.split())
+
+
+class StreamTest(unittest.TestCase):
+    def tokens(self, flags, text):
+        return check_output([TEST_STREAM] + flags + [tmp(text)]).split("\n")
+
+    def test_peek_up_to_eof(self):
+        self.assertEqual(
+            self.tokens(['-p'], "^a/a<n>$\n\n^b/b<n>$ ^c/c<n>$"),
+            ['blank 0',
+             'peek string "" lu "a" /a<n>',
+             'get string "" lu "a" /a<n>',
+             'blank 1',
+             'peek string "', '', '" lu "b" /b<n>',
+             'get string "', '', '" lu "b" /b<n>',
+             'blank 0',
+             'peek string " " lu "c" /c<n>',
+             'get string " " lu "c" /c<n>',
+             # at the end of the file: no blank, and an empty token
+             'blank 0',
+             'peek string ""',
+             'get string ""',
+             ''])
+
+    def test_blank_before_eof(self):
+        self.assertEqual(
+            self.tokens(['-p'], "^a/a<n>$\n\n"),
+            ['blank 0',
+             'peek string "" lu "a" /a<n>',
+             'get string "" lu "a" /a<n>',
+             'blank 1',
+             'peek string "', '', '"',
+             'get string "', '', '"',
+             ''])
+
+    def test_null_flush_reads_no_further(self):
+        # after each '\0' the '^' that follows it must still be unread
+        out = self.tokens(['-z'], "^a/a<n>$ ^b/b<n>$\n\0^c/c<n>$\n\0^d/d<n>$")
+        self.assertEqual([line for line in out if line.startswith('flush')],
+                         ['flush next 94', 'flush next 94'])
+        self.assertEqual([line for line in out if ' lu ' in line],
+                         ['get string "" lu "a" /a<n>',
+                          'get string " " lu "b" /b<n>',
+                          'get string "" lu "c" /c<n>',
+                          'get string "" lu "d" /d<n>'])
+
+
+class DiscardOnAmbiguityTest(unittest.TestCase):
+    """The discard rules should keep the forms and tags they always kept,
+so that existing models see the same ambiguity classes."""
+
+    def discard(self, rules, forms):
+        return check_output([TEST_DISCARD] + rules + ["--"] + forms).split("\n")
+
+    def test_form_after_erase_skipped(self):
+        self.assertEqual(
+            self.discard(["<n>"], ["a<n>", "b<n>", "c<vblex>"]),
+            ["^w/b<n>/c<vblex>$", "tags 2", ""])
+
+    def test_last_form_kept(self):
+        self.assertEqual(
+            self.discard(["<n>"], ["a<n><sg>", "b<n><pl>"]),
+            ["^w/b<n><pl>$", "tags 1", ""])
+
+    def test_rule_order(self):
+        self.assertEqual(
+            self.discard(["<vblex>", "<n>"], ["a<n>", "b<vblex>"]),
+            ["^w/a<n>$", "tags 0", ""])
+        self.assertEqual(
+            self.discard(["<n>", "<vblex>"], ["a<n>", "b<vblex>"]),
+            ["^w/b<vblex>$", "tags 1", ""])
+        self.assertEqual(
+            self.discard(["<sg>", "<n>"], ["a<n><sg>", "b<n><pl>", "c<vblex>"]),
+            ["^w/b<n><pl>/c<vblex>$", "tags 2", ""])
+
+    def test_tags_kept_when_length_matches(self):
+        # the tags are only replaced when their number differs from the
+        # length of the rule
+        self.assertEqual(
+            self.discard(["<n>"], ["a<adj>", "b<adj>", "c<adj>", "d<n>"]),
+            ["^w/a<adj>/b<adj>/c<adj>$", "tags 0 1 2 3", ""])
@@ -0,0 +1,53 @@
+#include "apertium/tag_pattern_set.h"
+#include "apertium/tagger_word.h"
+#include "apertium/utf_converter.h"
+#include <lttoolbox/lt_locale.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Apply the discard rules to a word with the given lexical forms, the
+ * n-th of them having the tag n, and print the lexical forms and the
+ * tags left.
+ */
+int main(int argc, char *argv[])
+{
+  LtLocale::tryToSetLocale();
+
+  int arg = 1;
+  vector<wstring> rules;
+  for (; arg < argc && strcmp(argv[arg], "--") != 0; arg++) {
+    rules.push_back(UtfConverter::fromUtf8(argv[arg]));
+  }
+  if (arg == argc) {
+    cerr << "Usage: " << argv[0] << " rule... -- lexical_form...\n";
+    exit(-1);
+  }
+
+  TagPatternSet discard, prefer;
+  discard.compile(rules);
+
+  TaggerWord word;
+  word.set_superficial_form(L"w");
+  for (TTag tag = 0; ++arg < argc; tag++) {
+    word.add_tag(tag, UtfConverter::fromUtf8(argv[arg]), prefer);
+  }
+
+  word.discardOnAmbiguity(discard);
+
+  word.outputOriginal(stdout);
+  wcout << L"tags";
+  set<TTag> &tags = word.get_tags();
+  for (set<TTag>::iterator it = tags.begin(); it != tags.end(); it++) {
+    wcout << L" " << *it;
+  }
+  wcout << L"\n";
+  return 0;
+}
@@ -0,0 +1,45 @@
+#include "apertium/tagger_data_hmm.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+void print_matrix(const char *name, double **matrix, int rows, int cols)
+{
+  for (int i = 0; i < rows; i++) {
+    printf("%s %d", name, i);
+    for (int j = 0; j < cols; j++) {
+      printf(" %.17g", matrix[i][j]);
+    }
+    printf("\n");
+  }
+}
+
+/**
+ * Print the size and the transition (a) and emission (b) matrices of an
+ * HMM model, one row per line, so that models can be compared.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <probfile>\n";
+    exit(-1);
+  }
+  char *probfile = argv[1];
+  FILE *fin = fopen(probfile, "rb");
+  if (!fin) {
+    cerr << "Error: cannot open file '" << probfile << "'\n";
+    exit(-2);
+  }
+  TaggerDataHMM tagger_data_hmm;
+  tagger_data_hmm.read(fin);
+  fclose(fin);
+
+  int const N = tagger_data_hmm.getN();
+  int const M = tagger_data_hmm.getM();
+  printf("N %d M %d\n", N, M);
+  print_matrix("a", tagger_data_hmm.getA(), N, N);
+  print_matrix("b", tagger_data_hmm.getB(), N, M);
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include "apertium/basic_tagger.h"
+#include "apertium/stream.h"
+#include "apertium/streamed_type.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <locale>
+#include <string>
+#include <vector>
+
+using namespace Apertium;
+using namespace std;
+
+void print_token(const StreamedType &token)
+{
+  wcout << L"string \"" << token.TheString << L"\"";
+  if (token.TheLexicalUnit) {
+    const LexicalUnit &lu = *token.TheLexicalUnit;
+    wcout << L" lu \"" << lu.TheSurfaceForm << L"\"";
+    for (size_t i = 0; i < lu.TheAnalyses.size(); i++) {
+      wcout << L" /";
+      const vector<Morpheme> &morphemes = lu.TheAnalyses[i].TheMorphemes;
+      for (size_t j = 0; j < morphemes.size(); j++) {
+        if (j > 0) {
+          wcout << L"+";
+        }
+        wcout << morphemes[j].TheLemma;
+        for (size_t k = 0; k < morphemes[j].TheTags.size(); k++) {
+          wcout << L"<" << morphemes[j].TheTags[k].TheTag << L">";
+        }
+      }
+    }
+  }
+  wcout << L"\n";
+}
+
+/**
+ * Print every token of the file, one per line.  With -p, print what
+ * peekIsBlank() and peek() said before each of them; with -z, read in
+ * null-flush mode and print the next character left in the file after
+ * each flush.
+ */
+int main(int argc, char *argv[])
+{
+  locale::global(locale(""));
+
+  basic_Tagger::Flags flags;
+  bool peeking = false;
+  int arg = 1;
+  for (; arg < argc - 1; arg++) {
+    if (strcmp(argv[arg], "-z") == 0) {
+      flags.setNullFlush(true);
+    } else if (strcmp(argv[arg], "-p") == 0) {
+      peeking = true;
+    } else {
+      break;
+    }
+  }
+  if (arg != argc - 1) {
+    cerr << "Usage: " << argv[0] << " [-z] [-p] <file>\n";
+    exit(-1);
+  }
+
+  wifstream input(argv[arg]);
+  if (!input) {
+    cerr << "Error: cannot open file '" << argv[arg] << "'\n";
+    exit(-2);
+  }
+  Stream stream(flags, input, argv[arg]);
+
+  while (true) {
+    if (peeking) {
+      wcout << L"blank " << stream.peekIsBlank() << L"\n";
+      wcout << L"peek ";
+      print_token(stream.peek());
+    }
+    StreamedType token = stream.get();
+    wcout << L"get ";
+    print_token(token);
+    if (stream.flush_()) {
+      wcout << L"flush next " << (long)input.peek() << L"\n";
+    } else if (!token.TheLexicalUnit) {
+      break;
+    }
+  }
+  return 0;
+}
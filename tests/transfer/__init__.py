@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import unittest
+
+from os.path import join as pjoin
+from subprocess import Popen, PIPE, call
+from tempfile import mkdtemp
+from shutil import rmtree
+
+
+class PipelineTest(unittest.TestCase):
+    """apertium-transfer with -I and -P should give the same output as
+piping it through apertium-interchunk and apertium-postchunk."""
+
+    t1xdata = "data/pipeline.t1x"
+    t2xdata = "data/pipeline.t2x"
+    t3xdata = "data/pipeline.t3x"
+    inputs = ["^the<det><def><sp>$ ^dog<n><sg>$ ^cat<n><pl>$^.<sent>$",
+              "^cat<n><sg>$ ^a<det><ind><sg>$ ^dog<n><sg>$^.<sent>$",
+              "^the<det><def><sp>$ ^cat<n><pl>$[ <b>]^dog<n><pl>$ ^here<adv>$^.<sent>$",
+              "^dog<n><sg>$^.<sent>$"]
+
+    def setUp(self):
+        self.tmpd = mkdtemp()
+        self.bins = {}
+        for rules in [self.t1xdata, self.t2xdata, self.t3xdata]:
+            self.bins[rules] = pjoin(self.tmpd, rules.split("/")[-1] + ".bin")
+            self.assertEqual(call(["../apertium/apertium-preprocess-transfer",
+                                   rules, self.bins[rules]]),
+                             0)
+
+    def tearDown(self):
+        rmtree(self.tmpd)
+
+    def runCmd(self, cmd, inp):
+        proc = Popen(cmd, stdin=PIPE, stdout=PIPE, stderr=PIPE)
+        out, err = proc.communicate(inp)
+        self.assertEqual(proc.returncode, 0, err)
+        return out
+
+    def stage(self, rules):
+        return rules + "," + self.bins[rules]
+
+    def threeProcesses(self, flags, inp, interchunk, postchunk):
+        out = self.runCmd(["../apertium/apertium-transfer", "-n"] + flags +
+                          [self.t1xdata, self.bins[self.t1xdata]], inp)
+        if interchunk:
+            out = self.runCmd(["../apertium/apertium-interchunk"] + flags +
+                              [self.t2xdata, self.bins[self.t2xdata]], out)
+        if postchunk:
+            out = self.runCmd(["../apertium/apertium-postchunk"] + flags +
+                              [self.t3xdata, self.bins[self.t3xdata]], out)
+        return out
+
+    def oneProcess(self, flags, inp, interchunk, postchunk):
+        stages = []
+        if interchunk:
+            stages += ["-I", self.stage(self.t2xdata)]
+        if postchunk:
+            stages += ["-P", self.stage(self.t3xdata)]
+        return self.runCmd(["../apertium/apertium-transfer", "-n"] + flags +
+                           stages + [self.t1xdata, self.bins[self.t1xdata]],
+                           inp)
+
+    def compare(self, flags, inp, interchunk=True, postchunk=True):
+        # each program may flush an empty segment at the end of the input,
+        # so only the segments that carry text are compared
+        expected = self.threeProcesses(flags, inp, interchunk, postchunk)
+        self.assertNotEqual(expected.strip(b"\0\n"), b"")
+        self.assertEqual(self.oneProcess(flags, inp, interchunk, postchunk).rstrip(b"\0"),
+                         expected.rstrip(b"\0"))
+
+    def test_all_stages(self):
+        inp = "[][\n]".join(self.inputs) + "[][\n]"
+        self.compare([], inp.encode('utf-8'))
+
+    def test_blanks(self):
+        # interchunk hands its blanks to postchunk as tokens, which should
+        # come out as they would from reading the text: words with no blank
+        # between them, superblanks holding '^' and '$', text before the
+        # first word and no blank after the last one
+        inp = ("text [<a href=\"^x$\">]^the<det><def><sp>$^dog<n><sg>$"
+               "[\\^]^cat<n><pl>$\\$[]^here<adv>$^.<sent>$")
+        self.compare([], inp.encode('utf-8'))
+
+    def test_interchunk_only(self):
+        inp = "[][\n]".join(self.inputs) + "[][\n]"
+        self.compare([], inp.encode('utf-8'), postchunk=False)
+
+    def test_postchunk_only(self):
+        inp = "[][\n]".join(self.inputs) + "[][\n]"
+        self.compare([], inp.encode('utf-8'), interchunk=False)
+
+    def test_null_flush(self):
+        inp = "".join(i + "[][\n]\0" for i in self.inputs)
+        self.compare(["-z"], inp.encode('utf-8'))
+
+    def test_with_threads(self):
+        proc = Popen(["../apertium/apertium-transfer", "-n", "-j", "2",
+                      "-I", self.stage(self.t2xdata),
+                      self.t1xdata, self.bins[self.t1xdata]],
+                     stdin=PIPE, stdout=PIPE, stderr=PIPE)
+        proc.communicate(b"")
+        self.assertNotEqual(proc.returncode, 0)
+
+
+class ThreadsTest(unittest.TestCase):
+    """apertium-transfer -j should give the same output as a single thread
+when no variable is carried from a sentence to the next."""
+
+    t1xdata = "data/pipeline.t1x"
+    sentences = ["^the<det><def><sp>$ ^dog<n><sg>$ ^cat<n><pl>$^.<sent>$",
+                 "^Cat<n><sg>$ ^a<det><ind><sg>$ ^dog<n><sg>$^.<sent>$",
+                 "^the<det><def><sp>$[ <b>]^cat<n><pl>$ ^here<adv>$^?<sent>$",
+                 "^dog<n><sg>$ ^and<cnjcoo>$ ^dog<n><pl>$^.<sent>$"]
+
+    def setUp(self):
+        self.tmpd = mkdtemp()
+        self.bindata = pjoin(self.tmpd, "pipeline.t1x.bin")
+        self.assertEqual(call(["../apertium/apertium-preprocess-transfer",
+                               self.t1xdata, self.bindata]),
+                         0)
+
+    def tearDown(self):
+        rmtree(self.tmpd)
+
+    def runTransfer(self, flags, inp):
+        proc = Popen(["../apertium/apertium-transfer", "-n"] + flags +
+                     [self.t1xdata, self.bindata],
+                     stdin=PIPE, stdout=PIPE, stderr=PIPE)
+        out, err = proc.communicate(inp)
+        self.assertEqual(proc.returncode, 0, err)
+        return out
+
+    def compare(self, flags, inp):
+        # as in PipelineTest, a trailing empty segment is not compared
+        serial = self.runTransfer(flags + ["-j", "1"], inp)
+        self.assertNotEqual(serial.strip(b"\0\n"), b"")
+        self.assertEqual(self.runTransfer(flags + ["-j", "4"], inp).rstrip(b"\0"),
+                         serial.rstrip(b"\0"))
+
+    def test_many_pieces(self):
+        # enough text for every thread to get several pieces
+        inp = "".join(self.sentences[i % len(self.sentences)] + "[][\n]"
+                      for i in range(4000))
+        self.compare([], inp.encode('utf-8'))
+
+    def test_null_flush(self):
+        inp = "".join("".join(self.sentences) * (i % 50 + 1) + "[][\n]\0"
+                      for i in range(20))
+        self.compare(["-z"], inp.encode('utf-8'))
+
+
+class OptionsTest(unittest.TestCase):
+    """apertium-transfer should reject numbers that don't fit its options
+rather than wrapping them."""
+
+    t1xdata = "data/pipeline.t1x"
+
+    def setUp(self):
+        self.tmpd = mkdtemp()
+        self.bindata = pjoin(self.tmpd, "pipeline.t1x.bin")
+        self.assertEqual(call(["../apertium/apertium-preprocess-transfer",
+                               self.t1xdata, self.bindata]),
+                         0)
+
+    def tearDown(self):
+        rmtree(self.tmpd)
+
+    def returncode(self, flags):
+        proc = Popen(["../apertium/apertium-transfer", "-n"] + flags +
+                     [self.t1xdata, self.bindata],
+                     stdin=PIPE, stdout=PIPE, stderr=PIPE)
+        proc.communicate(b"")
+        return proc.returncode
+
+    def test_cache_size(self):
+        self.assertEqual(self.returncode(["-C", "0"]), 0)
+        self.assertEqual(self.returncode(["-C", "4294967295"]), 0)
+        for value in ["-1", "4294967296", "99999999999999999999", "2x"]:
+            self.assertNotEqual(self.returncode(["-C", value]), 0, value)
+
+    def test_threads(self):
+        self.assertEqual(self.returncode(["-j", "256"]), 0)
+        for value in ["0", "257", "1000000", "-1"]:
+            self.assertNotEqual(self.returncode(["-j", value]), 0, value)